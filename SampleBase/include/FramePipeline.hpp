@@ -0,0 +1,278 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BasicTypes.h"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+/// Overlaps the simulation of the next frames with the recording and submission of the current one.
+
+/// A dedicated thread simulates frames into a ring of Depth state slots and hands them over to the render
+/// thread through a single-producer/single-consumer queue. The render thread takes the oldest simulated frame
+/// with AcquireFrame(), records and submits it, and gives the slot back with ReleaseFrame(). A thread that has
+/// to wait for the other one blocks on a condition variable rather than spinning.
+/// With Depth = 1, simulation and rendering run in lockstep; with Depth = 2, frame N+1 is simulated while
+/// frame N is rendered, and every extra slot lets the simulation run one more frame ahead.
+/// A slot is only accessed by the thread that currently owns it, so the state itself needs no locks.
+///
+/// The pipeline also measures the latency (from the start of the simulation of a frame to its release)
+/// and the throughput, so that the depth can be chosen for the workload at hand.
+template <typename StateType>
+class FramePipeline
+{
+public:
+    /// Writes the state of frame FrameId into State. ElapsedTime is the time in seconds since the simulation
+    /// of the previous frame started. State holds whatever was written to the slot Depth frames earlier.
+    using SimulateFunc = std::function<void(StateType& State, Uint64 FrameId, double ElapsedTime)>;
+
+    struct Stats
+    {
+        double LatencyMs       = 0; ///< Average time from the start of the simulation of a frame to its release
+        double FramesPerSecond = 0; ///< Released frames per second
+        double SimulationMs    = 0; ///< Average time spent simulating a frame
+        double ProducerWaitMs  = 0; ///< Average time the simulation thread waited for a free slot per frame
+        double ConsumerWaitMs  = 0; ///< Average time the render thread waited for a simulated frame per frame
+    };
+
+    FramePipeline() = default;
+
+    // clang-format off
+    FramePipeline           (const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+    // clang-format on
+
+    ~FramePipeline()
+    {
+        Stop();
+    }
+
+    /// Starts the simulation thread. The previous frames, if any, are discarded.
+    void Start(Uint32 Depth, SimulateFunc Simulate)
+    {
+        VERIFY_EXPR(Depth > 0 && Simulate);
+        Stop();
+
+        m_Slots.resize(Depth);
+        m_Simulate = std::move(Simulate);
+        m_Produced.store(0);
+        m_Consumed.store(0);
+        m_Acquired = false;
+        m_Stop.store(false);
+
+        m_Window      = {};
+        m_WindowStart = Clock::now();
+        m_Stats       = {};
+
+        m_Thread = std::thread{&FramePipeline::SimulationThreadFunc, this};
+    }
+
+    /// Stops the simulation thread. Must not be called between AcquireFrame() and ReleaseFrame().
+    void Stop()
+    {
+        if (!m_Thread.joinable())
+            return;
+
+        VERIFY(!m_Acquired, "The frame must be released before the pipeline is stopped");
+        m_Stop.store(true);
+        Notify(m_SlotReleased);
+        m_Thread.join();
+    }
+
+    bool IsRunning() const { return m_Thread.joinable(); }
+
+    Uint32 GetDepth() const { return static_cast<Uint32>(m_Slots.size()); }
+
+    /// Waits for the oldest simulated frame that has not been rendered yet and returns its state.
+    /// The state stays valid and unchanged until ReleaseFrame().
+    const StateType& AcquireFrame()
+    {
+        VERIFY(IsRunning(), "The pipeline is not running");
+        VERIFY(!m_Acquired, "The previous frame has not been released");
+
+        const auto   WaitStart = Clock::now();
+        const Uint64 FrameId   = m_Consumed.load(std::memory_order_relaxed);
+        if (m_Produced.load(std::memory_order_acquire) == FrameId)
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_FramePublished.wait(Lock, [&]() {
+                return m_Produced.load(std::memory_order_acquire) != FrameId;
+            });
+        }
+        m_Window.ConsumerWait += Clock::now() - WaitStart;
+
+        m_Acquired = true;
+        return m_Slots[FrameId % m_Slots.size()].State;
+    }
+
+    Uint64 GetAcquiredFrameId() const { return m_Consumed.load(std::memory_order_relaxed); }
+
+    /// Returns the slot of the acquired frame to the simulation thread.
+    void ReleaseFrame()
+    {
+        VERIFY(m_Acquired, "No frame has been acquired");
+
+        const Uint64 FrameId = m_Consumed.load(std::memory_order_relaxed);
+        const Slot&  S       = m_Slots[FrameId % m_Slots.size()];
+
+        const auto Now = Clock::now();
+        m_Window.Latency      += Now - S.SimulationStart;
+        m_Window.Simulation   += S.SimulationTime;
+        m_Window.ProducerWait += S.ProducerWait;
+        ++m_Window.NumFrames;
+
+        m_Acquired = false;
+        m_Consumed.store(FrameId + 1, std::memory_order_release);
+        Notify(m_SlotReleased);
+
+        const auto WindowTime = Now - m_WindowStart;
+        if (WindowTime >= std::chrono::milliseconds{500})
+        {
+            const double NumFrames  = static_cast<double>(m_Window.NumFrames);
+            m_Stats.LatencyMs       = ToMs(m_Window.Latency) / NumFrames;
+            m_Stats.FramesPerSecond = NumFrames / (ToMs(WindowTime) * 1e-3);
+            m_Stats.SimulationMs    = ToMs(m_Window.Simulation) / NumFrames;
+            m_Stats.ProducerWaitMs  = ToMs(m_Window.ProducerWait) / NumFrames;
+            m_Stats.ConsumerWaitMs  = ToMs(m_Window.ConsumerWait) / NumFrames;
+
+            m_Window      = {};
+            m_WindowStart = Now;
+        }
+    }
+
+    /// Statistics of the last complete measurement window (half a second)
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    using Clock    = std::chrono::high_resolution_clock;
+    using Duration = Clock::duration;
+
+    static double ToMs(Duration D)
+    {
+        return std::chrono::duration<double, std::milli>{D}.count();
+    }
+
+    // The counter or the flag the other thread waits for must be stored before the call. Locking the mutex
+    // in between guarantees that the waiting thread either sees the new value when it checks the predicate
+    // or is already blocked in wait() and receives the notification.
+    void Notify(std::condition_variable& CV)
+    {
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+        }
+        CV.notify_one();
+    }
+
+    void SimulationThreadFunc()
+    {
+        const Uint64 Depth = m_Slots.size();
+
+        Clock::time_point PrevStart;
+        for (Uint64 FrameId = 0;; ++FrameId)
+        {
+            // Wait until the render thread has released the slot
+            const auto WaitStart = Clock::now();
+            if (FrameId - m_Consumed.load(std::memory_order_acquire) >= Depth)
+            {
+                std::unique_lock<std::mutex> Lock{m_Mtx};
+                m_SlotReleased.wait(Lock, [&]() {
+                    return m_Stop.load(std::memory_order_relaxed) || FrameId - m_Consumed.load(std::memory_order_acquire) < Depth;
+                });
+            }
+            if (m_Stop.load(std::memory_order_relaxed))
+                return;
+
+            Slot& S = m_Slots[FrameId % Depth];
+
+            S.SimulationStart = Clock::now();
+            S.ProducerWait    = S.SimulationStart - WaitStart;
+
+            const double ElapsedTime = FrameId > 0 ? std::chrono::duration<double>{S.SimulationStart - PrevStart}.count() : 0.0;
+            PrevStart                = S.SimulationStart;
+
+            m_Simulate(S.State, FrameId, ElapsedTime);
+            S.SimulationTime = Clock::now() - S.SimulationStart;
+
+            // Publish the frame
+            m_Produced.store(FrameId + 1, std::memory_order_release);
+            Notify(m_FramePublished);
+        }
+    }
+
+    struct Slot
+    {
+        StateType State{};
+
+        // Written by the simulation thread together with the state
+        Clock::time_point SimulationStart;
+        Duration          SimulationTime{};
+        Duration          ProducerWait{};
+    };
+    std::vector<Slot> m_Slots;
+
+    SimulateFunc m_Simulate;
+    std::thread  m_Thread;
+
+    // Number of frames published by the simulation thread and released by the render thread.
+    // Each counter is only written by one thread.
+    alignas(64) std::atomic<Uint64> m_Produced{0};
+    alignas(64) std::atomic<Uint64> m_Consumed{0};
+    std::atomic<bool> m_Stop{false};
+
+    // Only used to block the thread that has to wait for the other one; the counters are read without it
+    std::mutex              m_Mtx;
+    std::condition_variable m_FramePublished; // Notified by the simulation thread
+    std::condition_variable m_SlotReleased;   // Notified by the render thread and by Stop()
+
+    // Render thread only
+    bool m_Acquired = false;
+
+    struct Window
+    {
+        Duration Latency{};
+        Duration Simulation{};
+        Duration ProducerWait{};
+        Duration ConsumerWait{};
+        Uint32   NumFrames = 0;
+    };
+    Window            m_Window;
+    Clock::time_point m_WindowStart;
+    Stats             m_Stats;
+};
+
+} // namespace Diligent
@@ -0,0 +1,128 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Linear allocator for small GPU data that is rewritten every frame, such as per-draw constants.
+
+/// The allocator owns a single dynamic buffer. Every context that records commands maps the buffer once
+/// with MAP_FLAG_DISCARD, bump-allocates the data of all its draws, unmaps the buffer and then selects the
+/// data of every draw by offset: with IShaderResourceVariable::SetBufferOffset() for constant buffers, or
+/// with the offset passed to SetVertexBuffers() for per-instance data.
+/// The engine backs every mapping of a dynamic buffer with a region of the mapping context's dynamic heap
+/// that is only reused after the GPU has finished the frame, so every context gets its own region for every
+/// frame in flight and the allocator never waits for the GPU.
+///
+/// Begin(), Allocate() and End() may be called from different threads as long as every thread uses its
+/// own context slot.
+class FrameRingAllocator
+{
+public:
+    struct Allocation
+    {
+        void*  pData  = nullptr;
+        Uint32 Offset = 0;
+
+        explicit operator bool() const { return pData != nullptr; }
+    };
+
+    FrameRingAllocator() = default;
+
+    // clang-format off
+    FrameRingAllocator           (const FrameRingAllocator&) = delete;
+    FrameRingAllocator& operator=(const FrameRingAllocator&) = delete;
+    // clang-format on
+
+    /// Offset alignment required by the buffers with the given bind flags
+    static Uint32 GetOffsetAlignment(IRenderDevice* pDevice, BIND_FLAGS BindFlags);
+
+    /// Creates the buffer. Size is the number of bytes that one context can allocate between Begin() and End(),
+    /// NumContextSlots is the number of contexts that may record at the same time.
+    void Create(IRenderDevice* pDevice, const char* Name, BIND_FLAGS BindFlags, Uint64 Size, Uint32 NumContextSlots);
+
+    /// Sets up the allocation state without a buffer, for memory that is mapped by the caller and passed
+    /// to BeginMapped(). Create() calls this method. Alignment must be a power of two.
+    void Initialize(Uint64 Size, Uint32 Alignment, Uint32 NumContextSlots);
+
+    /// Maps the buffer in pContext and resets the slot's allocation pointer.
+    bool Begin(IDeviceContext* pContext, Uint32 ContextSlot);
+
+    /// Same as Begin(), but allocates from pMappedData, which must point to at least GetSize() bytes.
+    bool BeginMapped(Uint32 ContextSlot, void* pMappedData);
+
+    /// Allocates Size bytes aligned to GetAlignment(). Returns an empty allocation if the slot is out of space.
+    Allocation Allocate(Uint32 ContextSlot, Uint32 Size);
+
+    template <typename T>
+    T* Allocate(Uint32 ContextSlot, Uint32& Offset)
+    {
+        Allocation Alloc = Allocate(ContextSlot, static_cast<Uint32>(sizeof(T)));
+        Offset           = Alloc.Offset;
+        return static_cast<T*>(Alloc.pData);
+    }
+
+    /// Unmaps the buffer. The allocations may only be used by the draw commands recorded after this call.
+    void End(IDeviceContext* pContext, Uint32 ContextSlot);
+
+    /// Counterpart of BeginMapped(). Returns false if the slot was not mapped.
+    bool EndMapped(Uint32 ContextSlot);
+
+    IBuffer* GetBuffer() const { return m_pBuffer; }
+
+    /// Offset alignment required by the bind flags of the buffer
+    Uint32 GetAlignment() const { return m_Alignment; }
+
+    Uint64 GetSize() const { return m_Size; }
+
+    /// Number of bytes allocated by the slot since the last Begin()
+    Uint64 GetUsedSize(Uint32 ContextSlot) const { return m_Slots[ContextSlot].Offset; }
+
+private:
+    struct Slot
+    {
+        Uint8* pData  = nullptr;
+        Uint64 Offset = 0;
+    };
+    std::vector<Slot> m_Slots;
+
+    RefCntAutoPtr<IBuffer> m_pBuffer;
+
+    Uint64 m_Size      = 0;
+    Uint32 m_Alignment = 16;
+};
+
+} // namespace Diligent
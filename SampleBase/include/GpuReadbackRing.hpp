@@ -0,0 +1,184 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Fence.h"
+#include "RefCntAutoPtr.hpp"
+#include "MapHelper.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+/// Non-blocking GPU-to-CPU readback of a small structure (e.g. a set of counters).
+
+/// Every frame, Enqueue() copies sizeof(T) bytes from a GPU buffer into the next free staging slot and
+/// signals a fence. Poll() reads the newest slot the GPU has completed and never waits: if no new slot
+/// is ready, the previous value is kept, and if all slots are still in flight, the frame is dropped.
+/// All counters that live in T share the same copy.
+template <typename T>
+class GpuReadbackRing
+{
+public:
+    GpuReadbackRing() = default;
+
+    // clang-format off
+    GpuReadbackRing           (const GpuReadbackRing&) = delete;
+    GpuReadbackRing& operator=(const GpuReadbackRing&) = delete;
+    // clang-format on
+
+    void Create(IRenderDevice* pDevice, const char* Name, Uint32 RingSize = 8)
+    {
+        VERIFY_EXPR(pDevice != nullptr && RingSize > 0);
+
+        m_Slots.clear();
+        m_Slots.resize(RingSize);
+        for (Slot& S : m_Slots)
+        {
+            BufferDesc BuffDesc;
+            BuffDesc.Name           = Name;
+            BuffDesc.Usage          = USAGE_STAGING;
+            BuffDesc.BindFlags      = BIND_NONE;
+            BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+            BuffDesc.Size           = sizeof(T);
+
+            pDevice->CreateBuffer(BuffDesc, nullptr, &S.pStaging);
+            VERIFY_EXPR(S.pStaging != nullptr);
+        }
+
+        FenceDesc FDesc;
+        FDesc.Name = Name;
+        m_pFence.Release();
+        pDevice->CreateFence(FDesc, &m_pFence);
+        VERIFY_EXPR(m_pFence != nullptr);
+
+        m_NextFrameId   = 1; // Can't signal 0
+        m_LatestFrameId = 0;
+        m_Latency       = 0;
+        m_DroppedFrames = 0;
+        m_Latest        = {};
+    }
+
+    /// Copies the structure at SrcOffset of pSrcBuffer into the next staging slot.
+    /// Returns false if all slots are still in flight and the frame was dropped.
+    bool Enqueue(IDeviceContext* pContext, IBuffer* pSrcBuffer, Uint64 SrcOffset = 0)
+    {
+        VERIFY_EXPR(pContext != nullptr && pSrcBuffer != nullptr);
+
+        Slot& S = m_Slots[m_NextFrameId % m_Slots.size()];
+        if (S.FrameId != 0)
+        {
+            // The slot has not been read yet. Take it back only if the GPU is done with it.
+            if (S.FrameId > m_pFence->GetCompletedValue())
+            {
+                ++m_DroppedFrames;
+                return false;
+            }
+        }
+
+        pContext->CopyBuffer(pSrcBuffer, SrcOffset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                             S.pStaging, 0, sizeof(T), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pContext->EnqueueSignal(m_pFence, m_NextFrameId);
+
+        S.FrameId = m_NextFrameId++;
+        return true;
+    }
+
+    /// Reads the newest completed slot, if any. Never waits for the GPU.
+    /// Returns true if a new value is available.
+    bool Poll(IDeviceContext* pContext)
+    {
+        const Uint64 CompletedFrameId = m_pFence->GetCompletedValue();
+
+        Slot* pNewest = nullptr;
+        for (Slot& S : m_Slots)
+        {
+            if (S.FrameId != 0 && S.FrameId <= CompletedFrameId && S.FrameId > m_LatestFrameId)
+            {
+                if (pNewest == nullptr || S.FrameId > pNewest->FrameId)
+                    pNewest = &S;
+            }
+        }
+        if (pNewest == nullptr)
+            return false;
+
+        {
+            MapHelper<T> StagingData{pContext, pNewest->pStaging, MAP_READ, MAP_FLAG_DO_NOT_WAIT};
+            if (!StagingData)
+                return false;
+            m_Latest = StagingData[0];
+        }
+
+        m_LatestFrameId = pNewest->FrameId;
+        m_Latency       = static_cast<Uint32>(m_NextFrameId - 1 - m_LatestFrameId);
+
+        // Older completed slots will never be read and can be reused
+        for (Slot& S : m_Slots)
+        {
+            if (S.FrameId != 0 && S.FrameId <= m_LatestFrameId)
+                S.FrameId = 0;
+        }
+        return true;
+    }
+
+    /// Value of the newest completed frame
+    const T& GetLatest() const { return m_Latest; }
+
+    bool HasData() const { return m_LatestFrameId != 0; }
+
+    /// Number of frames enqueued after the frame whose value is returned by GetLatest()
+    Uint32 GetLatency() const { return m_Latency; }
+
+    /// Number of frames that were skipped because all slots were in flight
+    Uint64 GetDroppedFrameCount() const { return m_DroppedFrames; }
+
+private:
+    struct Slot
+    {
+        RefCntAutoPtr<IBuffer> pStaging;
+
+        // Frame whose data the slot holds, or 0 if the slot is free
+        Uint64 FrameId = 0;
+    };
+    std::vector<Slot> m_Slots;
+
+    RefCntAutoPtr<IFence> m_pFence;
+
+    Uint64 m_NextFrameId   = 1;
+    Uint64 m_LatestFrameId = 0;
+    Uint32 m_Latency       = 0;
+    Uint64 m_DroppedFrames = 0;
+    T      m_Latest        = {};
+};
+
+} // namespace Diligent
@@ -0,0 +1,146 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Work-stealing job system.
+
+/// Every thread owns a job queue. A thread pushes and pops its own jobs at the back of its queue and,
+/// when the queue is empty, steals from the front of the other queues, so a thread that got stuck on a
+/// slow job or was preempted by the OS does not hold back the rest of the work.
+/// Thread 0 is the thread that drives the job system (normally the main thread): it executes jobs while
+/// it waits for a job group, so a job system with N threads creates N - 1 worker threads.
+class JobSystem
+{
+public:
+    /// ThreadIdx is the index of the thread that executes the job, in [0, GetThreadCount()).
+    using JobFunc = std::function<void(Uint32 ThreadIdx)>;
+
+    /// Executes the items [Begin, End) of a parallel loop.
+    using RangeFunc = std::function<void(Uint32 ThreadIdx, Uint32 Begin, Uint32 End)>;
+
+    struct ThreadStats
+    {
+        double BusyTimeMs    = 0; ///< Time spent executing jobs
+        Uint32 NumJobs       = 0; ///< Jobs executed by the thread
+        Uint32 NumStolenJobs = 0; ///< Jobs taken from the queues of other threads
+    };
+
+    /// Tracks the number of unfinished jobs submitted to it.
+    class JobGroup
+    {
+    public:
+        JobGroup() = default;
+
+        // clang-format off
+        JobGroup           (const JobGroup&) = delete;
+        JobGroup& operator=(const JobGroup&) = delete;
+        // clang-format on
+
+        bool IsDone() const { return m_NumPendingJobs.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<Uint32> m_NumPendingJobs{0};
+    };
+
+    /// NumThreads = 0 => one thread per hardware thread.
+    explicit JobSystem(Uint32 NumThreads = 0);
+    ~JobSystem();
+
+    // clang-format off
+    JobSystem           (const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    // clang-format on
+
+    Uint32 GetThreadCount() const { return static_cast<Uint32>(m_Queues.size()); }
+
+    /// Adds a job to the queue of the calling thread. Jobs may submit other jobs.
+    void Submit(JobGroup& Group, JobFunc Func);
+
+    /// Executes jobs on the calling thread until all jobs of the group have completed.
+    /// Can be called from inside a job.
+    void Wait(JobGroup& Group);
+
+    /// Splits [0, Count) into jobs of at most Granularity items, runs them and waits for completion.
+    void ParallelFor(Uint32 Count, Uint32 Granularity, const RangeFunc& Func);
+
+    /// Statistics since the last call to ResetStats().
+    ThreadStats GetThreadStats(Uint32 ThreadIdx) const;
+    void        ResetStats();
+
+private:
+    struct Job
+    {
+        JobFunc   Func;
+        JobGroup* pGroup = nullptr;
+    };
+
+    struct alignas(64) ThreadQueue
+    {
+        std::mutex      Mtx;
+        std::deque<Job> Jobs;
+
+        // Only written by the owning thread
+        std::atomic<Uint64> BusyTimeNs{0};
+        std::atomic<Uint32> NumJobs{0};
+        std::atomic<Uint32> NumStolenJobs{0};
+    };
+
+    Uint32 GetCurrentThreadIdx() const;
+    void   Push(Uint32 ThreadIdx, Job&& NewJob);
+    bool   TryPop(Uint32 ThreadIdx, Job& OutJob);
+    bool   TrySteal(Uint32 ThreadIdx, Job& OutJob);
+    bool   TryExecuteJob(Uint32 ThreadIdx);
+    void   WakeWorkers(Uint32 NumJobs);
+    void   WorkerThreadFunc(Uint32 ThreadIdx);
+
+    std::vector<std::unique_ptr<ThreadQueue>> m_Queues;
+    std::vector<std::thread>                  m_Workers;
+
+    // Total number of jobs in all queues, used to put idle workers to sleep
+    std::atomic<Uint32>     m_NumQueuedJobs{0};
+    std::mutex              m_SleepMtx;
+    std::condition_variable m_WakeCondVar;
+    bool                    m_Quit = false;
+};
+
+} // namespace Diligent
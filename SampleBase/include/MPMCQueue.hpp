@@ -0,0 +1,144 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "BasicTypes.h"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+/// Bounded lock-free multi-producer multi-consumer queue.
+
+/// Every cell stores a sequence number that tells producers and consumers whose turn it is to use the cell,
+/// so TryPush() and TryPop() only contend on one atomic counter each and never block. The queue never allocates
+/// after construction; TryPush() fails when the queue is full and TryPop() fails when it is empty.
+/// T should be cheap to move, e.g. a pointer to the actual work item.
+template <typename T>
+class MPMCQueue
+{
+public:
+    /// Capacity is rounded up to a power of two.
+    explicit MPMCQueue(Uint32 Capacity)
+    {
+        Uint32 Size = 2;
+        while (Size < Capacity)
+            Size *= 2;
+
+        m_Mask  = Size - 1;
+        m_Cells = std::make_unique<Cell[]>(Size);
+        for (Uint32 i = 0; i < Size; ++i)
+            m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // clang-format off
+    MPMCQueue           (const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+    // clang-format on
+
+    Uint32 GetCapacity() const { return m_Mask + 1; }
+
+    bool TryPush(T Item)
+    {
+        Uint32 Pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell&        C    = m_Cells[Pos & m_Mask];
+            const Uint32 Seq  = C.Sequence.load(std::memory_order_acquire);
+            const Int32  Diff = static_cast<Int32>(Seq - Pos);
+            if (Diff == 0)
+            {
+                // The cell is free. Claim it unless another producer got there first.
+                if (m_EnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                {
+                    C.Item = std::move(Item);
+                    C.Sequence.store(Pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (Diff < 0)
+            {
+                // The cell still holds an item that was pushed one lap ago: the queue is full
+                return false;
+            }
+            else
+            {
+                Pos = m_EnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& Item)
+    {
+        Uint32 Pos = m_DequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell&        C    = m_Cells[Pos & m_Mask];
+            const Uint32 Seq  = C.Sequence.load(std::memory_order_acquire);
+            const Int32  Diff = static_cast<Int32>(Seq - (Pos + 1));
+            if (Diff == 0)
+            {
+                if (m_DequeuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                {
+                    Item = std::move(C.Item);
+                    // Hand the cell over to the producer of the next lap
+                    C.Sequence.store(Pos + m_Mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (Diff < 0)
+            {
+                // The producer has not written the cell yet: the queue is empty
+                return false;
+            }
+            else
+            {
+                Pos = m_DequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<Uint32> Sequence{0};
+        T                   Item{};
+    };
+
+    std::unique_ptr<Cell[]> m_Cells;
+    Uint32                  m_Mask = 0;
+
+    // Producers and consumers update different counters, keep them on separate cache lines
+    alignas(64) std::atomic<Uint32> m_EnqueuePos{0};
+    alignas(64) std::atomic<Uint32> m_DequeuePos{0};
+};
+
+} // namespace Diligent
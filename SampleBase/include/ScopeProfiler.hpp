@@ -0,0 +1,291 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+#include "RefCntAutoPtr.hpp"
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Named-scope GPU and CPU profiler and frame tracer.
+
+/// Every scope records the CPU time between Begin() and End() and, if it is given a context, a pair of
+/// timestamp queries. Scopes may be nested and may be recorded by any number of threads; every thread appends
+/// its scopes to its own preallocated buffer without locking. Query results are read back NumFramesInFlight
+/// frames later without waiting for the GPU; a scope whose queries are not ready yet is dropped.
+///
+/// Scopes with the same name are accumulated into the per-scope statistics shown by UpdateUI(). On request,
+/// the scopes of a number of frames are also captured and written in the Chrome trace event format, which
+/// can be opened in chrome://tracing or in the Perfetto UI (ui.perfetto.dev). CPU threads and GPU queues are
+/// shown as separate tracks. GPU timestamps are not calibrated against the CPU clock: every queue is shifted
+/// so that none of its scopes starts before the CPU recorded it.
+///
+/// All scopes of a frame must end before EndFrame() is called, and no scopes may be recorded while EndFrame()
+/// runs. Scope names must outlive the profiler, normally they are string literals.
+class ScopeProfiler
+{
+public:
+    struct ScopeStats
+    {
+        const char* Name = nullptr;
+
+        // Number of scopes the scope is nested in on its thread. If the scope is recorded at
+        // different depths, the smallest one.
+        Uint32 Depth = 0;
+
+        // Average over the last RollingWindowSize frames, in milliseconds
+        double AvgGpuTimeMs = 0;
+        double AvgCpuTimeMs = 0;
+
+        // Totals since the last call to ResetTotals()
+        double TotalGpuTimeMs = 0;
+        double TotalCpuTimeMs = 0;
+        Uint32 NumGpuSamples  = 0;
+        Uint32 NumCpuSamples  = 0;
+
+        // GPU timestamps of the first begin and the last end of the scope in the last frame that was
+        // read back with the GPU time of the scope, in seconds
+        double LastGpuBegin = 0;
+        double LastGpuEnd   = 0;
+
+        double GetTotalAvgGpuTimeMs() const { return NumGpuSamples > 0 ? TotalGpuTimeMs / NumGpuSamples : 0.0; }
+        double GetTotalAvgCpuTimeMs() const { return NumCpuSamples > 0 ? TotalCpuTimeMs / NumCpuSamples : 0.0; }
+    };
+
+    static constexpr Uint32 RollingWindowSize = 64;
+
+    ScopeProfiler();
+
+    // clang-format off
+    ScopeProfiler           (const ScopeProfiler&) = delete;
+    ScopeProfiler& operator=(const ScopeProfiler&) = delete;
+    // clang-format on
+
+    /// pDevice may be null to measure CPU times only. If the device does not support timestamp queries,
+    /// only CPU times are measured too. MaxScopesPerThread is the number of scopes that one thread can
+    /// record in a frame.
+    void Initialize(IRenderDevice* pDevice, Uint32 NumFramesInFlight = 4, Uint32 MaxScopesPerThread = 1024);
+
+    /// Names the trace track of the calling thread. Name must outlive the profiler.
+    void SetThreadName(const char* Name);
+
+    /// pContext may be null to measure CPU time only. End() must be given the same context and name as
+    /// the matching Begin().
+    void Begin(IDeviceContext* pContext, const char* Name);
+    void End(IDeviceContext* pContext, const char* Name);
+
+    /// Must be called once per frame after all scopes have ended.
+    void EndFrame();
+
+    void ResetTotals();
+
+    /// Draws the rolling breakdown into the current ImGui window.
+    void UpdateUI() const;
+
+    /// Draws the trace capture controls into the current ImGui window.
+    void UpdateCaptureUI(const char* FilePath);
+
+    Uint32            GetScopeCount() const { return static_cast<Uint32>(m_Scopes.size()); }
+    const ScopeStats& GetScope(Uint32 Idx) const { return m_Scopes[Idx].Stats; }
+    const ScopeStats* FindScope(const char* Name) const;
+
+    bool IsInitialized() const { return m_Initialized; }
+    bool IsGpuTimingSupported() const { return m_GpuTimingSupported; }
+
+    /// Number of frames between issuing the scopes and reading their results
+    Uint32 GetLatency() const { return m_NumFramesInFlight; }
+
+    /// Captures the scopes of the next NumFrames frames and writes them to FilePath when the queries
+    /// of the last frame are read back. May be called before Initialize(). Does nothing if a capture
+    /// is in progress.
+    void BeginCapture(Uint32 NumFrames, const char* FilePath);
+
+    /// True while frames are captured or the capture is not written yet
+    bool IsCapturing() const { return m_PendingFrames > 0 || m_CaptureFramesLeft > 0 || m_ResolveFramesLeft > 0; }
+
+    /// Result of the last capture, empty if there was none
+    const std::string& GetCaptureStatus() const { return m_CaptureStatus; }
+
+    /// RAII helper that measures the enclosing block
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(ScopeProfiler& Profiler, IDeviceContext* pContext, const char* Name) :
+            m_Profiler{Profiler},
+            m_pContext{pContext},
+            m_Name{Name}
+        {
+            m_Profiler.Begin(m_pContext, m_Name);
+        }
+
+        ~ScopedTimer()
+        {
+            m_Profiler.End(m_pContext, m_Name);
+        }
+
+        // clang-format off
+        ScopedTimer           (const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        // clang-format on
+
+    private:
+        ScopeProfiler&        m_Profiler;
+        IDeviceContext* const m_pContext;
+        const char* const     m_Name;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct QueryPair
+    {
+        RefCntAutoPtr<IQuery> pBegin;
+        RefCntAutoPtr<IQuery> pEnd;
+    };
+
+    struct ScopeEvent
+    {
+        const char* Name      = nullptr;
+        const char* QueueName = nullptr;
+        Int64       BeginNs   = 0;
+        Int64       EndNs     = -1; // -1 while the scope is open
+        Uint32      Depth     = 0;
+        Uint32      ContextId = 0;
+        Uint32      Query     = ~0u; // Index of the query pair, or ~0u if the scope has no GPU part
+    };
+
+    struct FrameEvents
+    {
+        std::vector<ScopeEvent> Events;
+        std::vector<QueryPair>  Queries;
+        Uint32                  NumUsedQueries   = 0;
+        Uint32                  NumDroppedEvents = 0; // Scopes that did not fit in the buffers
+    };
+
+    struct ThreadData
+    {
+        std::thread::id Id;
+        const char*     Name  = nullptr;
+        Uint32          Index = 0;
+
+        // Indices of the open scopes in the events of the current frame
+        std::vector<Uint32> Stack;
+
+        // Scopes of every frame in flight
+        std::vector<FrameEvents> Frames;
+    };
+
+    struct Scope
+    {
+        ScopeStats Stats;
+
+        // Rolling history in milliseconds, negative values mark missing samples
+        float GpuHistory[RollingWindowSize] = {};
+        float CpuHistory[RollingWindowSize] = {};
+
+        // Times accumulated over the frame being read back, negative if the scope was not recorded
+        double FrameGpuTimeMs = -1;
+        double FrameCpuTimeMs = -1;
+        double FrameGpuBegin  = 0;
+        double FrameGpuEnd    = 0;
+    };
+
+    struct TraceCpuEvent
+    {
+        const char* Name    = nullptr;
+        Uint32      Thread  = 0; // Track index, 0 for the frames
+        Int64       BeginNs = 0;
+        Int64       EndNs   = 0;
+        Int64       Frame   = -1; // Frame number of the frame events, -1 for other events
+    };
+
+    struct TraceGpuEvent
+    {
+        const char* Name       = nullptr;
+        const char* QueueName  = nullptr;
+        Uint32      ContextId  = 0;
+        Int64       CpuBeginNs = 0;
+        double      GpuBegin   = 0; // in seconds
+        double      GpuEnd     = 0;
+    };
+
+    ThreadData& GetThreadData();
+    Int64       GetTimeNs() const;
+    Scope&      FindOrAddScope(const char* Name);
+    void        ResolveFrame(Uint32 FrameSlot, bool Captured);
+    bool        WriteChromeTrace(const char* FilePath) const;
+
+    Uint64 m_Id = 0;
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+
+    bool   m_Initialized                      = false;
+    bool   m_GpuTimingSupported               = false;
+    bool   m_TransferQueueTimestampsSupported = false;
+    Uint32 m_NumFramesInFlight                = 4;
+    Uint32 m_MaxScopesPerThread               = 1024;
+
+    Clock::time_point m_Epoch;
+
+    std::mutex                               m_ThreadsMtx;
+    std::vector<std::unique_ptr<ThreadData>> m_Threads;
+
+    std::vector<Scope> m_Scopes;
+
+    Uint64 m_FrameId      = 0;
+    Int64  m_FrameBeginNs = 0;
+    Uint32 m_HistoryIdx   = 0;
+
+    // Trace capture
+    Uint32      m_PendingFrames     = 0;
+    Uint32      m_CaptureFramesLeft = 0;
+    Uint32      m_ResolveFramesLeft = 0;
+    Uint64      m_CaptureFirstFrame = 0;
+    Uint64      m_CaptureEndFrame   = 0;
+    Uint64      m_NumDroppedEvents  = 0;
+    std::string m_CaptureFilePath;
+    std::string m_CaptureStatus;
+    int         m_NumCaptureFrames = 60;
+
+    std::vector<TraceCpuEvent> m_TraceCpuEvents;
+    std::vector<TraceGpuEvent> m_TraceGpuEvents;
+};
+
+} // namespace Diligent
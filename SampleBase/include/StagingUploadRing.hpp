@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <deque>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Fence.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Ring of CPU-writable staging memory for buffer-to-texture and buffer-to-buffer uploads.
+
+/// The ring owns a single staging buffer. Data is written into sub-allocations of the buffer and copied to
+/// the destination resources by the commands recorded between Begin() and End(), for example by UpdateTexture()
+/// with TextureSubResData::pSrcBuffer set to GetBuffer(). End() signals a fence after the copies, and the memory
+/// of a submission is reclaimed by Begin() once the GPU has passed that fence, so the CPU never waits: if the
+/// GPU still reads the whole ring, Allocate() fails and the caller uploads less data this frame.
+///
+/// On backends that allow it, the buffer stays mapped for the lifetime of the ring.
+/// The ring is not thread-safe.
+class StagingUploadRing
+{
+public:
+    struct Allocation
+    {
+        void*  pData  = nullptr;
+        Uint64 Offset = 0;
+
+        explicit operator bool() const { return pData != nullptr; }
+    };
+
+    StagingUploadRing() = default;
+
+    // clang-format off
+    StagingUploadRing           (const StagingUploadRing&) = delete;
+    StagingUploadRing& operator=(const StagingUploadRing&) = delete;
+    // clang-format on
+
+    /// Creates the staging buffer and the fence. ImmediateContextMask must include all contexts that record copies.
+    /// If the ring already exists, the old buffer is released; the engine keeps it alive until the GPU is done with it.
+    void Create(IRenderDevice* pDevice, IDeviceContext* pContext, const char* Name, Uint64 Size, Uint64 ImmediateContextMask);
+
+    /// Reclaims the memory of completed submissions and maps the buffer if it is not persistently mapped.
+    bool Begin(IDeviceContext* pContext);
+
+    /// Allocates Size bytes aligned to Alignment, which must be a power of two.
+    /// Returns an empty allocation if there is not enough free memory.
+    Allocation Allocate(Uint64 Size, Uint32 Alignment);
+
+    /// Makes the data visible to the GPU and signals the fence after all copies recorded in pContext.
+    void End(IDeviceContext* pContext);
+
+    /// Releases the buffer. The caller must make sure that the ring is not in use.
+    void Release(IDeviceContext* pContext);
+
+    IBuffer* GetBuffer() const { return m_pBuffer; }
+
+    Uint64 GetSize() const { return m_Size; }
+
+    /// Number of bytes that are still in use by the GPU or by the current submission
+    Uint64 GetUsedSize() const { return m_UsedSize; }
+
+    /// Number of allocations that failed because the ring was full
+    Uint64 GetFailedAllocationCount() const { return m_NumFailedAllocations; }
+
+private:
+    struct Submission
+    {
+        Uint64 FenceValue = 0;
+        Uint64 End        = 0; // Offset after the last allocation of the submission
+        Uint64 Size       = 0; // Allocated bytes including padding
+    };
+    std::deque<Submission> m_Submissions;
+
+    RefCntAutoPtr<IBuffer> m_pBuffer;
+    RefCntAutoPtr<IFence>  m_pFence;
+
+    Uint8* m_pData           = nullptr;
+    bool   m_PersistentMap   = false;
+    bool   m_NeedsFlush      = false;
+    Uint64 m_Size            = 0;
+    Uint64 m_Head            = 0; // Offset of the next allocation
+    Uint64 m_Tail            = 0; // Offset of the oldest allocation that is in use
+    Uint64 m_UsedSize        = 0;
+    Uint64 m_SubmissionStart = 0;
+    Uint64 m_SubmissionSize  = 0;
+    Uint64 m_NextFenceValue  = 1;
+
+    Uint64 m_NumFailedAllocations = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameRingAllocator.hpp"
+
+#include <algorithm>
+
+#include "Align.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+Uint32 FrameRingAllocator::GetOffsetAlignment(IRenderDevice* pDevice, BIND_FLAGS BindFlags)
+{
+    const auto& BuffProps = pDevice->GetAdapterInfo().Buffer;
+
+    Uint32 Alignment = 16;
+    if (BindFlags & BIND_UNIFORM_BUFFER)
+        Alignment = std::max(Alignment, BuffProps.ConstantBufferOffsetAlignment);
+    if (BindFlags & BIND_SHADER_RESOURCE)
+        Alignment = std::max(Alignment, BuffProps.StructuredBufferOffsetAlignment);
+    return Alignment;
+}
+
+void FrameRingAllocator::Create(IRenderDevice* pDevice, const char* Name, BIND_FLAGS BindFlags, Uint64 Size, Uint32 NumContextSlots)
+{
+    VERIFY_EXPR(pDevice != nullptr && Size > 0 && NumContextSlots > 0);
+
+    const Uint32 Alignment = GetOffsetAlignment(pDevice, BindFlags);
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = Name;
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = BindFlags;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    BuffDesc.Size           = AlignUp(Size, Uint64{Alignment});
+
+    m_pBuffer.Release();
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
+    VERIFY_EXPR(m_pBuffer != nullptr);
+
+    Initialize(BuffDesc.Size, Alignment, NumContextSlots);
+}
+
+void FrameRingAllocator::Initialize(Uint64 Size, Uint32 Alignment, Uint32 NumContextSlots)
+{
+    VERIFY_EXPR(Size > 0 && NumContextSlots > 0);
+    VERIFY(IsPowerOfTwo(Alignment), "Alignment must be a power of two");
+
+    m_Alignment = Alignment;
+    m_Size      = AlignUp(Size, Uint64{Alignment});
+    m_Slots.clear();
+    m_Slots.resize(NumContextSlots);
+}
+
+bool FrameRingAllocator::Begin(IDeviceContext* pContext, Uint32 ContextSlot)
+{
+    VERIFY(m_Slots[ContextSlot].pData == nullptr, "The buffer is already mapped in this slot");
+
+    void* pData = nullptr;
+    pContext->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_DISCARD, pData);
+    return BeginMapped(ContextSlot, pData);
+}
+
+bool FrameRingAllocator::BeginMapped(Uint32 ContextSlot, void* pMappedData)
+{
+    Slot& S = m_Slots[ContextSlot];
+    VERIFY(S.pData == nullptr, "The buffer is already mapped in this slot");
+
+    S.pData  = static_cast<Uint8*>(pMappedData);
+    S.Offset = 0;
+    return S.pData != nullptr;
+}
+
+FrameRingAllocator::Allocation FrameRingAllocator::Allocate(Uint32 ContextSlot, Uint32 Size)
+{
+    Slot& S = m_Slots[ContextSlot];
+    VERIFY(S.pData != nullptr, "Begin() must be called before allocating");
+
+    const Uint64 Offset = AlignUp(S.Offset, Uint64{m_Alignment});
+    if (S.pData == nullptr || Offset + Size > m_Size)
+        return {};
+
+    S.Offset = Offset + Size;
+
+    Allocation Alloc;
+    Alloc.pData  = S.pData + Offset;
+    Alloc.Offset = static_cast<Uint32>(Offset);
+    return Alloc;
+}
+
+void FrameRingAllocator::End(IDeviceContext* pContext, Uint32 ContextSlot)
+{
+    if (EndMapped(ContextSlot))
+        pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+}
+
+bool FrameRingAllocator::EndMapped(Uint32 ContextSlot)
+{
+    Slot& S = m_Slots[ContextSlot];
+    if (S.pData == nullptr)
+        return false;
+
+    S.pData = nullptr;
+    return true;
+}
+
+} // namespace Diligent
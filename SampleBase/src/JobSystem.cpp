@@ -0,0 +1,259 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct ThreadContext
+{
+    const JobSystem* pOwner    = nullptr;
+    Uint32           ThreadIdx = 0;
+};
+
+thread_local ThreadContext t_ThreadContext;
+
+} // namespace
+
+JobSystem::JobSystem(Uint32 NumThreads)
+{
+    if (NumThreads == 0)
+        NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    m_Queues.resize(NumThreads);
+    for (auto& Queue : m_Queues)
+        Queue = std::make_unique<ThreadQueue>();
+
+    m_Workers.reserve(NumThreads - 1);
+    for (Uint32 i = 1; i < NumThreads; ++i)
+        m_Workers.emplace_back(&JobSystem::WorkerThreadFunc, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_SleepMtx};
+        m_Quit = true;
+    }
+    m_WakeCondVar.notify_all();
+
+    for (auto& Worker : m_Workers)
+        Worker.join();
+
+#ifdef DILIGENT_DEBUG
+    for (const auto& Queue : m_Queues)
+        VERIFY(Queue->Jobs.empty(), "Job system is destroyed while jobs are pending");
+#endif
+}
+
+Uint32 JobSystem::GetCurrentThreadIdx() const
+{
+    // Threads that do not belong to this job system act as thread 0
+    return t_ThreadContext.pOwner == this ? t_ThreadContext.ThreadIdx : 0;
+}
+
+void JobSystem::Push(Uint32 ThreadIdx, Job&& NewJob)
+{
+    auto& Queue = *m_Queues[ThreadIdx];
+    std::lock_guard<std::mutex> Lock{Queue.Mtx};
+    // Count the job before it becomes visible, so that the count never drops below zero
+    m_NumQueuedJobs.fetch_add(1);
+    Queue.Jobs.emplace_back(std::move(NewJob));
+}
+
+bool JobSystem::TryPop(Uint32 ThreadIdx, Job& OutJob)
+{
+    auto& Queue = *m_Queues[ThreadIdx];
+
+    std::lock_guard<std::mutex> Lock{Queue.Mtx};
+    if (Queue.Jobs.empty())
+        return false;
+
+    // Newest job first: its data is most likely still in the cache
+    OutJob = std::move(Queue.Jobs.back());
+    Queue.Jobs.pop_back();
+    m_NumQueuedJobs.fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::TrySteal(Uint32 ThreadIdx, Job& OutJob)
+{
+    const auto NumQueues = static_cast<Uint32>(m_Queues.size());
+    for (Uint32 i = 1; i < NumQueues; ++i)
+    {
+        auto& Victim = *m_Queues[(ThreadIdx + i) % NumQueues];
+
+        std::unique_lock<std::mutex> Lock{Victim.Mtx, std::try_to_lock};
+        if (!Lock.owns_lock() || Victim.Jobs.empty())
+            continue;
+
+        // Oldest job: the owner works from the other end of the queue
+        OutJob = std::move(Victim.Jobs.front());
+        Victim.Jobs.pop_front();
+        m_NumQueuedJobs.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::TryExecuteJob(Uint32 ThreadIdx)
+{
+    Job CurrJob;
+
+    bool Stolen = false;
+    if (!TryPop(ThreadIdx, CurrJob))
+    {
+        if (!TrySteal(ThreadIdx, CurrJob))
+            return false;
+        Stolen = true;
+    }
+
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+    CurrJob.Func(ThreadIdx);
+    const auto EndTime = std::chrono::high_resolution_clock::now();
+
+    auto& Queue = *m_Queues[ThreadIdx];
+    Queue.BusyTimeNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(EndTime - StartTime).count(), std::memory_order_relaxed);
+    Queue.NumJobs.fetch_add(1, std::memory_order_relaxed);
+    if (Stolen)
+        Queue.NumStolenJobs.fetch_add(1, std::memory_order_relaxed);
+
+    // Release the job's captures before the group is signaled
+    CurrJob.Func = nullptr;
+    CurrJob.pGroup->m_NumPendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void JobSystem::WakeWorkers(Uint32 NumJobs)
+{
+    // Taking the mutex guarantees that a worker that found no jobs is either already waiting
+    // or will see the updated job count before it goes to sleep.
+    {
+        std::lock_guard<std::mutex> Lock{m_SleepMtx};
+    }
+    if (NumJobs == 1)
+        m_WakeCondVar.notify_one();
+    else
+        m_WakeCondVar.notify_all();
+}
+
+void JobSystem::Submit(JobGroup& Group, JobFunc Func)
+{
+    Group.m_NumPendingJobs.fetch_add(1, std::memory_order_relaxed);
+    Push(GetCurrentThreadIdx(), Job{std::move(Func), &Group});
+    WakeWorkers(1);
+}
+
+void JobSystem::Wait(JobGroup& Group)
+{
+    const auto ThreadIdx = GetCurrentThreadIdx();
+    while (!Group.IsDone())
+    {
+        // Help with any job, not only the ones of this group
+        if (!TryExecuteJob(ThreadIdx))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::ParallelFor(Uint32 Count, Uint32 Granularity, const RangeFunc& Func)
+{
+    if (Count == 0)
+        return;
+
+    Granularity = std::max(Granularity, 1u);
+
+    const auto NumJobs   = (Count + Granularity - 1) / Granularity;
+    const auto ThreadIdx = GetCurrentThreadIdx();
+    if (NumJobs == 1 || m_Workers.empty())
+    {
+        Func(ThreadIdx, 0, Count);
+        return;
+    }
+
+    JobGroup Group;
+    Group.m_NumPendingJobs.store(NumJobs, std::memory_order_relaxed);
+    // Push in reverse order so that the owner pops the first range first while the other
+    // threads steal from the end of the loop
+    for (Uint32 JobIdx = NumJobs; JobIdx-- > 0;)
+    {
+        const auto Begin = JobIdx * Granularity;
+        const auto End   = std::min(Begin + Granularity, Count);
+        Push(ThreadIdx, Job{[&Func, Begin, End](Uint32 Idx) { Func(Idx, Begin, End); }, &Group});
+    }
+    WakeWorkers(NumJobs);
+
+    Wait(Group);
+}
+
+JobSystem::ThreadStats JobSystem::GetThreadStats(Uint32 ThreadIdx) const
+{
+    const auto& Queue = *m_Queues[ThreadIdx];
+
+    ThreadStats Stats;
+    Stats.BusyTimeMs    = static_cast<double>(Queue.BusyTimeNs.load(std::memory_order_relaxed)) * 1e-6;
+    Stats.NumJobs       = Queue.NumJobs.load(std::memory_order_relaxed);
+    Stats.NumStolenJobs = Queue.NumStolenJobs.load(std::memory_order_relaxed);
+    return Stats;
+}
+
+void JobSystem::ResetStats()
+{
+    for (auto& Queue : m_Queues)
+    {
+        Queue->BusyTimeNs.store(0, std::memory_order_relaxed);
+        Queue->NumJobs.store(0, std::memory_order_relaxed);
+        Queue->NumStolenJobs.store(0, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::WorkerThreadFunc(Uint32 ThreadIdx)
+{
+    t_ThreadContext.pOwner    = this;
+    t_ThreadContext.ThreadIdx = ThreadIdx;
+
+    for (;;)
+    {
+        if (TryExecuteJob(ThreadIdx))
+            continue;
+
+        std::unique_lock<std::mutex> Lock{m_SleepMtx};
+        m_WakeCondVar.wait(Lock, [this]() { return m_Quit || m_NumQueuedJobs.load() > 0; });
+        if (m_Quit)
+            return;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,595 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ScopeProfiler.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "DebugUtilities.hpp"
+#include "imgui.h"
+
+namespace Diligent
+{
+
+namespace
+{
+
+std::atomic<Uint64> g_NextProfilerId{1};
+
+void WriteJsonString(std::ostream& Stream, const char* Str)
+{
+    Stream << '"';
+    for (const char* c = Str; c != nullptr && *c != '\0'; ++c)
+    {
+        switch (*c)
+        {
+            case '"': Stream << "\\\""; break;
+            case '\\': Stream << "\\\\"; break;
+            case '\n': Stream << "\\n"; break;
+            case '\t': Stream << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20)
+                    Stream << *c;
+        }
+    }
+    Stream << '"';
+}
+
+} // namespace
+
+ScopeProfiler::ScopeProfiler() :
+    m_Id{g_NextProfilerId.fetch_add(1)},
+    m_Epoch{Clock::now()}
+{
+}
+
+void ScopeProfiler::Initialize(IRenderDevice* pDevice, Uint32 NumFramesInFlight, Uint32 MaxScopesPerThread)
+{
+    VERIFY_EXPR(NumFramesInFlight > 0 && MaxScopesPerThread > 0);
+
+    m_pDevice = pDevice;
+    if (pDevice != nullptr)
+    {
+        const DeviceFeatures& Features     = pDevice->GetDeviceInfo().Features;
+        m_GpuTimingSupported               = Features.TimestampQueries != DEVICE_FEATURE_STATE_DISABLED;
+        m_TransferQueueTimestampsSupported = Features.TransferQueueTimestampQueries != DEVICE_FEATURE_STATE_DISABLED;
+    }
+    else
+    {
+        m_GpuTimingSupported               = false;
+        m_TransferQueueTimestampsSupported = false;
+    }
+    m_NumFramesInFlight  = NumFramesInFlight;
+    m_MaxScopesPerThread = MaxScopesPerThread;
+
+    {
+        // Thread data of the previous initialization is cached by the threads, so a new id is required
+        std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+        m_Threads.clear();
+        m_Id = g_NextProfilerId.fetch_add(1);
+    }
+
+    m_Scopes.clear();
+    m_FrameId      = 0;
+    m_FrameBeginNs = GetTimeNs();
+    m_HistoryIdx   = 0;
+
+    // A capture requested before the initialization starts with the first frame, a capture in progress is dropped
+    m_CaptureFramesLeft = 0;
+    m_ResolveFramesLeft = 0;
+    m_CaptureFirstFrame = 0;
+    m_CaptureEndFrame   = 0;
+    m_TraceCpuEvents.clear();
+    m_TraceGpuEvents.clear();
+
+    m_Initialized = true;
+}
+
+Int64 ScopeProfiler::GetTimeNs() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_Epoch).count();
+}
+
+ScopeProfiler::ThreadData& ScopeProfiler::GetThreadData()
+{
+    struct ThreadCache
+    {
+        Uint64      ProfilerId = 0;
+        ThreadData* pData      = nullptr;
+    };
+    static thread_local ThreadCache Cache;
+    if (Cache.ProfilerId == m_Id)
+        return *Cache.pData;
+
+    std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+
+    const std::thread::id ThreadId = std::this_thread::get_id();
+
+    ThreadData* pData = nullptr;
+    for (auto& pThread : m_Threads)
+    {
+        if (pThread->Id == ThreadId)
+            pData = pThread.get();
+    }
+
+    if (pData == nullptr)
+    {
+        m_Threads.emplace_back(new ThreadData{});
+        pData        = m_Threads.back().get();
+        pData->Id    = ThreadId;
+        pData->Index = static_cast<Uint32>(m_Threads.size());
+        pData->Stack.reserve(64);
+        pData->Frames.resize(m_NumFramesInFlight);
+        for (FrameEvents& Frame : pData->Frames)
+            Frame.Events.reserve(m_MaxScopesPerThread);
+    }
+
+    Cache.ProfilerId = m_Id;
+    Cache.pData      = pData;
+    return *pData;
+}
+
+void ScopeProfiler::SetThreadName(const char* Name)
+{
+    GetThreadData().Name = Name;
+}
+
+const ScopeProfiler::ScopeStats* ScopeProfiler::FindScope(const char* Name) const
+{
+    for (const Scope& S : m_Scopes)
+    {
+        if (S.Stats.Name == Name || std::strcmp(S.Stats.Name, Name) == 0)
+            return &S.Stats;
+    }
+    return nullptr;
+}
+
+ScopeProfiler::Scope& ScopeProfiler::FindOrAddScope(const char* Name)
+{
+    VERIFY_EXPR(Name != nullptr);
+
+    for (Scope& S : m_Scopes)
+    {
+        if (S.Stats.Name == Name || std::strcmp(S.Stats.Name, Name) == 0)
+            return S;
+    }
+
+    Scope NewScope;
+    NewScope.Stats.Name  = Name;
+    NewScope.Stats.Depth = ~0u;
+    std::fill(std::begin(NewScope.GpuHistory), std::end(NewScope.GpuHistory), -1.f);
+    std::fill(std::begin(NewScope.CpuHistory), std::end(NewScope.CpuHistory), -1.f);
+    m_Scopes.push_back(NewScope);
+    return m_Scopes.back();
+}
+
+void ScopeProfiler::Begin(IDeviceContext* pContext, const char* Name)
+{
+    if (!m_Initialized)
+        return;
+
+    ThreadData&  Thread = GetThreadData();
+    FrameEvents& Frame  = Thread.Frames[m_FrameId % m_NumFramesInFlight];
+    if (Frame.Events.size() == m_MaxScopesPerThread)
+    {
+        ++Frame.NumDroppedEvents;
+        Thread.Stack.push_back(~0u);
+        return;
+    }
+
+    ScopeEvent Event;
+    Event.Name  = Name;
+    Event.Depth = static_cast<Uint32>(Thread.Stack.size());
+
+    if (pContext != nullptr && m_GpuTimingSupported)
+    {
+        const DeviceContextDesc& CtxDesc = pContext->GetDesc();
+
+        // Deferred contexts are executed by the queue of the immediate context, and not all backends
+        // support queries in them. Timestamps in the transfer queue are an optional feature.
+        const bool IsTransferQueue = (CtxDesc.QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK) == COMMAND_QUEUE_TYPE_TRANSFER;
+        if (!CtxDesc.IsDeferred && (!IsTransferQueue || m_TransferQueueTimestampsSupported))
+        {
+            if (Frame.NumUsedQueries == Frame.Queries.size())
+            {
+                QueryDesc queryDesc;
+                queryDesc.Name = "Scope profiler timestamp query";
+                queryDesc.Type = QUERY_TYPE_TIMESTAMP;
+
+                QueryPair NewPair;
+                m_pDevice->CreateQuery(queryDesc, &NewPair.pBegin);
+                m_pDevice->CreateQuery(queryDesc, &NewPair.pEnd);
+                VERIFY_EXPR(NewPair.pBegin != nullptr && NewPair.pEnd != nullptr);
+                Frame.Queries.emplace_back(std::move(NewPair));
+            }
+
+            Event.QueueName = CtxDesc.Name;
+            Event.ContextId = CtxDesc.ContextId;
+            Event.Query     = Frame.NumUsedQueries++;
+            pContext->EndQuery(Frame.Queries[Event.Query].pBegin);
+        }
+    }
+
+    Event.BeginNs = GetTimeNs();
+    Thread.Stack.push_back(static_cast<Uint32>(Frame.Events.size()));
+    Frame.Events.push_back(Event);
+}
+
+void ScopeProfiler::End(IDeviceContext* pContext, const char* Name)
+{
+    if (!m_Initialized)
+        return;
+
+    ThreadData& Thread = GetThreadData();
+    VERIFY(!Thread.Stack.empty(), "End() is called without matching Begin()");
+    if (Thread.Stack.empty())
+        return;
+
+    const Uint32 EventIdx = Thread.Stack.back();
+    Thread.Stack.pop_back();
+    if (EventIdx == ~0u)
+        return;
+
+    FrameEvents& Frame = Thread.Frames[m_FrameId % m_NumFramesInFlight];
+    ScopeEvent&  Event = Frame.Events[EventIdx];
+    VERIFY(Event.Name == Name || std::strcmp(Event.Name, Name) == 0, "End(", Name, ") does not match Begin(", Event.Name, ")");
+
+    if (Event.Query != ~0u)
+    {
+        VERIFY(pContext != nullptr, "The scope was started with a context and must be ended with the same context");
+        if (pContext != nullptr)
+            pContext->EndQuery(Frame.Queries[Event.Query].pEnd);
+        else
+            Event.Query = ~0u;
+    }
+    Event.EndNs = GetTimeNs();
+}
+
+void ScopeProfiler::ResolveFrame(Uint32 FrameSlot, bool Captured)
+{
+    for (Scope& S : m_Scopes)
+    {
+        S.FrameGpuTimeMs = -1;
+        S.FrameCpuTimeMs = -1;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock{m_ThreadsMtx};
+        for (auto& pThread : m_Threads)
+        {
+            FrameEvents& Frame = pThread->Frames[FrameSlot];
+            for (const ScopeEvent& Event : Frame.Events)
+            {
+                if (Event.EndNs < 0)
+                {
+                    ++Frame.NumDroppedEvents;
+                    continue;
+                }
+
+                Scope& S         = FindOrAddScope(Event.Name);
+                S.Stats.Depth    = std::min(S.Stats.Depth, Event.Depth);
+                S.FrameCpuTimeMs = std::max(S.FrameCpuTimeMs, 0.0) + static_cast<double>(Event.EndNs - Event.BeginNs) * 1e-6;
+                if (Captured)
+                    m_TraceCpuEvents.push_back({Event.Name, pThread->Index, Event.BeginNs, Event.EndNs, -1});
+
+                if (Event.Query == ~0u)
+                    continue;
+
+                // Never wait for the GPU: if the queries are still not ready, the GPU part is dropped
+                const QueryPair&   Queries = Frame.Queries[Event.Query];
+                QueryDataTimestamp BeginData, EndData;
+                if (Queries.pBegin->GetData(&BeginData, sizeof(BeginData), true) &&
+                    Queries.pEnd->GetData(&EndData, sizeof(EndData), true) &&
+                    BeginData.Frequency != 0 && EndData.Frequency != 0)
+                {
+                    const double GpuBegin = static_cast<double>(BeginData.Counter) / static_cast<double>(BeginData.Frequency);
+                    const double GpuEnd   = static_cast<double>(EndData.Counter) / static_cast<double>(EndData.Frequency);
+                    VERIFY_EXPR(GpuEnd >= GpuBegin);
+                    if (S.FrameGpuTimeMs < 0)
+                    {
+                        S.FrameGpuTimeMs = 0;
+                        S.FrameGpuBegin  = GpuBegin;
+                        S.FrameGpuEnd    = GpuEnd;
+                    }
+                    S.FrameGpuTimeMs += (GpuEnd - GpuBegin) * 1000.0;
+                    S.FrameGpuBegin = std::min(S.FrameGpuBegin, GpuBegin);
+                    S.FrameGpuEnd   = std::max(S.FrameGpuEnd, GpuEnd);
+                    if (Captured)
+                        m_TraceGpuEvents.push_back({Event.Name, Event.QueueName, Event.ContextId, Event.BeginNs, GpuBegin, GpuEnd});
+                }
+                else
+                {
+                    ++Frame.NumDroppedEvents;
+                }
+            }
+
+            if (Captured)
+                m_NumDroppedEvents += Frame.NumDroppedEvents;
+            Frame.Events.clear();
+            Frame.NumUsedQueries   = 0;
+            Frame.NumDroppedEvents = 0;
+        }
+    }
+
+    const auto Average = [](const float* History) //
+    {
+        double Sum   = 0;
+        Uint32 Count = 0;
+        for (Uint32 i = 0; i < RollingWindowSize; ++i)
+        {
+            if (History[i] >= 0)
+            {
+                Sum += History[i];
+                ++Count;
+            }
+        }
+        return Count > 0 ? Sum / Count : 0.0;
+    };
+
+    for (Scope& S : m_Scopes)
+    {
+        if (S.FrameGpuTimeMs >= 0)
+        {
+            S.Stats.TotalGpuTimeMs += S.FrameGpuTimeMs;
+            ++S.Stats.NumGpuSamples;
+            S.Stats.LastGpuBegin = S.FrameGpuBegin;
+            S.Stats.LastGpuEnd   = S.FrameGpuEnd;
+        }
+        if (S.FrameCpuTimeMs >= 0)
+        {
+            S.Stats.TotalCpuTimeMs += S.FrameCpuTimeMs;
+            ++S.Stats.NumCpuSamples;
+        }
+
+        S.GpuHistory[m_HistoryIdx] = static_cast<float>(S.FrameGpuTimeMs);
+        S.CpuHistory[m_HistoryIdx] = static_cast<float>(S.FrameCpuTimeMs);
+        S.Stats.AvgGpuTimeMs       = Average(S.GpuHistory);
+        S.Stats.AvgCpuTimeMs       = Average(S.CpuHistory);
+    }
+
+    m_HistoryIdx = (m_HistoryIdx + 1) % RollingWindowSize;
+}
+
+void ScopeProfiler::EndFrame()
+{
+    if (!m_Initialized)
+        return;
+
+    const Int64 Now = GetTimeNs();
+
+    if (m_CaptureFramesLeft > 0)
+    {
+        m_TraceCpuEvents.push_back({"Frame", 0, m_FrameBeginNs, Now, static_cast<Int64>(m_FrameId)});
+        if (--m_CaptureFramesLeft == 0)
+        {
+            // Queries of the last frames are read back by the following calls
+            m_ResolveFramesLeft = m_NumFramesInFlight;
+        }
+    }
+
+    ++m_FrameId;
+
+    // The slot that is reused by the next frame holds the scopes recorded NumFramesInFlight frames ago
+    if (m_FrameId >= m_NumFramesInFlight)
+    {
+        const Uint64 ResolvedFrame = m_FrameId - m_NumFramesInFlight;
+        ResolveFrame(static_cast<Uint32>(m_FrameId % m_NumFramesInFlight), ResolvedFrame >= m_CaptureFirstFrame && ResolvedFrame < m_CaptureEndFrame);
+    }
+
+    if (m_ResolveFramesLeft > 0 && --m_ResolveFramesLeft == 0)
+    {
+        if (WriteChromeTrace(m_CaptureFilePath.c_str()))
+        {
+            m_CaptureStatus = "Saved to " + m_CaptureFilePath;
+            if (m_NumDroppedEvents > 0)
+                m_CaptureStatus += " (" + std::to_string(m_NumDroppedEvents) + " scopes dropped)";
+            LOG_INFO_MESSAGE("Frame trace ", m_CaptureStatus);
+        }
+        else
+        {
+            m_CaptureStatus = "Failed to save the trace";
+        }
+        m_TraceCpuEvents.clear();
+        m_TraceGpuEvents.clear();
+    }
+
+    if (m_PendingFrames > 0 && m_CaptureFramesLeft == 0 && m_ResolveFramesLeft == 0)
+    {
+        m_CaptureFirstFrame = m_FrameId;
+        m_CaptureEndFrame   = m_FrameId + m_PendingFrames;
+        m_CaptureFramesLeft = m_PendingFrames;
+        m_PendingFrames     = 0;
+        m_NumDroppedEvents  = 0;
+    }
+
+    m_FrameBeginNs = Now;
+}
+
+void ScopeProfiler::BeginCapture(Uint32 NumFrames, const char* FilePath)
+{
+    if (NumFrames == 0 || IsCapturing())
+        return;
+
+    m_PendingFrames   = NumFrames;
+    m_CaptureFilePath = FilePath;
+    m_CaptureStatus.clear();
+}
+
+void ScopeProfiler::ResetTotals()
+{
+    for (Scope& S : m_Scopes)
+    {
+        S.Stats.TotalGpuTimeMs = 0;
+        S.Stats.TotalCpuTimeMs = 0;
+        S.Stats.NumGpuSamples  = 0;
+        S.Stats.NumCpuSamples  = 0;
+    }
+}
+
+bool ScopeProfiler::WriteChromeTrace(const char* FilePath) const
+{
+    std::ofstream Stream{FilePath};
+    if (!Stream)
+    {
+        LOG_ERROR_MESSAGE("Failed to open trace file '", FilePath, "'");
+        return false;
+    }
+    Stream.setf(std::ios_base::fixed);
+    Stream.precision(3);
+
+    static constexpr int CpuPid = 1;
+    static constexpr int GpuPid = 2;
+
+    // Timestamps are in microseconds
+    const auto WriteEvent = [&Stream](const char* Name, const char* Category, int Pid, Uint32 Tid, double BeginUs, double EndUs) {
+        Stream << ",\n{\"name\":";
+        WriteJsonString(Stream, Name);
+        Stream << ",\"cat\":\"" << Category << "\",\"ph\":\"X\",\"pid\":" << Pid << ",\"tid\":" << Tid
+               << ",\"ts\":" << BeginUs << ",\"dur\":" << std::max(EndUs - BeginUs, 0.0);
+    };
+    const auto WriteTrackName = [&Stream](const char* Type, int Pid, Uint32 Tid, const char* Name) {
+        Stream << ",\n{\"name\":\"" << Type << "\",\"ph\":\"M\",\"pid\":" << Pid << ",\"tid\":" << Tid << ",\"args\":{\"name\":";
+        WriteJsonString(Stream, Name);
+        Stream << "}}";
+    };
+
+    Stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    Stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << CpuPid << ",\"args\":{\"name\":\"CPU\"}}";
+    Stream << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << GpuPid << ",\"args\":{\"name\":\"GPU\"}}";
+
+    // Frames are shown in a separate track
+    WriteTrackName("thread_name", CpuPid, 0, "Frames");
+    for (const auto& pThread : m_Threads)
+    {
+        const std::string DefaultName = "Thread " + std::to_string(pThread->Index);
+        WriteTrackName("thread_name", CpuPid, pThread->Index, pThread->Name != nullptr ? pThread->Name : DefaultName.c_str());
+    }
+
+    for (const TraceCpuEvent& Event : m_TraceCpuEvents)
+    {
+        WriteEvent(Event.Name, Event.Frame >= 0 ? "Frame" : "CPU", CpuPid, Event.Thread, Event.BeginNs * 1e-3, Event.EndNs * 1e-3);
+        if (Event.Frame >= 0)
+            Stream << ",\"args\":{\"frame\":" << Event.Frame << "}";
+        Stream << "}";
+    }
+
+    // Every queue has its own timestamp origin. Shift the queue so that no scope starts on the GPU
+    // before it was recorded on the CPU; the earliest of these bounds is the best estimate of the offset.
+    std::unordered_map<Uint32, double> QueueOffsetsNs;
+    for (const TraceGpuEvent& Event : m_TraceGpuEvents)
+    {
+        const double Offset = static_cast<double>(Event.CpuBeginNs) - Event.GpuBegin * 1e+9;
+        auto         It     = QueueOffsetsNs.find(Event.ContextId);
+        if (It == QueueOffsetsNs.end())
+        {
+            QueueOffsetsNs.emplace(Event.ContextId, Offset);
+            WriteTrackName("thread_name", GpuPid, Event.ContextId, Event.QueueName != nullptr ? Event.QueueName : "Queue");
+        }
+        else
+        {
+            It->second = std::max(It->second, Offset);
+        }
+    }
+
+    for (const TraceGpuEvent& Event : m_TraceGpuEvents)
+    {
+        const double OffsetNs = QueueOffsetsNs[Event.ContextId];
+        WriteEvent(Event.Name, "GPU", GpuPid, Event.ContextId, (Event.GpuBegin * 1e+9 + OffsetNs) * 1e-3, (Event.GpuEnd * 1e+9 + OffsetNs) * 1e-3);
+        Stream << "}";
+    }
+
+    Stream << "\n]}\n";
+    return static_cast<bool>(Stream);
+}
+
+void ScopeProfiler::UpdateUI() const
+{
+    if (!m_Initialized || m_Scopes.empty())
+        return;
+
+    // The time of nested scopes is already included in the time of the top-level scopes
+    double TotalGpuTimeMs = 0;
+    double TotalCpuTimeMs = 0;
+    for (const Scope& S : m_Scopes)
+    {
+        if (S.Stats.Depth == 0)
+        {
+            TotalGpuTimeMs += S.Stats.AvgGpuTimeMs;
+            TotalCpuTimeMs += S.Stats.AvgCpuTimeMs;
+        }
+    }
+
+    ImGui::Text("%-16s %9s %9s", "Scope", "GPU, ms", "CPU, ms");
+    for (const Scope& S : m_Scopes)
+    {
+        // Nested scopes are indented by their depth
+        ImGui::Text("%*s%-*s %9.3f %9.3f", static_cast<int>(S.Stats.Depth), "", std::max(16 - static_cast<int>(S.Stats.Depth), 0), S.Stats.Name,
+                    S.Stats.AvgGpuTimeMs, S.Stats.AvgCpuTimeMs);
+        if (m_GpuTimingSupported)
+        {
+            const auto GetSample = [](void* pData, int Idx) //
+            {
+                return (std::max)(static_cast<const float*>(pData)[Idx], 0.f);
+            };
+
+            ImGui::PushID(S.Stats.Name);
+            ImGui::PlotLines("##GpuTime", GetSample, const_cast<float*>(S.GpuHistory), RollingWindowSize, static_cast<int>(m_HistoryIdx),
+                             nullptr, 0.f, FLT_MAX, ImVec2{0, 30});
+            ImGui::SameLine();
+            ImGui::ProgressBar(TotalGpuTimeMs > 0 ? static_cast<float>(S.Stats.AvgGpuTimeMs / TotalGpuTimeMs) : 0.f, ImVec2{60, 0});
+            ImGui::PopID();
+        }
+    }
+
+    ImGui::Text("%-16s %9.3f %9.3f", "Total", TotalGpuTimeMs, TotalCpuTimeMs);
+    if (!m_GpuTimingSupported)
+        ImGui::TextDisabled("Timestamp queries are not supported, GPU times are unavailable");
+    ImGui::TextDisabled("Averaged over %u frames, %u frames latency", RollingWindowSize, GetLatency());
+}
+
+void ScopeProfiler::UpdateCaptureUI(const char* FilePath)
+{
+    if (IsCapturing())
+    {
+        ImGui::TextDisabled("Capturing trace...");
+        return;
+    }
+
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderInt("##TraceFrames", &m_NumCaptureFrames, 1, 600, "%d frames");
+    ImGui::SameLine();
+    if (ImGui::Button("Capture trace"))
+        BeginCapture(static_cast<Uint32>(m_NumCaptureFrames), FilePath);
+    if (!m_CaptureStatus.empty())
+        ImGui::TextDisabled("%s", m_CaptureStatus.c_str());
+}
+
+} // namespace Diligent
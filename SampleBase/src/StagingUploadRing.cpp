@@ -0,0 +1,220 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "StagingUploadRing.hpp"
+
+#include "Align.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void StagingUploadRing::Create(IRenderDevice* pDevice, IDeviceContext* pContext, const char* Name, Uint64 Size, Uint64 ImmediateContextMask)
+{
+    VERIFY_EXPR(pDevice != nullptr && pContext != nullptr && Size > 0);
+
+    Release(pContext);
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name                 = Name;
+    BuffDesc.Usage                = USAGE_STAGING;
+    BuffDesc.BindFlags            = BIND_NONE;
+    BuffDesc.CPUAccessFlags       = CPU_ACCESS_WRITE;
+    BuffDesc.Size                 = Size;
+    BuffDesc.ImmediateContextMask = ImmediateContextMask;
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
+    VERIFY_EXPR(m_pBuffer != nullptr);
+
+    // The buffer is used in multiple contexts, so disable automatic resource transitions.
+    VERIFY_EXPR((m_pBuffer->GetState() & RESOURCE_STATE_COPY_SOURCE) != 0);
+    m_pBuffer->SetState(RESOURCE_STATE_UNKNOWN);
+
+    if (!m_pFence)
+    {
+        FenceDesc FDesc;
+        FDesc.Name = Name;
+        pDevice->CreateFence(FDesc, &m_pFence);
+        VERIFY_EXPR(m_pFence != nullptr);
+    }
+
+    // Staging memory of these backends may be accessed by the GPU while it is mapped.
+    // The other backends only copy from unmapped buffers.
+    const RENDER_DEVICE_TYPE DevType = pDevice->GetDeviceInfo().Type;
+    m_PersistentMap = DevType == RENDER_DEVICE_TYPE_D3D12 || DevType == RENDER_DEVICE_TYPE_VULKAN || DevType == RENDER_DEVICE_TYPE_METAL;
+    m_NeedsFlush    = (m_pBuffer->GetMemoryProperties() & MEMORY_PROPERTY_HOST_COHERENT) == 0;
+    if (m_PersistentMap)
+    {
+        void* pData = nullptr;
+        pContext->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_NONE, pData);
+        m_pData = static_cast<Uint8*>(pData);
+        VERIFY_EXPR(m_pData != nullptr);
+    }
+
+    m_Size = Size;
+}
+
+void StagingUploadRing::Release(IDeviceContext* pContext)
+{
+    if (m_pBuffer && m_pData != nullptr)
+        pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+
+    // Submissions of the old buffer use the same fence, so the fence value keeps growing.
+    m_pBuffer.Release();
+    m_Submissions.clear();
+
+    m_pData           = nullptr;
+    m_PersistentMap   = false;
+    m_Size            = 0;
+    m_Head            = 0;
+    m_Tail            = 0;
+    m_UsedSize        = 0;
+    m_SubmissionStart = 0;
+    m_SubmissionSize  = 0;
+}
+
+bool StagingUploadRing::Begin(IDeviceContext* pContext)
+{
+    if (!m_pBuffer)
+        return false;
+
+    // Memory of the submissions that the GPU has finished is free again
+    const Uint64 CompletedFenceValue = m_pFence->GetCompletedValue();
+    while (!m_Submissions.empty() && m_Submissions.front().FenceValue <= CompletedFenceValue)
+    {
+        const Submission& Sub = m_Submissions.front();
+        m_Tail                = Sub.End;
+        m_UsedSize -= Sub.Size;
+        m_Submissions.pop_front();
+    }
+    if (m_UsedSize == 0)
+        m_Head = m_Tail = 0;
+
+    if (!m_PersistentMap)
+    {
+        VERIFY(m_pData == nullptr, "The buffer is already mapped");
+        // Mapping a staging buffer may synchronize with the GPU on these backends
+        void* pData = nullptr;
+        pContext->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_NONE, pData);
+        m_pData = static_cast<Uint8*>(pData);
+    }
+
+    m_SubmissionStart = m_Head;
+    m_SubmissionSize  = 0;
+    return m_pData != nullptr;
+}
+
+StagingUploadRing::Allocation StagingUploadRing::Allocate(Uint64 Size, Uint32 Alignment)
+{
+    VERIFY(m_pData != nullptr, "Begin() must be called before allocating");
+    VERIFY(IsPowerOfTwo(Alignment), "Alignment must be a power of two");
+
+    if (m_pData == nullptr || Size == 0)
+        return {};
+
+    // Free memory is [Head, Size) + [0, Tail) when Head is not before Tail, and [Head, Tail) otherwise
+    Uint64 Offset  = AlignUp(m_Head, Uint64{Alignment});
+    Uint64 Padding = Offset - m_Head;
+
+    bool Fits = false;
+    if (m_UsedSize == m_Size)
+    {
+        Fits = false;
+    }
+    else if (m_Head >= m_Tail)
+    {
+        if (Offset + Size <= m_Size)
+        {
+            Fits = true;
+        }
+        else if (Size <= m_Tail)
+        {
+            // Skip the end of the buffer and continue from the start
+            Padding = m_Size - m_Head;
+            Offset  = 0;
+            Fits    = true;
+        }
+    }
+    else
+    {
+        Fits = Offset + Size <= m_Tail;
+    }
+
+    if (!Fits)
+    {
+        ++m_NumFailedAllocations;
+        return {};
+    }
+
+    m_Head = Offset + Size;
+    m_UsedSize += Padding + Size;
+    m_SubmissionSize += Padding + Size;
+
+    Allocation Alloc;
+    Alloc.pData  = m_pData + Offset;
+    Alloc.Offset = Offset;
+    return Alloc;
+}
+
+void StagingUploadRing::End(IDeviceContext* pContext)
+{
+    if (m_pData == nullptr)
+        return;
+
+    if (m_SubmissionSize > 0 && m_PersistentMap && m_NeedsFlush)
+    {
+        if (m_Head > m_SubmissionStart)
+        {
+            m_pBuffer->FlushMappedRange(m_SubmissionStart, m_Head - m_SubmissionStart);
+        }
+        else
+        {
+            // The submission wrapped around the end of the buffer
+            m_pBuffer->FlushMappedRange(m_SubmissionStart, m_Size - m_SubmissionStart);
+            m_pBuffer->FlushMappedRange(0, m_Head);
+        }
+    }
+
+    if (!m_PersistentMap)
+    {
+        pContext->UnmapBuffer(m_pBuffer, MAP_WRITE);
+        m_pData = nullptr;
+    }
+
+    if (m_SubmissionSize > 0)
+    {
+        Submission Sub;
+        Sub.FenceValue = m_NextFenceValue++;
+        Sub.End        = m_Head;
+        Sub.Size       = m_SubmissionSize;
+        m_Submissions.push_back(Sub);
+
+        pContext->EnqueueSignal(m_pFence, Sub.FenceValue);
+        m_SubmissionSize = 0;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,192 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+// Headless stress test of FramePipeline, meant to be run under ThreadSanitizer as well. The simulation thread
+// fills every state with the id of its frame, and the render thread checks that it receives every frame exactly
+// once, in order, unmodified while it is acquired, and that the simulation never runs more than Depth frames ahead.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "FramePipeline.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+bool Check(bool Condition, const char* Message)
+{
+    if (!Condition)
+        std::printf("FAILED: %s\n", Message);
+    return Condition;
+}
+
+struct TestState
+{
+    Uint64              FrameId = ~Uint64{0};
+    std::vector<Uint64> Data;
+};
+
+void Work(Uint32 Iterations)
+{
+    volatile Uint32 x = 0;
+    for (Uint32 i = 0; i < Iterations; ++i)
+        x = x + i;
+}
+
+// ProducerWork and ConsumerWork set which side is slower, so that both of them have to wait
+bool TestFrames(Uint32 Depth, Uint32 NumFrames, Uint32 ProducerWork, Uint32 ConsumerWork)
+{
+    constexpr size_t DataSize = 1024;
+
+    std::atomic<Uint64> NumReleased{0};
+    std::atomic<bool>   SimulationFailed{false};
+
+    FramePipeline<TestState> Pipeline;
+    Pipeline.Start(Depth, [&](TestState& State, Uint64 FrameId, double ElapsedTime) {
+        // The slot must hold the frame simulated Depth frames earlier, and that frame must have been released
+        const Uint64 PrevFrameId = FrameId >= Depth ? FrameId - Depth : ~Uint64{0};
+        if (State.FrameId != PrevFrameId || FrameId >= NumReleased.load() + Depth || ElapsedTime < 0)
+            SimulationFailed.store(true);
+
+        State.FrameId = FrameId;
+        State.Data.assign(DataSize, FrameId);
+        Work(ProducerWork);
+    });
+
+    bool Passed = true;
+    for (Uint64 Frame = 0; Frame < NumFrames && Passed; ++Frame)
+    {
+        const TestState& State = Pipeline.AcquireFrame();
+        Passed = Check(Pipeline.GetAcquiredFrameId() == Frame && State.FrameId == Frame, "frames are acquired out of order") && Passed;
+
+        Work(ConsumerWork);
+        for (Uint64 Value : State.Data)
+        {
+            if (Value != Frame)
+            {
+                Passed = Check(false, "the state of an acquired frame was modified");
+                break;
+            }
+        }
+
+        NumReleased.store(Frame + 1);
+        Pipeline.ReleaseFrame();
+    }
+    Pipeline.Stop();
+
+    Passed = Check(!SimulationFailed.load(), "the simulation ran more than Depth frames ahead or reused a wrong slot") && Passed;
+    return Passed;
+}
+
+// Stop() must wake up the simulation thread that waits for a free slot, and the pipeline must be restartable
+bool TestStopRestart()
+{
+    FramePipeline<TestState> Pipeline;
+
+    bool Passed = true;
+    for (Uint32 Depth = 1; Depth <= 3; ++Depth)
+    {
+        Pipeline.Start(Depth, [](TestState& State, Uint64 FrameId, double) {
+            State.FrameId = FrameId;
+        });
+        for (Uint64 Frame = 0; Frame < 10; ++Frame)
+        {
+            Passed = Check(Pipeline.AcquireFrame().FrameId == Frame, "restarted pipeline does not begin with frame 0") && Passed;
+            Pipeline.ReleaseFrame();
+        }
+        // Let the simulation thread fill all slots and block
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        Pipeline.Stop();
+        Passed = Check(!Pipeline.IsRunning(), "pipeline is running after Stop()") && Passed;
+    }
+    return Passed;
+}
+
+// The render thread must block rather than spin while the simulation is slow. Only checked where std::clock()
+// measures the processor time of the process; on Windows it returns the wall time.
+bool TestBlockingWait()
+{
+#if PLATFORM_WIN32
+    return true;
+#else
+    constexpr Uint32 NumFrames = 5;
+
+    FramePipeline<TestState> Pipeline;
+    Pipeline.Start(1, [](TestState& State, Uint64 FrameId, double) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{40});
+        State.FrameId = FrameId;
+    });
+
+    const auto         WallStart = std::chrono::steady_clock::now();
+    const std::clock_t CpuStart  = std::clock();
+    for (Uint32 Frame = 0; Frame < NumFrames; ++Frame)
+    {
+        Pipeline.AcquireFrame();
+        Pipeline.ReleaseFrame();
+    }
+    const double CpuMs  = static_cast<double>(std::clock() - CpuStart) * 1000.0 / CLOCKS_PER_SEC;
+    const double WallMs = std::chrono::duration<double, std::milli>{std::chrono::steady_clock::now() - WallStart}.count();
+    Pipeline.Stop();
+
+    std::printf("    %.0f ms of processor time in %.0f ms of waiting\n", CpuMs, WallMs);
+    return Check(CpuMs < WallMs * 0.25, "the render thread spins while it waits for the simulation");
+#endif
+}
+
+} // namespace
+
+int main()
+{
+    bool Passed = true;
+
+    for (Uint32 Depth = 1; Depth <= 4; ++Depth)
+    {
+        const bool SlowConsumer = TestFrames(Depth, 3000, 100, 5000);
+        const bool SlowProducer = TestFrames(Depth, 3000, 5000, 100);
+        const bool Balanced     = TestFrames(Depth, 3000, 0, 0);
+        std::printf("Depth %u: slow render thread %s, slow simulation %s, no work %s\n", Depth,
+                    SlowConsumer ? "passed" : "FAILED", SlowProducer ? "passed" : "FAILED", Balanced ? "passed" : "FAILED");
+        Passed = SlowConsumer && SlowProducer && Balanced && Passed;
+    }
+
+    const bool StopPassed = TestStopRestart();
+    std::printf("Stop with a blocked simulation thread, restart: %s\n", StopPassed ? "passed" : "FAILED");
+    Passed = StopPassed && Passed;
+
+    const bool BlockingPassed = TestBlockingWait();
+    std::printf("Blocking wait: %s\n", BlockingPassed ? "passed" : "FAILED");
+    Passed = BlockingPassed && Passed;
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
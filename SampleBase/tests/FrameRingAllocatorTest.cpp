@@ -0,0 +1,258 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+// Headless test of FrameRingAllocator. The allocator is driven with CPU memory through BeginMapped()/EndMapped()
+// the same way Begin()/End() drive it with a dynamic buffer: every map of every context slot gets a new region
+// of a simulated dynamic heap that is reused after NumFramesInFlight frames.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "FrameRingAllocator.hpp"
+#include "Align.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+constexpr Uint32 NumFramesInFlight = 3;
+
+bool Check(bool Condition, const char* Message)
+{
+    if (!Condition)
+        std::printf("FAILED: %s\n", Message);
+    return Condition;
+}
+
+// CPU stand-in for the dynamic heap of the engine: one region per frame in flight and per context slot
+class CpuDynamicHeap
+{
+public:
+    CpuDynamicHeap(Uint64 RegionSize, Uint32 NumContextSlots) :
+        m_RegionSize{RegionSize},
+        m_NumContextSlots{NumContextSlots},
+        m_Memory(static_cast<size_t>(RegionSize * NumFramesInFlight * NumContextSlots))
+    {}
+
+    Uint8* Map(Uint64 Frame, Uint32 ContextSlot)
+    {
+        const Uint64 Region = (Frame % NumFramesInFlight) * m_NumContextSlots + ContextSlot;
+        return m_Memory.data() + Region * m_RegionSize;
+    }
+
+private:
+    const Uint64       m_RegionSize;
+    const Uint32       m_NumContextSlots;
+    std::vector<Uint8> m_Memory;
+};
+
+bool TestAllocation()
+{
+    constexpr Uint32 Alignment = 256;
+
+    FrameRingAllocator Allocator;
+    Allocator.Initialize(4000, Alignment, 1);
+
+    bool Passed = Check(Allocator.GetSize() == 4096, "size is not aligned up");
+    Passed      = Check(Allocator.GetAlignment() == Alignment, "wrong alignment") && Passed;
+
+    std::vector<Uint8> Memory(static_cast<size_t>(Allocator.GetSize()));
+    Passed = Check(Allocator.BeginMapped(0, Memory.data()), "BeginMapped() failed") && Passed;
+    Passed = Check(Allocator.GetUsedSize(0) == 0, "used size is not reset by BeginMapped()") && Passed;
+
+    // Sizes that are not multiples of the alignment
+    const Uint32 Sizes[] = {1, 100, 256, 257, 1000};
+    Uint64       End     = 0;
+    for (Uint32 Size : Sizes)
+    {
+        const auto Alloc = Allocator.Allocate(0, Size);
+        Passed           = Check(static_cast<bool>(Alloc), "allocation that fits failed") && Passed;
+        if (!Alloc)
+            continue;
+        Passed = Check(Alloc.Offset % Alignment == 0, "offset is not aligned") && Passed;
+        Passed = Check(Alloc.Offset >= End, "allocation overlaps the previous one") && Passed;
+        Passed = Check(Alloc.pData == Memory.data() + Alloc.Offset, "pointer does not match the offset") && Passed;
+        End    = Alloc.Offset + Size;
+        Passed = Check(Allocator.GetUsedSize(0) == End, "wrong used size") && Passed;
+        std::memset(Alloc.pData, 0xAB, Size);
+    }
+
+    // The last allocation ends at 2280, the next aligned offset is 2304
+    Uint32 Offset = ~0u;
+    Passed        = Check(Allocator.Allocate<Uint8[1024]>(0, Offset) != nullptr && Offset == 2304, "typed allocation failed") && Passed;
+
+    // Out of space: 768 bytes are left. The failed allocation does not change the state, a smaller one still fits exactly
+    const Uint64 UsedSize = Allocator.GetUsedSize(0);
+    const auto   TooLarge = Allocator.Allocate(0, 769);
+    Passed                = Check(!TooLarge && TooLarge.Offset == 0, "allocation past the end succeeded") && Passed;
+    Passed                = Check(Allocator.GetUsedSize(0) == UsedSize, "failed allocation changed the used size") && Passed;
+    const auto ExactFit   = Allocator.Allocate(0, 768);
+    Passed                = Check(ExactFit && ExactFit.Offset == 3328, "allocation that exactly fits failed") && Passed;
+    Passed                = Check(!Allocator.Allocate(0, 1), "allocation in a full buffer succeeded") && Passed;
+
+    Passed = Check(Allocator.EndMapped(0), "EndMapped() of a mapped slot returned false") && Passed;
+    Passed = Check(!Allocator.EndMapped(0), "EndMapped() of an unmapped slot returned true") && Passed;
+
+    // The next map starts from the beginning
+    Passed = Check(Allocator.BeginMapped(0, Memory.data()), "second BeginMapped() failed") && Passed;
+    Passed = Check(Allocator.GetUsedSize(0) == 0, "used size is not reset by the second BeginMapped()") && Passed;
+    const auto First = Allocator.Allocate(0, 16);
+    Passed           = Check(First && First.Offset == 0, "first allocation after the second BeginMapped() is not at offset 0") && Passed;
+    Allocator.EndMapped(0);
+
+    // Failed map
+    Passed = Check(!Allocator.BeginMapped(0, nullptr), "BeginMapped() with null memory succeeded") && Passed;
+    Passed = Check(!Allocator.EndMapped(0), "EndMapped() after a failed BeginMapped() returned true") && Passed;
+
+    return Passed;
+}
+
+// Every allocation is filled with a value that identifies the frame, the slot and the allocation. After every frame,
+// the data of all frames in flight must be intact, and after NumFramesInFlight frames the allocator must start
+// from the beginning of the region it was given again.
+bool TestFrames(Uint32 NumContextSlots, bool Threaded)
+{
+    constexpr Uint32 Alignment = 64;
+    constexpr Uint64 Size      = 16384;
+    constexpr Uint32 NumFrames = 200;
+
+    FrameRingAllocator Allocator;
+    Allocator.Initialize(Size, Alignment, NumContextSlots);
+    CpuDynamicHeap Heap{Allocator.GetSize(), NumContextSlots};
+
+    struct Record
+    {
+        Uint8* pData;
+        Uint32 Size;
+        Uint8  Value;
+    };
+    // Allocations of every frame in flight and every slot
+    std::vector<std::vector<Record>> Records(NumFramesInFlight * NumContextSlots);
+    std::vector<int>                 SlotPassed(NumContextSlots, 1);
+
+    const auto RecordSlot = [&](Uint64 Frame, Uint32 Slot) {
+        std::mt19937 Rng{static_cast<Uint32>(Frame * 131 + Slot)};
+        auto&        FrameRecords = Records[(Frame % NumFramesInFlight) * NumContextSlots + Slot];
+        FrameRecords.clear();
+
+        Uint8* const pRegion = Heap.Map(Frame, Slot);
+        bool         Passed  = Allocator.BeginMapped(Slot, pRegion);
+        Uint64       End     = 0;
+        for (;;)
+        {
+            const Uint32 AllocSize = 1 + Rng() % 1024;
+            const auto   Alloc     = Allocator.Allocate(Slot, AllocSize);
+            if (!Alloc)
+            {
+                // The slot only runs out of space when the allocation does not fit
+                Passed = Passed && (AlignUp(End, Uint64{Alignment}) + AllocSize > Allocator.GetSize());
+                break;
+            }
+            Passed = Passed && Alloc.Offset % Alignment == 0 && Alloc.Offset >= End && Alloc.Offset + AllocSize <= Allocator.GetSize();
+            Passed = Passed && static_cast<Uint8*>(Alloc.pData) == pRegion + Alloc.Offset;
+            // The first allocation of every map, including the maps that reuse a region, starts at the beginning
+            Passed = Passed && (End != 0 || Alloc.Offset == 0);
+            End    = Alloc.Offset + AllocSize;
+
+            const auto Value = static_cast<Uint8>(Frame * 7 + Slot * 3 + FrameRecords.size());
+            std::memset(Alloc.pData, Value, AllocSize);
+            FrameRecords.push_back({static_cast<Uint8*>(Alloc.pData), AllocSize, Value});
+        }
+        Passed = Allocator.EndMapped(Slot) && Passed;
+        if (!Passed)
+            SlotPassed[Slot] = 0;
+    };
+
+    bool Passed = true;
+    for (Uint64 Frame = 0; Frame < NumFrames && Passed; ++Frame)
+    {
+        if (Threaded)
+        {
+            std::vector<std::thread> Threads;
+            for (Uint32 Slot = 0; Slot < NumContextSlots; ++Slot)
+                Threads.emplace_back(RecordSlot, Frame, Slot);
+            for (auto& Thread : Threads)
+                Thread.join();
+        }
+        else
+        {
+            for (Uint32 Slot = 0; Slot < NumContextSlots; ++Slot)
+                RecordSlot(Frame, Slot);
+        }
+
+        for (Uint32 Slot = 0; Slot < NumContextSlots; ++Slot)
+            Passed = Check(SlotPassed[Slot] != 0, "invalid allocation") && Passed;
+
+        // The frames that the GPU may still be reading must not have been overwritten
+        for (const auto& FrameRecords : Records)
+        {
+            for (const auto& Rec : FrameRecords)
+            {
+                for (Uint32 i = 0; i < Rec.Size; ++i)
+                {
+                    if (Rec.pData[i] != Rec.Value)
+                    {
+                        Passed = Check(false, "data of a frame in flight was overwritten");
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return Passed;
+}
+
+} // namespace
+
+int main()
+{
+    bool Passed = true;
+
+    const bool AllocationPassed = TestAllocation();
+    std::printf("Allocation, alignment, out of space, end: %s\n", AllocationPassed ? "passed" : "FAILED");
+    Passed = AllocationPassed && Passed;
+
+    const bool FramesPassed = TestFrames(1, false);
+    std::printf("Frame wrap-around, 1 context slot: %s\n", FramesPassed ? "passed" : "FAILED");
+    Passed = FramesPassed && Passed;
+
+    const bool SlotsPassed = TestFrames(4, false);
+    std::printf("Frame wrap-around, 4 context slots: %s\n", SlotsPassed ? "passed" : "FAILED");
+    Passed = SlotsPassed && Passed;
+
+    const bool ThreadsPassed = TestFrames(4, true);
+    std::printf("Frame wrap-around, 4 context slots on 4 threads: %s\n", ThreadsPassed ? "passed" : "FAILED");
+    Passed = ThreadsPassed && Passed;
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+// Headless stress test of MPMCQueue, meant to be run under ThreadSanitizer as well. Several producers push
+// tagged items through a small queue that several consumers drain at the same time. Every item must be popped
+// exactly once, and items of the same producer must reach every consumer in the order they were pushed.
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "MPMCQueue.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+bool Check(bool Condition, const char* Message)
+{
+    if (!Condition)
+        std::printf("FAILED: %s\n", Message);
+    return Condition;
+}
+
+// Producer index in the upper bits, item index in the lower bits
+constexpr Uint32 ItemIdxBits = 24;
+constexpr Uint32 ItemIdxMask = (1u << ItemIdxBits) - 1;
+
+// Push until the queue is full, pop until it is empty, and do it again to wrap the sequence numbers around
+bool TestSingleThread()
+{
+    MPMCQueue<Uint32> Queue{5};
+
+    bool Passed = Check(Queue.GetCapacity() == 8, "capacity is not rounded up to a power of two");
+    for (Uint32 Lap = 0; Lap < 3; ++Lap)
+    {
+        for (Uint32 i = 0; i < Queue.GetCapacity(); ++i)
+            Passed = Check(Queue.TryPush(Lap * 100 + i), "push to a queue that is not full failed") && Passed;
+        Passed = Check(!Queue.TryPush(0), "push to a full queue succeeded") && Passed;
+
+        for (Uint32 i = 0; i < Queue.GetCapacity(); ++i)
+        {
+            Uint32 Item = ~0u;
+            Passed      = Check(Queue.TryPop(Item) && Item == Lap * 100 + i, "items are popped out of order") && Passed;
+        }
+        Uint32 Item = 0;
+        Passed      = Check(!Queue.TryPop(Item), "pop from an empty queue succeeded") && Passed;
+    }
+    return Passed;
+}
+
+bool TestThreads(Uint32 NumProducers, Uint32 NumConsumers, Uint32 Capacity, Uint32 NumItemsPerProducer)
+{
+    MPMCQueue<Uint32> Queue{Capacity};
+
+    std::atomic<Uint32> NumPopped{0};
+    std::atomic<bool>   OrderFailed{false};
+
+    // Every consumer records the items it has popped, they are checked after all threads are joined
+    std::vector<std::vector<Uint32>> Popped(NumConsumers);
+
+    std::vector<std::thread> Threads;
+    for (Uint32 p = 0; p < NumProducers; ++p)
+    {
+        Threads.emplace_back([&Queue, p, NumItemsPerProducer]() {
+            for (Uint32 i = 0; i < NumItemsPerProducer; ++i)
+            {
+                while (!Queue.TryPush((p << ItemIdxBits) | i))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    const Uint32 NumItems = NumProducers * NumItemsPerProducer;
+    for (Uint32 c = 0; c < NumConsumers; ++c)
+    {
+        Threads.emplace_back([&, c]() {
+            std::vector<Uint32> LastIdx(NumProducers, ~0u);
+            while (NumPopped.load() < NumItems)
+            {
+                Uint32 Item = 0;
+                if (!Queue.TryPop(Item))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                NumPopped.fetch_add(1);
+
+                const Uint32 Producer = Item >> ItemIdxBits;
+                const Uint32 ItemIdx  = Item & ItemIdxMask;
+                if (Producer >= NumProducers || (LastIdx[Producer] != ~0u && ItemIdx <= LastIdx[Producer]))
+                    OrderFailed.store(true);
+                else
+                    LastIdx[Producer] = ItemIdx;
+                Popped[c].push_back(Item);
+            }
+        });
+    }
+
+    for (auto& Thread : Threads)
+        Thread.join();
+
+    bool Passed = Check(!OrderFailed.load(), "items of one producer are popped out of order");
+
+    std::vector<Uint32> Count(NumItems, 0);
+    for (const auto& Items : Popped)
+    {
+        for (Uint32 Item : Items)
+        {
+            const Uint32 Producer = Item >> ItemIdxBits;
+            if (Producer < NumProducers)
+                ++Count[Producer * NumItemsPerProducer + (Item & ItemIdxMask)];
+        }
+    }
+    for (Uint32 n : Count)
+    {
+        if (n != 1)
+        {
+            Passed = Check(false, n == 0 ? "an item was lost" : "an item was popped more than once");
+            break;
+        }
+    }
+
+    Uint32 Item = 0;
+    Passed      = Check(!Queue.TryPop(Item), "queue is not empty after all items were popped") && Passed;
+    return Passed;
+}
+
+} // namespace
+
+int main()
+{
+    bool Passed = true;
+
+    const bool SingleThreadPassed = TestSingleThread();
+    std::printf("Single thread, full and empty queue: %s\n", SingleThreadPassed ? "passed" : "FAILED");
+    Passed = SingleThreadPassed && Passed;
+
+    struct
+    {
+        Uint32 NumProducers;
+        Uint32 NumConsumers;
+        Uint32 Capacity;
+    } const Configs[] = {
+        {1, 1, 4},
+        {4, 1, 16},
+        {1, 4, 16},
+        {4, 4, 2},
+        {4, 4, 64},
+    };
+    for (const auto& Cfg : Configs)
+    {
+        const bool ConfigPassed = TestThreads(Cfg.NumProducers, Cfg.NumConsumers, Cfg.Capacity, 100000);
+        std::printf("%u producers, %u consumers, capacity %u: %s\n", Cfg.NumProducers, Cfg.NumConsumers, Cfg.Capacity,
+                    ConfigPassed ? "passed" : "FAILED");
+        Passed = ConfigPassed && Passed;
+    }
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
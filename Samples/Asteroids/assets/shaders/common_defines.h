@@ -3,4 +3,7 @@
 
 #define NUM_UNIQUE_TEXTURES 10
 
+// Asteroid vertex positions are stored as snorm values of position / MESH_POSITION_SCALE
+#define MESH_POSITION_SCALE 2.0f
+
 #endif
@@ -21,11 +21,13 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <cfloat>
 
 #include "asteroids_d3d11.h"
 #include "asteroids_d3d12.h"
 #include "asteroids_DE.h"
 #include "camera.h"
+#include "sim_benchmark.h"
 #include "gui.h"
 
 using namespace DirectX;
@@ -193,7 +195,7 @@ LRESULT CALLBACK WindowProc(
                 return 0;
             case 'B':
                 if (gSettings.mode == Settings::RenderMode::DiligentD3D12 || gSettings.mode == Settings::RenderMode::DiligentVulkan) {
-                    gSettings.resourceBindingMode = (gSettings.resourceBindingMode + 1) % 4;
+                    gSettings.resourceBindingMode = (gSettings.resourceBindingMode + 1) % 5;
                     gUpdateWorkload = true;
                 }
                 return 0;
@@ -415,6 +417,8 @@ int main(int argc, char** argv)
             gSettings.mode = gd3d12Available ? Settings::RenderMode::DiligentD3D12 : Settings::RenderMode::Undefined;
         } else if (_stricmp(argv[a], "-vk") == 0) {
             gSettings.mode = gVulkanAvailable ? Settings::RenderMode::DiligentVulkan : Settings::RenderMode::Undefined;
+        } else if (_stricmp(argv[a], "-sim_benchmark") == 0) {
+            return RunSimulationBenchmark();
         } else {
             fprintf(stderr, "error: unrecognized argument '%s'\n", argv[a]);
             fprintf(stderr, "usage: asteroids_d3d12 [options]\n");
@@ -427,6 +431,7 @@ int main(int argc, char** argv)
             fprintf(stderr, "  -render_scale [scale]\n");
             fprintf(stderr, "  -locked_fps [fps]\n");
             fprintf(stderr, "  -warp\n");
+            fprintf(stderr, "  -sim_benchmark\n");
             return -1;
         }
     }
@@ -580,6 +585,7 @@ int main(int argc, char** argv)
                         case 1: resBindModeStr = "-mut";break;
                         case 2: resBindModeStr = "-tex_mut";break;
                         case 3: resBindModeStr = "-bindless";break;
+                        case 4: resBindModeStr = "-instanced";break;
                     }
                 break;
             }
@@ -593,6 +599,20 @@ int main(int argc, char** argv)
             sprintf_s(buffer, "Asteroids %s%s (%dt) - %4.1f ms (%4.1f ms / %4.1f ms)", ModeStr, resBindModeStr, (gSettings.multithreadedRendering ? gSettings.numThreads : 1), 
                               1000.f * filteredFrameTime, 1000.f * filteredUpdateTime, 1000.f * filteredRenderTime);
 
+            if (gWorkloadDE != nullptr && gSettings.multithreadedRendering) {
+                // Spread of the per-thread busy time shows how well the job system balances the frame
+                float minBusyTime = FLT_MAX, maxBusyTime = 0.0f;
+                unsigned int stolenJobs = 0;
+                for (unsigned int t = 0; t < gWorkloadDE->GetThreadCount(); ++t) {
+                    auto stats = gWorkloadDE->GetThreadStats(t);
+                    minBusyTime = std::min(minBusyTime, (float)stats.BusyTimeMs);
+                    maxBusyTime = std::max(maxBusyTime, (float)stats.BusyTimeMs);
+                    stolenJobs += stats.NumStolenJobs;
+                }
+                auto len = strlen(buffer);
+                sprintf_s(buffer + len, sizeof(buffer) - len, " - thread busy %4.1f..%4.1f ms, %u stolen", minBusyTime, maxBusyTime, stolenJobs);
+            }
+
             SetWindowText(hWnd, buffer);
 
             if (gSettings.lockFrameRate) {
@@ -39,6 +39,7 @@
 #endif
 
 #include "MapHelper.hpp"
+#include "Align.hpp"
 
 #include "util.h"
 #include "mesh.h"
@@ -108,7 +109,8 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
     SwapChainDesc.DepthBufferFormat = TEX_FORMAT_D32_FLOAT;
     SwapChainDesc.DefaultDepthValue = 0.f;
 
-    std::vector<IDeviceContext*> ppContexts(mNumSubsets);
+    // Immediate context and one deferred context per thread of the job system
+    std::vector<IDeviceContext*> ppContexts(1 + mNumThreads);
 
     switch (DevType)
     {
@@ -116,7 +118,7 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
         case RENDER_DEVICE_TYPE_D3D11:
         {
             EngineD3D11CreateInfo EngineCI;
-            EngineCI.NumDeferredContexts = mNumSubsets - 1;
+            EngineCI.NumDeferredContexts = mNumThreads;
 
 #    if ENGINE_DLL
             if (GetEngineFactoryD3D11 == nullptr)
@@ -134,7 +136,7 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
         case RENDER_DEVICE_TYPE_D3D12:
         {
             EngineD3D12CreateInfo EngineCI;
-            EngineCI.NumDeferredContexts             = mNumSubsets - 1;
+            EngineCI.NumDeferredContexts             = mNumThreads;
             EngineCI.GPUDescriptorHeapDynamicSize[0] = 65536 * 4;
             EngineCI.GPUDescriptorHeapSize[0]        = 65536; // For mutable mode
 #    ifndef DILIGENT_DEBUG
@@ -156,7 +158,7 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
         case RENDER_DEVICE_TYPE_VULKAN:
         {
             EngineVkCreateInfo EngineCI;
-            EngineCI.NumDeferredContexts = mNumSubsets - 1;
+            EngineCI.NumDeferredContexts = mNumThreads;
             EngineCI.DynamicHeapSize     = 64 << 20;
 
             const char* const ppIgnoreDebugMessages[] = //
@@ -205,8 +207,8 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
     if (DevType == RENDER_DEVICE_TYPE_D3D11 || DevType == RENDER_DEVICE_TYPE_D3D12 || DevType == RENDER_DEVICE_TYPE_VULKAN)
     {
         mDeviceCtxt.Attach(ppContexts[0]);
-        mDeferredCtxt.resize(mNumSubsets - 1);
-        for (size_t ctx = 0; ctx < mNumSubsets - 1; ++ctx)
+        mDeferredCtxt.resize(mNumThreads);
+        for (size_t ctx = 0; ctx < mNumThreads; ++ctx)
             mDeferredCtxt[ctx].Attach(ppContexts[1 + ctx]);
     }
 }
@@ -216,21 +218,34 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
 {
     QueryPerformanceFrequency((LARGE_INTEGER*)&mPerfCounterFreq);
 
-    mNumSubsets = std::max(settings.numThreads, 1);
-    mNumSubsets = std::min(settings.numThreads, 32);
+    mNumThreads = static_cast<Uint32>(std::min(std::max(settings.numThreads, 1), 32));
 
     InitDevice(hWnd, DevType);
 
     m_BindingMode = static_cast<BindingMode>(settings.resourceBindingMode);
-    if (m_BindingMode == BindingMode::Bindless && !mDevice->GetDeviceInfo().Features.BindlessResources)
+    if (UsesAsteroidDataBuffer() && !mDevice->GetDeviceInfo().Features.BindlessResources)
         m_BindingMode = BindingMode::TextureMutable;
 
-    mCmdLists.resize(mDeferredCtxt.size());
-    mWorkerThreads.resize(mNumSubsets - 1);
-    for (auto& thread : mWorkerThreads)
-    {
-        thread = std::thread(WorkerThreadFunc, this, (Uint32)(&thread - mWorkerThreads.data()));
-    }
+    mJobSystem.reset(new JobSystem(mNumThreads));
+    mThreadStats.resize(mNumThreads);
+
+    for (Uint32 ctx = 0; ctx < mDeferredCtxt.size(); ++ctx)
+        mFreeDeferredCtxts.push_back(ctx);
+
+    // Several recording jobs per thread, so that the threads can balance the load by stealing jobs
+    const Uint32 RecordJobsPerThread = 4;
+    mDrawsPerJob   = (NUM_ASTEROIDS + mNumThreads * RecordJobsPerThread - 1) / (mNumThreads * RecordJobsPerThread);
+    // Subsets are also the update jobs, keep them aligned to the simulation blocks
+    mDrawsPerJob   = (mDrawsPerJob + SIM_BLOCK_SIZE - 1) / SIM_BLOCK_SIZE * SIM_BLOCK_SIZE;
+    mNumRecordJobs = (NUM_ASTEROIDS + mDrawsPerJob - 1) / mDrawsPerJob;
+    mCmdLists.resize(mNumRecordJobs);
+    mVisibleIndices.resize(mNumRecordJobs);
+    for (auto& indices : mVisibleIndices)
+        indices.resize(mDrawsPerJob);
+    mNumVisible.resize(mNumRecordJobs);
+
+    // Resources that are modified while recording are duplicated for every context that records concurrently
+    const auto NumContextSlots = static_cast<Uint32>(std::max<size_t>(mDeferredCtxt.size(), 1));
 
     const char* spriteFile = nullptr;
     switch (DevType)
@@ -249,23 +264,27 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
     std::vector<StateTransitionDesc> Barriers;
     mBackBufferWidth                = mSwapChain->GetDesc().Width;
     mBackBufferHeight               = mSwapChain->GetDesc().Height;
-    const auto MaxAsteroidsInSubset = (NUM_ASTEROIDS + mNumSubsets - 1) / mNumSubsets;
 
+    const Uint32 drawConstantsStride = AlignUp(static_cast<Uint32>(sizeof(DrawConstantBuffer)), FrameRingAllocator::GetOffsetAlignment(mDevice, BIND_UNIFORM_BUFFER));
+    if (UsesAsteroidDataBuffer())
     {
         BufferDesc desc;
         desc.Name = "Asteroids constant buffer";
         // In bindless mode we will be updating the buffer with UpdateBuffer method
-        desc.Usage          = (m_BindingMode == BindingMode::Bindless) ? USAGE_DEFAULT : USAGE_DYNAMIC;
-        desc.CPUAccessFlags = desc.Usage == USAGE_DYNAMIC ? CPU_ACCESS_WRITE : CPU_ACCESS_NONE;
-        desc.BindFlags      = BIND_UNIFORM_BUFFER;
+        desc.Usage     = USAGE_DEFAULT;
+        desc.BindFlags = BIND_UNIFORM_BUFFER;
         // In bindless mode, we will only write view-projection matrix
-        desc.Size = static_cast<Uint32>((m_BindingMode == BindingMode::Bindless) ? sizeof(DirectX::XMFLOAT4X4) : sizeof(DrawConstantBuffer));
+        desc.Size = static_cast<Uint32>(sizeof(DirectX::XMFLOAT4X4));
         mDevice->CreateBuffer(desc, nullptr, &mDrawConstantBuffer);
-        if (m_BindingMode != BindingMode::Bindless)
-            Barriers.emplace_back(mDrawConstantBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    }
+    else
+    {
+        // Every recording job allocates the constants of all its draws from the ring at once
+        mDrawConstants.Create(mDevice, "Asteroids constant buffer", BIND_UNIFORM_BUFFER, Uint64{drawConstantsStride} * mDrawsPerJob, NumContextSlots);
+        Barriers.emplace_back(mDrawConstants.GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
 
-    if (m_BindingMode == BindingMode::Bindless)
+    if (UsesAsteroidDataBuffer())
     {
         {
             // In Direct3D there is no easy way to pass draw call number into the shader,
@@ -275,8 +294,8 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             desc.Name      = "Instance ID buffer";
             desc.Usage     = USAGE_IMMUTABLE;
             desc.BindFlags = BIND_VERTEX_BUFFER;
-            desc.Size      = static_cast<Uint64>(sizeof(Uint32)) * MaxAsteroidsInSubset;
-            std::vector<Uint32> Ids(MaxAsteroidsInSubset);
+            desc.Size      = static_cast<Uint64>(sizeof(Uint32)) * mDrawsPerJob;
+            std::vector<Uint32> Ids(mDrawsPerJob);
             for (Uint32 i = 0; i < Ids.size(); ++i)
                 Ids[i] = i;
             BufferData Data{Ids.data(), desc.Size};
@@ -294,13 +313,20 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             desc.Mode              = BUFFER_MODE_STRUCTURED;
             desc.CPUAccessFlags    = CPU_ACCESS_WRITE;
             desc.ElementByteStride = static_cast<Uint32>(sizeof(AsteroidData));
-            desc.Size              = desc.ElementByteStride * MaxAsteroidsInSubset;
-            mAsteroidsDataBuffers.resize(mNumSubsets);
-            for (Uint32 i = 0; i < mNumSubsets; ++i)
+            desc.Size              = desc.ElementByteStride * mDrawsPerJob;
+            mAsteroidsDataBuffers.resize(NumContextSlots);
+            for (Uint32 i = 0; i < NumContextSlots; ++i)
             {
                 mDevice->CreateBuffer(desc, nullptr, &mAsteroidsDataBuffers[i]);
             }
         }
+
+        if (m_BindingMode == BindingMode::Instanced)
+        {
+            mInstanceOrder.resize(NumContextSlots);
+            for (auto& order : mInstanceOrder)
+                order.reserve(mDrawsPerJob);
+        }
     }
 
     // create pipeline state
@@ -312,15 +338,15 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         // clang-format off
         LayoutElement inputDesc[] =
         {
-            LayoutElement{0, 0, 3, VT_FLOAT32, false, 0, sizeof(Vertex)},
-            LayoutElement{1, 0, 3, VT_FLOAT32},
+            LayoutElement{0, 0, 4, VT_INT16, True, 0, sizeof(PackedVertex)},
+            LayoutElement{1, 0, 2, VT_INT16, True},
             LayoutElement{2, 1, 1, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
         };
         // clang-format on
 
         GraphicsPipeline.InputLayout.LayoutElements = inputDesc;
         // In bindless mode we will use instance ID buffer as the third input
-        GraphicsPipeline.InputLayout.NumElements = (m_BindingMode == BindingMode::Bindless) ? 3 : 2;
+        GraphicsPipeline.InputLayout.NumElements = UsesAsteroidDataBuffer() ? 3 : 2;
 
         GraphicsPipeline.DepthStencilDesc.DepthFunc = COMPARISON_FUNC_GREATER_EQUAL;
 
@@ -334,7 +360,7 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             attribs.pShaderSourceStreamFactory = pShaderSourceFactory;
 
             ShaderMacro Macros[] = {{"BINDLESS", "1"}};
-            if (m_BindingMode == BindingMode::Bindless)
+            if (UsesAsteroidDataBuffer())
             {
                 attribs.Macros = {Macros, _countof(Macros)};
             }
@@ -351,7 +377,7 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
             attribs.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
 
             ShaderMacro Macros[] = {{"BINDLESS", "1"}};
-            if (m_BindingMode == BindingMode::Bindless)
+            if (UsesAsteroidDataBuffer())
             {
                 attribs.Macros = {Macros, _countof(Macros)};
             }
@@ -380,8 +406,10 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         std::vector<ShaderResourceVariableDesc> Variables =
             {
                 {SHADER_TYPE_PIXEL, "Tex", m_BindingMode == BindingMode::Dynamic ? SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC : SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
-        if (m_BindingMode == BindingMode::Bindless)
+        if (UsesAsteroidDataBuffer())
             Variables.emplace_back(SHADER_TYPE_VERTEX, "g_Data", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE);
+        else
+            Variables.emplace_back(SHADER_TYPE_VERTEX, "DrawConstantBuffer", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE); // Bound by offset
 
         PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
         PSODesc.ResourceLayout.Variables           = Variables.data();
@@ -397,30 +425,33 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         PSOCreateInfo.pVS = vs;
         PSOCreateInfo.pPS = ps;
         mDevice->CreateGraphicsPipelineState(PSOCreateInfo, &mAsteroidsPSO);
-        mAsteroidsPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "DrawConstantBuffer")->Set(mDrawConstantBuffer);
+        if (UsesAsteroidDataBuffer())
+            mAsteroidsPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "DrawConstantBuffer")->Set(mDrawConstantBuffer);
 
         Uint32 NumSRBs = 0;
         if (m_BindingMode == BindingMode::Dynamic)
         {
-            // Create one SRB per subset for dynamic binding mode
-            NumSRBs = mNumSubsets;
+            // Create one SRB per context for dynamic binding mode
+            NumSRBs = NumContextSlots;
         }
         else if (m_BindingMode == BindingMode::Mutable)
         {
-            // Create one SRB per asteroid in mutable binding mode
+            // Create one SRB per asteroid in mutable binding mode. Every asteroid is only drawn by
+            // one recording job, so its SRB is never used by two contexts at the same time.
             PSODesc.SRBAllocationGranularity = 1024;
             NumSRBs                          = NUM_ASTEROIDS;
         }
         else if (m_BindingMode == BindingMode::TextureMutable)
         {
-            // Create one SRB per texture in texture-mutable binding mode
+            // Create one SRB per texture per context in texture-mutable binding mode
+            // as every context moves the draw constants to its own offsets
             PSODesc.SRBAllocationGranularity = NUM_UNIQUE_TEXTURES;
-            NumSRBs                          = NUM_UNIQUE_TEXTURES;
+            NumSRBs                          = NUM_UNIQUE_TEXTURES * NumContextSlots;
         }
-        else if (m_BindingMode == BindingMode::Bindless)
+        else if (UsesAsteroidDataBuffer())
         {
-            // Create one SRB per subset for bindless mode
-            NumSRBs = mNumSubsets;
+            // Create one SRB per context for bindless mode
+            NumSRBs = NumContextSlots;
         }
         mAsteroidsSRBs.resize(NumSRBs);
         for (size_t srb = 0; srb < mAsteroidsSRBs.size(); ++srb)
@@ -626,23 +657,34 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
     else if (m_BindingMode == BindingMode::TextureMutable)
     {
         // Bind the corresponding texture to the textures's SRB
-        for (size_t srb = 0; srb < NUM_UNIQUE_TEXTURES; ++srb)
+        for (size_t srb = 0; srb < mAsteroidsSRBs.size(); ++srb)
         {
-            mAsteroidsSRBs[srb]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex")->Set(mTextureSRVs[srb]);
+            mAsteroidsSRBs[srb]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex")->Set(mTextureSRVs[srb % NUM_UNIQUE_TEXTURES]);
         }
     }
-    else if (m_BindingMode == BindingMode::Bindless)
+    else if (UsesAsteroidDataBuffer())
     {
         // Bind all textures to every subset's SRB. The textures will be dynamically indexed in the shader.
         IDeviceObject* SRVArray[NUM_UNIQUE_TEXTURES];
         for (Uint32 t = 0; t < NUM_UNIQUE_TEXTURES; ++t)
             SRVArray[t] = mTextureSRVs[t];
-        for (Uint32 i = 0; i < mNumSubsets; ++i)
+        for (Uint32 i = 0; i < NumContextSlots; ++i)
         {
             mAsteroidsSRBs[i]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex")->SetArray(SRVArray, 0, NUM_UNIQUE_TEXTURES);
             mAsteroidsSRBs[i]->GetVariableByName(SHADER_TYPE_VERTEX, "g_Data")->Set(mAsteroidsDataBuffers[i]->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
         }
     }
+
+    if (!UsesAsteroidDataBuffer())
+    {
+        // The range covers the constants of one draw. RenderSubset() moves it to the constants of every draw.
+        mDrawConstantsVars.resize(mAsteroidsSRBs.size());
+        for (size_t srb = 0; srb < mAsteroidsSRBs.size(); ++srb)
+        {
+            mDrawConstantsVars[srb] = mAsteroidsSRBs[srb]->GetVariableByName(SHADER_TYPE_VERTEX, "DrawConstantBuffer");
+            mDrawConstantsVars[srb]->SetBufferRange(mDrawConstants.GetBuffer(), 0, drawConstantsStride);
+        }
+    }
     mDeviceCtxt->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 }
 
@@ -651,12 +693,7 @@ Asteroids::~Asteroids()
     mDeviceCtxt->Flush();
     mDeviceCtxt->FinishFrame();
 
-    mUpdateSubsetsSignal.Trigger(true, -1);
-
-    for (auto& thread : mWorkerThreads)
-    {
-        thread.join();
-    }
+    mJobSystem.reset();
 }
 
 
@@ -675,14 +712,18 @@ void Asteroids::CreateMeshes()
     std::vector<StateTransitionDesc> Barriers;
     // create vertex buffer
     {
+        // Quantized positions and normals take half the memory of the float vertices
+        std::vector<PackedVertex> packedVertices(asteroidMeshes->vertices.size());
+        PackVertices(asteroidMeshes->vertices.data(), asteroidMeshes->vertices.size(), packedVertices.data());
+
         BufferDesc desc;
         desc.Name      = "Asteroid Meshes Vertex Buffer";
-        desc.Size      = (Uint32)asteroidMeshes->vertices.size() * sizeof(asteroidMeshes->vertices[0]);
+        desc.Size      = (Uint32)packedVertices.size() * sizeof(packedVertices[0]);
         desc.BindFlags = BIND_VERTEX_BUFFER;
         desc.Usage     = USAGE_DEFAULT;
 
         BufferData data;
-        data.pData    = asteroidMeshes->vertices.data();
+        data.pData    = packedVertices.data();
         data.DataSize = desc.Size;
 
         mDevice->CreateBuffer(desc, &data, &mVertexBuffer);
@@ -760,9 +801,9 @@ void Asteroids::InitializeTextureData()
         auto*                          texData = mAsteroids->TextureData(t);
         for (size_t subRes = 0; subRes < subResData.size(); ++subRes)
         {
-            subResData[subRes].pData       = texData[subRes].pSysMem;
-            subResData[subRes].Stride      = texData[subRes].SysMemPitch;
-            subResData[subRes].DepthStride = texData[subRes].SysMemSlicePitch;
+            subResData[subRes].pData       = texData[subRes].pData;
+            subResData[subRes].Stride      = texData[subRes].rowPitch;
+            subResData[subRes].DepthStride = texData[subRes].slicePitch;
         }
         TextureData initData;
         initData.NumSubresources = (Uint32)subResData.size();
@@ -821,43 +862,26 @@ void Asteroids::CreateGUIResources()
 
 static_assert(sizeof(IndexType) == 2, "Expecting 16-bit index buffer");
 
-void Asteroids::WorkerThreadFunc(Asteroids* pThis, Uint32 ThreadNum)
+Uint32 Asteroids::AcquireDeferredContext()
 {
-    for (;;)
-    {
-        // Wait for UpdateSubsets signal
-        auto SignalledValue = pThis->mUpdateSubsetsSignal.Wait();
-        if (SignalledValue < 0)
-            return;
-
-        auto  SubsetSize   = NUM_ASTEROIDS / pThis->mNumSubsets;
-        auto  SubsetStart  = SubsetSize * (ThreadNum + 1);
-        auto& FrameAttribs = pThis->mFrameAttribs;
-
-        pThis->mAsteroids->Update(FrameAttribs.frameTime, FrameAttribs.camera->Eye(), *FrameAttribs.settings, SubsetStart, SubsetSize);
-
-        // Increment number of completed threads
-        ++pThis->m_NumThreadsCompleted;
-
-
-        // Wait for RenderSubsets signal
-        pThis->mRenderSubsetsSignal.Wait();
-
-        pThis->RenderSubset(1 + ThreadNum, pThis->mDeferredCtxt[ThreadNum], *FrameAttribs.camera, SubsetStart, SubsetSize);
-
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pThis->mCmdLists[ThreadNum].Release();
-        pThis->mDeferredCtxt[ThreadNum]->FinishCommandList(&pThis->mCmdLists[ThreadNum]);
+    std::lock_guard<std::mutex> lock(mDeferredCtxtMutex);
+    // There is a deferred context for every thread of the job system, so one is always free
+    VERIFY_EXPR(!mFreeDeferredCtxts.empty());
+    auto contextSlot = mFreeDeferredCtxts.back();
+    mFreeDeferredCtxts.pop_back();
+    return contextSlot;
+}
 
-        // Increment number of completed threads
-        ++pThis->m_NumThreadsCompleted;
-    }
+void Asteroids::ReleaseDeferredContext(Uint32 contextSlot)
+{
+    std::lock_guard<std::mutex> lock(mDeferredCtxtMutex);
+    mFreeDeferredCtxts.push_back(contextSlot);
 }
 
-void Asteroids::RenderSubset(Uint32             SubsetNum,
+void Asteroids::RenderSubset(Uint32             ContextSlot,
                              IDeviceContext*    pCtx,
                              const OrbitCamera& camera,
-                             Uint32             startIdx,
+                             const Uint32*      pAsteroidIndices,
                              Uint32             numAsteroids)
 {
     if (pCtx->GetDesc().IsDeferred)
@@ -876,64 +900,134 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
     {
         IBuffer* ia_buffers[] = {mVertexBuffer, mInstanceIDBuffer};
         // Bind instance data buffer in bindless mode
-        pCtx->SetVertexBuffers(0, (m_BindingMode == BindingMode::Bindless) ? 2 : 1, ia_buffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_NONE);
+        pCtx->SetVertexBuffers(0, UsesAsteroidDataBuffer() ? 2 : 1, ia_buffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_NONE);
         pCtx->SetIndexBuffer(mIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
-    if (m_BindingMode == BindingMode::Bindless)
+    if (m_BindingMode == BindingMode::Instanced)
+    {
+        // Group the asteroids that share the mesh and the subdiv level, so that every group
+        // is a contiguous range of instances in the data buffer
+        auto& order = mInstanceOrder[ContextSlot];
+        order.assign(pAsteroidIndices, pAsteroidIndices + numAsteroids);
+        std::sort(order.begin(), order.end(), [&](Uint32 a, Uint32 b) {
+            const auto vertexStartA = staticAsteroidData[a].vertexStart;
+            const auto vertexStartB = staticAsteroidData[b].vertexStart;
+            return vertexStartA != vertexStartB ? vertexStartA < vertexStartB : dynamicAsteroidData[a].indexStart < dynamicAsteroidData[b].indexStart;
+        });
+        pAsteroidIndices = order.data();
+    }
+
+    if (UsesAsteroidDataBuffer())
     {
         {
-            // Update asteroid data buffer
-            MapHelper<AsteroidData> asteroidData(pCtx, mAsteroidsDataBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
-            UINT                    i = 0;
-            for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx, ++i)
+            // Update asteroid data buffer, only visible asteroids are written
+            MapHelper<AsteroidData> asteroidData(pCtx, mAsteroidsDataBuffers[ContextSlot], MAP_WRITE, MAP_FLAG_DISCARD);
+            for (UINT i = 0; i < numAsteroids; ++i)
             {
+                const auto drawIdx     = pAsteroidIndices[i];
                 const auto staticData  = &staticAsteroidData[drawIdx];
                 const auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-                XMStoreFloat4x4(&asteroidData[i].mWorld, dynamicData->world);
-                asteroidData[i].mSurfaceColor = staticData->surfaceColor;
-                asteroidData[i].mDeepColor    = staticData->deepColor;
+                asteroidData[i].mWorld        = DirectX::XMFLOAT4X4(&dynamicData->world[0][0]);
+                asteroidData[i].mSurfaceColor = DirectX::XMFLOAT3(staticData->surfaceColor);
+                asteroidData[i].mDeepColor    = DirectX::XMFLOAT3(staticData->deepColor);
                 asteroidData[i].mTextureIndex = staticData->textureIndex;
             }
         }
 
-        StateTransitionDesc Barrier{mAsteroidsDataBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        StateTransitionDesc Barrier{mAsteroidsDataBuffers[ContextSlot], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
         pCtx->TransitionResourceStates(1, &Barrier);
 
         // Commit and verify resources
-        pCtx->CommitShaderResources(mAsteroidsSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        pCtx->CommitShaderResources(mAsteroidsSRBs[ContextSlot], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
-    const auto& viewProjection = camera.ViewProjection();
-    auto        pVar           = m_BindingMode == BindingMode::Dynamic ? mAsteroidsSRBs[SubsetNum]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex") : nullptr;
-    for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx)
+    if (m_BindingMode == BindingMode::Instanced)
     {
-        const auto staticData  = &staticAsteroidData[drawIdx];
-        const auto dynamicData = &dynamicAsteroidData[drawIdx];
-
-        if (m_BindingMode != BindingMode::Bindless)
+        // One instanced draw per group. Instance IDs are the positions in the data buffer.
+        for (UINT first = 0; first < numAsteroids;)
         {
-            MapHelper<DrawConstantBuffer> drawConstants(pCtx, mDrawConstantBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-            XMStoreFloat4x4(&drawConstants->mWorld, dynamicData->world);
-            XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
-            drawConstants->mSurfaceColor = staticData->surfaceColor;
-            drawConstants->mDeepColor    = staticData->deepColor;
+            const auto staticData  = &staticAsteroidData[pAsteroidIndices[first]];
+            const auto dynamicData = &dynamicAsteroidData[pAsteroidIndices[first]];
+
+            UINT last = first + 1;
+            while (last < numAsteroids &&
+                   staticAsteroidData[pAsteroidIndices[last]].vertexStart == staticData->vertexStart &&
+                   dynamicAsteroidData[pAsteroidIndices[last]].indexStart == dynamicData->indexStart)
+                ++last;
+
+            DrawIndexedAttribs attribs(dynamicData->indexCount, VT_UINT16, DRAW_FLAG_VERIFY_ALL | DRAW_FLAG_DYNAMIC_RESOURCE_BUFFERS_INTACT);
+            attribs.NumInstances          = last - first;
+            attribs.FirstIndexLocation    = dynamicData->indexStart;
+            attribs.BaseVertex            = staticData->vertexStart;
+            attribs.FirstInstanceLocation = first;
+            pCtx->DrawIndexed(attribs);
+
+            first = last;
         }
-        // No need to update the buffer in bindless mode
+        return;
+    }
 
-        if (m_BindingMode == BindingMode::Dynamic)
+    // Write the constants of all draws with a single map instead of mapping the buffer for every draw.
+    // Every draw then selects its constants by offset. No need to update the buffer in bindless mode.
+    const Uint32                   constantsStride = AlignUp(static_cast<Uint32>(sizeof(DrawConstantBuffer)), mDrawConstants.GetAlignment());
+    FrameRingAllocator::Allocation drawConstants;
+    if (m_BindingMode != BindingMode::Bindless)
+    {
+        DirectX::XMFLOAT4X4 viewProjection;
+        XMStoreFloat4x4(&viewProjection, camera.ViewProjection());
+
+        if (mDrawConstants.Begin(pCtx, ContextSlot))
+            drawConstants = mDrawConstants.Allocate(ContextSlot, constantsStride * numAsteroids);
+        if (drawConstants)
         {
-            pVar->Set(mTextureSRVs[staticData->textureIndex]);
-            pCtx->CommitShaderResources(mAsteroidsSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            for (UINT i = 0; i < numAsteroids; ++i)
+            {
+                const auto drawIdx     = pAsteroidIndices[i];
+                const auto staticData  = &staticAsteroidData[drawIdx];
+                const auto dynamicData = &dynamicAsteroidData[drawIdx];
+
+                auto* constants            = reinterpret_cast<DrawConstantBuffer*>(static_cast<Uint8*>(drawConstants.pData) + constantsStride * i);
+                constants->mWorld          = DirectX::XMFLOAT4X4(&dynamicData->world[0][0]);
+                constants->mViewProjection = viewProjection;
+                constants->mSurfaceColor   = DirectX::XMFLOAT3(staticData->surfaceColor);
+                constants->mDeepColor      = DirectX::XMFLOAT3(staticData->deepColor);
+            }
         }
-        else if (m_BindingMode == BindingMode::Mutable)
+        mDrawConstants.End(pCtx, ContextSlot);
+        if (!drawConstants)
         {
-            pCtx->CommitShaderResources(mAsteroidsSRBs[drawIdx], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            LOG_ERROR_MESSAGE("Failed to allocate asteroid draw constants");
+            return;
         }
-        else if (m_BindingMode == BindingMode::TextureMutable)
+    }
+
+    auto pVar = m_BindingMode == BindingMode::Dynamic ? mAsteroidsSRBs[ContextSlot]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex") : nullptr;
+    for (UINT i = 0; i < numAsteroids; ++i)
+    {
+        const auto drawIdx     = pAsteroidIndices[i];
+        const auto staticData  = &staticAsteroidData[drawIdx];
+        const auto dynamicData = &dynamicAsteroidData[drawIdx];
+
+        if (m_BindingMode != BindingMode::Bindless)
         {
-            pCtx->CommitShaderResources(mAsteroidsSRBs[staticData->textureIndex], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            size_t srb = 0;
+            if (m_BindingMode == BindingMode::Dynamic)
+            {
+                pVar->Set(mTextureSRVs[staticData->textureIndex]);
+                srb = ContextSlot;
+            }
+            else if (m_BindingMode == BindingMode::Mutable)
+            {
+                srb = drawIdx;
+            }
+            else if (m_BindingMode == BindingMode::TextureMutable)
+            {
+                srb = size_t{ContextSlot} * NUM_UNIQUE_TEXTURES + staticData->textureIndex;
+            }
+            mDrawConstantsVars[srb]->SetBufferOffset(drawConstants.Offset + constantsStride * i);
+            pCtx->CommitShaderResources(mAsteroidsSRBs[srb], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
         }
 
         DrawIndexedAttribs attribs(dynamicData->indexCount, VT_UINT16, DRAW_FLAG_VERIFY_ALL);
@@ -945,7 +1039,7 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
             // It is very important to specify this flag to make sure the engine does not do extra
             // work processing buffers that stay intact.
             attribs.Flags |= DRAW_FLAG_DYNAMIC_RESOURCE_BUFFERS_INTACT;
-            attribs.FirstInstanceLocation = drawIdx - startIdx;
+            attribs.FirstInstanceLocation = i;
         }
 
         pCtx->DrawIndexed(attribs);
@@ -954,9 +1048,12 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
 
 void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Settings& settings)
 {
-    mFrameAttribs.frameTime = frameTime;
-    mFrameAttribs.camera    = &camera;
-    mFrameAttribs.settings  = &settings;
+    DirectX::XMStoreFloat3(&mCameraEye, camera.Eye());
+    {
+        DirectX::XMFLOAT4X4 viewProjection;
+        XMStoreFloat4x4(&viewProjection, camera.ViewProjection());
+        ExtractFrustumPlanes(viewProjection.m, &mFrustum);
+    }
 
     // Clear the render target
     float clearcol[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -970,9 +1067,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
     mUpdateTicks = currCounter;
 
-    auto SubsetSize = NUM_ASTEROIDS / mNumSubsets;
-
-    if (m_BindingMode == BindingMode::Bindless)
+    if (UsesAsteroidDataBuffer())
     {
         // Write view-projection matrix into the buffer
         const auto& viewProjection = camera.ViewProjection();
@@ -982,23 +1077,26 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         mDeviceCtxt->TransitionResourceStates(1, &Barrier);
     }
 
-    if (settings.multithreadedRendering)
+    const bool multithreaded = settings.multithreadedRendering && !mDeferredCtxt.empty();
+    mJobSystem->ResetStats();
+
+    // Update and cull the subsets, idle threads steal subsets from busy ones
+    auto UpdateSubset = [&](Uint32 job) {
+        const auto startIdx = job * mDrawsPerJob;
+        mNumVisible[job]    = static_cast<Uint32>(mAsteroids->Update(frameTime, &mCameraEye.x, settings, startIdx, mDrawsPerJob,
+                                                                     &mFrustum, mVisibleIndices[job].data()));
+    };
+    if (multithreaded)
     {
-        m_NumThreadsCompleted = 0;
-        mUpdateSubsetsSignal.Trigger(true);
+        mJobSystem->ParallelFor(mNumRecordJobs, 1, [&](Uint32, Uint32 Begin, Uint32 End) {
+            for (Uint32 job = Begin; job < End; ++job)
+                UpdateSubset(job);
+        });
     }
-
-    // Update all subsets in this thread when multithreadedRendering is false
-    for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        mAsteroids->Update(frameTime, camera.Eye(), settings, SubsetSize * i, SubsetSize);
-
-    if (settings.multithreadedRendering)
+    else
     {
-        // Wait for worker threads to finish
-        while (m_NumThreadsCompleted < (int)mNumSubsets - 1)
-            std::this_thread::yield();
-        // Reset mUpdateSubsetsSignal while all threads are waiting for mRenderSubsetsSignal
-        mUpdateSubsetsSignal.Reset();
+        for (Uint32 job = 0; job < mNumRecordJobs; ++job)
+            UpdateSubset(job);
     }
 
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -1006,25 +1104,24 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
 
     mRenderTicks = currCounter;
 
-    if (settings.multithreadedRendering)
+    if (multithreaded)
     {
-        // Signal RenderSubsets
-        m_NumThreadsCompleted = 0;
-        mRenderSubsetsSignal.Trigger(true);
-    }
+        // Every job records the visible asteroids of its subset into its own command list using any free deferred context
+        mJobSystem->ParallelFor(mNumRecordJobs, 1, [&](Uint32, Uint32 Begin, Uint32 End) {
+            for (Uint32 job = Begin; job < End; ++job)
+            {
+                const auto contextSlot = AcquireDeferredContext();
+                auto*      pCtx        = mDeferredCtxt[contextSlot].RawPtr();
 
-    // Render all subsets in this thread when multithreadedRendering is false
-    for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        RenderSubset(i, mDeviceCtxt, camera, SubsetSize * i, SubsetSize);
+                RenderSubset(contextSlot, pCtx, camera, mVisibleIndices[job].data(), mNumVisible[job]);
 
-    if (settings.multithreadedRendering)
-    {
-        // Wait for worker threads to finish
-        while (m_NumThreadsCompleted < (int)mNumSubsets - 1)
-            std::this_thread::yield();
-        // Reset mRenderSubsetsSignal while all threads are waiting for mUpdateSubsetsSignal
-        mRenderSubsetsSignal.Reset();
+                mCmdLists[job].Release();
+                pCtx->FinishCommandList(&mCmdLists[job]);
+                ReleaseDeferredContext(contextSlot);
+            }
+        });
 
+        // Command lists are executed in job order, so the draw order does not depend on the scheduling
         mCmdListPtrs.resize(mCmdLists.size());
         for (size_t i = 0; i < mCmdLists.size(); ++i)
             mCmdListPtrs[i] = mCmdLists[i];
@@ -1038,6 +1135,15 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
             cmdList.Release();
         }
     }
+    else
+    {
+        // Render all visible asteroids in this thread, using the same draw batches as the recording jobs
+        for (Uint32 job = 0; job < mNumRecordJobs; ++job)
+            RenderSubset(0, mDeviceCtxt, camera, mVisibleIndices[job].data(), mNumVisible[job]);
+    }
+
+    for (Uint32 t = 0; t < mNumThreads; ++t)
+        mThreadStats[t] = mJobSystem->GetThreadStats(t);
 
     // Call FinishFrame() to release dynamic resources allocated by deferred contexts
     // IMPORTANT: we must wait until the command lists are submitted for execution
@@ -14,10 +14,11 @@
 #include "SwapChain.h"
 #include "DeviceContext.h"
 #include "RefCntAutoPtr.hpp"
-#include "ThreadSignal.hpp"
+#include "JobSystem.hpp"
+#include "FrameRingAllocator.hpp"
 #include <map>
+#include <memory>
 #include <mutex>
-#include <atomic>
 
 #include "camera.h"
 #include "settings.h"
@@ -39,11 +40,20 @@ public:
 
     void GetPerfCounters(float &UpdateTime, float &RenderTime);
 
+    // Per-thread statistics of the last frame's update and command recording jobs
+    Diligent::Uint32 GetThreadCount() const { return mJobSystem->GetThreadCount(); }
+    Diligent::JobSystem::ThreadStats GetThreadStats(Diligent::Uint32 ThreadIdx) const { return mThreadStats[ThreadIdx]; }
+
 private:
     void CreateMeshes();
     void InitializeTextureData();
     void CreateGUIResources();
-    void RenderSubset(Diligent::Uint32 SubsetNum, Diligent::IDeviceContext *pCtx, const OrbitCamera& camera, Diligent::Uint32 startIdx, Diligent::Uint32 numAsteroids);
+    void RenderSubset(Diligent::Uint32 ContextSlot, Diligent::IDeviceContext *pCtx, const OrbitCamera& camera, const Diligent::Uint32* pAsteroidIndices, Diligent::Uint32 numAsteroids);
+
+    // Deferred contexts are shared by the recording jobs: a job takes a free context, records
+    // its command list and returns the context to the pool.
+    Diligent::Uint32 AcquireDeferredContext();
+    void ReleaseDeferredContext(Diligent::Uint32 ContextSlot);
     void InitDevice(HWND hWnd, Diligent::RENDER_DEVICE_TYPE DevType);
 
     enum class BindingMode
@@ -51,9 +61,15 @@ private:
         Dynamic = 0,
         Mutable,
         TextureMutable,
-        Bindless
+        Bindless,
+        // Bindless resources, visible asteroids are grouped by mesh and subdiv level
+        // and every group is rendered with a single instanced draw call
+        Instanced
     }m_BindingMode = BindingMode::TextureMutable;
 
+    // Both bindless modes read per-asteroid data from the structured buffer indexed by the instance ID
+    bool UsesAsteroidDataBuffer() const { return m_BindingMode == BindingMode::Bindless || m_BindingMode == BindingMode::Instanced; }
+
     AsteroidsSimulation*        mAsteroids = nullptr;
     GUI*                        mGUI = nullptr;
 
@@ -65,34 +81,43 @@ private:
     std::vector< Diligent::ICommandList* > mCmdListPtrs;
     
     Diligent::Uint32 mBackBufferWidth, mBackBufferHeight;
-    Diligent::Uint32 mNumSubsets = 0;
-    std::vector<std::thread> mWorkerThreads;
-    
-    std::mutex mMutex;
-    std::condition_variable mCondVar;
-    Threading::Signal mUpdateSubsetsSignal;
-    Threading::Signal mRenderSubsetsSignal;
-    std::atomic_int m_NumThreadsCompleted;
-    static void WorkerThreadFunc(Asteroids *pThis, Diligent::Uint32 ThreadNum);
-
-    struct FrameAttribs
-    {
-        float frameTime;
-        const OrbitCamera* camera;
-        const Settings* settings;
-    }mFrameAttribs;
+    Diligent::Uint32 mNumThreads = 0;
+    std::unique_ptr<Diligent::JobSystem> mJobSystem;
+    std::vector<Diligent::JobSystem::ThreadStats> mThreadStats;
+
+    std::mutex mDeferredCtxtMutex;
+    std::vector<Diligent::Uint32> mFreeDeferredCtxts;
+
+    // Every recording job draws mDrawsPerJob asteroids into its own command list
+    Diligent::Uint32 mDrawsPerJob = 0;
+    Diligent::Uint32 mNumRecordJobs = 0;
+
+    // The update job of every subset culls its asteroids against the frustum and
+    // writes the indices of the visible ones to the list that the recording job draws
+    std::vector<std::vector<Diligent::Uint32>> mVisibleIndices;
+    std::vector<Diligent::Uint32> mNumVisible;
+    // Visible asteroids sorted by mesh and subdiv level for instanced rendering, one list per context slot
+    std::vector<std::vector<Diligent::Uint32>> mInstanceOrder;
+
+    DirectX::XMFLOAT3 mCameraEye;
+    SimFrustum mFrustum;
 
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mIndexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mVertexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mInstanceIDBuffer;
     std::vector<Diligent::RefCntAutoPtr<Diligent::IBuffer>>  mAsteroidsDataBuffers;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mDrawConstantBuffer;
+    // Per-draw constants of the modes that do not use the asteroid data buffer. Every recording writes
+    // the constants of all its draws with a single map, and every draw selects its constants by offset.
+    Diligent::FrameRingAllocator mDrawConstants;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mSpriteVertexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mSkyboxConstantBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer>  mSkyboxVertexBuffer;
 
     Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mAsteroidsPSO;
     std::vector< Diligent::RefCntAutoPtr<Diligent::IShaderResourceBinding> > mAsteroidsSRBs;
+    // DrawConstantBuffer variable of every SRB in the modes that use mDrawConstants
+    std::vector<Diligent::IShaderResourceVariable*> mDrawConstantsVars;
     
     Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mFontPSO;
     Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mSpritePSO;
@@ -403,7 +403,8 @@ void Asteroids::InitializeTextureData()
     textureDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
 
     for (UINT t = 0; t < NUM_UNIQUE_TEXTURES; ++t) {
-        ThrowIfFailed(mDevice->CreateTexture2D(&textureDesc, mAsteroids->TextureData(t), &mTextures[t]));
+        auto initialData = ToD3D11SubresourceData(mAsteroids->TextureData(t), size_t{textureDesc.ArraySize} * mAsteroids->GetTextureMipLevels());
+        ThrowIfFailed(mDevice->CreateTexture2D(&textureDesc, initialData.data(), &mTextures[t]));
         ThrowIfFailed(mDevice->CreateShaderResourceView(mTextures[t], nullptr, &mTextureSRVs[t]));
     }
 }
@@ -442,7 +443,9 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
 
     // Frame data
-    mAsteroids->Update(frameTime, camera.Eye(), settings);
+    XMFLOAT3 cameraEye;
+    XMStoreFloat3(&cameraEye, camera.Eye());
+    mAsteroids->Update(frameTime, &cameraEye.x, settings);
     
     mTotalUpdateTicks = currCounter;
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -490,10 +493,10 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         ThrowIfFailed(mDeviceCtxt->Map(mDrawConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
 
         auto drawConstants = (DrawConstantBuffer*) mapped.pData;
-        XMStoreFloat4x4(&drawConstants->mWorld,          dynamicData->world);
+        drawConstants->mWorld = XMFLOAT4X4(&dynamicData->world[0][0]);
         XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
-        drawConstants->mSurfaceColor = staticData->surfaceColor;
-        drawConstants->mDeepColor    = staticData->deepColor;
+        drawConstants->mSurfaceColor = XMFLOAT3(staticData->surfaceColor);
+        drawConstants->mDeepColor    = XMFLOAT3(staticData->deepColor);
 
         mDeviceCtxt->Unmap(mDrawConstantBuffer, 0);
 
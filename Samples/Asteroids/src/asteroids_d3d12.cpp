@@ -122,7 +122,8 @@ Asteroids::Asteroids(AsteroidsSimulation* asteroids, GUI *gui, UINT minCmdLsts,
             ));
             textureDesc = mAsteroidTextures[i]->GetDesc();
 
-            InitializeTexture2D(mDevice, mCommandQueue, mAsteroidTextures[i], &textureDesc, 1, 1, 4, mAsteroids->TextureData(i));
+            auto initialData = ToD3D11SubresourceData(mAsteroids->TextureData(i), size_t{textureDesc.DepthOrArraySize} * textureDesc.MipLevels);
+            InitializeTexture2D(mDevice, mCommandQueue, mAsteroidTextures[i], &textureDesc, 1, 1, 4, initialData.data());
 
             // Append a descriptor to the heap
             mSRVDescs->AppendSRV(mAsteroidTextures[i]);
@@ -168,8 +169,8 @@ Asteroids::Asteroids(AsteroidsSimulation* asteroids, GUI *gui, UINT minCmdLsts,
         auto staticData = mAsteroids->StaticData();
         for (int j = 0; j < NUM_ASTEROIDS; ++j) {
             auto constants = &dynamicUploadWO->mDrawConstantBuffers[j];
-            constants->mSurfaceColor = staticData[j].surfaceColor;
-            constants->mDeepColor = staticData[j].deepColor;
+            constants->mSurfaceColor = XMFLOAT3(staticData[j].surfaceColor);
+            constants->mDeepColor = XMFLOAT3(staticData[j].deepColor);
             constants->mTextureIndex = staticData[j].textureIndex;
 
             auto indirectDraw = &dynamicUploadWO->mIndirectArgs[j];
@@ -721,7 +722,7 @@ void Asteroids::RenderSubset(
             auto staticData = &staticAsteroidData[drawIdx];
             auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
+            drawConstantBuffers[drawIdx].mWorld = XMFLOAT4X4(&dynamicData->world[0][0]);
             XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
 
             // Set root cbuffer
@@ -739,7 +740,7 @@ void Asteroids::RenderSubset(
         {
             auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
+            drawConstantBuffers[drawIdx].mWorld = XMFLOAT4X4(&dynamicData->world[0][0]);
             XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
 
             auto drawIndexed = &indirectArgs[drawIdx].mDrawIndexed;
@@ -767,6 +768,9 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     assert(mCurrentFrameIndex < NUM_FRAMES_TO_BUFFER);
     auto frame = &mFrame[mCurrentFrameIndex];
 
+    XMFLOAT3 cameraEye;
+    XMStoreFloat3(&cameraEye, camera.Eye());
+
     QueryPerformanceCounter((LARGE_INTEGER*)&mTotalUpdateTicks);
     // Update asteroid simulation
     if (settings.multithreadedRendering)
@@ -774,12 +778,12 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         concurrency::parallel_for<UINT>(0, mSubsetCount, [&](UINT subsetIdx) {
             UINT drawStart = mDrawsPerSubset * subsetIdx;
             UINT drawEnd = std::min(drawStart + mDrawsPerSubset, (UINT)NUM_ASTEROIDS);
-            mAsteroids->Update(frameTime, camera.Eye(), settings, drawStart, drawEnd - drawStart);
+            mAsteroids->Update(frameTime, &cameraEye.x, settings, drawStart, drawEnd - drawStart);
         });
     }
     else
     {
-        mAsteroids->Update(frameTime, camera.Eye(), settings, 0, (UINT)NUM_ASTEROIDS);
+        mAsteroids->Update(frameTime, &cameraEye.x, settings, 0, (UINT)NUM_ASTEROIDS);
     }
     LONG64 currCounter;
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -10,10 +10,11 @@
 
 #include "mesh.h"
 #include "noise.h"
-#include <map>
+#include "thread_pool.h"
+#include <algorithm>
 #include <random>
-
-using namespace DirectX;
+#include <assert.h>
+#include <cmath>
 
 void CreateIcosahedron(Mesh *outMesh)
 {
@@ -68,65 +69,70 @@ void CreateIcosahedron(Mesh *outMesh)
 }
 
 
-// Maps edge (lower index first!) to
-struct Edge
+void SubdivideInPlace(Mesh *outMesh)
 {
-    Edge(IndexType i0, IndexType i1)
-        : v0(i0), v1(i1)
-    {
-        if (v0 > v1)
-            std::swap(v0, v1);
+    assert(outMesh->indices.size() % 3 == 0); // trilist
+    size_t triangles = outMesh->indices.size() / 3;
+    size_t vertexCount = outMesh->vertices.size();
+
+    // Edge table addressed by the lower vertex index of an edge: every vertex owns a range of slots
+    // in edgeSlots (starting at slotOffsets[v]) that hold the higher vertex index and the midpoint
+    // of its edges. The ranges are sized for the worst case of each edge being seen twice.
+    std::vector<unsigned int> slotOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangles * 3; ++i) {
+        auto v0 = outMesh->indices[i];
+        auto v1 = outMesh->indices[i - i % 3 + (i + 1) % 3];
+        ++slotOffsets[std::min(v0, v1) + 1];
     }
-    IndexType v0;
-    IndexType v1;
-
-    bool operator<(const Edge &c) const
-    {
-        return v0 < c.v0 || (v0 == c.v0 && v1 < c.v1);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        slotOffsets[v + 1] += slotOffsets[v];
     }
-};
-
-typedef std::map<Edge, IndexType> MidpointMap;
 
-inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
-{
-    auto index = midpoints->find(e);
-    if (index == midpoints->end())
+    struct EdgeSlot
     {
-        auto a = mesh->vertices[e.v0];
-        auto b = mesh->vertices[e.v1];
+        IndexType v1;
+        IndexType midpoint;
+    };
+    std::vector<EdgeSlot> edgeSlots(slotOffsets[vertexCount]);
+    std::vector<unsigned int> slotCounts(vertexCount, 0);
+
+    // New vertices are created in the order their edges are first seen
+    auto edgeMidpoint = [&](IndexType i0, IndexType i1) {
+        auto v0 = std::min(i0, i1);
+        auto v1 = std::max(i0, i1);
+        auto slots = edgeSlots.data() + slotOffsets[v0];
+        for (unsigned int s = 0; s < slotCounts[v0]; ++s) {
+            if (slots[s].v1 == v1)
+                return slots[s].midpoint;
+        }
+
+        auto a = outMesh->vertices[v0];
+        auto b = outMesh->vertices[v1];
 
         Vertex m;
         m.x = (a.x + b.x) * 0.5f;
         m.y = (a.y + b.y) * 0.5f;
         m.z = (a.z + b.z) * 0.5f;
 
-        index = midpoints->insert(std::make_pair(e, static_cast<IndexType>(mesh->vertices.size()))).first;
-        mesh->vertices.push_back(m);
-    }
-    return index->second;
-}
-
-
-void SubdivideInPlace(Mesh *outMesh)
-{
-    MidpointMap midpoints;
+        auto midpoint = static_cast<IndexType>(outMesh->vertices.size());
+        outMesh->vertices.push_back(m);
+        slots[slotCounts[v0]++] = EdgeSlot{v1, midpoint};
+        return midpoint;
+    };
 
     std::vector<IndexType> newIndices;
     newIndices.reserve(outMesh->indices.size() * 4);
     outMesh->vertices.reserve(outMesh->vertices.size() * 2);
 
-    assert(outMesh->indices.size() % 3 == 0); // trilist
-    size_t triangles = outMesh->indices.size() / 3;
     for (size_t t = 0; t < triangles; ++t)
     {
         auto t0 = outMesh->indices[t*3+0];
         auto t1 = outMesh->indices[t*3+1];
         auto t2 = outMesh->indices[t*3+2];
 
-        auto m0 = EdgeMidpoint(outMesh, &midpoints, Edge(t0, t1));
-        auto m1 = EdgeMidpoint(outMesh, &midpoints, Edge(t1, t2));
-        auto m2 = EdgeMidpoint(outMesh, &midpoints, Edge(t2, t0));
+        auto m0 = edgeMidpoint(t0, t1);
+        auto m1 = edgeMidpoint(t1, t2);
+        auto m2 = edgeMidpoint(t2, t0);
 
         IndexType indices[] = {
             t0, m0, m2,
@@ -154,19 +160,27 @@ void SpherifyInPlace(Mesh *outMesh, float radius)
 
 void ComputeAvgNormalsInPlace(Mesh *outMesh)
 {
-    for (auto &v : outMesh->vertices) {
+    ComputeAvgNormals(outMesh->vertices.data(), outMesh->vertices.size(),
+                      outMesh->indices.data(), outMesh->indices.size());
+}
+
+
+void ComputeAvgNormals(Vertex *vertices, size_t vertexCount, const IndexType *indices, size_t indexCount)
+{
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto &v = vertices[i];
         v.nx = 0.0f;
         v.ny = 0.0f;
         v.nz = 0.0f;
     }
 
-    assert(outMesh->indices.size() % 3 == 0); // trilist
-    size_t triangles = outMesh->indices.size() / 3;
+    assert(indexCount % 3 == 0); // trilist
+    size_t triangles = indexCount / 3;
     for (size_t t = 0; t < triangles; ++t)
     {
-        auto v1 = &outMesh->vertices[outMesh->indices[t*3+0]];
-        auto v2 = &outMesh->vertices[outMesh->indices[t*3+1]];
-        auto v3 = &outMesh->vertices[outMesh->indices[t*3+2]];
+        auto v1 = &vertices[indices[t*3+0]];
+        auto v2 = &vertices[indices[t*3+1]];
+        auto v3 = &vertices[indices[t*3+2]];
 
         // Two edge vectors u,v
         auto ux = v2->x - v1->x;
@@ -188,7 +202,8 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
     }
 
     // Normalize
-    for (auto &v : outMesh->vertices) {
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto &v = vertices[i];
         float n = 1.0f / std::sqrt(v.nx*v.nx + v.ny*v.ny + v.nz*v.nz);
         v.nx *= n;
         v.ny *= n;
@@ -197,6 +212,42 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
 }
 
 
+static int16_t FloatToSnorm16(float v)
+{
+    v = std::max(-1.0f, std::min(1.0f, v));
+    return (int16_t)std::lround(v * 32767.0f);
+}
+
+
+void PackVertices(const Vertex *vertices, size_t vertexCount, PackedVertex *outVertices)
+{
+    const float rcpPositionScale = 1.0f / MESH_POSITION_SCALE;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const auto &v = vertices[i];
+        auto &p = outVertices[i];
+
+        assert(std::abs(v.x) <= MESH_POSITION_SCALE && std::abs(v.y) <= MESH_POSITION_SCALE && std::abs(v.z) <= MESH_POSITION_SCALE);
+        p.x = FloatToSnorm16(v.x * rcpPositionScale);
+        p.y = FloatToSnorm16(v.y * rcpPositionScale);
+        p.z = FloatToSnorm16(v.z * rcpPositionScale);
+        p.w = 0;
+
+        // Project the normal onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+        float rcpL1 = 1.0f / (std::abs(v.nx) + std::abs(v.ny) + std::abs(v.nz));
+        float ox = v.nx * rcpL1;
+        float oy = v.ny * rcpL1;
+        if (v.nz < 0.0f) {
+            float fx = (1.0f - std::abs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::abs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+            ox = fx;
+            oy = fy;
+        }
+        p.octNormalX = FloatToSnorm16(ox);
+        p.octNormalY = FloatToSnorm16(oy);
+    }
+}
+
+
 void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets)
 {
     CreateIcosahedron(outMesh);
@@ -242,8 +293,8 @@ void CreateAsteroidsFromGeospheres(Mesh *outMesh,
 
     // Per unique mesh
     *vertexCountPerMesh = (unsigned int)baseMesh.vertices.size();
-    std::vector<Vertex> vertices;
-    vertices.reserve(meshInstanceCount * baseMesh.vertices.size());
+    size_t baseVertexCount = baseMesh.vertices.size();
+    std::vector<Vertex> vertices(meshInstanceCount * baseVertexCount);
     // Reuse indices for the different unique meshes
 
     auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
@@ -252,23 +303,36 @@ void CreateAsteroidsFromGeospheres(Mesh *outMesh,
     float radiusScale = 0.9f;
     float radiusBias = 0.3f;
 
-    // Create and randomize unique vertices for each mesh instance
-    for (unsigned int m = 0; m < meshInstanceCount; ++m) {
-        Mesh newMesh(baseMesh);
-        NoiseOctaves<4> textureNoise(randomPersistence(rng));
-        float noise = randomNoise(rng);
+    // Draw the random parameters of all mesh instances first, in the same order as a serial loop would
+    struct InstanceParams
+    {
+        float persistence;
+        float noise;
+    };
+    std::vector<InstanceParams> instanceParams(meshInstanceCount);
+    for (auto &params : instanceParams) {
+        params.persistence = randomPersistence(rng);
+        params.noise = randomNoise(rng);
+    }
+
+    // Create and randomize unique vertices for each mesh instance, instances are independent
+    ThreadPool threadPool;
+    threadPool.ParallelFor(0u, meshInstanceCount, [&](unsigned int m) {
+        NoiseOctaves<4> textureNoise(instanceParams[m].persistence);
+        float noise = instanceParams[m].noise;
 
-        for (auto &v : newMesh.vertices) {
+        Vertex *meshVertices = vertices.data() + m * baseVertexCount;
+        for (size_t i = 0; i < baseVertexCount; ++i) {
+            Vertex v = baseMesh.vertices[i];
             float radius = textureNoise(v.x*noiseScale, v.y*noiseScale, v.z*noiseScale, noise);
             radius = radius * radiusScale + radiusBias;
             v.x *= radius;
             v.y *= radius;
             v.z *= radius;
+            meshVertices[i] = v;
         }
-        ComputeAvgNormalsInPlace(&newMesh);
-
-        vertices.insert(vertices.end(), newMesh.vertices.begin(), newMesh.vertices.end());
-    }
+        ComputeAvgNormals(meshVertices, baseVertexCount, baseMesh.indices.data(), baseMesh.indices.size());
+    }); // parallel_for
 
     // Copy to output
     std::swap(outMesh->indices, baseMesh.indices);
@@ -282,7 +346,7 @@ void CreateSkyboxMesh(std::vector<SkyboxVertex>* outVertices)
     
     // Cube mesh centered at zero
     static const float c = 0.5f;
-    static const DirectX::XMFLOAT3 vertexPos[] = { // x, y, z
+    static const struct { float x, y, z; } vertexPos[] = { // x, y, z
         {-c,  c, -c}, // 0
         { c,  c, -c}, // 1
         { c,  c,  c}, // 2
@@ -10,8 +10,11 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <vector>
-#include <directxmath.h>
+
+#include "common_defines.h"
 
 typedef unsigned short IndexType;
 
@@ -26,6 +29,21 @@ struct Vertex
     float nz;
 };
 
+// Compressed vertex for rendering, half the size of Vertex:
+// - position divided by MESH_POSITION_SCALE as 16-bit snorm (w is unused)
+// - unit normal in octahedral encoding as 16-bit snorm
+struct PackedVertex
+{
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    int16_t w;
+    int16_t octNormalX;
+    int16_t octNormalY;
+};
+
+void PackVertices(const Vertex *vertices, size_t vertexCount, PackedVertex *outVertices);
+
 struct Mesh
 {
     void clear()
@@ -47,6 +65,9 @@ void SpherifyInPlace(Mesh *outMesh, float radius = 1.0f);
 
 void ComputeAvgNormalsInPlace(Mesh *outMesh);
 
+// Same as ComputeAvgNormalsInPlace for an array of vertices, e.g. one mesh instance of a combined mesh
+void ComputeAvgNormals(Vertex *vertices, size_t vertexCount, const IndexType *indices, size_t indexCount);
+
 // subdivIndexOffset array should be [subdivLevels+2] in size
 void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets);
 
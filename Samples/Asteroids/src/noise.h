@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include "simplexnoise1234.h"
 
 // Very simple multi-octave simplex noise helper
@@ -44,6 +46,26 @@ public:
         return r * mWeightNorm + 0.5f;
     }
 
+    // Evaluates SNOISE_LANES points at once, same results as the scalar version above
+    void operator()(const float* x, const float* y, const float* z, float* out) const
+    {
+        float px[SNOISE_LANES], py[SNOISE_LANES], pz[SNOISE_LANES], n[SNOISE_LANES];
+        for (size_t l = 0; l < SNOISE_LANES; ++l) {
+            px[l] = x[l]; py[l] = y[l]; pz[l] = z[l];
+            out[l] = 0.0f;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            snoise3_lanes(px, py, pz, n);
+            for (size_t l = 0; l < SNOISE_LANES; ++l) {
+                out[l] += mWeights[i] * n[l];
+                px[l] *= 2.0f; py[l] *= 2.0f; pz[l] *= 2.0f;
+            }
+        }
+        for (size_t l = 0; l < SNOISE_LANES; ++l) {
+            out[l] = out[l] * mWeightNorm + 0.5f;
+        }
+    }
+
     // Returns [0, 1]
     float operator()(float x, float y, float z, float w) const
     {
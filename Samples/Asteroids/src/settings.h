@@ -10,7 +10,6 @@
 
 #pragma once
 
-#include "camera.h"
 #include "common_defines.h"
 
 // Profiling
@@ -75,7 +74,7 @@ struct Settings
         DiligentVulkan
     }mode = DiligentD3D11;
        
-    int resourceBindingMode = 3;  // Only for DiligentD3D12 and DiligentVk modes
+    int resourceBindingMode = 3;  // Only for DiligentD3D12 and DiligentVk modes: dynamic, mutable, texture-mutable, bindless, instanced
 
     bool lockFrameRate = false;
     bool animate = true;
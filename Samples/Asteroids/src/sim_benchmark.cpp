@@ -0,0 +1,328 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "sim_benchmark.h"
+#include "simulation.h"
+#include "settings.h"
+#include "thread_pool.h"
+#include "noise.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+const unsigned int BENCHMARK_ASTEROID_COUNTS[] = {50000, 100000, 250000, 500000, 1000000, 2000000, 5000000};
+
+enum { BENCHMARK_WARMUP_FRAMES = 8 };
+enum { BENCHMARK_MEASURE_FRAMES = 64 };
+
+// Asteroids per task in the multithreaded run, a multiple of the simulation block size
+enum { BENCHMARK_TASK_SIZE = 256 * SIM_BLOCK_SIZE };
+
+template <typename Func>
+double MeasureTime(Func func)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+template <typename UpdateFunc>
+double MeasureFrameTime(UpdateFunc update)
+{
+    for (int f = 0; f < BENCHMARK_WARMUP_FRAMES; ++f) {
+        update();
+    }
+
+    return MeasureTime([&]() {
+        for (int f = 0; f < BENCHMARK_MEASURE_FRAMES; ++f) {
+            update();
+        }
+    }) / BENCHMARK_MEASURE_FRAMES;
+}
+
+// Row-vector view-projection matrix of a camera at eye looking at the origin, equivalent to
+// XMMatrixLookAtRH * XMMatrixPerspectiveFovRH with reversed depth as used by the sample camera
+void LookAtOriginViewProjection(const float eye[3], float fovY, float aspect, float viewProjection[4][4])
+{
+    float z[3] = {eye[0], eye[1], eye[2]};
+    float zLength = std::sqrt(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+    for (auto& c : z) c /= zLength;
+    // x = normalize(cross(up, z)) with up = (0, 1, 0)
+    float x[3] = {z[2], 0.0f, -z[0]};
+    float xLength = std::sqrt(x[0] * x[0] + x[2] * x[2]);
+    for (auto& c : x) c /= xLength;
+    float y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+
+    float view[4][4] = {
+        {x[0], y[0], z[0], 0.0f},
+        {x[1], y[1], z[1], 0.0f},
+        {x[2], y[2], z[2], 0.0f},
+        {-(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]),
+         -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]),
+         -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f},
+    };
+
+    const float nearZ = 10000.0f, farZ = 0.1f; // Reversed depth
+    float h = 1.0f / std::tan(0.5f * fovY);
+    float range = farZ / (nearZ - farZ);
+    float projection[4][4] = {
+        {h / aspect, 0.0f, 0.0f, 0.0f},
+        {0.0f, h, 0.0f, 0.0f},
+        {0.0f, 0.0f, range, -1.0f},
+        {0.0f, 0.0f, range * nearZ, 0.0f},
+    };
+
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            viewProjection[r][c] = view[r][0] * projection[0][c] + view[r][1] * projection[1][c] +
+                                   view[r][2] * projection[2][c] + view[r][3] * projection[3][c];
+        }
+    }
+}
+
+// FNV-1a, used to detect changes in the generated content between builds
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    auto bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Scalar texture generation as it was before the SIMD kernels, the optimized code must produce the same bytes
+void FillNoise2DReference_RGBA8(SubresourceData* subresources, size_t width, size_t height, size_t mipLevels,
+                                float seed, float persistence, float noiseScale, float noiseStrength)
+{
+    NoiseOctaves<4> textureNoise(persistence);
+    for (size_t y = 0; y < height; ++y) {
+        uint32_t* row = (uint32_t*)((uint8_t*)subresources[0].pData + y*subresources[0].rowPitch);
+        for (size_t x = 0; x < width; ++x) {
+            auto c = textureNoise((float)x*noiseScale, (float)y*noiseScale, seed);
+            c = std::max(0.0f, std::min(1.0f, (c - 0.5f) * noiseStrength + 0.5f));
+            int32_t cr = (int32_t)(c * 255.0f);
+            row[x] = cr << 16 | cr << 8 | cr;
+        }
+    }
+
+    for (size_t m = 1; m < mipLevels; ++m) {
+        const uint8_t* dataSrc = (const uint8_t*)subresources[m - 1].pData;
+        uint8_t* dataDst = (uint8_t*)subresources[m].pData;
+        for (size_t y = 0; y < (height >> m); ++y) {
+            auto rowSrc0 = dataSrc + (y*2+0)*subresources[m - 1].rowPitch;
+            auto rowSrc1 = dataSrc + (y*2+1)*subresources[m - 1].rowPitch;
+            auto rowDst  = dataDst + y*subresources[m].rowPitch;
+            for (size_t x = 0; x < (width >> m); ++x) {
+                for (size_t comp = 0; comp < 4; ++comp) {
+                    uint32_t c = rowSrc0[x*8+comp] + rowSrc0[x*8+comp+4] + rowSrc1[x*8+comp] + rowSrc1[x*8+comp+4];
+                    rowDst[4*x+comp] = (uint8_t)(c / 4);
+                }
+            }
+        }
+    }
+}
+
+void RunContentBenchmark(ThreadPool& threadPool)
+{
+    // Meshes, same parameters as the sample
+    Mesh meshes;
+    std::vector<unsigned int> indexOffsets(MESH_MAX_SUBDIV_LEVELS + 2);
+    unsigned int vertexCountPerMesh = 0;
+    double meshTime = MeasureTime([&]() {
+        CreateAsteroidsFromGeospheres(&meshes, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_MESHES, 1337,
+                                      indexOffsets.data(), &vertexCountPerMesh);
+    });
+    printf("%-28s %10.1f ms, %zu vertices, hash %016llx\n", "CreateAsteroidsFromGeospheres", meshTime * 1e3,
+           meshes.vertices.size(), (unsigned long long)HashBytes(meshes.vertices.data(), meshes.vertices.size() * sizeof(Vertex)));
+
+    // Quantized vertex buffer, with the error of the normals decoded like in the vertex shader
+    std::vector<PackedVertex> packedVertices(meshes.vertices.size());
+    double packTime = MeasureTime([&]() {
+        PackVertices(meshes.vertices.data(), meshes.vertices.size(), packedVertices.data());
+    });
+    float maxPositionError = 0.0f;
+    float minNormalDot = 1.0f;
+    for (size_t i = 0; i < meshes.vertices.size(); ++i) {
+        const auto& v = meshes.vertices[i];
+        const auto& p = packedVertices[i];
+        float x = std::max(p.x / 32767.0f, -1.0f) * MESH_POSITION_SCALE;
+        float y = std::max(p.y / 32767.0f, -1.0f) * MESH_POSITION_SCALE;
+        float z = std::max(p.z / 32767.0f, -1.0f) * MESH_POSITION_SCALE;
+        maxPositionError = std::max(maxPositionError, std::max(std::abs(x - v.x), std::max(std::abs(y - v.y), std::abs(z - v.z))));
+
+        float nx = std::max(p.octNormalX / 32767.0f, -1.0f);
+        float ny = std::max(p.octNormalY / 32767.0f, -1.0f);
+        float nz = 1.0f - std::abs(nx) - std::abs(ny);
+        if (nz < 0.0f) {
+            float fx = (1.0f - std::abs(ny)) * (nx >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::abs(nx)) * (ny >= 0.0f ? 1.0f : -1.0f);
+            nx = fx;
+            ny = fy;
+        }
+        float rcpLength = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+        minNormalDot = std::min(minNormalDot, (nx * v.nx + ny * v.ny + nz * v.nz) * rcpLength);
+    }
+    printf("%-28s %10.1f ms, %.1f MB -> %.1f MB, max position error %.2g, max normal error %.3f deg\n", "PackVertices",
+           packTime * 1e3, meshes.vertices.size() * sizeof(Vertex) / 1048576.0, packedVertices.size() * sizeof(PackedVertex) / 1048576.0,
+           maxPositionError, std::acos(std::min(minNormalDot, 1.0f)) * 57.29578f);
+
+    // One texture with full mip chain per task
+    unsigned int mipLevels = 0;
+    for (unsigned int dim = TEXTURE_DIM; dim != 0; dim >>= 1) {
+        ++mipLevels;
+    }
+    std::vector<std::vector<uint32_t>> texels(NUM_UNIQUE_TEXTURES);
+    std::vector<std::vector<SubresourceData>> subresources(NUM_UNIQUE_TEXTURES);
+    for (unsigned int t = 0; t < NUM_UNIQUE_TEXTURES; ++t) {
+        texels[t].resize(size_t{TEXTURE_DIM} * TEXTURE_DIM * 2);
+        subresources[t].resize(mipLevels);
+        auto data = texels[t].data();
+        for (unsigned int m = 0; m < mipLevels; ++m) {
+            subresources[t][m].pData = data;
+            subresources[t][m].rowPitch = (TEXTURE_DIM >> m) * 4;
+            data += size_t(TEXTURE_DIM >> m) * (TEXTURE_DIM >> m);
+        }
+    }
+
+    auto clearTextures = [&]() {
+        for (auto& t : texels) {
+            std::fill(t.begin(), t.end(), 0u);
+        }
+    };
+    auto hashTextures = [&]() {
+        uint64_t hash = HashBytes(nullptr, 0);
+        for (const auto& t : texels) {
+            hash = HashBytes(t.data(), t.size() * sizeof(uint32_t), hash);
+        }
+        return hash;
+    };
+
+    auto fillReference = [&](unsigned int t) {
+        FillNoise2DReference_RGBA8(subresources[t].data(), TEXTURE_DIM, TEXTURE_DIM, mipLevels,
+                                   100.0f * float(t), 0.9f, 125.0f / float(TEXTURE_DIM), 1.5f);
+    };
+    double referenceTextureTime = MeasureTime([&]() {
+        for (unsigned int t = 0; t < NUM_UNIQUE_TEXTURES; ++t) {
+            fillReference(t);
+        }
+    });
+    uint64_t referenceHash = hashTextures();
+
+    auto fillTexture = [&](unsigned int t) {
+        FillNoise2D_RGBA8(subresources[t].data(), TEXTURE_DIM, TEXTURE_DIM, mipLevels,
+                          100.0f * float(t), 0.9f, 125.0f / float(TEXTURE_DIM), 1.5f);
+    };
+    clearTextures();
+    double serialTextureTime = MeasureTime([&]() {
+        for (unsigned int t = 0; t < NUM_UNIQUE_TEXTURES; ++t) {
+            fillTexture(t);
+        }
+    });
+    uint64_t serialHash = hashTextures();
+
+    clearTextures();
+    double parallelTextureTime = MeasureTime([&]() {
+        threadPool.ParallelFor(0u, NUM_UNIQUE_TEXTURES, fillTexture);
+    });
+    uint64_t parallelHash = hashTextures();
+
+    printf("%-28s %10.1f ms, %u x %ux%u, hash %016llx\n", "FillNoise2D (scalar ref)", referenceTextureTime * 1e3,
+           (unsigned int)NUM_UNIQUE_TEXTURES, (unsigned int)TEXTURE_DIM, (unsigned int)TEXTURE_DIM,
+           (unsigned long long)referenceHash);
+    printf("%-28s %10.1f ms, parallel %.1f ms, hash %016llx, %s\n", "FillNoise2D_RGBA8", serialTextureTime * 1e3,
+           parallelTextureTime * 1e3, (unsigned long long)serialHash,
+           serialHash == referenceHash && parallelHash == referenceHash ? "matches reference" : "DIFFERS FROM REFERENCE");
+
+    // Startup: all content of the sample
+    std::unique_ptr<AsteroidsSimulation> simulation;
+    double startupTime = MeasureTime([&]() {
+        simulation.reset(new AsteroidsSimulation(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES));
+    });
+    uint64_t contentHash = HashBytes(nullptr, 0);
+    for (unsigned int t = 0; t < NUM_UNIQUE_TEXTURES; ++t) {
+        auto textureData = simulation->TextureData(t);
+        for (unsigned int s = 0; s < 3 * simulation->GetTextureMipLevels(); ++s) {
+            auto rowPitch = textureData[s].rowPitch;
+            contentHash = HashBytes(textureData[s].pData, size_t{rowPitch} * (rowPitch / 4), contentHash);
+        }
+    }
+    printf("%-28s %10.1f ms, texture hash %016llx\n", "AsteroidsSimulation startup", startupTime * 1e3,
+           (unsigned long long)contentHash);
+}
+
+} // namespace
+
+int RunSimulationBenchmark(unsigned int threadCount)
+{
+    ThreadPool threadPool(threadCount);
+    printf("Using %u threads\n\n", threadPool.ThreadCount());
+
+    RunContentBenchmark(threadPool);
+    printf("\n");
+
+    Settings settings;
+    settings.animate = true;
+
+    const float frameTime = 1.0f / 60.0f;
+    const float cameraEye[3] = {0.0f, 200.0f, -SIM_ORBIT_RADIUS - 400.0f};
+
+    float viewProjection[4][4];
+    LookAtOriginViewProjection(cameraEye, 0.25f * 3.14159265f, 16.0f / 9.0f, viewProjection);
+    SimFrustum frustum;
+    ExtractFrustumPlanes(viewProjection, &frustum);
+
+    printf("%10s %16s %16s %16s %16s %16s %10s\n", "asteroids", "1 thread, ms", "ns/asteroid", "parallel, ms", "ns/asteroid",
+           "culled, ms", "visible");
+    for (auto asteroidCount : BENCHMARK_ASTEROID_COUNTS) {
+        // Minimal mesh and texture set (content generation requires a mesh per subdiv level):
+        // only the simulation state scales with the asteroid count
+        AsteroidsSimulation simulation(1337, asteroidCount, MESH_MAX_SUBDIV_LEVELS, MESH_MAX_SUBDIV_LEVELS, 1);
+
+        double serialTime = MeasureFrameTime([&]() {
+            simulation.Update(frameTime, cameraEye, settings);
+        });
+
+        unsigned int taskCount = (asteroidCount + BENCHMARK_TASK_SIZE - 1) / BENCHMARK_TASK_SIZE;
+        double parallelTime = MeasureFrameTime([&]() {
+            threadPool.ParallelFor(0u, taskCount, [&](unsigned int t) {
+                simulation.Update(frameTime, cameraEye, settings, size_t{t} * BENCHMARK_TASK_SIZE, BENCHMARK_TASK_SIZE);
+            });
+        });
+
+        // Fused update and frustum culling, one visible list per task
+        std::vector<uint32_t> visibleIndices(size_t{taskCount} * BENCHMARK_TASK_SIZE);
+        std::vector<size_t> visibleCounts(taskCount);
+        double culledTime = MeasureFrameTime([&]() {
+            threadPool.ParallelFor(0u, taskCount, [&](unsigned int t) {
+                visibleCounts[t] = simulation.Update(frameTime, cameraEye, settings, size_t{t} * BENCHMARK_TASK_SIZE, BENCHMARK_TASK_SIZE,
+                                                     &frustum, visibleIndices.data() + size_t{t} * BENCHMARK_TASK_SIZE);
+            });
+        });
+        size_t visibleCount = 0;
+        for (auto c : visibleCounts) {
+            visibleCount += c;
+        }
+
+        printf("%10u %16.3f %16.2f %16.3f %16.2f %16.3f %9.1f%%\n", asteroidCount,
+               serialTime * 1e3, serialTime * 1e9 / asteroidCount,
+               parallelTime * 1e3, parallelTime * 1e9 / asteroidCount,
+               culledTime * 1e3, 100.0 * double(visibleCount) / asteroidCount);
+    }
+
+    return 0;
+}
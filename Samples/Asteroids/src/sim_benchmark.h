@@ -0,0 +1,17 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+// Times the mesh and texture generation and runs the asteroid simulation without rendering for a range
+// of asteroid counts, and prints the update time per frame and per asteroid. Content hashes are printed
+// as well to catch unintended changes of the generated data.
+// threadCount = 0 => one thread per hardware thread. Returns the process exit code.
+int RunSimulationBenchmark(unsigned int threadCount = 0);
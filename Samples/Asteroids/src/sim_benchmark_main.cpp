@@ -0,0 +1,36 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+// Headless entry point of the portable simulation and content generation code,
+// used to profile and regression-test the CPU side on platforms without the renderers.
+
+#include "sim_benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv)
+{
+    unsigned int threadCount = 0;
+    for (int a = 1; a < argc; ++a) {
+        if (strcmp(argv[a], "-threads") == 0 && a + 1 < argc) {
+            threadCount = (unsigned int)atoi(argv[++a]);
+        } else {
+            fprintf(stderr, "error: unrecognized argument '%s'\n", argv[a]);
+            fprintf(stderr, "usage: AsteroidsBenchmark [options]\n");
+            fprintf(stderr, "options:\n");
+            fprintf(stderr, "  -threads [count]\n");
+            return -1;
+        }
+    }
+
+    return RunSimulationBenchmark(threadCount);
+}
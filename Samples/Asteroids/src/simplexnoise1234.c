@@ -149,6 +149,25 @@ float  grad3( int hash, float x, float y , float z ) {
     return ((h&1)? -u : u) + ((h&2)? -v : v);
 }
 
+// Same as grad3(), written so that it can be if-converted in vectorized loops
+static float grad3_lane( int hash, float x, float y, float z ) {
+    int h = hash & 15;
+    float u = h<8 ? x : y;
+    float v = h<4 ? y : ((h==12) | (h==14)) ? x : z;
+    float su = (h&1) ? -u : u;
+    float sv = (h&2) ? -v : v;
+    return su + sv;
+}
+
+// Returns c if keep is -1 and +0.0f if keep is 0. Unlike a select between computed floating-point
+// values, the bitwise AND does not prevent vectorization when floating-point traps are honored.
+static float mask_lane( float c, int keep ) {
+    union { float f; int i; } u;
+    u.f = c;
+    u.i &= keep;
+    return u.f;
+}
+
 float  grad4( int hash, float x, float y, float z, float t ) {
     int h = hash & 31;      // Convert low 5 bits of hash code into 32 simple
     float u = h<24 ? x : y; // gradient directions, and compute dot product.
@@ -361,6 +380,93 @@ float snoise3(float x, float y, float z) {
     return 32.0f * (n0 + n1 + n2 + n3); // TODO: The scale factor is preliminary!
   }
 
+// 3D simplex noise of SNOISE_LANES points at once. Every lane performs exactly the same
+// operations as snoise3() and gives the same result, but the lanes are processed in loops
+// without branches that the compiler can vectorize. Only the permutation table lookups
+// are done in a separate scalar loop.
+void snoise3_lanes(const float* x, const float* y, const float* z, float* out) {
+
+    float x0[SNOISE_LANES], y0[SNOISE_LANES], z0[SNOISE_LANES];
+    int ii[SNOISE_LANES], jj[SNOISE_LANES], kk[SNOISE_LANES];
+    int i1[SNOISE_LANES], j1[SNOISE_LANES], k1[SNOISE_LANES];
+    int i2[SNOISE_LANES], j2[SNOISE_LANES], k2[SNOISE_LANES];
+    int gi0[SNOISE_LANES], gi1[SNOISE_LANES], gi2[SNOISE_LANES], gi3[SNOISE_LANES];
+    int l;
+
+    for(l = 0; l < SNOISE_LANES; ++l) {
+      // Skew the input space to determine which simplex cell we're in
+      float s = (x[l]+y[l]+z[l])*F3;
+      float xs = x[l]+s;
+      float ys = y[l]+s;
+      float zs = z[l]+s;
+      int i = FASTFLOOR(xs);
+      int j = FASTFLOOR(ys);
+      int k = FASTFLOOR(zs);
+
+      float t = (float)(i+j+k)*G3;
+      float X0 = i-t;
+      float Y0 = j-t;
+      float Z0 = k-t;
+      x0[l] = x[l]-X0;
+      y0[l] = y[l]-Y0;
+      z0[l] = z[l]-Z0;
+
+      // Same simplex as the nested ifs in snoise3(), expressed with comparison masks
+      int xy = x0[l]>=y0[l];
+      int yz = y0[l]>=z0[l];
+      int xz = x0[l]>=z0[l];
+      i1[l] = xy & xz;
+      j1[l] = (!xy) & yz;
+      k1[l] = (!xz) & (!yz);
+      i2[l] = xy | xz;
+      j2[l] = (!xy) | yz;
+      k2[l] = (!yz) | ((!xy) & (!xz));
+
+      ii[l] = i & 0xff;
+      jj[l] = j & 0xff;
+      kk[l] = k & 0xff;
+    }
+
+    for(l = 0; l < SNOISE_LANES; ++l) {
+      gi0[l] = perm[ii[l]+perm[jj[l]+perm[kk[l]]]];
+      gi1[l] = perm[ii[l]+i1[l]+perm[jj[l]+j1[l]+perm[kk[l]+k1[l]]]];
+      gi2[l] = perm[ii[l]+i2[l]+perm[jj[l]+j2[l]+perm[kk[l]+k2[l]]]];
+      gi3[l] = perm[ii[l]+1+perm[jj[l]+1+perm[kk[l]+1]]];
+    }
+
+    for(l = 0; l < SNOISE_LANES; ++l) {
+      float x1 = x0[l] - i1[l] + G3;
+      float y1 = y0[l] - j1[l] + G3;
+      float z1 = z0[l] - k1[l] + G3;
+      float x2 = x0[l] - i2[l] + 2.0f*G3;
+      float y2 = y0[l] - j2[l] + 2.0f*G3;
+      float z2 = z0[l] - k2[l] + 2.0f*G3;
+      float x3 = x0[l] - 1.0f + 3.0f*G3;
+      float y3 = y0[l] - 1.0f + 3.0f*G3;
+      float z3 = z0[l] - 1.0f + 3.0f*G3;
+
+      // Contributions are computed for all corners, the ones with negative t's are discarded
+      float t0 = 0.6f - x0[l]*x0[l] - y0[l]*y0[l] - z0[l]*z0[l];
+      float t1 = 0.6f - x1*x1 - y1*y1 - z1*z1;
+      float t2 = 0.6f - x2*x2 - y2*y2 - z2*z2;
+      float t3 = 0.6f - x3*x3 - y3*y3 - z3*z3;
+      float tt0 = t0 * t0;
+      float tt1 = t1 * t1;
+      float tt2 = t2 * t2;
+      float tt3 = t3 * t3;
+      float c0 = tt0 * tt0 * grad3_lane(gi0[l], x0[l], y0[l], z0[l]);
+      float c1 = tt1 * tt1 * grad3_lane(gi1[l], x1, y1, z1);
+      float c2 = tt2 * tt2 * grad3_lane(gi2[l], x2, y2, z2);
+      float c3 = tt3 * tt3 * grad3_lane(gi3[l], x3, y3, z3);
+      float n0 = mask_lane(c0, -!(t0 < 0.0f));
+      float n1 = mask_lane(c1, -!(t1 < 0.0f));
+      float n2 = mask_lane(c2, -!(t2 < 0.0f));
+      float n3 = mask_lane(c3, -!(t3 < 0.0f));
+
+      out[l] = 32.0f * (n0 + n1 + n2 + n3);
+    }
+  }
+
 
 // 4D simplex noise
 float snoise4(float x, float y, float z, float w) {
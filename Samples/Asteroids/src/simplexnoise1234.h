@@ -65,6 +65,12 @@ extern "C" {
     float snoise3( float x, float y, float z );
     float snoise4( float x, float y, float z, float w );
 
+    // Number of points evaluated by one call of the *_lanes functions
+    #define SNOISE_LANES 8
+
+    // Evaluates snoise3() for SNOISE_LANES points, bit-exact with the scalar version
+    void snoise3_lanes( const float* x, const float* y, const float* z, float* out );
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -9,17 +9,21 @@
 // nor any responsibility to update it.
 
 #include "simulation.h"
+#include "simulation_kernels.h"
 #include "settings.h"
-#include "texture.h"
-#include "util.h"
+#include "thread_pool.h"
 
+#include <assert.h>
+#include <cmath>
 #include <random>
 #include <limits>
 #include <algorithm>
 #include <iostream>
-#include <ppl.h>
 
-using namespace DirectX;
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <intrin.h>
+#    include <immintrin.h>
+#endif
 
 static int const COLOR_SCHEMES[] = {
     156, 139, 113,  55,  49,  40,
@@ -32,27 +36,173 @@ static int const COLOR_SCHEMES[] = {
 
 static int const NUM_COLOR_SCHEMES = (int) (sizeof(COLOR_SCHEMES) / (6 * sizeof(int)));
 
-static XMVECTOR RandomPointOnSphere(std::mt19937& rng)
+static void RandomPointOnSphere(std::mt19937& rng, float point[3])
 {
     std::normal_distribution<float> dist;
 
-    XMVECTOR r;
     for (;;) {
-        r = XMVectorSet(dist(rng), dist(rng), dist(rng), 0.0f);
-        auto d2 = XMVectorGetX(XMVector3LengthSq(r));
+        // Draw in a fixed order (unlike function arguments), so that every compiler generates the same axes
+        float x = dist(rng);
+        float y = dist(rng);
+        float z = dist(rng);
+        auto d2 = x * x + y * y + z * z;
         if (d2 > std::numeric_limits<float>::min()) {
-            return XMVector3Normalize(r);
+            float rcpLength = 1.0f / std::sqrt(d2);
+            point[0] = x * rcpLength;
+            point[1] = y * rcpLength;
+            point[2] = z * rcpLength;
+            return;
         }
     }
     // Unreachable
 }
 
-// From http://guihaire.com/code/?p=1135
-static inline float VeryApproxLog2f(float x)
-{   
-    union { float f; uint32_t i; } ux;
-    ux.f = x;
-    return (float)ux.i * 1.1920928955078125e-7f - 126.94269504f;
+// Branch-free sine and cosine (same polynomials as XMScalarSinCos). LaneSinCos_AVX in simulation_avx.cpp
+// performs the same operations on 8 lanes at once.
+static inline void LaneSinCos(float x, float& sinOut, float& cosOut)
+{
+    // Map x to [-pi, pi]
+    float quotient = SIM_1DIV2PI * x;
+    quotient = (float)(int)(quotient + (quotient >= 0.0f ? 0.5f : -0.5f));
+    float y = x - SIM_2PI * quotient;
+
+    // Map y to [-pi/2, pi/2] with sin(y) = sin(x) by reflecting it about +-pi/2. The selects
+    // only pick constants, which keeps the loops that call this function free of branches.
+    float fold = (y > SIM_PIDIV2 || y < -SIM_PIDIV2) ? 1.0f : 0.0f;
+    float reflectAbout = y >= 0.0f ? SIM_PI : -SIM_PI;
+    y += fold * (reflectAbout - 2.0f * y);
+    float sign = 1.0f - 2.0f * fold;
+
+    float y2 = y * y;
+    sinOut = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+    cosOut = sign * (((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f);
+}
+
+
+void SimulateLanes(AsteroidSimBlock& block, unsigned int laneBegin, unsigned int laneEnd,
+                   float frameTime, const float cameraEye[3],
+                   float world[9][SIM_BLOCK_SIZE], float distSq[SIM_BLOCK_SIZE], float scaleSq[SIM_BLOCK_SIZE])
+{
+    // All lanes are independent and the loop has no branches. Compilers leave it scalar at -O2 and vectorize it
+    // for the baseline SSE at best, which is why full blocks go through SimulateLanes_AVX when the CPU has AVX.
+    for (unsigned int l = laneBegin; l < laneEnd; ++l) {
+        // Orbit, kept in [-pi, pi] to preserve precision
+        float angle = block.orbitAngle[l] + block.orbitVelocity[l] * frameTime;
+        angle += angle > SIM_PI ? -SIM_2PI : 0.0f;
+        block.orbitAngle[l] = angle;
+
+        float sinOrbit, cosOrbit;
+        LaneSinCos(angle, sinOrbit, cosOrbit);
+
+        // Spin: rotate the orientation about the spin axis
+        float sinHalfSpin, cosHalfSpin;
+        LaneSinCos(0.5f * block.spinVelocity[l] * frameTime, sinHalfSpin, cosHalfSpin);
+        float dx = block.spinAxisX[l] * sinHalfSpin;
+        float dy = block.spinAxisY[l] * sinHalfSpin;
+        float dz = block.spinAxisZ[l] * sinHalfSpin;
+        float dw = cosHalfSpin;
+
+        float qx = block.orientationX[l];
+        float qy = block.orientationY[l];
+        float qz = block.orientationZ[l];
+        float qw = block.orientationW[l];
+
+        float x = dw * qx + dx * qw + dy * qz - dz * qy;
+        float y = dw * qy - dx * qz + dy * qw + dz * qx;
+        float z = dw * qz + dx * qy - dy * qx + dz * qw;
+        float w = dw * qw - dx * qx - dy * qy - dz * qz;
+
+        // Renormalize to avoid drift. The length is always very close to 1, so the first-order
+        // approximation of 1/sqrt(lenSq) is accurate to float precision.
+        float rcpLen = 0.5f * (3.0f - (x * x + y * y + z * z + w * w));
+        x *= rcpLen;
+        y *= rcpLen;
+        z *= rcpLen;
+        w *= rcpLen;
+
+        block.orientationX[l] = x;
+        block.orientationY[l] = y;
+        block.orientationZ[l] = z;
+        block.orientationW[l] = w;
+
+        // Position: disc offset rotated about Y by the orbit angle
+        float posX = block.orbitRadius[l] * cosOrbit;
+        float posY = block.discHeight[l];
+        float posZ = -block.orbitRadius[l] * sinOrbit;
+        block.positionX[l] = posX;
+        block.positionY[l] = posY;
+        block.positionZ[l] = posZ;
+
+        // Rows of scale * rotation(q) * rotationY(angle)
+        float scale = block.scale[l];
+        float r00 = 1.0f - 2.0f * (y * y + z * z), r01 = 2.0f * (x * y + w * z), r02 = 2.0f * (x * z - w * y);
+        float r10 = 2.0f * (x * y - w * z), r11 = 1.0f - 2.0f * (x * x + z * z), r12 = 2.0f * (y * z + w * x);
+        float r20 = 2.0f * (x * z + w * y), r21 = 2.0f * (y * z - w * x), r22 = 1.0f - 2.0f * (x * x + y * y);
+
+        world[0][l] = scale * (r00 * cosOrbit + r02 * sinOrbit);
+        world[1][l] = scale * r01;
+        world[2][l] = scale * (r02 * cosOrbit - r00 * sinOrbit);
+        world[3][l] = scale * (r10 * cosOrbit + r12 * sinOrbit);
+        world[4][l] = scale * r11;
+        world[5][l] = scale * (r12 * cosOrbit - r10 * sinOrbit);
+        world[6][l] = scale * (r20 * cosOrbit + r22 * sinOrbit);
+        world[7][l] = scale * r21;
+        world[8][l] = scale * (r22 * cosOrbit - r20 * sinOrbit);
+
+        float toEyeX = cameraEye[0] - posX;
+        float toEyeY = cameraEye[1] - posY;
+        float toEyeZ = cameraEye[2] - posZ;
+        distSq[l] = toEyeX * toEyeX + toEyeY * toEyeY + toEyeZ * toEyeZ;
+        scaleSq[l] = scale * scale;
+    }
+}
+
+
+// The AVX kernel is used if it was compiled and both the CPU and the OS (which must save the YMM registers) support AVX
+static bool CpuSupportsAVX()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+    const bool avx     = (cpuInfo[2] & (1 << 28)) != 0;
+    return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // Also checks XCR0 for the OS support
+    return __builtin_cpu_supports("avx") != 0;
+#else
+    return false;
+#endif
+}
+
+static const bool sUseAVXKernel = SimAVXKernelCompiled() && CpuSupportsAVX();
+
+
+void ExtractFrustumPlanes(const float viewProjection[4][4], SimFrustum* outFrustum)
+{
+    // Clip-space coordinates are the products of the row vector (x, y, z, 1) with the columns of the matrix,
+    // and a point is inside when -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    static const float signs[6][2] = {
+        { 1.0f,  1.0f}, // Left:   w + x
+        { 1.0f, -1.0f}, // Right:  w - x
+        { 1.0f,  1.0f}, // Bottom: w + y
+        { 1.0f, -1.0f}, // Top:    w - y
+        { 0.0f,  1.0f}, // z
+        { 1.0f, -1.0f}, // w - z
+    };
+    for (unsigned int p = 0; p < 6; ++p) {
+        unsigned int column = p / 2;
+        float* plane = outFrustum->planes[p];
+        for (unsigned int r = 0; r < 4; ++r) {
+            plane[r] = signs[p][0] * viewProjection[r][3] + signs[p][1] * viewProjection[r][column];
+        }
+
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        float rcpLength = length > 0.0f ? 1.0f / length : 0.0f;
+        for (unsigned int r = 0; r < 4; ++r) {
+            plane[r] *= rcpLength;
+        }
+    }
 }
 
 
@@ -61,6 +211,7 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
                                          unsigned int textureCount)
     : mAsteroidStatic(asteroidCount)
     , mAsteroidDynamic(asteroidCount)
+    , mSimBlocks((size_t{asteroidCount} + SIM_BLOCK_SIZE - 1) / SIM_BLOCK_SIZE)
     , mIndexOffsets(size_t{subdivCount} + 2) // Mesh subdivs are inclusive on both ends and need forward differencing for count
     , mSubdivCount(subdivCount)
 {
@@ -74,12 +225,19 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
     CreateAsteroidsFromGeospheres(&mMeshes, mSubdivCount, meshInstanceCount,
                                   rng(), mIndexOffsets.data(), &mVertexCountPerMesh);
 
+    // Conservative bounding sphere for culling: the meshes are deformed unit spheres
+    mMeshBoundingRadius = 0.0f;
+    for (const auto& v : mMeshes.vertices) {
+        mMeshBoundingRadius = std::max(mMeshBoundingRadius, v.x * v.x + v.y * v.y + v.z * v.z);
+    }
+    mMeshBoundingRadius = std::sqrt(mMeshBoundingRadius);
+
     CreateTextures(textureCount, rng());
 
     // Constants
     std::normal_distribution<float> orbitRadiusDist(SIM_ORBIT_RADIUS, 0.6f * SIM_DISC_RADIUS);
     std::normal_distribution<float> heightDist(0.0f, 0.4f);
-    std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+    std::uniform_real_distribution<float> angleDist(-SIM_PI, SIM_PI);
     std::uniform_real_distribution<float> radialVelocityDist(5.0f, 15.0f);
     std::uniform_real_distribution<float> spinVelocityDist(-2.0f, 2.0f);
     std::normal_distribution<float> scaleDist(1.3f, 0.7f);
@@ -90,8 +248,14 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
 
     // Approximate SRGB->Linear for colors
     float linearColorSchemes[NUM_COLOR_SCHEMES * 6];
-    for (int i = 0; i < ARRAYSIZE(linearColorSchemes); ++i) {
-        linearColorSchemes[i] = std::powf((float)COLOR_SCHEMES[i] / 255.0f, 2.2f);
+    for (size_t i = 0; i < sizeof(linearColorSchemes) / sizeof(linearColorSchemes[0]); ++i) {
+        linearColorSchemes[i] = std::pow((float)COLOR_SCHEMES[i] / 255.0f, 2.2f);
+    }
+
+    // Padding lanes of the last block are simulated but never output
+    for (auto& block : mSimBlocks) {
+        std::fill(std::begin(block.scale), std::end(block.scale), 1.0f);
+        std::fill(std::begin(block.orientationW), std::end(block.orientationW), 1.0f);
     }
 
     // Create a torus of asteroids that spin around the ring
@@ -101,72 +265,153 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
         scale = scale * 0.3f;
 #endif
         scale = std::max(scale, SIM_MIN_SCALE);
-        auto scaleMatrix = XMMatrixScaling(scale, scale, scale);
 
         auto orbitRadius = orbitRadiusDist(rng);
         auto discPosY = float(SIM_DISC_RADIUS) * heightDist(rng);
 
-        auto disc = XMMatrixTranslation(orbitRadius, discPosY, 0.0f);
-
         auto positionAngle = angleDist(rng);
-        auto orbit = XMMatrixRotationY(positionAngle);
 
         auto meshInstance = (unsigned int)(i / instancesPerMesh); // Vcache friendly ordering
 
+        auto& block = mSimBlocks[i / SIM_BLOCK_SIZE];
+        auto lane = i % SIM_BLOCK_SIZE;
+
+        // Simulation state. The world matrix is rebuilt as scale * spin * disc * orbit.
+        block.orbitRadius[lane] = orbitRadius;
+        block.discHeight[lane] = discPosY;
+        block.scale[lane] = scale;
+        block.orbitAngle[lane] = positionAngle;
+        block.spinVelocity[lane] = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
+        block.orbitVelocity[lane] = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
+
         // Static data
-        mAsteroidStatic[i].spinVelocity = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
-        mAsteroidStatic[i].orbitVelocity = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
         mAsteroidStatic[i].vertexStart = mVertexCountPerMesh * meshInstance;
-        mAsteroidStatic[i].spinAxis = XMVector3Normalize(RandomPointOnSphere(rng));
-        mAsteroidStatic[i].scale = scale;
+
+        float spinAxis[3];
+        RandomPointOnSphere(rng, spinAxis);
+        block.spinAxisX[lane] = spinAxis[0];
+        block.spinAxisY[lane] = spinAxis[1];
+        block.spinAxisZ[lane] = spinAxis[2];
+
         mAsteroidStatic[i].textureIndex = textureIndexDist(rng);
 
-        auto colorScheme = ((int)abs(colorSchemeDist(rng))) % NUM_COLOR_SCHEMES;
+        auto colorScheme = ((int)std::abs(colorSchemeDist(rng))) % NUM_COLOR_SCHEMES;
         auto c = linearColorSchemes + 6 * colorScheme;
-        mAsteroidStatic[i].surfaceColor = XMFLOAT3(c[0], c[1], c[2]);
-        mAsteroidStatic[i].deepColor    = XMFLOAT3(c[3], c[4], c[5]);
+        std::copy(c + 0, c + 3, mAsteroidStatic[i].surfaceColor);
+        std::copy(c + 3, c + 6, mAsteroidStatic[i].deepColor);
 
-        // Initialize dynamic data
-        mAsteroidDynamic[i].world = scaleMatrix * disc * orbit;
+        assert(block.scale[lane] > 0.0f);
+        assert(block.orbitVelocity[lane] > 0.0f);
+    }
+
+    // LOD thresholds: one subdiv level for each factor of 2 of the approximate screen size past the minimum
+    // TODO: This constant should really depend on resolution and/or be configurable...
+    const float minSubdivSize = 0.0019f;
+    for (unsigned int s = 1; s <= mSubdivCount; ++s) {
+        float threshold = minSubdivSize * float(1u << s);
+        mSubdivSizeThresholdsSq.push_back(threshold * threshold);
+    }
 
-        assert(mAsteroidStatic[i].scale > 0.0f);
-        assert(mAsteroidStatic[i].orbitVelocity > 0.0f);
+    // Initialize dynamic data
+    const float origin[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t b = 0; b < mSimBlocks.size(); ++b) {
+        auto blockStart = b * SIM_BLOCK_SIZE;
+        auto laneEnd = (unsigned int)std::min(size_t{SIM_BLOCK_SIZE}, size_t{asteroidCount} - blockStart);
+        UpdateBlock(mSimBlocks[b], blockStart, 0, laneEnd, 0.0f, origin, nullptr, nullptr);
     }
 }
 
 
-void AsteroidsSimulation::Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
-                                 size_t startIndex, size_t count)
+size_t AsteroidsSimulation::Update(float frameTime, const float cameraEye[3], const Settings& settings,
+                                   size_t startIndex, size_t count,
+                                   const SimFrustum* frustum, uint32_t* visibleIndices)
 {
-    bool animate = settings.animate;
+    assert((frustum == nullptr) == (visibleIndices == nullptr));
+    float dt = settings.animate ? frameTime : 0.0f;
+
+    size_t last = count ? std::min(startIndex + count, mAsteroidDynamic.size()) : mAsteroidDynamic.size();
+    size_t visibleCount = 0;
+    for (size_t i = startIndex; i < last;) {
+        size_t blockIdx = i / SIM_BLOCK_SIZE;
+        size_t blockStart = blockIdx * SIM_BLOCK_SIZE;
+        auto laneBegin = (unsigned int)(i - blockStart);
+        auto laneEnd = (unsigned int)std::min(size_t{SIM_BLOCK_SIZE}, last - blockStart);
+
+        // Blocks at the range boundaries may be partial, their other lanes belong to another range
+        visibleCount += UpdateBlock(mSimBlocks[blockIdx], blockStart, laneBegin, laneEnd, dt, cameraEye,
+                                    frustum, visibleIndices ? visibleIndices + visibleCount : nullptr);
+        i = blockStart + laneEnd;
+    }
 
-    // TODO: This constant should really depend on resolution and/or be configurable...
-    static const float minSubdivSizeLog2 = std::log2f(0.0019f);
+    return frustum ? visibleCount : last - std::min(startIndex, last);
+}
 
-    size_t last = count ? startIndex + count : mAsteroidDynamic.size();
-    for (size_t i = startIndex; i < last; ++i) {
-        const AsteroidStatic& staticData = mAsteroidStatic[i];
-        AsteroidDynamic& dynamicData = mAsteroidDynamic[i];
 
-        if (animate) {
-            auto orbit = XMMatrixRotationY(staticData.orbitVelocity * frameTime);
-            auto spin = XMMatrixRotationNormal(staticData.spinAxis, staticData.spinVelocity * frameTime);
-            dynamicData.world = spin * dynamicData.world * orbit;
+unsigned int AsteroidsSimulation::UpdateBlock(AsteroidSimBlock& block, size_t blockStart, unsigned int laneBegin, unsigned int laneEnd,
+                                              float frameTime, const float cameraEye[3],
+                                              const SimFrustum* frustum, uint32_t* visibleIndices)
+{
+    // Rotation part of the world matrix, row-major as in XMMATRIX
+    float world[9][SIM_BLOCK_SIZE];
+    float distSq[SIM_BLOCK_SIZE];
+    float scaleSq[SIM_BLOCK_SIZE];
+    unsigned int subdiv[SIM_BLOCK_SIZE] = {};
+
+    // Ranges that split a block must not touch the lanes of other ranges, those use the portable kernel
+    if (sUseAVXKernel && laneBegin == 0 && laneEnd == SIM_BLOCK_SIZE) {
+        SimulateLanes_AVX(block, frameTime, cameraEye, world, distSq, scaleSq);
+    } else {
+        SimulateLanes(block, laneBegin, laneEnd, frameTime, cameraEye, world, distSq, scaleSq);
+    }
+
+    // Pick LOD based on approx screen area: scale / distance is compared against the
+    // thresholds of all levels, which avoids the log2 and the square root
+    for (unsigned int s = 0; s < mSubdivCount; ++s) {
+        float thresholdSq = mSubdivSizeThresholdsSq[s];
+        for (unsigned int l = laneBegin; l < laneEnd; ++l) {
+            subdiv[l] += scaleSq[l] >= distSq[l] * thresholdSq ? 1 : 0;
         }
+    }
 
-        // Pick LOD based on approx screen area - can be very approximate
-        auto position = dynamicData.world.r[3];
-        auto distanceToEyeRcp = XMVectorGetX(XMVector3ReciprocalLengthEst(XMVectorSubtract(cameraEye, position)));
-        // Add one subdiv for each factor of 2 past min
-        auto relativeScreenSizeLog2 = VeryApproxLog2f(staticData.scale * distanceToEyeRcp);
-        float subdivFloat = std::max(0.0f, relativeScreenSizeLog2 - minSubdivSizeLog2);
-        auto subdiv = std::min(mSubdivCount, (unsigned int)subdivFloat);
+    unsigned int visibleCount = 0;
+    if (frustum != nullptr) {
+        // Bounding sphere vs. frustum planes; also branch-free over the lanes
+        unsigned int visible[SIM_BLOCK_SIZE];
+        float radius[SIM_BLOCK_SIZE];
+        for (unsigned int l = laneBegin; l < laneEnd; ++l) {
+            visible[l] = 1;
+            radius[l] = block.scale[l] * mMeshBoundingRadius;
+        }
+        for (unsigned int p = 0; p < 6; ++p) {
+            const float* plane = frustum->planes[p];
+            for (unsigned int l = laneBegin; l < laneEnd; ++l) {
+                float dist = plane[0] * block.positionX[l] + plane[1] * block.positionY[l] + plane[2] * block.positionZ[l] + plane[3];
+                visible[l] &= dist >= -radius[l] ? 1u : 0u;
+            }
+        }
 
-        // TODO: Ignore/cull/force lowest subdiv if offscreen?
-        
-        dynamicData.indexStart = mIndexOffsets[subdiv];
-        dynamicData.indexCount = mIndexOffsets[subdiv+1] - dynamicData.indexStart;
+        // Compact the visible lanes: every lane writes its index, but only visible ones advance the output
+        for (unsigned int l = laneBegin; l < laneEnd; ++l) {
+            visibleIndices[visibleCount] = (uint32_t)(blockStart + l);
+            visibleCount += visible[l];
+        }
     }
+
+    // Scatter to the per-asteroid output. Culled asteroids are updated as well, since their
+    // state must stay valid for renderers that do not cull and for the next frames.
+    for (unsigned int l = laneBegin; l < laneEnd; ++l) {
+        AsteroidDynamic& dynamicData = mAsteroidDynamic[blockStart + l];
+        float (&m)[4][4] = dynamicData.world;
+        m[0][0] = world[0][l]; m[0][1] = world[1][l]; m[0][2] = world[2][l]; m[0][3] = 0.0f;
+        m[1][0] = world[3][l]; m[1][1] = world[4][l]; m[1][2] = world[5][l]; m[1][3] = 0.0f;
+        m[2][0] = world[6][l]; m[2][1] = world[7][l]; m[2][2] = world[8][l]; m[2][3] = 0.0f;
+        m[3][0] = block.positionX[l]; m[3][1] = block.positionY[l]; m[3][2] = block.positionZ[l]; m[3][3] = 1.0f;
+
+        dynamicData.indexStart = mIndexOffsets[subdiv[l]];
+        dynamicData.indexCount = mIndexOffsets[subdiv[l] + 1] - dynamicData.indexStart;
+    }
+
+    return visibleCount;
 }
 
 
@@ -175,11 +420,10 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
     mTextureDim = TEXTURE_DIM;
     mTextureCount = textureCount;
     mTextureArraySize = 3;
-    {
-        DWORD msbIndex = 0;
-        auto result = _BitScanReverse(&msbIndex, mTextureDim);
-        assert(result); // Should only fail if mTextureDim = 0
-        mTextureMipLevels = msbIndex + 1;
+    assert(mTextureDim > 0);
+    mTextureMipLevels = 0;
+    for (auto dim = mTextureDim; dim != 0; dim >>= 1) {
+        ++mTextureMipLevels; // Index of the most significant bit + 1
     }
 
     assert((mTextureDim & (mTextureDim-1)) == 0); // Must be pow2 currently; we don't handle wacky mip chains
@@ -189,62 +433,91 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
         << mTextureDim << "x" << mTextureDim << " textures..." << std::endl;
     
     // Allocate space
-    UINT texelSizeInBytes = 4; // RGBA8
-    UINT extraSpaceForMips = 2;
-    UINT totalTextureSizeInBytes = texelSizeInBytes * mTextureDim * mTextureDim * mTextureArraySize * extraSpaceForMips;
-    totalTextureSizeInBytes = AlignUp(totalTextureSizeInBytes, 64U); // Avoid false sharing
+    unsigned int texelSizeInBytes = 4; // RGBA8
+    unsigned int extraSpaceForMips = 2;
+    unsigned int totalTextureSizeInBytes = texelSizeInBytes * mTextureDim * mTextureDim * mTextureArraySize * extraSpaceForMips;
+    totalTextureSizeInBytes = (totalTextureSizeInBytes + 63U) & ~63U; // Avoid false sharing
 
     mTextureDataBuffer.resize(size_t{totalTextureSizeInBytes} * size_t{textureCount});
     mTextureSubresources.resize(size_t{mTextureArraySize} * size_t{mTextureMipLevels} * size_t{textureCount});
     
-    // Parallel over textures
-    std::vector<unsigned int> rngSeeds(textureCount);
+    // Noise parameters, drawn in the same order as when every texture was generated by a single task
+    struct NoiseParams
+    {
+        float scale;
+        float persistence;
+        float seeds[3];
+    };
+    assert(mTextureArraySize <= 3);
+    std::vector<NoiseParams> noiseParams(textureCount);
     {
         std::mt19937 seeds;
-        for (auto &i : rngSeeds) i = seeds();
+        for (auto& params : noiseParams) {
+            std::mt19937 rng(seeds());
+            auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
+            auto randomNoiseScale = std::uniform_real_distribution<float>(100, 150);
+            auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
+
+            // Use same parameters for each of the tri-planar projection planes/cube map faces/etc.
+            params.scale = randomNoiseScale(rng) / float(mTextureDim);
+            params.persistence = randomPersistence(rng);
+            for (unsigned int a = 0; a < mTextureArraySize; ++a) {
+                params.seeds[a] = randomNoise(rng);
+            }
+        }
     }
 
-    concurrency::parallel_for(UINT(0), textureCount, [&](UINT t) {
-        std::mt19937 rng(rngSeeds[t]);
-        auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
-        auto randomNoiseScale = std::uniform_real_distribution<float>(100, 150);
-        auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
-
-        BYTE* data = mTextureDataBuffer.data() + t * size_t{totalTextureSizeInBytes};
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
-            for (UINT m = 0; m < mTextureMipLevels; ++m) {
+    for (unsigned int t = 0; t < textureCount; ++t) {
+        uint8_t* data = mTextureDataBuffer.data() + t * size_t{totalTextureSizeInBytes};
+        for (unsigned int a = 0; a < mTextureArraySize; ++a) {
+            for (unsigned int m = 0; m < mTextureMipLevels; ++m) {
                 auto width  = mTextureDim >> m;
                 auto height = mTextureDim >> m;
 
-                D3D11_SUBRESOURCE_DATA initialData = {};
-                initialData.pSysMem = data;
-                initialData.SysMemPitch = width * texelSizeInBytes;
+                SubresourceData initialData;
+                initialData.pData = data;
+                initialData.rowPitch = width * texelSizeInBytes;
                 mTextureSubresources[SubresourceIndex(t, a, m)] = initialData;
 
-                data += size_t{initialData.SysMemPitch} * size_t{height};
+                data += size_t{initialData.rowPitch} * size_t{height};
             }
         }
+    }
 
-        // Use same parameters for each of the tri-planar projection planes/cube map faces/etc.
-        float noiseScale = randomNoiseScale(rng) / float(mTextureDim);
-        float persistence = randomPersistence(rng);
-        float strength = 1.5f;
-
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
-            float redScale   = 255.0f;
-            float greenScale = 255.0f;
-            float blueScale  = 255.0f;
-
-            // DEBUG colors
+    // Parallel over tiles of rows of every array slice of every texture, so that the work is
+    // balanced even when there are fewer textures than threads
+    const unsigned int rowsPerTile = std::min(mTextureDim, 32u);
+    const unsigned int tilesPerSlice = mTextureDim / rowsPerTile;
+    const unsigned int sliceCount = textureCount * mTextureArraySize;
+
+    ThreadPool threadPool;
+    threadPool.ParallelFor(0u, sliceCount * tilesPerSlice, [&](unsigned int tile) {
+        auto slice = tile / tilesPerSlice;
+        auto t = slice / mTextureArraySize;
+        auto a = slice % mTextureArraySize;
+        auto rowBegin = (tile % tilesPerSlice) * rowsPerTile;
+        const auto& params = noiseParams[t];
+
+        float redScale   = 255.0f;
+        float greenScale = 255.0f;
+        float blueScale  = 255.0f;
+
+        // DEBUG colors
 #if 0
-            redScale   = t & 1 ? 255.0f : 0.0f;
-            greenScale = t & 2 ? 255.0f : 0.0f;
-            blueScale  = t & 4 ? 255.0f : 0.0f;
+        redScale   = t & 1 ? 255.0f : 0.0f;
+        greenScale = t & 2 ? 255.0f : 0.0f;
+        blueScale  = t & 4 ? 255.0f : 0.0f;
 #endif
 
-            FillNoise2D_RGBA8(&mTextureSubresources[SubresourceIndex(t, a)], mTextureDim, mTextureDim, mTextureMipLevels,
-                              randomNoise(rng), persistence, noiseScale, strength,
+        FillNoise2DRows_RGBA8(mTextureSubresources[SubresourceIndex(t, a)], mTextureDim, rowBegin, rowBegin + rowsPerTile,
+                              params.seeds[a], params.persistence, params.scale, 1.5f,
                               redScale, greenScale, blueScale);
-        }
+    }); // parallel_for
+
+    // Mips need the whole top level of the slice
+    threadPool.ParallelFor(0u, sliceCount, [&](unsigned int slice) {
+        auto t = slice / mTextureArraySize;
+        auto a = slice % mTextureArraySize;
+        GenerateMips2D_XXXX8(&mTextureSubresources[SubresourceIndex(t, a)], mTextureDim, mTextureDim, mTextureMipLevels);
     }); // parallel_for
 }
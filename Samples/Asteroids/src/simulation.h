@@ -10,33 +10,68 @@
 
 #pragma once
 
-#include <d3d11.h> // For D3D11_SUBRESOURCE_DATA
-#include <DirectXMath.h>
+#include <stdint.h>
 #include <vector>
 #include <algorithm>
 #include <random>
 
 #include "mesh.h"
 #include "settings.h"
+#include "texture_gen.h"
 
-// We may want to ISPC-ify this down the road and just let it own the data structure in AoSoA format or similar
-// For now we'll just do the dumb thing and see if it's fast enough
+// Number of asteroids in one AoSoA block of the simulation state
+enum { SIM_BLOCK_SIZE = 8 };
+
+// Simulation state of SIM_BLOCK_SIZE asteroids in AoSoA layout: every member holds one value per lane,
+// so the update kernel works on all lanes of a block at once (one AVX register per member, see simulation_avx.cpp).
+// The world matrix is not stored, it is rebuilt from scale * spin * disc offset * orbit every frame.
+struct alignas(32) AsteroidSimBlock
+{
+    // Constant
+    float orbitRadius[SIM_BLOCK_SIZE];
+    float discHeight[SIM_BLOCK_SIZE];
+    float scale[SIM_BLOCK_SIZE];
+    float orbitVelocity[SIM_BLOCK_SIZE];
+    float spinVelocity[SIM_BLOCK_SIZE];
+    float spinAxisX[SIM_BLOCK_SIZE];
+    float spinAxisY[SIM_BLOCK_SIZE];
+    float spinAxisZ[SIM_BLOCK_SIZE];
+
+    // Dynamic
+    float orbitAngle[SIM_BLOCK_SIZE];
+    float orientationX[SIM_BLOCK_SIZE]; // Spin orientation quaternion
+    float orientationY[SIM_BLOCK_SIZE];
+    float orientationZ[SIM_BLOCK_SIZE];
+    float orientationW[SIM_BLOCK_SIZE];
+    float positionX[SIM_BLOCK_SIZE];
+    float positionY[SIM_BLOCK_SIZE];
+    float positionZ[SIM_BLOCK_SIZE];
+};
+
+// Per-frame output of the update kernel consumed by the renderers
 struct AsteroidDynamic
 {
-    DirectX::XMMATRIX world;
+    float world[4][4]; // Row-major, same layout as XMFLOAT4X4
     // These depend on chosen subdiv level, hence are not constant
     unsigned int indexStart;
     unsigned int indexCount;
 };
 
+// View frustum as six planes (a, b, c, d) with unit normals pointing inside: dot(n, p) + d >= 0 for the inner half-space
+struct SimFrustum
+{
+    float planes[6][4];
+};
+
+// Extracts the frustum planes of a row-major view-projection matrix that uses the row vector convention of
+// DirectXMath and a [0, w] clip-space depth range. Works for both regular and reversed depth.
+void ExtractFrustumPlanes(const float viewProjection[4][4], SimFrustum* outFrustum);
+
+// Render-only data that never changes
 struct AsteroidStatic
 {
-    DirectX::XMFLOAT3 surfaceColor;
-    DirectX::XMFLOAT3 deepColor;
-    DirectX::XMVECTOR spinAxis;
-    float scale;
-    float spinVelocity;
-    float orbitVelocity;
+    float surfaceColor[3];
+    float deepColor[3];
     unsigned int vertexStart;
     unsigned int textureIndex;
 };
@@ -44,21 +79,25 @@ struct AsteroidStatic
 class AsteroidsSimulation
 {
 private:
-    // NOTE: Memory could be optimized further for efficient cache traversal, etc.
     std::vector<AsteroidStatic> mAsteroidStatic;
     std::vector<AsteroidDynamic> mAsteroidDynamic;
+    std::vector<AsteroidSimBlock> mSimBlocks;
 
     Mesh mMeshes;
     std::vector<unsigned int> mIndexOffsets;
     unsigned int mSubdivCount;
     unsigned int mVertexCountPerMesh;
+    // Radius of the bounding sphere of all meshes at unit scale
+    float mMeshBoundingRadius;
+    // Squared screen size thresholds of subdiv levels 1..mSubdivCount
+    std::vector<float> mSubdivSizeThresholdsSq;
 
     unsigned int mTextureDim;
     unsigned int mTextureCount;
     unsigned int mTextureArraySize;
     unsigned int mTextureMipLevels;
-    std::vector<BYTE> mTextureDataBuffer;
-    std::vector<D3D11_SUBRESOURCE_DATA> mTextureSubresources;
+    std::vector<uint8_t> mTextureDataBuffer;
+    std::vector<SubresourceData> mTextureSubresources;
 
     unsigned int SubresourceIndex(unsigned int texture, unsigned int arrayElement = 0, unsigned int mip = 0)
     {
@@ -73,7 +112,8 @@ public:
                         unsigned int textureCount);
 
     const Mesh* Meshes() { return &mMeshes; }
-    const D3D11_SUBRESOURCE_DATA* TextureData(unsigned int textureIndex)
+    // GetTextureMipLevels() * 3 array slices of RGBA8 data, mips of each slice are consecutive
+    const SubresourceData* TextureData(unsigned int textureIndex)
     {
         return mTextureSubresources.data() + SubresourceIndex(textureIndex);
     }
@@ -83,8 +123,21 @@ public:
     const AsteroidStatic* StaticData() const { return mAsteroidStatic.data(); }
     const AsteroidDynamic* DynamicData() const { return mAsteroidDynamic.data(); }
 
+    size_t AsteroidCount() const { return mAsteroidDynamic.size(); }
+
     // Can optionally provide a range of asteroids to update; count = 0 => to the end
-    // This is useful for multithreading
-    void Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
-                size_t startIndex = 0, size_t count = 0);
+    // This is useful for multithreading. Ranges that start or end in the middle of a block
+    // only touch their own lanes, but block-aligned ranges are faster.
+    // If a frustum is given, the bounding spheres of the updated asteroids are culled against it and the indices of
+    // the visible ones are written in ascending order to visibleIndices, which must have room for the whole range.
+    // Returns the number of visible asteroids (the size of the range when there is no frustum).
+    size_t Update(float frameTime, const float cameraEye[3], const Settings& settings,
+                  size_t startIndex = 0, size_t count = 0,
+                  const SimFrustum* frustum = nullptr, uint32_t* visibleIndices = nullptr);
+
+private:
+    // Returns the number of visible lanes written to visibleIndices (0 if visibleIndices is null)
+    unsigned int UpdateBlock(AsteroidSimBlock& block, size_t blockStart, unsigned int laneBegin, unsigned int laneEnd,
+                             float frameTime, const float cameraEye[3],
+                             const SimFrustum* frustum, uint32_t* visibleIndices);
 };
@@ -0,0 +1,171 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+// This file is compiled with -mavx (/arch:AVX with MSVC) on x86, see CMakeLists.txt. Everything in it
+// may use AVX instructions, so it must only be entered after the CPU check in simulation.cpp, and it must not
+// use inline functions or templates from other headers, since the linker may pick their AVX copies for all callers.
+// FMA is deliberately not enabled: contracted multiply-adds would round differently from SimulateLanes.
+
+#include "simulation_kernels.h"
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+static_assert(SIM_BLOCK_SIZE == 8, "The AVX kernel processes one block per register");
+
+// The loads and stores are unaligned: before C++17 std::vector does not honor the alignment of AsteroidSimBlock
+
+// Same operations in the same order as LaneSinCos in simulation.cpp
+static inline void LaneSinCos_AVX(__m256 x, __m256& sinOut, __m256& cosOut)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one  = _mm256_set1_ps(1.0f);
+    const __m256 two  = _mm256_set1_ps(2.0f);
+
+    // Map x to [-pi, pi]
+    __m256 quotient = _mm256_mul_ps(_mm256_set1_ps(SIM_1DIV2PI), x);
+    __m256 round    = _mm256_blendv_ps(_mm256_set1_ps(-0.5f), _mm256_set1_ps(0.5f), _mm256_cmp_ps(quotient, zero, _CMP_GE_OQ));
+    quotient        = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_add_ps(quotient, round)));
+    __m256 y        = _mm256_sub_ps(x, _mm256_mul_ps(_mm256_set1_ps(SIM_2PI), quotient));
+
+    // Map y to [-pi/2, pi/2] with sin(y) = sin(x) by reflecting it about +-pi/2
+    __m256 outside      = _mm256_or_ps(_mm256_cmp_ps(y, _mm256_set1_ps(SIM_PIDIV2), _CMP_GT_OQ),
+                                       _mm256_cmp_ps(y, _mm256_set1_ps(-SIM_PIDIV2), _CMP_LT_OQ));
+    __m256 fold         = _mm256_and_ps(outside, one);
+    __m256 reflectAbout = _mm256_blendv_ps(_mm256_set1_ps(-SIM_PI), _mm256_set1_ps(SIM_PI), _mm256_cmp_ps(y, zero, _CMP_GE_OQ));
+    y                   = _mm256_add_ps(y, _mm256_mul_ps(fold, _mm256_sub_ps(reflectAbout, _mm256_mul_ps(two, y))));
+    __m256 sign         = _mm256_sub_ps(one, _mm256_mul_ps(two, fold));
+
+    __m256 y2 = _mm256_mul_ps(y, y);
+
+    __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-2.3889859e-08f), y2), _mm256_set1_ps(2.7525562e-06f));
+    s        = _mm256_sub_ps(_mm256_mul_ps(s, y2), _mm256_set1_ps(0.00019840874f));
+    s        = _mm256_add_ps(_mm256_mul_ps(s, y2), _mm256_set1_ps(0.0083333310f));
+    s        = _mm256_sub_ps(_mm256_mul_ps(s, y2), _mm256_set1_ps(0.16666667f));
+    s        = _mm256_add_ps(_mm256_mul_ps(s, y2), one);
+    sinOut   = _mm256_mul_ps(s, y);
+
+    __m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-2.6051615e-07f), y2), _mm256_set1_ps(2.4760495e-05f));
+    c        = _mm256_sub_ps(_mm256_mul_ps(c, y2), _mm256_set1_ps(0.0013888378f));
+    c        = _mm256_add_ps(_mm256_mul_ps(c, y2), _mm256_set1_ps(0.041666638f));
+    c        = _mm256_sub_ps(_mm256_mul_ps(c, y2), _mm256_set1_ps(0.5f));
+    c        = _mm256_add_ps(_mm256_mul_ps(c, y2), one);
+    cosOut   = _mm256_mul_ps(sign, c);
+}
+
+static inline __m256 Mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+static inline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+static inline __m256 Sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+
+void SimulateLanes_AVX(AsteroidSimBlock& block, float frameTime, const float cameraEye[3],
+                       float world[9][SIM_BLOCK_SIZE], float distSq[SIM_BLOCK_SIZE], float scaleSq[SIM_BLOCK_SIZE])
+{
+    const __m256 dt  = _mm256_set1_ps(frameTime);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    // Orbit, kept in [-pi, pi] to preserve precision
+    __m256 angle = Add(_mm256_loadu_ps(block.orbitAngle), Mul(_mm256_loadu_ps(block.orbitVelocity), dt));
+    angle        = Add(angle, _mm256_and_ps(_mm256_cmp_ps(angle, _mm256_set1_ps(SIM_PI), _CMP_GT_OQ), _mm256_set1_ps(-SIM_2PI)));
+    _mm256_storeu_ps(block.orbitAngle, angle);
+
+    __m256 sinOrbit, cosOrbit;
+    LaneSinCos_AVX(angle, sinOrbit, cosOrbit);
+
+    // Spin: rotate the orientation about the spin axis
+    __m256 sinHalfSpin, cosHalfSpin;
+    LaneSinCos_AVX(Mul(Mul(_mm256_set1_ps(0.5f), _mm256_loadu_ps(block.spinVelocity)), dt), sinHalfSpin, cosHalfSpin);
+    __m256 dx = Mul(_mm256_loadu_ps(block.spinAxisX), sinHalfSpin);
+    __m256 dy = Mul(_mm256_loadu_ps(block.spinAxisY), sinHalfSpin);
+    __m256 dz = Mul(_mm256_loadu_ps(block.spinAxisZ), sinHalfSpin);
+    __m256 dw = cosHalfSpin;
+
+    __m256 qx = _mm256_loadu_ps(block.orientationX);
+    __m256 qy = _mm256_loadu_ps(block.orientationY);
+    __m256 qz = _mm256_loadu_ps(block.orientationZ);
+    __m256 qw = _mm256_loadu_ps(block.orientationW);
+
+    __m256 x = Sub(Add(Add(Mul(dw, qx), Mul(dx, qw)), Mul(dy, qz)), Mul(dz, qy));
+    __m256 y = Add(Add(Sub(Mul(dw, qy), Mul(dx, qz)), Mul(dy, qw)), Mul(dz, qx));
+    __m256 z = Add(Sub(Add(Mul(dw, qz), Mul(dx, qy)), Mul(dy, qx)), Mul(dz, qw));
+    __m256 w = Sub(Sub(Sub(Mul(dw, qw), Mul(dx, qx)), Mul(dy, qy)), Mul(dz, qz));
+
+    // First-order renormalization, see SimulateLanes
+    __m256 lenSq  = Add(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)), Mul(w, w));
+    __m256 rcpLen = Mul(_mm256_set1_ps(0.5f), Sub(_mm256_set1_ps(3.0f), lenSq));
+    x             = Mul(x, rcpLen);
+    y             = Mul(y, rcpLen);
+    z             = Mul(z, rcpLen);
+    w             = Mul(w, rcpLen);
+
+    _mm256_storeu_ps(block.orientationX, x);
+    _mm256_storeu_ps(block.orientationY, y);
+    _mm256_storeu_ps(block.orientationZ, z);
+    _mm256_storeu_ps(block.orientationW, w);
+
+    // Position: disc offset rotated about Y by the orbit angle
+    __m256 orbitRadius = _mm256_loadu_ps(block.orbitRadius);
+    __m256 posX        = Mul(orbitRadius, cosOrbit);
+    __m256 posY        = _mm256_loadu_ps(block.discHeight);
+    __m256 posZ        = Mul(_mm256_xor_ps(orbitRadius, _mm256_set1_ps(-0.0f)), sinOrbit);
+    _mm256_storeu_ps(block.positionX, posX);
+    _mm256_storeu_ps(block.positionY, posY);
+    _mm256_storeu_ps(block.positionZ, posZ);
+
+    // Rows of scale * rotation(q) * rotationY(angle)
+    __m256 scale = _mm256_loadu_ps(block.scale);
+    __m256 r00   = Sub(one, Mul(two, Add(Mul(y, y), Mul(z, z))));
+    __m256 r01   = Mul(two, Add(Mul(x, y), Mul(w, z)));
+    __m256 r02   = Mul(two, Sub(Mul(x, z), Mul(w, y)));
+    __m256 r10   = Mul(two, Sub(Mul(x, y), Mul(w, z)));
+    __m256 r11   = Sub(one, Mul(two, Add(Mul(x, x), Mul(z, z))));
+    __m256 r12   = Mul(two, Add(Mul(y, z), Mul(w, x)));
+    __m256 r20   = Mul(two, Add(Mul(x, z), Mul(w, y)));
+    __m256 r21   = Mul(two, Sub(Mul(y, z), Mul(w, x)));
+    __m256 r22   = Sub(one, Mul(two, Add(Mul(x, x), Mul(y, y))));
+
+    _mm256_storeu_ps(world[0], Mul(scale, Add(Mul(r00, cosOrbit), Mul(r02, sinOrbit))));
+    _mm256_storeu_ps(world[1], Mul(scale, r01));
+    _mm256_storeu_ps(world[2], Mul(scale, Sub(Mul(r02, cosOrbit), Mul(r00, sinOrbit))));
+    _mm256_storeu_ps(world[3], Mul(scale, Add(Mul(r10, cosOrbit), Mul(r12, sinOrbit))));
+    _mm256_storeu_ps(world[4], Mul(scale, r11));
+    _mm256_storeu_ps(world[5], Mul(scale, Sub(Mul(r12, cosOrbit), Mul(r10, sinOrbit))));
+    _mm256_storeu_ps(world[6], Mul(scale, Add(Mul(r20, cosOrbit), Mul(r22, sinOrbit))));
+    _mm256_storeu_ps(world[7], Mul(scale, r21));
+    _mm256_storeu_ps(world[8], Mul(scale, Sub(Mul(r22, cosOrbit), Mul(r20, sinOrbit))));
+
+    __m256 toEyeX = Sub(_mm256_set1_ps(cameraEye[0]), posX);
+    __m256 toEyeY = Sub(_mm256_set1_ps(cameraEye[1]), posY);
+    __m256 toEyeZ = Sub(_mm256_set1_ps(cameraEye[2]), posZ);
+    _mm256_storeu_ps(distSq, Add(Add(Mul(toEyeX, toEyeX), Mul(toEyeY, toEyeY)), Mul(toEyeZ, toEyeZ)));
+    _mm256_storeu_ps(scaleSq, Mul(scale, scale));
+}
+
+bool SimAVXKernelCompiled()
+{
+    return true;
+}
+
+#else
+
+void SimulateLanes_AVX(AsteroidSimBlock& block, float frameTime, const float cameraEye[3],
+                       float world[9][SIM_BLOCK_SIZE], float distSq[SIM_BLOCK_SIZE], float scaleSq[SIM_BLOCK_SIZE])
+{
+    // Never called, SimAVXKernelCompiled() is false
+    SimulateLanes(block, 0, SIM_BLOCK_SIZE, frameTime, cameraEye, world, distSq, scaleSq);
+}
+
+bool SimAVXKernelCompiled()
+{
+    return false;
+}
+
+#endif
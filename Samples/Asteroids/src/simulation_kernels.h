@@ -0,0 +1,36 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include "simulation.h"
+
+// Lane kernels of AsteroidsSimulation::UpdateBlock. They advance the orbit and spin of the lanes and output
+// the rotation part of the world matrix (row-major), the squared distance to the eye and the squared scale.
+
+// Same values as the DirectXMath constants
+static const float SIM_PI       = 3.141592654f;
+static const float SIM_2PI      = 6.283185307f;
+static const float SIM_1DIV2PI  = 0.159154943f;
+static const float SIM_PIDIV2   = 1.570796327f;
+
+// Portable kernel for lanes [laneBegin, laneEnd) of a block
+void SimulateLanes(AsteroidSimBlock& block, unsigned int laneBegin, unsigned int laneEnd,
+                   float frameTime, const float cameraEye[3],
+                   float world[9][SIM_BLOCK_SIZE], float distSq[SIM_BLOCK_SIZE], float scaleSq[SIM_BLOCK_SIZE]);
+
+// 8-wide AVX kernel for all lanes of a block, in simulation_avx.cpp which is the only file built with AVX code
+// generation. Produces the same bits as SimulateLanes.
+// Must only be called if SimAVXKernelCompiled() is true and the CPU and the OS support AVX.
+void SimulateLanes_AVX(AsteroidSimBlock& block, float frameTime, const float cameraEye[3],
+                       float world[9][SIM_BLOCK_SIZE], float distSq[SIM_BLOCK_SIZE], float scaleSq[SIM_BLOCK_SIZE]);
+
+// True if simulation_avx.cpp was built with AVX code generation (on other architectures it only has a stub)
+bool SimAVXKernelCompiled();
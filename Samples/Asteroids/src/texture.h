@@ -13,13 +13,21 @@
 #include <d3d12.h>
 #include <d3dx12.h>
 #include <d3d11.h>
+#include <vector>
 
-void GenerateMips2D_XXXX8(D3D11_SUBRESOURCE_DATA* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels);
+#include "texture_gen.h"
 
-// Will generate mips (into subresources array) is mipLevels > 0
-void FillNoise2D_RGBA8(D3D11_SUBRESOURCE_DATA* subresources, size_t width, size_t height, size_t mipLevels,
-                       float seed, float persistence, float noiseScale, float noiseStrength,
-					   float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
+// Windows renderers upload the portable SubresourceData through the D3D11 structure
+inline std::vector<D3D11_SUBRESOURCE_DATA> ToD3D11SubresourceData(const SubresourceData* subresources, size_t count)
+{
+    std::vector<D3D11_SUBRESOURCE_DATA> d3d11Subresources(count);
+    for (size_t i = 0; i < count; ++i) {
+        d3d11Subresources[i].pSysMem = subresources[i].pData;
+        d3d11Subresources[i].SysMemPitch = subresources[i].rowPitch;
+        d3d11Subresources[i].SysMemSlicePitch = subresources[i].slicePitch;
+    }
+    return d3d11Subresources;
+}
 
 
 // Helper for uploading initial texture data in D3D12; as with D3D11, one initialData structure per subresource
@@ -0,0 +1,105 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "texture_gen.h"
+#include "noise.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+
+
+void GenerateMips2D_XXXX8(SubresourceData* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels)
+{
+    for (size_t m = 1; m < mipLevels; ++m) {
+        auto rowPitchSrc = subresources[m - 1].rowPitch;
+        const uint8_t* dataSrc = (const uint8_t*)subresources[m - 1].pData;
+
+        auto rowPitchDst = subresources[m].rowPitch;
+        uint8_t* dataDst = (uint8_t*)subresources[m].pData;
+        
+        auto width = widthLevel0 >> m;
+        auto height = heightLevel0 >> m;
+
+        // Every channel is the truncated average of the 2x2 source texels. The four channels of a texel are
+        // processed at once as two pairs of 16-bit sums (at most 4 * 255, so they never overflow into each
+        // other), and the loop over the texels of a row compiles to SIMD.
+        const uint32_t evenBytes = 0x00FF00FFu;
+        for (size_t y = 0; y < height; ++y) {
+            auto rowSrc0 = (const uint32_t*)(dataSrc + (y*2+0)*rowPitchSrc);
+            auto rowSrc1 = (const uint32_t*)(dataSrc + (y*2+1)*rowPitchSrc);
+            auto rowDst  = (uint32_t*)(dataDst + (y    )*rowPitchDst);
+            for (size_t x = 0; x < width; ++x) {
+                uint32_t t00 = rowSrc0[x*2+0];
+                uint32_t t01 = rowSrc0[x*2+1];
+                uint32_t t10 = rowSrc1[x*2+0];
+                uint32_t t11 = rowSrc1[x*2+1];
+                uint32_t even = (t00 & evenBytes) + (t01 & evenBytes) + (t10 & evenBytes) + (t11 & evenBytes);
+                uint32_t odd  = ((t00 >> 8) & evenBytes) + ((t01 >> 8) & evenBytes) + ((t10 >> 8) & evenBytes) + ((t11 >> 8) & evenBytes);
+                rowDst[x] = ((even >> 2) & evenBytes) | (((odd >> 2) & evenBytes) << 8);
+            }
+        }
+    }
+}
+
+
+void FillNoise2DRows_RGBA8(const SubresourceData& level0, size_t width, size_t rowBegin, size_t rowEnd,
+                           float seed, float persistence, float noiseScale, float noiseStrength,
+                           float redScale, float greenScale, float blueScale)
+{
+    NoiseOctaves<4> textureNoise(persistence);
+
+    for (size_t y = rowBegin; y < rowEnd; ++y) {
+        uint32_t* row = (uint32_t*)((uint8_t*)level0.pData + y*level0.rowPitch);
+
+        // SNOISE_LANES texels of the row at a time
+        for (size_t x0 = 0; x0 < width; x0 += SNOISE_LANES) {
+            float nx[SNOISE_LANES], ny[SNOISE_LANES], nz[SNOISE_LANES], c[SNOISE_LANES];
+            for (size_t l = 0; l < SNOISE_LANES; ++l) {
+                nx[l] = (float)(x0 + l)*noiseScale;
+                ny[l] = (float)y*noiseScale;
+                nz[l] = seed;
+            }
+            textureNoise(nx, ny, nz, c);
+
+            uint32_t texels[SNOISE_LANES];
+            for (size_t l = 0; l < SNOISE_LANES; ++l) {
+                float cl = std::max(0.0f, std::min(1.0f, (c[l] - 0.5f) * noiseStrength + 0.5f));
+
+                int32_t cr = (int32_t)(cl * redScale);
+                int32_t cg = (int32_t)(cl * greenScale);
+                int32_t cb = (int32_t)(cl * blueScale);
+                assert(cr >= 0 && cr < 256);
+                assert(cg >= 0 && cg < 256);
+                assert(cb >= 0 && cb < 256);
+
+                texels[l] = (cr) << 16 | (cg) <<  8 | (cb) << 0;
+            }
+
+            auto count = std::min(size_t{SNOISE_LANES}, width - x0);
+            for (size_t l = 0; l < count; ++l) {
+                row[x0 + l] = texels[l];
+            }
+        }
+    }
+}
+
+
+void FillNoise2D_RGBA8(SubresourceData* subresources, size_t width, size_t height, size_t mipLevels,
+                       float seed, float persistence, float noiseScale, float noiseStrength,
+					   float redScale, float greenScale, float blueScale)
+{
+    // Level 0
+    FillNoise2DRows_RGBA8(subresources[0], width, 0, height, seed, persistence, noiseScale, noiseStrength,
+                          redScale, greenScale, blueScale);
+
+    if (mipLevels > 1)
+        GenerateMips2D_XXXX8(subresources, width, height, mipLevels);
+}
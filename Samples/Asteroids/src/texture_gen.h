@@ -0,0 +1,35 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <stddef.h>
+
+// Platform-independent description of one subresource of initial texture data
+// (same layout as D3D11_SUBRESOURCE_DATA)
+struct SubresourceData
+{
+    void* pData = nullptr;
+    unsigned int rowPitch = 0;
+    unsigned int slicePitch = 0;
+};
+
+void GenerateMips2D_XXXX8(SubresourceData* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels);
+
+// Will generate mips (into subresources array) is mipLevels > 0
+void FillNoise2D_RGBA8(SubresourceData* subresources, size_t width, size_t height, size_t mipLevels,
+                       float seed, float persistence, float noiseScale, float noiseStrength,
+					   float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
+
+// Fills rows [rowBegin, rowEnd) of the top level only, so that a texture can be split into row tiles
+// that are filled in parallel. Gives the same texels as FillNoise2D_RGBA8 with the same parameters.
+void FillNoise2DRows_RGBA8(const SubresourceData& level0, size_t width, size_t rowBegin, size_t rowEnd,
+                           float seed, float persistence, float noiseScale, float noiseStrength,
+                           float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
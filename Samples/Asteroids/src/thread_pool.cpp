@@ -0,0 +1,118 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "thread_pool.h"
+
+#include <assert.h>
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    mWorkers.reserve(threadCount - 1);
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        mWorkers.emplace_back(&ThreadPool::WorkerThreadFunc, this);
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mJobReady.notify_all();
+
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+
+void ThreadPool::RunJob(const std::function<void(unsigned int)>* body, unsigned int end)
+{
+    for (;;) {
+        auto i = mNextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (i >= end) {
+            break;
+        }
+        (*body)(i);
+    }
+}
+
+
+void ThreadPool::WorkerThreadFunc()
+{
+    unsigned long long lastGeneration = 0;
+    for (;;) {
+        const std::function<void(unsigned int)>* body = nullptr;
+        unsigned int end = 0;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobReady.wait(lock, [&]() { return mQuit || mJobGeneration != lastGeneration; });
+            if (mQuit) {
+                return;
+            }
+            lastGeneration = mJobGeneration;
+            body = mBody;
+            end = mEndIndex;
+            ++mBusyWorkers;
+        }
+
+        RunJob(body, end);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --mBusyWorkers;
+        }
+        mJobDone.notify_one();
+    }
+}
+
+
+void ThreadPool::ParallelFor(unsigned int begin, unsigned int end, const std::function<void(unsigned int)>& body)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    // Not worth waking up the workers
+    if (mWorkers.empty() || end - begin == 1) {
+        for (auto i = begin; i < end; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    {
+        // A worker that woke up too late for the previous job may still be draining its index counter
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJobDone.wait(lock, [&]() { return mBusyWorkers == 0; });
+        assert(mBody == nullptr); // Not reentrant
+        mBody = &body;
+        mNextIndex.store(begin, std::memory_order_relaxed);
+        mEndIndex = end;
+        ++mJobGeneration;
+    }
+    mJobReady.notify_all();
+
+    RunJob(&body, end);
+
+    // Every index has been handed out, wait until the workers that took some are done with them.
+    // Workers that wake up later find no indices left and never call body.
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJobDone.wait(lock, [&]() { return mBusyWorkers == 0; });
+    mBody = nullptr;
+}
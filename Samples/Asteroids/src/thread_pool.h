@@ -0,0 +1,57 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join thread pool used by the portable part of the sample (content generation
+// and the simulation benchmark) in place of the platform-specific concurrency runtime.
+class ThreadPool
+{
+public:
+    // threadCount = 0 => one thread per hardware thread. The calling thread takes part in
+    // ParallelFor, so threadCount - 1 worker threads are created.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int ThreadCount() const { return (unsigned int)mWorkers.size() + 1; }
+
+    // Calls body(i) for every i in [begin, end) and returns when all calls have completed.
+    // Indices are handed out one at a time, so each call should do a reasonable amount of work.
+    // Not reentrant: body must not call ParallelFor on the same pool.
+    void ParallelFor(unsigned int begin, unsigned int end, const std::function<void(unsigned int)>& body);
+
+private:
+    void WorkerThreadFunc();
+    void RunJob(const std::function<void(unsigned int)>* body, unsigned int end);
+
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mJobReady;
+    std::condition_variable mJobDone;
+    unsigned long long mJobGeneration = 0;
+    unsigned int mBusyWorkers = 0;
+    bool mQuit = false;
+
+    // Current job
+    const std::function<void(unsigned int)>* mBody = nullptr;
+    unsigned int mEndIndex = 0;
+    std::atomic<unsigned int> mNextIndex{0};
+};
@@ -0,0 +1,19 @@
+
+#include "HemisphereVSCommon.fxh"
+#include "TerrainCLOD.fxh"
+
+void HemisphereCLODVS(in float3 f3GridPos : ATTRIB0,
+                      in float4 f4PatchAttribs : ATTRIB1,
+                      in float fSkirtDepth : ATTRIB2,
+                      out float4 f4PosPS : SV_Position,
+                      out HemisphereVSOutput VSOut
+                      // IMPORTANT: non-system generated pixel shader input
+                      // arguments must have the exact same name as vertex shader 
+                      // outputs and must go in the same order.
+                     )
+{
+    float3 f3PosWS;
+    float2 f2MaskUV0;
+    GetCLODVertex(f3GridPos, f4PatchAttribs, fSkirtDepth, f3PosWS, f2MaskUV0);
+    ComputeHemisphereVertex(f3PosWS, f2MaskUV0, f4PosPS, VSOut);
+}
@@ -0,0 +1,20 @@
+
+#include "HostSharedTerrainStructs.fxh"
+#include "TerrainShadersCommon.fxh"
+#include "TerrainCLOD.fxh"
+
+cbuffer cbCameraAttribs
+{
+    CameraAttribs g_CameraAttribs;
+}
+
+void HemisphereCLODZOnlyVS(in float3 f3GridPos : ATTRIB0,
+                           in float4 f4PatchAttribs : ATTRIB1,
+                           in float fSkirtDepth : ATTRIB2,
+                           out float4 f4PosPS : SV_Position)
+{
+    float3 f3PosWS;
+    float2 f2MaskUV0;
+    GetCLODVertex(f3GridPos, f4PatchAttribs, fSkirtDepth, f3PosWS, f2MaskUV0);
+    f4PosPS = mul( float4(f3PosWS,1.0), g_CameraAttribs.mViewProj);
+}
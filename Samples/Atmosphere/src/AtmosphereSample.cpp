@@ -197,6 +197,21 @@ void AtmosphereSample::UpdateUI()
             ImGui::TreePop();
         }
 
+        if (ImGui::TreeNode("Terrain"))
+        {
+            ImGui::Checkbox("Continuous LOD", &m_TerrainRenderParams.m_bEnableCLOD);
+            if (m_TerrainRenderParams.m_bEnableCLOD)
+            {
+                ImGui::SliderFloat("Max screen error", &m_TerrainRenderParams.m_fCLODMaxScreenError, 0.5f, 16.f);
+                ImGui::HelpMarker("Maximum projected height error of the selected patches, in pixels");
+
+                const auto& Stats = m_EarthHemisphere.GetCLODStats();
+                ImGui::Text("Patches: %u (visited nodes: %u)", Stats.NumPatches, Stats.NumVisitedNodes);
+            }
+
+            ImGui::TreePop();
+        }
+
         ImGui::Checkbox("Enable Light Scattering", &m_bEnableLightScattering);
 
         if (m_bEnableLightScattering)
@@ -834,6 +849,21 @@ void AtmosphereSample::Update(double CurrTime, double ElapsedTime)
 
     m_fElapsedTime = static_cast<float>(ElapsedTime);
 
+    if (m_pElevDataSource)
+    {
+        // Keep the camera above the terrain
+        constexpr float MinCameraClearance = 100.f;
+
+        const auto&  TerrainAttribs = m_TerrainRenderParams.m_TerrainAttribs;
+        const float3 f3ProbeStart{m_f3CameraPos.x, m_fMaxElevation + 1.f, m_f3CameraPos.z};
+        float        fGroundDist = 0;
+        if (m_pElevDataSource->IntersectRay(f3ProbeStart, float3{0, -1, 0}, TerrainAttribs.m_fElevationSamplingInterval, TerrainAttribs.m_fElevationScale,
+                                            m_fMaxElevation - m_fMinElevation + 2.f, fGroundDist))
+        {
+            m_f3CameraPos.y = std::max(m_f3CameraPos.y, f3ProbeStart.y - fGroundDist + MinCameraClearance);
+        }
+    }
+
     const auto& SCDesc = m_pSwapChain->GetDesc();
     // Set world/view/proj matrices and global shader constants
     float aspectRatio = (float)SCDesc.Width / SCDesc.Height;
@@ -865,6 +895,16 @@ void AtmosphereSample::Update(double CurrTime, double ElapsedTime)
     fFarPlaneZ  = std::max(fFarPlaneZ, 1000.f);
 
     m_mCameraProj = float4x4::Projection(FOV, aspectRatio, fNearPlaneZ, fFarPlaneZ, NegativeOneToOneZ);
+    // Converts the view-space height error at unit distance to pixels
+    m_TerrainRenderParams.m_fCLODProjScale = m_mCameraProj._22 * static_cast<float>(SCDesc.Height) * 0.5f;
+
+    if (m_pElevDataSource)
+    {
+        // Keep the height map patches around the camera resident. The visible terrain
+        // extends farther as the camera goes up.
+        const float fSamplingStep = m_TerrainRenderParams.m_TerrainAttribs.m_fElevationSamplingInterval;
+        m_pElevDataSource->PrefetchPatches(m_f3CameraPos.x / fSamplingStep, m_f3CameraPos.z / fSamplingStep, m_f3CameraPos.y * 4.f / fSamplingStep);
+    }
 
 #if 0
     if( m_bAnimateSun )
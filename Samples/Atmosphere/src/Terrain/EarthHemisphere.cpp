@@ -45,6 +45,7 @@
 
 #include <algorithm>
 #include <cfloat>
+#include <cstring>
 #include <array>
 
 #include "EarthHemisphere.hpp"
@@ -68,6 +69,8 @@ namespace Diligent
 #include "CallbackWrapper.hpp"
 #include "Utilities/interface/DiligentFXShaderSourceStreamFactory.hpp"
 #include "ShaderSourceFactoryUtils.hpp"
+#include "JobSystem.hpp"
+#include "VertexCacheOptimizer.hpp"
 
 namespace Diligent
 {
@@ -204,23 +207,33 @@ private:
 typedef TriStrip<Uint32, StdIndexGenerator> StdTriStrip32;
 
 
-void ComputeVertexHeight(HemisphereVertex&          Vertex,
-                         class ElevationDataSource* pDataSource,
-                         float                      fSamplingStep,
-                         float                      fSampleScale)
+void ComputeVertexHeights(HemisphereVertex*          pVerts,
+                          size_t                     NumVerts,
+                          const ElevationDataSource* pDataSource,
+                          float                      fSamplingStep,
+                          float                      fSampleScale)
 {
-    float3& f3PosWS = Vertex.f3WorldPos;
+    std::vector<float> Cols(NumVerts), Rows(NumVerts), Displ(NumVerts);
+    for (size_t i = 0; i < NumVerts; ++i)
+    {
+        Cols[i] = pVerts[i].f3WorldPos.x / fSamplingStep;
+        Rows[i] = pVerts[i].f3WorldPos.z / fSamplingStep;
+    }
+    pDataSource->GetInterpolatedHeights(Cols.data(), Rows.data(), Displ.data(), NumVerts);
 
-    float fCol   = f3PosWS.x / fSamplingStep;
-    float fRow   = f3PosWS.z / fSamplingStep;
-    float fDispl = pDataSource->GetInterpolatedHeight(fCol, fRow);
-    int   iColOffset, iRowOffset;
+    int iColOffset, iRowOffset;
     pDataSource->GetOffsets(iColOffset, iRowOffset);
-    Vertex.f2MaskUV0.x = (fCol + (float)iColOffset + 0.5f) / (float)pDataSource->GetNumCols();
-    Vertex.f2MaskUV0.y = (fRow + (float)iRowOffset + 0.5f) / (float)pDataSource->GetNumRows();
+    for (size_t i = 0; i < NumVerts; ++i)
+    {
+        auto&   Vertex  = pVerts[i];
+        float3& f3PosWS = Vertex.f3WorldPos;
+
+        Vertex.f2MaskUV0.x = (Cols[i] + (float)iColOffset + 0.5f) / (float)pDataSource->GetNumCols();
+        Vertex.f2MaskUV0.y = (Rows[i] + (float)iRowOffset + 0.5f) / (float)pDataSource->GetNumRows();
 
-    float3 f3SphereNormal = normalize(f3PosWS);
-    f3PosWS += f3SphereNormal * fDispl * fSampleScale;
+        float3 f3SphereNormal = normalize(f3PosWS);
+        f3PosWS += f3SphereNormal * Displ[i] * fSampleScale;
+    }
 }
 
 
@@ -230,67 +243,132 @@ public:
     RingMeshBuilder(IRenderDevice*                       pDevice,
                     const std::vector<HemisphereVertex>& VB,
                     int                                  iGridDimenion,
+                    bool                                 bUseTriangleLists,
                     std::vector<RingSectorMesh>&         RingMeshes) :
         m_pDevice(pDevice),
         m_RingMeshes(RingMeshes),
         m_VB(VB),
-        m_iGridDimenion(iGridDimenion)
+        m_iGridDimenion(iGridDimenion),
+        m_bUseTriangleLists(bUseTriangleLists)
     {}
 
-    void CreateMesh(int                          iBaseIndex,
-                    int                          iStartCol,
-                    int                          iStartRow,
-                    int                          iNumCols,
-                    int                          iNumRows,
-                    enum QUAD_TRIANGULATION_TYPE QuadTriangType)
+    // Adds a ring sector mesh. The meshes are generated by Build().
+    void AddMesh(int                          iBaseIndex,
+                 int                          iStartCol,
+                 int                          iStartRow,
+                 int                          iNumCols,
+                 int                          iNumRows,
+                 enum QUAD_TRIANGULATION_TYPE QuadTriangType)
     {
-        m_RingMeshes.push_back(RingSectorMesh());
-        auto& CurrMesh = m_RingMeshes.back();
+        m_Sectors.push_back({iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType});
+    }
 
-        std::vector<Uint32> IB;
-        StdTriStrip32       TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
-        TriStrip.AddStrip(iBaseIndex, iStartCol, iStartRow, iNumCols, iNumRows, QuadTriangType);
+    // Generates the indices of all added sectors in parallel and creates the index buffers
+    void Build(JobSystem& Jobs)
+    {
+        const size_t FirstMesh = m_RingMeshes.size();
+        m_RingMeshes.resize(FirstMesh + m_Sectors.size());
 
-        CurrMesh.uiNumIndices = (Uint32)IB.size();
+        std::vector<std::vector<Uint32>> IBs(m_Sectors.size());
+        Jobs.ParallelFor(static_cast<Uint32>(m_Sectors.size()), 1, [&](Uint32, Uint32 Begin, Uint32 End) {
+            for (Uint32 i = Begin; i < End; ++i)
+                GenerateIndices(m_Sectors[i], m_RingMeshes[FirstMesh + i], IBs[i]);
+        });
 
-        // Prepare buffer description
-        BufferDesc IndexBufferDesc;
-        IndexBufferDesc.Name      = "Ring mesh index buffer";
-        IndexBufferDesc.Size      = (Uint32)(IB.size() * sizeof(IB[0]));
-        IndexBufferDesc.BindFlags = BIND_INDEX_BUFFER;
-        IndexBufferDesc.Usage     = USAGE_IMMUTABLE;
-        BufferData IBInitData;
-        IBInitData.pData    = IB.data();
-        IBInitData.DataSize = IndexBufferDesc.Size;
-        // Create the buffer
-        m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &CurrMesh.pIndBuff);
-        VERIFY(CurrMesh.pIndBuff, "Failed to create index buffer");
+        for (size_t i = 0; i < m_Sectors.size(); ++i)
+            CreateIndexBuffer(IBs[i], m_RingMeshes[FirstMesh + i]);
+        m_Sectors.clear();
+    }
+
+private:
+    struct SectorInfo
+    {
+        int                     iBaseIndex;
+        int                     iStartCol;
+        int                     iStartRow;
+        int                     iNumCols;
+        int                     iNumRows;
+        QUAD_TRIANGULATION_TYPE QuadTriangType;
+    };
+
+    void GenerateIndices(const SectorInfo& Sector, RingSectorMesh& Mesh, std::vector<Uint32>& IB) const
+    {
+        if (m_bUseTriangleLists)
+        {
+            // Indices are relative to the ring grid, so that they fit into 16 bits
+            std::vector<Uint32> Strip;
+            StdTriStrip32       TriStrip(Strip, StdIndexGenerator(m_iGridDimenion));
+            TriStrip.AddStrip(0, Sector.iStartCol, Sector.iStartRow, Sector.iNumCols, Sector.iNumRows, Sector.QuadTriangType);
+
+            TriangleStripToList(Strip, IB);
+            OptimizeVertexCache(IB.data(), IB.size(), static_cast<Uint32>(m_iGridDimenion * m_iGridDimenion));
+            Mesh.uiBaseVertex = static_cast<Uint32>(Sector.iBaseIndex);
+        }
+        else
+        {
+            StdTriStrip32 TriStrip(IB, StdIndexGenerator(m_iGridDimenion));
+            TriStrip.AddStrip(Sector.iBaseIndex, Sector.iStartCol, Sector.iStartRow, Sector.iNumCols, Sector.iNumRows, Sector.QuadTriangType);
+            Mesh.uiBaseVertex = 0;
+        }
+        Mesh.uiNumIndices = (Uint32)IB.size();
 
         // Compute bounding box
-        auto& BB = CurrMesh.BndBox;
+        auto& BB = Mesh.BndBox;
         BB.Max   = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
         BB.Min   = float3(+FLT_MAX, +FLT_MAX, +FLT_MAX);
         for (auto Ind = IB.begin(); Ind != IB.end(); ++Ind)
         {
-            const auto& CurrVert = m_VB[*Ind].f3WorldPos;
+            const auto& CurrVert = m_VB[Mesh.uiBaseVertex + *Ind].f3WorldPos;
 
             BB.Min = std::min(BB.Min, CurrVert);
             BB.Max = std::max(BB.Max, CurrVert);
         }
     }
 
-private:
+    void CreateIndexBuffer(const std::vector<Uint32>& IB, RingSectorMesh& Mesh) const
+    {
+        // Prepare buffer description
+        BufferDesc IndexBufferDesc;
+        IndexBufferDesc.Name      = "Ring mesh index buffer";
+        IndexBufferDesc.BindFlags = BIND_INDEX_BUFFER;
+        IndexBufferDesc.Usage     = USAGE_IMMUTABLE;
+        BufferData IBInitData;
+
+        std::vector<Uint16> IB16;
+        if (m_bUseTriangleLists && m_iGridDimenion * m_iGridDimenion <= 0x10000)
+        {
+            IB16.assign(IB.begin(), IB.end());
+            Mesh.IndexType       = VT_UINT16;
+            IndexBufferDesc.Size = (Uint32)(IB16.size() * sizeof(IB16[0]));
+            IBInitData.pData     = IB16.data();
+        }
+        else
+        {
+            Mesh.IndexType       = VT_UINT32;
+            IndexBufferDesc.Size = (Uint32)(IB.size() * sizeof(IB[0]));
+            IBInitData.pData     = IB.data();
+        }
+        IBInitData.DataSize = IndexBufferDesc.Size;
+        // Create the buffer
+        m_pDevice->CreateBuffer(IndexBufferDesc, &IBInitData, &Mesh.pIndBuff);
+        VERIFY(Mesh.pIndBuff, "Failed to create index buffer");
+    }
+
     RefCntAutoPtr<IRenderDevice>         m_pDevice;
     std::vector<RingSectorMesh>&         m_RingMeshes;
     const std::vector<HemisphereVertex>& m_VB;
     const int                            m_iGridDimenion;
+    const bool                           m_bUseTriangleLists;
+    std::vector<SectorInfo>              m_Sectors;
 };
 
 
 void GenerateSphereGeometry(IRenderDevice*                 pDevice,
+                            JobSystem&                     Jobs,
                             const float                    fEarthRadius,
                             int                            iGridDimension,
                             const int                      iNumRings,
+                            bool                           bUseTriangleLists,
                             class ElevationDataSource*     pDataSource,
                             float                          fSamplingStep,
                             float                          fSampleScale,
@@ -307,21 +385,24 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 
     //const int iLargestGridScale = iGridDimension << (iNumRings-1);
 
-    RingMeshBuilder RingMeshBuilder(pDevice, VB, iGridDimension, SphereMeshes);
+    RingMeshBuilder RingMeshBuilder(pDevice, VB, iGridDimension, bUseTriangleLists, SphereMeshes);
 
     int iStartRing = 0;
-    VB.reserve((iNumRings - iStartRing) * iGridDimension * iGridDimension);
-    for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
-    {
-        int iCurrGridStart = (int)VB.size();
-        VB.resize(VB.size() + static_cast<size_t>(iGridDimension) * static_cast<size_t>(iGridDimension));
-        float fGridScale = 1.f / (float)(1 << (iNumRings - 1 - iRing));
-        // Fill vertex buffer
-        for (int iRow = 0; iRow < iGridDimension; ++iRow)
+
+    // Vertices of all rings are independent, so fill the vertex buffer in parallel, one grid row per job
+    const int iFirstGridStart = (int)VB.size();
+    VB.resize(VB.size() + static_cast<size_t>(iNumRings - iStartRing) * iGridDimension * iGridDimension);
+    Jobs.ParallelFor(static_cast<Uint32>((iNumRings - iStartRing) * iGridDimension), 1, [&](Uint32, Uint32 Begin, Uint32 End) {
+        for (Uint32 GridRow = Begin; GridRow < End; ++GridRow)
+        {
+            const int iRing = iStartRing + static_cast<int>(GridRow) / iGridDimension;
+            const int iRow  = static_cast<int>(GridRow) % iGridDimension;
+
+            HemisphereVertex* pRowVerts  = &VB[iFirstGridStart + static_cast<size_t>(GridRow) * iGridDimension];
+            float             fGridScale = 1.f / (float)(1 << (iNumRings - 1 - iRing));
             for (int iCol = 0; iCol < iGridDimension; ++iCol)
             {
-                auto& CurrVert = VB[iCurrGridStart + iCol + iRow * iGridDimension];
-                auto& f3Pos    = CurrVert.f3WorldPos;
+                auto& f3Pos = pRowVerts[iCol].f3WorldPos;
 
                 f3Pos.x = static_cast<float>(iCol) / static_cast<float>(iGridDimension - 1);
                 f3Pos.z = static_cast<float>(iRow) / static_cast<float>(iGridDimension - 1);
@@ -347,11 +428,18 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
                 f3Pos.x *= fEarthRadius;
                 f3Pos.z *= fEarthRadius;
                 f3Pos.y *= fEarthRadius;
-
-                ComputeVertexHeight(CurrVert, pDataSource, fSamplingStep, fSampleScale);
-                f3Pos.y -= fEarthRadius;
             }
 
+            ComputeVertexHeights(pRowVerts, iGridDimension, pDataSource, fSamplingStep, fSampleScale);
+            for (int iCol = 0; iCol < iGridDimension; ++iCol)
+                pRowVerts[iCol].f3WorldPos.y -= fEarthRadius;
+        }
+    });
+
+    for (int iRing = iStartRing; iRing < iNumRings; ++iRing)
+    {
+        int iCurrGridStart = iFirstGridStart + (iRing - iStartRing) * iGridDimension * iGridDimension;
+
         // Align vertices on the outer boundary
         if (iRing < iNumRings - 1)
         {
@@ -382,36 +470,38 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
         if (iRing == 0)
         {
             // clang-format off
-            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,                   0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst,          0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, 0,          iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridMidst, iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart, 0,                   0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart, iGridMidst,          0, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart, 0,          iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart, iGridMidst, iGridMidst, iGridMidst+1, iGridMidst+1, QUAD_TRIANG_TYPE_00_TO_11);
             // clang-format on
         }
         else
         {
             // clang-format off
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart,            0,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart,   iGridQuart,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart,   iGridMidst,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart, iGridQuart*3,            0,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
                                        
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart,            0,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart,            0,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
                                        
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart, iGridQuart*3,   iGridQuart,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart, iGridQuart*3,   iGridMidst,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,            0, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridQuart, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart,            0, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
+            RingMeshBuilder.AddMesh(iCurrGridStart,   iGridQuart, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_01_TO_10);
 
-            RingMeshBuilder.CreateMesh(iCurrGridStart,   iGridMidst, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
-            RingMeshBuilder.CreateMesh(iCurrGridStart, iGridQuart*3, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart,   iGridMidst, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
+            RingMeshBuilder.AddMesh(iCurrGridStart, iGridQuart*3, iGridQuart*3,   iGridQuart+1, iGridQuart+1, QUAD_TRIANG_TYPE_00_TO_11);
             // clang-format on
         }
     }
 
+    RingMeshBuilder.Build(Jobs);
+
     // We do not need per-vertex normals as we use normal map to shade terrain
     // Sphere tangent vertex are computed in the shader
 #if 0
@@ -492,76 +582,117 @@ void GenerateSphereGeometry(IRenderDevice*                 pDevice,
 }
 
 
-void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
-                                      IDeviceContext* pContext,
-                                      const Uint16*   pHeightMap,
-                                      size_t          HeightMapStride,
-                                      int             iHeightMapDim,
-                                      ITexture*       ptex2DNormalMap)
+void EarthHemsiphere::RenderNormalMap(IRenderDevice*             pDevice,
+                                      IDeviceContext*            pContext,
+                                      JobSystem&                 Jobs,
+                                      const ElevationDataSource* pDataSource,
+                                      ITexture*                  ptex2DNormalMap)
 {
+    const Uint32 HeightMapDim = pDataSource->GetNumCols();
+
     TextureDesc HeightMapDesc;
     HeightMapDesc.Name      = "Height map texture";
     HeightMapDesc.Type      = RESOURCE_DIM_TEX_2D;
-    HeightMapDesc.Width     = iHeightMapDim;
-    HeightMapDesc.Height    = iHeightMapDim;
+    HeightMapDesc.Width     = HeightMapDim;
+    HeightMapDesc.Height    = HeightMapDim;
     HeightMapDesc.Format    = TEX_FORMAT_R16_UINT;
-    HeightMapDesc.Usage     = USAGE_IMMUTABLE;
+    HeightMapDesc.Usage     = USAGE_DEFAULT;
     HeightMapDesc.BindFlags = BIND_SHADER_RESOURCE;
     HeightMapDesc.MipLevels = ComputeMipLevelsCount(HeightMapDesc.Width, HeightMapDesc.Height);
 
-    // Stack all coarse mip levels on top of each other with the same stride
-    //    __________
-    //   |__|__     |
-    //   |     |    |
-    //   |_____|____|
-    //   |          |
-    //   |          |
-    //   |          |
-    //   |__________|
-    std::vector<Uint16> CoarseMipLevels;
-    CoarseMipLevels.resize(static_cast<size_t>(iHeightMapDim) / 2 * iHeightMapDim);
-
-    std::vector<TextureSubResData> InitData(HeightMapDesc.MipLevels);
-    InitData[0].pData            = pHeightMap;
-    InitData[0].Stride           = (Uint32)HeightMapStride * sizeof(pHeightMap[0]);
-    const Uint16* pFinerMipLevel = pHeightMap;
-    Uint16*       pCurrMipLevel  = &CoarseMipLevels[0];
-    size_t        FinerMipStride = HeightMapStride;
-    size_t        CurrMipStride  = iHeightMapDim / 2;
-    for (Uint32 uiMipLevel = 1; uiMipLevel < HeightMapDesc.MipLevels; ++uiMipLevel)
-    {
-        const auto MipProps = GetMipLevelProperties(HeightMapDesc, uiMipLevel);
-        for (size_t Row = 0; Row < MipProps.LogicalHeight; ++Row)
+    RefCntAutoPtr<ITexture> ptex2DHeightMap;
+    pDevice->CreateTexture(HeightMapDesc, nullptr, &ptex2DHeightMap);
+    VERIFY(ptex2DHeightMap, "Failed to create height map texture");
+
+    // The height map is uploaded in bands of rows read from the data source, so that it is never copied whole.
+    // Every band is averaged into the next mip level as soon as it is uploaded. A band of BandRows rows of the
+    // finest level makes BandRows >> L rows of level L; when the band of a level has an odd number of rows,
+    // its last row is kept at the start of the band to be paired with the first row of the next band.
+    constexpr Uint32 BandRows = 256;
+
+    struct MipBand
+    {
+        std::vector<Uint16> Rows;
+        size_t              Pitch    = 0;
+        Uint32              Width    = 0;
+        Uint32              Height   = 0;
+        Uint32              NumKept  = 0; // Rows at the start of the band that are already uploaded
+        Uint32              FirstRow = 0; // First row of the level that is not uploaded yet
+    };
+    std::vector<MipBand> Bands(HeightMapDesc.MipLevels);
+    for (Uint32 MipLevel = 0; MipLevel < HeightMapDesc.MipLevels; ++MipLevel)
+    {
+        const auto MipProps = GetMipLevelProperties(HeightMapDesc, MipLevel);
+        auto&      Band     = Bands[MipLevel];
+        Band.Width          = MipProps.LogicalWidth;
+        Band.Height         = MipProps.LogicalHeight;
+        // Keep the rows 4-byte aligned as required for texture update data
+        Band.Pitch = (size_t{Band.Width} + 1) & ~size_t{1};
+        Band.Rows.resize(Band.Pitch * (std::max(BandRows >> MipLevel, 1u) + 1));
+    }
+
+    for (Uint32 BandStart = 0; BandStart < HeightMapDim; BandStart += BandRows)
+    {
+        auto&   FinestBand = Bands[0];
+        Uint32  NumNewRows = std::min(BandRows, HeightMapDim - BandStart);
+        Uint16* pNewRows   = &FinestBand.Rows[FinestBand.NumKept * FinestBand.Pitch];
+        Jobs.ParallelFor(NumNewRows, 64, [&](Uint32, Uint32 BeginRow, Uint32 EndRow) {
+            pDataSource->ReadRows(BandStart + BeginRow, EndRow - BeginRow, pNewRows + BeginRow * FinestBand.Pitch, FinestBand.Pitch);
+        });
+
+        for (Uint32 MipLevel = 0; NumNewRows > 0; ++MipLevel)
         {
-            for (size_t Col = 0; Col < MipProps.LogicalWidth; ++Col)
-            {
-                int iAverageHeight = 0;
-                for (size_t i = 0; i < 2; ++i)
+            auto& Band = Bands[MipLevel];
+
+            TextureSubResData SubResData;
+            SubResData.pData  = &Band.Rows[Band.NumKept * Band.Pitch];
+            SubResData.Stride = static_cast<Uint64>(Band.Pitch * sizeof(Uint16));
+            Box Region{0, Band.Width, Band.FirstRow, Band.FirstRow + NumNewRows};
+            pContext->UpdateTexture(ptex2DHeightMap, MipLevel, 0, Region, SubResData, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            Band.FirstRow += NumNewRows;
+
+            if (MipLevel + 1 == HeightMapDesc.MipLevels)
+                break;
+
+            // The last row of a level with an odd height has no pair and does not contribute to the next level
+            auto&         CoarserBand = Bands[MipLevel + 1];
+            const Uint32  NumRows     = Band.NumKept + NumNewRows;
+            const Uint32  NumPairs    = std::min(NumRows / 2, CoarserBand.Height - CoarserBand.FirstRow);
+            const Uint16* pFinerRows  = Band.Rows.data();
+            Uint16*       pCurrRows   = &CoarserBand.Rows[CoarserBand.NumKept * CoarserBand.Pitch];
+            // Rows of a mip level are independent
+            Jobs.ParallelFor(NumPairs, 64, [&](Uint32, Uint32 BeginRow, Uint32 EndRow) {
+                for (size_t Row = BeginRow; Row < EndRow; ++Row)
                 {
-                    for (size_t j = 0; j < 2; ++j)
+                    for (size_t Col = 0; Col < CoarserBand.Width; ++Col)
                     {
-                        iAverageHeight += pFinerMipLevel[(Col * 2 + i) + (Row * 2 + j) * size_t{FinerMipStride}];
+                        int iAverageHeight = 0;
+                        for (size_t i = 0; i < 2; ++i)
+                        {
+                            for (size_t j = 0; j < 2; ++j)
+                            {
+                                iAverageHeight += pFinerRows[(Col * 2 + i) + (Row * 2 + j) * Band.Pitch];
+                            }
+                        }
+                        pCurrRows[Col + Row * CoarserBand.Pitch] = (Uint16)(iAverageHeight >> 2);
                     }
                 }
-                pCurrMipLevel[Col + Row * CurrMipStride] = (Uint16)(iAverageHeight >> 2);
+            });
+
+            if (NumRows % 2 != 0)
+            {
+                const auto LastRow = Band.Rows.begin() + (NumRows - 1) * Band.Pitch;
+                std::copy(LastRow, LastRow + Band.Width, Band.Rows.begin());
+                Band.NumKept = 1;
             }
+            else
+            {
+                Band.NumKept = 0;
+            }
+            NumNewRows = NumPairs;
         }
-
-        InitData[uiMipLevel].pData  = pCurrMipLevel;
-        InitData[uiMipLevel].Stride = (Uint32)CurrMipStride * sizeof(*pCurrMipLevel);
-        pFinerMipLevel              = pCurrMipLevel;
-        FinerMipStride              = CurrMipStride;
-        pCurrMipLevel += MipProps.LogicalHeight * CurrMipStride;
-        CurrMipStride = iHeightMapDim / 2; // Same stride for all mips
     }
 
-    RefCntAutoPtr<ITexture> ptex2DHeightMap;
-    TextureData             HeigtMapInitData;
-    HeigtMapInitData.pSubResources   = InitData.data();
-    HeigtMapInitData.NumSubresources = (Uint32)InitData.size();
-    pDevice->CreateTexture(HeightMapDesc, &HeigtMapInitData, &ptex2DHeightMap);
-    VERIFY(ptex2DHeightMap, "Failed to create height map texture");
-
     m_pResMapping->AddResource("g_tex2DElevationMap", ptex2DHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), true);
 
     RefCntAutoPtr<IBuffer> pcbNMGenerationAttribs;
@@ -603,8 +734,7 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
         pContext->Draw(DrawAttrs);
     }
 
-    // Remove elevation map from resource mapping to release the resource
-    m_pResMapping->RemoveResourceByName("g_tex2DElevationMap");
+    // The elevation map stays in the resource mapping: continuous LOD patches read their heights from it
 }
 
 
@@ -619,8 +749,9 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
                              IBuffer*                   pcbLightAttribs,
                              IBuffer*                   pcMediaScatteringParams)
 {
-    m_Params  = Params;
-    m_pDevice = pDevice;
+    m_Params       = Params;
+    m_pDevice      = pDevice;
+    m_MeshTopology = Params.m_bUseTriangleLists ? PRIMITIVE_TOPOLOGY_TRIANGLE_LIST : PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
 
     RefCntAutoPtr<IRenderStateNotationParser> pRSNParser;
     {
@@ -641,12 +772,12 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         CreateRenderStateNotationLoader({m_pDevice, pRSNParser, pCompoundFactory}, &m_pRSNLoader);
     }
 
-    const Uint16* pHeightMap;
-    size_t        HeightMapPitch;
-    pDataSource->GetDataPtr(pHeightMap, HeightMapPitch);
     Uint32 iHeightMapDim = pDataSource->GetNumCols();
     VERIFY_EXPR(iHeightMapDim == pDataSource->GetNumRows());
 
+    // Height map mip levels and the ring meshes are computed in parallel
+    JobSystem Jobs;
+
     TextureDesc NormalMapDesc;
     NormalMapDesc.Name      = "Normal map texture";
     NormalMapDesc.Type      = RESOURCE_DIM_TEX_2D;
@@ -708,7 +839,7 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
 
     m_pDevice->CreateSampler(Sam_ComparisonLinearClamp, &m_pComparisonSampler);
 
-    RenderNormalMap(pDevice, pContext, pHeightMap, HeightMapPitch, iHeightMapDim, ptex2DNormalMap);
+    RenderNormalMap(pDevice, pContext, Jobs, pDataSource, ptex2DNormalMap);
 
     {
         auto ShaderCallback = MakeCallback([&](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
@@ -718,7 +849,8 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
 
         auto PipelineCallback = MakeCallback([&](PipelineStateCreateInfo& pPipelineCI) {
             auto& GraphicsPipelineCI{static_cast<GraphicsPipelineStateCreateInfo&>(pPipelineCI)};
-            GraphicsPipelineCI.GraphicsPipeline.DSVFormat = m_Params.ShadowMapFormat;
+            GraphicsPipelineCI.GraphicsPipeline.DSVFormat         = m_Params.ShadowMapFormat;
+            GraphicsPipelineCI.GraphicsPipeline.PrimitiveTopology = m_MeshTopology;
         });
         m_pRSNLoader->LoadPipelineState({"Render Hemisphere Z Only", PIPELINE_TYPE_GRAPHICS, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pHemisphereZOnlyPSO);
         m_pHemisphereZOnlyPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
@@ -726,7 +858,7 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
     }
 
     std::vector<HemisphereVertex> VB;
-    GenerateSphereGeometry(pDevice, Diligent::AirScatteringAttribs().fEarthRadius, m_Params.m_iRingDimension, m_Params.m_iNumRings, pDataSource, m_Params.m_TerrainAttribs.m_fElevationSamplingInterval, m_Params.m_TerrainAttribs.m_fElevationScale, VB, m_SphereMeshes);
+    GenerateSphereGeometry(pDevice, Jobs, Diligent::AirScatteringAttribs().fEarthRadius, m_Params.m_iRingDimension, m_Params.m_iNumRings, m_Params.m_bUseTriangleLists, pDataSource, m_Params.m_TerrainAttribs.m_fElevationSamplingInterval, m_Params.m_TerrainAttribs.m_fElevationScale, VB, m_SphereMeshes);
 
     BufferDesc VBDesc;
     VBDesc.Name      = "Hemisphere vertex buffer";
@@ -738,6 +870,81 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
     VBInitData.DataSize = VBDesc.Size;
     pDevice->CreateBuffer(VBDesc, &VBInitData, &m_pVertBuff);
     VERIFY(m_pVertBuff, "Failed to create VB");
+
+    TerrainQuadTree::CreateInfo TreeCI;
+    TreeCI.pDataSource   = pDataSource;
+    TreeCI.fSamplingStep = m_Params.m_TerrainAttribs.m_fElevationSamplingInterval;
+    TreeCI.fHeightScale  = m_Params.m_TerrainAttribs.m_fElevationScale;
+    TreeCI.fEarthRadius  = Diligent::AirScatteringAttribs().fEarthRadius;
+    CreateCLODResources(TreeCI);
+}
+
+void EarthHemsiphere::CreateCLODResources(const TerrainQuadTree::CreateInfo& TreeCI)
+{
+    m_pCLODTree = std::make_unique<TerrainQuadTree>(TreeCI);
+
+    std::vector<float3> PatchVerts;
+    std::vector<Uint32> PatchInds;
+    TerrainQuadTree::CreatePatchMesh(TreeCI.PatchQuads, PatchVerts, PatchInds);
+    OptimizeVertexCache(PatchInds.data(), PatchInds.size(), static_cast<Uint32>(PatchVerts.size()));
+    VERIFY_EXPR(PatchVerts.size() <= 65536);
+    const std::vector<Uint16> PatchInds16(PatchInds.begin(), PatchInds.end());
+    m_CLODPatchNumIndices = static_cast<Uint32>(PatchInds16.size());
+
+    BufferDesc VBDesc;
+    VBDesc.Name      = "CLOD patch vertex buffer";
+    VBDesc.Size      = static_cast<Uint64>(PatchVerts.size() * sizeof(PatchVerts[0]));
+    VBDesc.Usage     = USAGE_IMMUTABLE;
+    VBDesc.BindFlags = BIND_VERTEX_BUFFER;
+    BufferData VBInitData;
+    VBInitData.pData    = PatchVerts.data();
+    VBInitData.DataSize = VBDesc.Size;
+    m_pDevice->CreateBuffer(VBDesc, &VBInitData, &m_pCLODPatchVB);
+    VERIFY(m_pCLODPatchVB, "Failed to create CLOD patch VB");
+
+    BufferDesc IBDesc;
+    IBDesc.Name      = "CLOD patch index buffer";
+    IBDesc.Size      = static_cast<Uint64>(PatchInds16.size() * sizeof(PatchInds16[0]));
+    IBDesc.Usage     = USAGE_IMMUTABLE;
+    IBDesc.BindFlags = BIND_INDEX_BUFFER;
+    BufferData IBInitData;
+    IBInitData.pData    = PatchInds16.data();
+    IBInitData.DataSize = IBDesc.Size;
+    m_pDevice->CreateBuffer(IBDesc, &IBInitData, &m_pCLODPatchIB);
+    VERIFY(m_pCLODPatchIB, "Failed to create CLOD patch IB");
+
+    BufferDesc InstBuffDesc;
+    InstBuffDesc.Name           = "CLOD patch instance buffer";
+    InstBuffDesc.Size           = Uint64{MaxCLODPatches} * sizeof(TerrainQuadTree::PatchInstance);
+    InstBuffDesc.Usage          = USAGE_DYNAMIC;
+    InstBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+    InstBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_pCLODInstanceBuffer);
+    VERIFY(m_pCLODInstanceBuffer, "Failed to create CLOD patch instance buffer");
+
+    TerrainCLODAttribs CLODAttribs;
+    CLODAttribs.m_fElevationScale            = TreeCI.fHeightScale;
+    CLODAttribs.m_fElevationSamplingInterval = TreeCI.fSamplingStep;
+    CLODAttribs.m_fEarthRadius               = TreeCI.fEarthRadius;
+    CLODAttribs.m_fPatchQuads                = static_cast<float>(TreeCI.PatchQuads);
+    CLODAttribs.m_iHeightMapDim              = static_cast<int>(TreeCI.pDataSource->GetNumCols());
+    TreeCI.pDataSource->GetOffsets(CLODAttribs.m_iColOffset, CLODAttribs.m_iRowOffset);
+    CLODAttribs.m_iDummy                     = 0;
+    CreateUniformBuffer(m_pDevice, sizeof(CLODAttribs), "Terrain CLOD Attribs CB", &m_pcbCLODAttribs, USAGE_IMMUTABLE, BIND_UNIFORM_BUFFER, CPU_ACCESS_NONE, &CLODAttribs);
+    m_pResMapping->AddResource("cbTerrainCLODAttribs", m_pcbCLODAttribs, true);
+
+    auto ShaderCallback = MakeCallback([&](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
+        if (!m_pDevice->GetDeviceInfo().IsGLDevice())
+            ShaderCI.CompileFlags = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
+    });
+
+    auto PipelineCallback = MakeCallback([&](PipelineStateCreateInfo& pPipelineCI) {
+        auto& GraphicsPipelineCI{static_cast<GraphicsPipelineStateCreateInfo&>(pPipelineCI)};
+        GraphicsPipelineCI.GraphicsPipeline.DSVFormat = m_Params.ShadowMapFormat;
+    });
+    m_pRSNLoader->LoadPipelineState({"Render Hemisphere CLOD Z Only", PIPELINE_TYPE_GRAPHICS, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pHemisphereCLODZOnlyPSO);
+    m_pHemisphereCLODZOnlyPSO->BindStaticResources(SHADER_TYPE_VERTEX, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+    m_pHemisphereCLODZOnlyPSO->CreateShaderResourceBinding(&m_pHemisphereCLODZOnlySRB, true);
 }
 
 void EarthHemsiphere::Render(IDeviceContext*        pContext,
@@ -757,6 +964,8 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
     {
         m_pHemispherePSO.Release();
         m_pHemisphereSRB.Release();
+        m_pHemisphereCLODPSO.Release();
+        m_pHemisphereCLODSRB.Release();
     }
 
     m_Params = NewParams;
@@ -789,17 +998,28 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
                 ShaderCI.CompileFlags = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
         });
 
+        // Ring meshes use the topology selected at creation, patches are always triangle lists
+        PRIMITIVE_TOPOLOGY Topology = m_MeshTopology;
+
         auto PipelineCallback = MakeCallback([&](PipelineStateCreateInfo& pPipelineCI) {
             auto& GraphicsPipelineCI{static_cast<GraphicsPipelineStateCreateInfo&>(pPipelineCI)};
-            GraphicsPipelineCI.GraphicsPipeline.DSVFormat        = TEX_FORMAT_D32_FLOAT;
-            GraphicsPipelineCI.GraphicsPipeline.RTVFormats[0]    = m_Params.DstRTVFormat;
-            GraphicsPipelineCI.GraphicsPipeline.NumRenderTargets = 1;
+            GraphicsPipelineCI.GraphicsPipeline.DSVFormat         = TEX_FORMAT_D32_FLOAT;
+            GraphicsPipelineCI.GraphicsPipeline.RTVFormats[0]     = m_Params.DstRTVFormat;
+            GraphicsPipelineCI.GraphicsPipeline.NumRenderTargets  = 1;
+            GraphicsPipelineCI.GraphicsPipeline.PrimitiveTopology = Topology;
         });
         m_pRSNLoader->LoadPipelineState({"RenderHemisphere", PIPELINE_TYPE_GRAPHICS, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pHemispherePSO);
 
         m_pHemispherePSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
         m_pHemispherePSO->CreateShaderResourceBinding(&m_pHemisphereSRB, true);
         m_pHemisphereSRB->BindResources(SHADER_TYPE_VERTEX, m_pResMapping, BIND_SHADER_RESOURCES_KEEP_EXISTING);
+
+        Topology = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        m_pRSNLoader->LoadPipelineState({"Render Hemisphere CLOD", PIPELINE_TYPE_GRAPHICS, false, PipelineCallback, PipelineCallback, ShaderCallback, ShaderCallback}, &m_pHemisphereCLODPSO);
+
+        m_pHemisphereCLODPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
+        m_pHemisphereCLODPSO->CreateShaderResourceBinding(&m_pHemisphereCLODSRB, true);
+        m_pHemisphereCLODSRB->BindResources(SHADER_TYPE_VERTEX, m_pResMapping, BIND_SHADER_RESOURCES_KEEP_EXISTING);
     }
 
     ViewFrustumExt ViewFrustum;
@@ -833,32 +1053,74 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
 	pd3dImmediateContext->PSSetSamplers(0, _countof(pSamplers), pSamplers);
 #endif
 
-    IBuffer* ppBuffers[1] = {m_pVertBuff};
-    pContext->SetVertexBuffers(0, 1, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+    const bool bUseCLOD = m_Params.m_bEnableCLOD && m_pCLODTree;
 
+    IPipelineState*         pPSO = nullptr;
+    IShaderResourceBinding* pSRB = nullptr;
     if (bZOnlyPass)
     {
-        pContext->SetPipelineState(m_pHemisphereZOnlyPSO);
-        pContext->CommitShaderResources(m_pHemisphereZOnlySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pPSO = bUseCLOD ? m_pHemisphereCLODZOnlyPSO : m_pHemisphereZOnlyPSO;
+        pSRB = bUseCLOD ? m_pHemisphereCLODZOnlySRB : m_pHemisphereZOnlySRB;
     }
     else
     {
         pShadowMapSRV->SetSampler(m_pComparisonSampler);
-        pContext->SetPipelineState(m_pHemispherePSO);
+        pPSO = bUseCLOD ? m_pHemisphereCLODPSO : m_pHemispherePSO;
+        pSRB = bUseCLOD ? m_pHemisphereCLODSRB : m_pHemisphereSRB;
 
-        m_pHemisphereSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DOccludedNetDensityToAtmTop")->Set(pPrecomputedNetDensitySRV);
-        m_pHemisphereSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DAmbientSkylight")->Set(pAmbientSkylightSRV);
-        m_pHemisphereSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_tex2DShadowMap")->Set(pShadowMapSRV);
+        pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DOccludedNetDensityToAtmTop")->Set(pPrecomputedNetDensitySRV);
+        pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_tex2DAmbientSkylight")->Set(pAmbientSkylightSRV);
+        pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_tex2DShadowMap")->Set(pShadowMapSRV);
+    }
+    pContext->SetPipelineState(pPSO);
+    pContext->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-        pContext->CommitShaderResources(m_pHemisphereSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    if (bUseCLOD)
+    {
+        // Shadow passes select the patches for the screen-space error of the main camera too
+        TerrainQuadTree::SelectionAttribs SelectionAttribs;
+        SelectionAttribs.f3CameraPos     = vCameraPosition;
+        SelectionAttribs.pFrustum        = &ViewFrustum;
+        SelectionAttribs.FrustumFlags    = bZOnlyPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM;
+        SelectionAttribs.fProjScale      = m_Params.m_fCLODProjScale;
+        SelectionAttribs.fMaxScreenError = m_Params.m_fCLODMaxScreenError;
+
+        TerrainQuadTree::SelectionStats Stats;
+        m_CLODPatches.clear();
+        m_pCLODTree->Select(SelectionAttribs, m_CLODPatches, &Stats);
+        if (!bZOnlyPass)
+            m_CLODStats = Stats;
+
+        // Patches are selected front to back, so only the farthest ones are dropped if there are too many
+        const Uint32 NumPatches = std::min(static_cast<Uint32>(m_CLODPatches.size()), MaxCLODPatches);
+        if (NumPatches == 0)
+            return;
+
+        {
+            MapHelper<TerrainQuadTree::PatchInstance> Instances(pContext, m_pCLODInstanceBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+            memcpy(Instances, m_CLODPatches.data(), NumPatches * sizeof(m_CLODPatches[0]));
+        }
+
+        IBuffer* ppBuffers[] = {m_pCLODPatchVB, m_pCLODInstanceBuffer};
+        pContext->SetVertexBuffers(0, _countof(ppBuffers), ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+        pContext->SetIndexBuffer(m_pCLODPatchIB, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DrawIndexedAttribs DrawAttrs(m_CLODPatchNumIndices, VT_UINT16, DRAW_FLAG_VERIFY_ALL);
+        DrawAttrs.NumInstances = NumPatches;
+        pContext->DrawIndexed(DrawAttrs);
+        return;
     }
 
+    IBuffer* ppBuffers[1] = {m_pVertBuff};
+    pContext->SetVertexBuffers(0, 1, ppBuffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+
     for (auto MeshIt = m_SphereMeshes.begin(); MeshIt != m_SphereMeshes.end(); ++MeshIt)
     {
         if (GetBoxVisibility(ViewFrustum, MeshIt->BndBox, bZOnlyPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) != BoxVisibility::Invisible)
         {
             pContext->SetIndexBuffer(MeshIt->pIndBuff, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-            DrawIndexedAttribs DrawAttrs(MeshIt->uiNumIndices, VT_UINT32, DRAW_FLAG_VERIFY_ALL);
+            DrawIndexedAttribs DrawAttrs(MeshIt->uiNumIndices, MeshIt->IndexType, DRAW_FLAG_VERIFY_ALL);
+            DrawAttrs.BaseVertex = MeshIt->uiBaseVertex;
             pContext->DrawIndexed(DrawAttrs);
         }
     }
@@ -45,6 +45,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "RenderDevice.h"
@@ -58,6 +59,7 @@
 #include "RenderStateNotationLoader.h"
 
 #include "AdvancedMath.hpp"
+#include "TerrainQuadTree.hpp"
 
 namespace Diligent
 {
@@ -82,6 +84,16 @@ struct RenderingParams
     int            m_iRingDimension = 65;
     int            m_iNumRings      = 15;
 
+    // Render ring sectors as vertex-cache optimized triangle lists with 16-bit indices instead of
+    // triangle strips. Only takes effect when the hemisphere is created.
+    bool m_bUseTriangleLists = true;
+
+    // Render the terrain as patches selected by the quadtree for the screen-space error instead of the ring meshes.
+    // The projection scale is the viewport height divided by 2 * tan(FOV / 2) and must be set by the application.
+    bool  m_bEnableCLOD         = true;
+    float m_fCLODMaxScreenError = 8.f;
+    float m_fCLODProjScale      = 1000.f;
+
     int            m_iNumShadowCascades         = 6;
     int            m_bBestCascadeSearch         = 1;
     int            m_FixedShadowFilterSize      = 5;
@@ -96,9 +108,11 @@ struct RingSectorMesh
 {
     RefCntAutoPtr<IBuffer> pIndBuff;
     Uint32                 uiNumIndices;
+    Uint32                 uiBaseVertex;
+    VALUE_TYPE             IndexType;
     BoundBox               BndBox;
     RingSectorMesh() :
-        uiNumIndices(0) {}
+        uiNumIndices(0), uiBaseVertex(0), IndexType(VT_UINT32) {}
 };
 
 // This class renders the adaptive model using DX11 API
@@ -142,13 +156,17 @@ public:
         NUM_TILE_TEXTURES = 1 + 4
     }; // One base material + 4 masked materials
 
+    // Patch selection statistics of the last main pass rendered with continuous LOD
+    const TerrainQuadTree::SelectionStats& GetCLODStats() const { return m_CLODStats; }
+
 private:
-    void RenderNormalMap(IRenderDevice*  pd3dDevice,
-                         IDeviceContext* pd3dImmediateContext,
-                         const Uint16*   pHeightMap,
-                         size_t          HeightMapPitch,
-                         int             HeightMapDim,
-                         ITexture*       ptex2DNormalMap);
+    void CreateCLODResources(const TerrainQuadTree::CreateInfo& TreeCI);
+
+    void RenderNormalMap(IRenderDevice*                   pd3dDevice,
+                         IDeviceContext*                  pd3dImmediateContext,
+                         class JobSystem&                 Jobs,
+                         const class ElevationDataSource* pDataSource,
+                         ITexture*                        ptex2DNormalMap);
 
     RenderingParams m_Params;
 
@@ -172,6 +190,25 @@ private:
     RefCntAutoPtr<ISampler>               m_pComparisonSampler;
 
     std::vector<RingSectorMesh> m_SphereMeshes;
+    PRIMITIVE_TOPOLOGY          m_MeshTopology = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    // Continuous LOD: instanced patches selected by the quadtree every pass
+    static constexpr Uint32 MaxCLODPatches = 16384;
+
+    std::unique_ptr<TerrainQuadTree>            m_pCLODTree;
+    std::vector<TerrainQuadTree::PatchInstance> m_CLODPatches;
+    TerrainQuadTree::SelectionStats             m_CLODStats;
+
+    RefCntAutoPtr<IBuffer> m_pCLODPatchVB;
+    RefCntAutoPtr<IBuffer> m_pCLODPatchIB;
+    RefCntAutoPtr<IBuffer> m_pCLODInstanceBuffer;
+    RefCntAutoPtr<IBuffer> m_pcbCLODAttribs;
+    Uint32                 m_CLODPatchNumIndices = 0;
+
+    RefCntAutoPtr<IPipelineState>         m_pHemisphereCLODZOnlyPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pHemisphereCLODZOnlySRB;
+    RefCntAutoPtr<IPipelineState>         m_pHemisphereCLODPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pHemisphereCLODSRB;
 
     Uint32 m_ValidShaders;
 };
@@ -45,6 +45,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
 
 #include "ElevationDataSource.hpp"
 #include "FileWrapper.hpp"
@@ -53,96 +56,377 @@
 #include "BasicFileStream.hpp"
 #include "TextureUtilities.h"
 #include "GraphicsAccessories.hpp"
+#include "Align.hpp"
+
+// Batched height queries use SSE2 on x86 targets and the scalar code on other platforms
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ELEVATION_DATA_SOURCE_SSE2 1
+#    include <emmintrin.h>
+#else
+#    define ELEVATION_DATA_SOURCE_SSE2 0
+#endif
 
 namespace Diligent
 {
 
+namespace
+{
+
+struct TiledFileHeader
+{
+    static constexpr Uint32 ExpectedMagic   = 0x54454C45; // "ELET"
+    static constexpr Uint32 ExpectedVersion = 2;
+
+    Uint32 Magic        = ExpectedMagic;
+    Uint32 Version      = ExpectedVersion;
+    Uint64 SrcFileSize  = 0;
+    Int64  SrcFileTime  = 0;
+    Uint32 NumCols      = 0;
+    Uint32 NumRows      = 0;
+    Uint32 PatchDim     = 0;
+    Uint32 NumPatchesX  = 0;
+    Uint32 NumPatchesY  = 0;
+    Uint32 PatchStride  = 0; // in samples
+    Uint16 MinElevation = 0;
+    Uint16 MaxElevation = 0;
+    Uint32 Padding      = 0;
+};
+
+// Patches are aligned to the page size, so that they can be paged in and out independently.
+// The min/max pyramid follows the patches.
+constexpr size_t TiledFilePageSize = 4096;
+
+// Maximum size of the patches that are kept resident
+constexpr size_t MaxResidentPatchesSizeMb = 128;
+
+String ToNativePath(const Char* Path)
+{
+    String NativePath{Path};
+#if !PLATFORM_WIN32
+    std::replace(NativePath.begin(), NativePath.end(), '\\', '/');
+#endif
+    return NativePath;
+}
+
+bool GetFileStats(const String& Path, Uint64& Size, Int64& Time)
+{
+#if PLATFORM_WIN32 || PLATFORM_LINUX || PLATFORM_MACOS
+#    if PLATFORM_WIN32
+    struct _stat64 FileStat;
+    if (_stat64(Path.c_str(), &FileStat) != 0)
+        return false;
+#    else
+    struct stat FileStat;
+    if (stat(Path.c_str(), &FileStat) != 0)
+        return false;
+#    endif
+    Size = static_cast<Uint64>(FileStat.st_size);
+    Time = static_cast<Int64>(FileStat.st_mtime);
+    return true;
+#else
+    // Source files are packed with the application
+    return false;
+#endif
+}
+
+// Calls Handler(First, Last) for the ranges of the height map samples that the sample range [Start, End]
+// maps to with MirrorCoord().
+template <typename HandlerType>
+void ForEachMirroredRange(int Start, int End, int Dim, HandlerType&& Handler)
+{
+    if (Start < 0)
+    {
+        // Negative coordinates are mirrored about zero
+        if (End < 0)
+        {
+            ForEachMirroredRange(-End, -Start, Dim, Handler);
+            return;
+        }
+        ForEachMirroredRange(1, -Start, Dim, Handler);
+        Start = 0;
+    }
+
+    if (End - Start + 1 >= 2 * Dim)
+    {
+        Handler(0, Dim - 1);
+        return;
+    }
+
+    for (int Period = Start / Dim; Period * Dim <= End; ++Period)
+    {
+        const int First = std::max(Start, Period * Dim) - Period * Dim;
+        const int Last  = std::min(End, Period * Dim + Dim - 1) - Period * Dim;
+        if (Period & 0x01)
+            Handler(Dim - 1 - Last, Dim - 1 - First);
+        else
+            Handler(First, Last);
+    }
+}
+
+} // namespace
+
 // Creates data source from the specified raw data file
 ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
-    m_iNumLevels(0),
-    m_iPatchSize(128),
     m_iColOffset(0),
     m_iRowOffset(0)
 {
+    // The tiled file is rebuilt when the source file changes
+    const String SrcPath         = ToNativePath(strSrcDemFile);
+    const String TiledPath       = SrcPath + ".tiles";
+    Uint64       SrcFileSize     = 0;
+    Int64        SrcFileTime     = 0;
+    const bool   CanUseTiledFile = GetFileStats(SrcPath, SrcFileSize, SrcFileTime);
+
+    if (!CanUseTiledFile || !MapTiledFile(TiledPath, SrcFileSize, SrcFileTime))
+    {
+        ConvertSourceImage(strSrcDemFile);
+        BuildMinMaxPyramid();
+
+        if (CanUseTiledFile && WriteTiledFile(TiledPath, SrcFileSize, SrcFileTime) && MapTiledFile(TiledPath, SrcFileSize, SrcFileTime))
+        {
+            LOG_INFO_MESSAGE("Converted height map '", strSrcDemFile, "' into tiled file '", TiledPath, "'");
+            std::vector<Uint16>{}.swap(m_PatchData);
+            std::vector<ElevationRange>{}.swap(m_MinMaxData);
+        }
+    }
+
+    m_MaxResidentPatches = std::max((MaxResidentPatchesSizeMb << 20) / (m_PatchStride * sizeof(Uint16)), size_t{1});
+}
+
+ElevationDataSource::ElevationDataSource(const Uint16* pHeights, Uint32 Width, Uint32 Height, size_t Pitch) :
+    m_iColOffset(0),
+    m_iRowOffset(0)
+{
+    CreatePatches(reinterpret_cast<const Uint8*>(pHeights), Width, Height, Pitch * sizeof(Uint16));
+    BuildMinMaxPyramid();
 
-#if 1
+    m_MaxResidentPatches = std::max((MaxResidentPatchesSizeMb << 20) / (m_PatchStride * sizeof(Uint16)), size_t{1});
+}
+
+void ElevationDataSource::ConvertSourceImage(const Char* strSrcDemFile)
+{
     RefCntAutoPtr<Image> pHeightMap;
     CreateImageFromFile(strSrcDemFile, &pHeightMap);
 
     const auto& ImgInfo    = pHeightMap->GetDesc();
     auto*       pImageData = pHeightMap->GetData();
+    VERIFY(ImgInfo.ComponentType == VT_UINT16 && ImgInfo.NumComponents == 1, "Unexpected scanline size: 16-bit single-channel image is expected");
+
+    CreatePatches(reinterpret_cast<const Uint8*>(pImageData->GetDataPtr()), ImgInfo.Width, ImgInfo.Height, ImgInfo.RowStride);
+}
+
+void ElevationDataSource::CreatePatches(const Uint8* pSrcImgData, Uint32 Width, Uint32 Height, size_t RowStride)
+{
     // Calculate minimal number of columns and rows
     // in the form 2^n+1 that encompass the data
     m_iNumCols = 1;
     m_iNumRows = 1;
-    while (m_iNumCols + 1 < ImgInfo.Width || m_iNumRows + 1 < ImgInfo.Height)
+    while (m_iNumCols + 1 < Width || m_iNumRows + 1 < Height)
     {
         m_iNumCols *= 2;
         m_iNumRows *= 2;
     }
 
-    m_iNumLevels = 1;
-    while ((m_iPatchSize << (m_iNumLevels - 1)) < (int)m_iNumCols ||
-           (m_iPatchSize << (m_iNumLevels - 1)) < (int)m_iNumRows)
-        m_iNumLevels++;
+    m_NumPatchesX = std::max(m_iNumCols >> PatchDimLog2, 1u);
+    m_NumPatchesY = std::max(m_iNumRows >> PatchDimLog2, 1u);
+    m_PatchStride = AlignUp(size_t{PatchDim + 1} * size_t{PatchDim + 1}, TiledFilePageSize / sizeof(Uint16));
 
     m_iNumCols++;
     m_iNumRows++;
-    m_iStride = (m_iNumCols + 1) & (-2);
 
-    // Load the data
-    m_TheHeightMap.resize(size_t{m_iStride} * size_t{m_iNumRows});
+    m_PatchData.resize(size_t{m_NumPatchesX} * size_t{m_NumPatchesY} * m_PatchStride);
 
-    VERIFY(ImgInfo.ComponentType == VT_UINT16 && ImgInfo.NumComponents == 1, "Unexpected scanline size: 16-bit single-channel image is expected");
-    auto* pSrcImgData = reinterpret_cast<Uint8*>(pImageData->GetDataPtr());
-    for (size_t row = 0; row < ImgInfo.Height; row++, pSrcImgData += ImgInfo.RowStride)
+    m_GlobalMinElevation = reinterpret_cast<const Uint16*>(pSrcImgData)[0];
+    m_GlobalMaxElevation    = m_GlobalMinElevation;
+    for (Uint32 PatchY = 0; PatchY < m_NumPatchesY; ++PatchY)
     {
-        memcpy(&m_TheHeightMap[row * m_iStride], pSrcImgData, size_t{ImgInfo.Width} * size_t{GetValueSize(ImgInfo.ComponentType)});
+        for (Uint32 PatchX = 0; PatchX < m_NumPatchesX; ++PatchX)
+        {
+            Uint16* pPatch = &m_PatchData[(size_t{PatchY} * m_NumPatchesX + PatchX) * m_PatchStride];
+            for (Uint32 y = 0; y <= PatchDim; ++y)
+            {
+                // Duplicate the last row and column
+                const Uint32  SrcRow  = std::min((PatchY << PatchDimLog2) + y, Height - 1);
+                const Uint16* pSrcRow = reinterpret_cast<const Uint16*>(pSrcImgData + size_t{SrcRow} * RowStride);
+                for (Uint32 x = 0; x <= PatchDim; ++x)
+                {
+                    const Uint32 SrcCol = std::min((PatchX << PatchDimLog2) + x, Width - 1);
+                    const Uint16 Elev   = pSrcRow[SrcCol];
+
+                    pPatch[x + y * (PatchDim + 1)] = Elev;
+
+                    m_GlobalMinElevation = std::min(m_GlobalMinElevation, Elev);
+                    m_GlobalMaxElevation = std::max(m_GlobalMaxElevation, Elev);
+                }
+            }
+        }
     }
+    m_pPatches = m_PatchData.data();
+}
 
-    // Duplicate the last row and column
-    for (Uint32 iRow = 0; iRow < ImgInfo.Height; iRow++)
-        for (Uint32 iCol = ImgInfo.Width; iCol < m_iNumCols; iCol++)
-            GetElevSample(iCol, iRow) = GetElevSample((ImgInfo.Width - 1), iRow);
+size_t ElevationDataSource::InitMinMaxPyramidLayout()
+{
+    VERIFY(m_iNumCols == m_iNumRows, "The height map is expected to be square");
+
+    // Cells of level 0 can't be larger than the height map
+    const Uint32 NumQuads = m_iNumCols - 1;
+    m_MinMaxCellSizeLog2  = 0;
+    while (m_MinMaxCellSizeLog2 < MinMaxCellSizeLog2 && (2u << m_MinMaxCellSizeLog2) <= NumQuads)
+        ++m_MinMaxCellSizeLog2;
+
+    m_NumMinMaxLevels = 0;
+    m_MinMaxLevelOffsets.clear();
+    size_t NumCells = 0;
+    while ((NumQuads >> (m_MinMaxCellSizeLog2 + m_NumMinMaxLevels)) > 0)
+    {
+        m_MinMaxLevelOffsets.push_back(NumCells);
+        const size_t LevelDim = GetMinMaxLevelDim(m_NumMinMaxLevels);
+        NumCells += LevelDim * LevelDim;
+        ++m_NumMinMaxLevels;
+    }
+    return NumCells;
+}
 
-    for (Uint32 iCol = 0; iCol < m_iNumCols; iCol++)
-        for (Uint32 iRow = ImgInfo.Height; iRow < m_iNumRows; iRow++)
-            GetElevSample(iCol, iRow) = GetElevSample(iCol, ImgInfo.Height - 1);
+void ElevationDataSource::BuildMinMaxPyramid()
+{
+    m_MinMaxData.resize(InitMinMaxPyramidLayout());
 
-#else
-    m_iStride  = 2048;
-    m_iNumRows = m_iNumCols = 2048;
-    m_iNumLevels            = 5;
-    m_TheHeightMap.resize(m_iStride * m_iNumRows);
-    for (Uint32 j = 0; j < m_iNumRows; ++j)
+    // Cells share the border samples with their neighbors, so the interpolated surface is always within the cell range
+    const Uint32 CellSize  = GetMinMaxCellSize(0);
+    const Uint32 Level0Dim = GetMinMaxLevelDim(0);
+    for (Uint32 CellY = 0; CellY < Level0Dim; ++CellY)
     {
-        for (Uint32 i = 0; i < m_iNumCols; ++i)
+        for (Uint32 CellX = 0; CellX < Level0Dim; ++CellX)
         {
-            float x = (float)i / (float)m_iNumRows;
-            float y = (float)j / (float)m_iNumCols;
-            float A = 1;
-            float F = 1;
-            float h = 0;
-            for (int Octave = 0; Octave < 8; ++Octave, A *= 0.7f, F *= 1.8f)
+            ElevationRange Range;
+            Range.Min = Range.Max = GetElevSample(CellX * CellSize, CellY * CellSize);
+            for (Uint32 y = 0; y <= CellSize; ++y)
             {
-                h += A * (sin(x * F) * sin(y * 1.5f * F) + 0.5f * (sin((x + y) * 1.3f * F) + cos((x * y) * 1.7f * F)));
-                h = fabs(h - 0.5f);
+                for (Uint32 x = 0; x <= CellSize; ++x)
+                {
+                    const Uint16 Elev = GetElevSample(CellX * CellSize + x, CellY * CellSize + y);
+
+                    Range.Min = std::min(Range.Min, Elev);
+                    Range.Max = std::max(Range.Max, Elev);
+                }
             }
-            h = fabs(h) * 32000.f;
-            h = std::min(h, (float)std::numeric_limits<Uint16>::max());
+            m_MinMaxData[CellX + size_t{CellY} * Level0Dim] = Range;
+        }
+    }
 
-            GetElevSample(i, j) = (Uint16)h;
+    for (Uint32 Level = 1; Level < m_NumMinMaxLevels; ++Level)
+    {
+        const Uint32          LevelDim = GetMinMaxLevelDim(Level);
+        const ElevationRange* pFiner   = &m_MinMaxData[m_MinMaxLevelOffsets[Level - 1]];
+        ElevationRange*       pCells   = &m_MinMaxData[m_MinMaxLevelOffsets[Level]];
+        for (Uint32 CellY = 0; CellY < LevelDim; ++CellY)
+        {
+            for (Uint32 CellX = 0; CellX < LevelDim; ++CellX)
+            {
+                const ElevationRange& R00 = pFiner[(CellX * 2 + 0) + size_t{CellY * 2 + 0} * LevelDim * 2];
+                const ElevationRange& R10 = pFiner[(CellX * 2 + 1) + size_t{CellY * 2 + 0} * LevelDim * 2];
+                const ElevationRange& R01 = pFiner[(CellX * 2 + 0) + size_t{CellY * 2 + 1} * LevelDim * 2];
+                const ElevationRange& R11 = pFiner[(CellX * 2 + 1) + size_t{CellY * 2 + 1} * LevelDim * 2];
+
+                ElevationRange& Range = pCells[CellX + size_t{CellY} * LevelDim];
+                Range.Min             = std::min(std::min(R00.Min, R10.Min), std::min(R01.Min, R11.Min));
+                Range.Max             = std::max(std::max(R00.Max, R10.Max), std::max(R01.Max, R11.Max));
+            }
         }
     }
-#endif
+    m_pMinMaxPyramid = m_MinMaxData.data();
+}
 
-    m_GlobalMinElevation = m_TheHeightMap[0];
-    m_GlobalMaxElevation = m_TheHeightMap[0];
-    for (auto Elev : m_TheHeightMap)
+bool ElevationDataSource::WriteTiledFile(const String& Path, Uint64 SrcFileSize, Int64 SrcFileTime) const
+{
+    TiledFileHeader Header;
+    Header.SrcFileSize  = SrcFileSize;
+    Header.SrcFileTime  = SrcFileTime;
+    Header.NumCols      = m_iNumCols;
+    Header.NumRows      = m_iNumRows;
+    Header.PatchDim     = PatchDim;
+    Header.NumPatchesX  = m_NumPatchesX;
+    Header.NumPatchesY  = m_NumPatchesY;
+    Header.PatchStride  = static_cast<Uint32>(m_PatchStride);
+    Header.MinElevation = m_GlobalMinElevation;
+    Header.MaxElevation = m_GlobalMaxElevation;
+
+    // Write to a temporary file first, so that an interrupted conversion never leaves a valid-looking file
+    const String TmpPath = Path + ".tmp";
+    FILE*        pFile   = fopen(TmpPath.c_str(), "wb");
+    if (pFile == nullptr)
     {
-        m_GlobalMinElevation = std::min(m_GlobalMinElevation, Elev);
-        m_GlobalMaxElevation = std::max(m_GlobalMaxElevation, Elev);
+        LOG_WARNING_MESSAGE("Failed to create tiled height map file '", TmpPath, "'. The height map will be kept in memory.");
+        return false;
     }
+
+    std::vector<Uint8> HeaderPage(TiledFilePageSize);
+    memcpy(HeaderPage.data(), &Header, sizeof(Header));
+
+    bool Success = fwrite(HeaderPage.data(), HeaderPage.size(), 1, pFile) == 1 &&
+                   fwrite(m_PatchData.data(), m_PatchData.size() * sizeof(Uint16), 1, pFile) == 1 &&
+                   fwrite(m_MinMaxData.data(), m_MinMaxData.size() * sizeof(ElevationRange), 1, pFile) == 1;
+    Success = fclose(pFile) == 0 && Success;
+
+    if (Success)
+    {
+        // rename() does not replace existing files on Windows
+        remove(Path.c_str());
+        Success = rename(TmpPath.c_str(), Path.c_str()) == 0;
+    }
+    if (!Success)
+    {
+        remove(TmpPath.c_str());
+        LOG_WARNING_MESSAGE("Failed to write tiled height map file '", Path, "'. The height map will be kept in memory.");
+    }
+    return Success;
+}
+
+bool ElevationDataSource::MapTiledFile(const String& Path, Uint64 SrcFileSize, Int64 SrcFileTime)
+{
+    if (!m_TiledFile.Open(Path.c_str()))
+        return false;
+
+    TiledFileHeader Header;
+    if (m_TiledFile.GetSize() < TiledFilePageSize)
+    {
+        m_TiledFile.Close();
+        return false;
+    }
+    memcpy(&Header, m_TiledFile.GetData(), sizeof(Header));
+
+    if (Header.Magic != TiledFileHeader::ExpectedMagic ||
+        Header.Version != TiledFileHeader::ExpectedVersion ||
+        Header.SrcFileSize != SrcFileSize ||
+        Header.SrcFileTime != SrcFileTime ||
+        Header.PatchDim != PatchDim ||
+        Header.NumCols != Header.NumRows)
+    {
+        m_TiledFile.Close();
+        return false;
+    }
+
+    m_iNumCols = Header.NumCols;
+    m_iNumRows = Header.NumRows;
+
+    const size_t DataSize    = size_t{Header.NumPatchesX} * size_t{Header.NumPatchesY} * Header.PatchStride * sizeof(Uint16);
+    const size_t PyramidSize = InitMinMaxPyramidLayout() * sizeof(ElevationRange);
+    if (m_TiledFile.GetSize() < TiledFilePageSize + DataSize + PyramidSize)
+    {
+        m_TiledFile.Close();
+        return false;
+    }
+
+    m_NumPatchesX        = Header.NumPatchesX;
+    m_NumPatchesY        = Header.NumPatchesY;
+    m_PatchStride        = Header.PatchStride;
+    m_GlobalMinElevation = Header.MinElevation;
+    m_GlobalMaxElevation = Header.MaxElevation;
+
+    m_TiledFileDataOffset = TiledFilePageSize;
+    m_pPatches            = reinterpret_cast<const Uint16*>(m_TiledFile.GetData() + m_TiledFileDataOffset);
+    m_pMinMaxPyramid      = reinterpret_cast<const ElevationRange*>(m_TiledFile.GetData() + m_TiledFileDataOffset + DataSize);
+    return true;
 }
 
 ElevationDataSource::~ElevationDataSource(void)
@@ -171,14 +455,71 @@ int MirrorCoord(int iCoord, int iDim)
     return iCoord;
 }
 
-inline Uint16& ElevationDataSource::GetElevSample(Int32 i, Int32 j)
+#if ELEVATION_DATA_SOURCE_SSE2
+
+namespace
+{
+
+// SSE2 has no 32-bit integer select, min and abs instructions
+inline __m128i Select(__m128i Mask, __m128i A, __m128i B)
+{
+    return _mm_or_si128(_mm_and_si128(Mask, A), _mm_andnot_si128(Mask, B));
+}
+
+inline __m128 Floor(__m128 f4Val)
+{
+    const __m128 f4Trunc = _mm_cvtepi32_ps(_mm_cvttps_epi32(f4Val));
+    return _mm_sub_ps(f4Trunc, _mm_and_ps(_mm_cmpgt_ps(f4Trunc, f4Val), _mm_set1_ps(1.f)));
+}
+
+// Same as MirrorCoord(). The division is done in floating point, which is exact
+// for coordinates below 2^24.
+inline __m128i MirrorCoord(__m128i i4Coord, int iDim)
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    const __m128i Sign = _mm_srai_epi32(i4Coord, 31);
+    i4Coord            = _mm_sub_epi32(_mm_xor_si128(i4Coord, Sign), Sign);
+
+    const __m128  f4Coord  = _mm_cvtepi32_ps(i4Coord);
+    const __m128  f4Dim    = _mm_set1_ps(static_cast<float>(iDim));
+    const __m128i i4Dim    = _mm_set1_epi32(iDim);
+    __m128i       i4Period = _mm_cvttps_epi32(_mm_mul_ps(f4Coord, _mm_set1_ps(1.f / static_cast<float>(iDim))));
+    __m128i       i4Rem    = _mm_cvttps_epi32(_mm_sub_ps(f4Coord, _mm_mul_ps(_mm_cvtepi32_ps(i4Period), f4Dim)));
+
+    // Multiplication by the reciprocal may be off by one period
+    const __m128i Under = _mm_cmplt_epi32(i4Rem, _mm_setzero_si128());
+    i4Rem               = _mm_add_epi32(i4Rem, _mm_and_si128(Under, i4Dim));
+    i4Period            = _mm_add_epi32(i4Period, Under);
+    const __m128i Over  = _mm_cmpgt_epi32(i4Rem, _mm_set1_epi32(iDim - 1));
+    i4Rem               = _mm_sub_epi32(i4Rem, _mm_and_si128(Over, i4Dim));
+    i4Period            = _mm_sub_epi32(i4Period, Over);
+
+    const __m128i One = _mm_set1_epi32(1);
+    const __m128i Odd = _mm_cmpeq_epi32(_mm_and_si128(i4Period, One), One);
+    return Select(Odd, _mm_sub_epi32(_mm_set1_epi32(iDim - 1), i4Rem), i4Rem);
 }
 
+// Splits the coordinate into the patch index and the coordinate within the patch, same as GetElevSample()
+inline void SplitCoord(__m128i i4Coord, Uint32 NumPatches, Int32* pPatch, Int32* pLocal)
+{
+    const __m128i LastPatch = _mm_set1_epi32(static_cast<int>(NumPatches - 1));
+    __m128i       i4Patch   = _mm_srli_epi32(i4Coord, ElevationDataSource::PatchDimLog2);
+    i4Patch                 = Select(_mm_cmpgt_epi32(i4Patch, LastPatch), LastPatch, i4Patch);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pPatch), i4Patch);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pLocal), _mm_sub_epi32(i4Coord, _mm_slli_epi32(i4Patch, ElevationDataSource::PatchDimLog2)));
+}
+
+} // namespace
+
+#endif
+
 inline Uint16 ElevationDataSource::GetElevSample(Int32 i, Int32 j) const
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    // The last sample of a patch is the first sample of the next one
+    const Uint32 PatchX = std::min(static_cast<Uint32>(i) >> PatchDimLog2, m_NumPatchesX - 1);
+    const Uint32 PatchY = std::min(static_cast<Uint32>(j) >> PatchDimLog2, m_NumPatchesY - 1);
+    const Uint32 x      = static_cast<Uint32>(i) - (PatchX << PatchDimLog2);
+    const Uint32 y      = static_cast<Uint32>(j) - (PatchY << PatchDimLog2);
+    return GetPatch(PatchX, PatchY)[x + y * (PatchDim + 1)];
 }
 
 float ElevationDataSource::GetInterpolatedHeight(float fCol, float fRow, int iStep) const
@@ -233,10 +574,396 @@ float3 ElevationDataSource::ComputeSurfaceNormal(float fCol, float fRow, float f
     return Normal;
 }
 
-void ElevationDataSource::GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch)
+void ElevationDataSource::GetInterpolatedHeights(const float* pCols, const float* pRows, float* pHeights, size_t Count, int iStep) const
 {
-    pDataPtr = &m_TheHeightMap[0];
-    Pitch    = m_iStride;
+    size_t i = 0;
+#if ELEVATION_DATA_SOURCE_SSE2
+    const __m128  f4Step      = _mm_set1_ps(static_cast<float>(iStep));
+    const __m128  f4One       = _mm_set1_ps(1.f);
+    const __m128i i4Step      = _mm_set1_epi32(iStep);
+    const __m128i i4ColOffset = _mm_set1_epi32(m_iColOffset);
+    const __m128i i4RowOffset = _mm_set1_epi32(m_iRowOffset);
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m128 f4Col = _mm_loadu_ps(pCols + i);
+        const __m128 f4Row = _mm_loadu_ps(pRows + i);
+
+        __m128 f4Col0 = Floor(f4Col);
+        __m128 f4Row0 = Floor(f4Row);
+        if (iStep != 1)
+        {
+            // Division of integers in floating point truncates the same way as the integer division
+            f4Col0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(f4Col0, f4Step))), f4Step);
+            f4Row0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(f4Row0, f4Step))), f4Step);
+        }
+        const __m128 f4HWeight = _mm_div_ps(_mm_sub_ps(f4Col, f4Col0), f4Step);
+        const __m128 f4VWeight = _mm_div_ps(_mm_sub_ps(f4Row, f4Row0), f4Step);
+
+        const __m128i i4Col0 = _mm_add_epi32(_mm_cvttps_epi32(f4Col0), i4ColOffset);
+        const __m128i i4Row0 = _mm_add_epi32(_mm_cvttps_epi32(f4Row0), i4RowOffset);
+
+        alignas(16) Int32 PatchX[2][4], PatchY[2][4], X[2][4], Y[2][4];
+        SplitCoord(MirrorCoord(i4Col0, m_iNumCols), m_NumPatchesX, PatchX[0], X[0]);
+        SplitCoord(MirrorCoord(_mm_add_epi32(i4Col0, i4Step), m_iNumCols), m_NumPatchesX, PatchX[1], X[1]);
+        SplitCoord(MirrorCoord(i4Row0, m_iNumRows), m_NumPatchesY, PatchY[0], Y[0]);
+        SplitCoord(MirrorCoord(_mm_add_epi32(i4Row0, i4Step), m_iNumRows), m_NumPatchesY, PatchY[1], Y[1]);
+
+        // SSE2 has no gather instruction, so the samples are fetched one lane at a time
+        alignas(16) float H[2][2][4];
+        for (size_t Lane = 0; Lane < 4; ++Lane)
+        {
+            for (size_t r = 0; r < 2; ++r)
+            {
+                for (size_t c = 0; c < 2; ++c)
+                    H[r][c][Lane] = GetPatch(PatchX[c][Lane], PatchY[r][Lane])[X[c][Lane] + Y[r][Lane] * (PatchDim + 1)];
+            }
+        }
+
+        const __m128 f4InvHWeight = _mm_sub_ps(f4One, f4HWeight);
+        const __m128 f4InvVWeight = _mm_sub_ps(f4One, f4VWeight);
+
+        const __m128 f4H0 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(H[0][0]), f4InvHWeight), _mm_mul_ps(_mm_load_ps(H[0][1]), f4HWeight));
+        const __m128 f4H1 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(H[1][0]), f4InvHWeight), _mm_mul_ps(_mm_load_ps(H[1][1]), f4HWeight));
+        _mm_storeu_ps(pHeights + i, _mm_add_ps(_mm_mul_ps(f4H0, f4InvVWeight), _mm_mul_ps(f4H1, f4VWeight)));
+    }
+#endif
+
+    for (; i < Count; ++i)
+        pHeights[i] = GetInterpolatedHeight(pCols[i], pRows[i], iStep);
+}
+
+void ElevationDataSource::ReadRows(Uint32 StartRow, Uint32 NumRows, Uint16* pDst, size_t DstPitch) const
+{
+    VERIFY_EXPR(StartRow + NumRows <= m_iNumRows);
+    for (Uint32 Row = StartRow; Row < StartRow + NumRows; ++Row, pDst += DstPitch)
+    {
+        const Uint32 PatchY = std::min(Row >> PatchDimLog2, m_NumPatchesY - 1);
+        const Uint32 y      = Row - (PatchY << PatchDimLog2);
+        for (Uint32 PatchX = 0; PatchX < m_NumPatchesX; ++PatchX)
+        {
+            const Uint32 StartCol = PatchX << PatchDimLog2;
+            const Uint32 EndCol   = PatchX + 1 < m_NumPatchesX ? StartCol + PatchDim : m_iNumCols;
+            memcpy(pDst + StartCol, GetPatch(PatchX, PatchY) + y * (PatchDim + 1), (EndCol - StartCol) * sizeof(Uint16));
+        }
+    }
+}
+
+ElevationDataSource::ElevationRange ElevationDataSource::GetElevationRange(int StartCol, int StartRow, int EndCol, int EndRow) const
+{
+    VERIFY_EXPR(StartCol <= EndCol && StartRow <= EndRow);
+
+    // Start with an empty range, so that only the cells that extend it are visited
+    ElevationRange Range;
+    Range.Min = m_GlobalMaxElevation;
+    Range.Max = m_GlobalMinElevation;
+    ForEachMirroredRange(StartCol + m_iColOffset, EndCol + m_iColOffset, static_cast<int>(m_iNumCols), [&](int FirstCol, int LastCol) {
+        ForEachMirroredRange(StartRow + m_iRowOffset, EndRow + m_iRowOffset, static_cast<int>(m_iNumRows), [&](int FirstRow, int LastRow) {
+            UpdateElevationRange(m_NumMinMaxLevels - 1, 0, 0, FirstCol, FirstRow, LastCol, LastRow, Range);
+        });
+    });
+    return Range;
+}
+
+ElevationDataSource::ElevationRange ElevationDataSource::GetElevationBounds(int StartCol, int StartRow, int EndCol, int EndRow) const
+{
+    VERIFY_EXPR(StartCol <= EndCol && StartRow <= EndRow);
+
+    ElevationRange Range;
+    Range.Min = m_GlobalMaxElevation;
+    Range.Max = m_GlobalMinElevation;
+    ForEachMirroredRange(StartCol + m_iColOffset, EndCol + m_iColOffset, static_cast<int>(m_iNumCols), [&](int FirstCol, int LastCol) {
+        ForEachMirroredRange(StartRow + m_iRowOffset, EndRow + m_iRowOffset, static_cast<int>(m_iNumRows), [&](int FirstRow, int LastRow) {
+            // The coarsest level at which the region spans at most 8 cells along each side
+            const Uint32 Extent = static_cast<Uint32>(std::max(LastCol - FirstCol, LastRow - FirstRow));
+            Uint32       Level  = 0;
+            while (Level + 1 < m_NumMinMaxLevels && GetMinMaxCellSize(Level) * 8 < Extent)
+                ++Level;
+
+            // Cells share the border samples, so the last sample of the height map is in the last cell
+            const Uint32 CellSize = GetMinMaxCellSize(Level);
+            const Uint32 LastCell = GetMinMaxLevelDim(Level) - 1;
+            for (Uint32 CellY = std::min(FirstRow / CellSize, LastCell); CellY <= std::min(LastRow / CellSize, LastCell); ++CellY)
+            {
+                for (Uint32 CellX = std::min(FirstCol / CellSize, LastCell); CellX <= std::min(LastCol / CellSize, LastCell); ++CellX)
+                {
+                    const ElevationRange Cell = GetMinMaxCell(Level, CellX, CellY);
+
+                    Range.Min = std::min(Range.Min, Cell.Min);
+                    Range.Max = std::max(Range.Max, Cell.Max);
+                }
+            }
+        });
+    });
+    return Range;
+}
+
+void ElevationDataSource::UpdateElevationRange(Uint32 Level, Uint32 CellX, Uint32 CellY, Uint32 FirstCol, Uint32 FirstRow, Uint32 LastCol, Uint32 LastRow, ElevationRange& Range) const
+{
+    const ElevationRange Cell = GetMinMaxCell(Level, CellX, CellY);
+    if (Cell.Min >= Range.Min && Cell.Max <= Range.Max)
+        return;
+
+    const Uint32 CellSize     = GetMinMaxCellSize(Level);
+    const Uint32 CellFirstCol = CellX * CellSize;
+    const Uint32 CellFirstRow = CellY * CellSize;
+    const Uint32 CellLastCol  = CellFirstCol + CellSize;
+    const Uint32 CellLastRow  = CellFirstRow + CellSize;
+    if (CellLastCol < FirstCol || CellFirstCol > LastCol || CellLastRow < FirstRow || CellFirstRow > LastRow)
+        return;
+
+    if (CellFirstCol >= FirstCol && CellLastCol <= LastCol && CellFirstRow >= FirstRow && CellLastRow <= LastRow)
+    {
+        Range.Min = std::min(Range.Min, Cell.Min);
+        Range.Max = std::max(Range.Max, Cell.Max);
+        return;
+    }
+
+    if (Level == 0)
+    {
+        for (Uint32 Row = std::max(FirstRow, CellFirstRow); Row <= std::min(LastRow, CellLastRow); ++Row)
+        {
+            for (Uint32 Col = std::max(FirstCol, CellFirstCol); Col <= std::min(LastCol, CellLastCol); ++Col)
+            {
+                const Uint16 Elev = GetElevSample(Col, Row);
+
+                Range.Min = std::min(Range.Min, Elev);
+                Range.Max = std::max(Range.Max, Elev);
+            }
+        }
+        return;
+    }
+
+    for (Uint32 Child = 0; Child < 4; ++Child)
+        UpdateElevationRange(Level - 1, CellX * 2 + (Child & 0x01), CellY * 2 + (Child >> 1), FirstCol, FirstRow, LastCol, LastRow, Range);
+}
+
+// Ray in the height map space: x and z are the column and the row, y is the height in height map units
+struct ElevationDataSource::RaySegment
+{
+    double3 Origin;
+    double3 Dir;
+
+    double3 At(double t) const { return Origin + Dir * t; }
+};
+
+bool ElevationDataSource::IntersectRay(const float3& f3Origin, const float3& f3Dir, float fSampleSpacing, float fHeightScale, float fMaxDist, float& fDist) const
+{
+    VERIFY_EXPR(fSampleSpacing > 0 && fHeightScale > 0 && std::isfinite(fMaxDist));
+
+    // The origin and the direction are scaled the same way, so the distance along the ray is preserved
+    RaySegment Ray;
+    Ray.Origin = double3{f3Origin.x / static_cast<double>(fSampleSpacing), f3Origin.y / static_cast<double>(fHeightScale), f3Origin.z / static_cast<double>(fSampleSpacing)};
+    Ray.Dir    = double3{f3Dir.x / static_cast<double>(fSampleSpacing), f3Dir.y / static_cast<double>(fHeightScale), f3Dir.z / static_cast<double>(fSampleSpacing)};
+
+    // The surface is never above the global maximum elevation
+    const double MaxElev = m_GlobalMaxElevation;
+
+    double t0 = 0;
+    double t1 = fMaxDist;
+    if (Ray.Dir.y < 0)
+        t0 = std::max(t0, (MaxElev - Ray.Origin.y) / Ray.Dir.y);
+    else if (Ray.Dir.y > 0)
+        t1 = std::min(t1, (MaxElev - Ray.Origin.y) / Ray.Dir.y);
+    else if (Ray.Origin.y > MaxElev)
+        return false;
+
+    double tHit = 0;
+    if (t0 > t1 || !IntersectRaySegment(Ray, t0, t1, tHit))
+        return false;
+
+    fDist = static_cast<float>(tHit);
+    return true;
+}
+
+bool ElevationDataSource::IntersectRaySegment(const RaySegment& Ray, double t0, double t1, double& tHit) const
+{
+    const double3 Start = Ray.At(t0);
+    const double3 End   = Ray.At(t1);
+
+    // Samples that the interpolated surface under the segment depends on
+    const int StartCol = static_cast<int>(std::floor(std::min(Start.x, End.x)));
+    const int StartRow = static_cast<int>(std::floor(std::min(Start.z, End.z)));
+    const int EndCol   = static_cast<int>(std::floor(std::max(Start.x, End.x))) + 1;
+    const int EndRow   = static_cast<int>(std::floor(std::max(Start.z, End.z))) + 1;
+
+    const ElevationRange Range = GetElevationRange(StartCol, StartRow, EndCol, EndRow);
+    if (std::min(Start.y, End.y) > Range.Max)
+        return false;
+
+    if (std::max(Start.y, End.y) < Range.Min)
+    {
+        // Segments are traversed front to back, so the ray goes under the surface at the start of the segment
+        tHit = t0;
+        return true;
+    }
+
+    if (EndCol - StartCol <= 2 && EndRow - StartRow <= 2)
+    {
+        // The segment crosses at most 2x2 quads
+        bool bHit = false;
+        tHit      = t1;
+        for (int iRow = StartRow; iRow < EndRow; ++iRow)
+        {
+            for (int iCol = StartCol; iCol < EndCol; ++iCol)
+            {
+                double tQuadHit = 0;
+                if (IntersectRayQuad(Ray, iCol, iRow, t0, tHit, tQuadHit))
+                {
+                    tHit = tQuadHit;
+                    bHit = true;
+                }
+            }
+        }
+        return bHit;
+    }
+
+    const double tMid = (t0 + t1) * 0.5;
+    return IntersectRaySegment(Ray, t0, tMid, tHit) || IntersectRaySegment(Ray, tMid, t1, tHit);
+}
+
+bool ElevationDataSource::IntersectRayQuad(const RaySegment& Ray, int iCol, int iRow, double t0, double t1, double& tHit) const
+{
+    // Clip the segment to the quad
+    auto ClipToSlab = [&t0, &t1](double Origin, double Dir, double Min) {
+        if (Dir == 0)
+            return Origin >= Min && Origin <= Min + 1;
+
+        double tA = (Min - Origin) / Dir;
+        double tB = (Min + 1 - Origin) / Dir;
+        if (tA > tB)
+            std::swap(tA, tB);
+        t0 = std::max(t0, tA);
+        t1 = std::min(t1, tB);
+        return t0 <= t1;
+    };
+    if (!ClipToSlab(Ray.Origin.x, Ray.Dir.x, iCol) || !ClipToSlab(Ray.Origin.z, Ray.Dir.z, iRow))
+        return false;
+
+    // Same samples as in GetInterpolatedHeight()
+    const int iCol0 = MirrorCoord(iCol + m_iColOffset, m_iNumCols);
+    const int iCol1 = MirrorCoord(iCol + 1 + m_iColOffset, m_iNumCols);
+    const int iRow0 = MirrorCoord(iRow + m_iRowOffset, m_iNumRows);
+    const int iRow1 = MirrorCoord(iRow + 1 + m_iRowOffset, m_iNumRows);
+
+    const double H00 = GetElevSample(iCol0, iRow0);
+    const double H10 = GetElevSample(iCol1, iRow0);
+    const double H01 = GetElevSample(iCol0, iRow1);
+    const double H11 = GetElevSample(iCol1, iRow1);
+
+    // Height of the bilinear surface above the ray is a quadratic function of the distance s from the clipped
+    // segment start: A * s^2 + B * s + C, where u = U0 + Ray.Dir.x * s and v = V0 + Ray.Dir.z * s
+    const double3 Start = Ray.At(t0);
+    const double  U0    = Start.x - iCol;
+    const double  V0    = Start.z - iRow;
+    const double  dHdU  = H10 - H00;
+    const double  dHdV  = H01 - H00;
+    const double  dHdUV = H00 - H10 - H01 + H11;
+
+    const double A = dHdUV * Ray.Dir.x * Ray.Dir.z;
+    const double B = dHdU * Ray.Dir.x + dHdV * Ray.Dir.z + dHdUV * (U0 * Ray.Dir.z + V0 * Ray.Dir.x) - Ray.Dir.y;
+    const double C = H00 + dHdU * U0 + dHdV * V0 + dHdUV * U0 * V0 - Start.y;
+    if (C >= 0)
+    {
+        // The segment starts under the surface
+        tHit = t0;
+        return true;
+    }
+
+    double Roots[2] = {};
+    int    NumRoots = 0;
+    if (A == 0)
+    {
+        if (B != 0)
+            Roots[NumRoots++] = -C / B;
+    }
+    else
+    {
+        const double D = B * B - 4 * A * C;
+        if (D >= 0)
+        {
+            // C is not zero, so neither is Q
+            const double Q    = -0.5 * (B >= 0 ? B + std::sqrt(D) : B - std::sqrt(D));
+            Roots[NumRoots++] = Q / A;
+            Roots[NumRoots++] = C / Q;
+        }
+    }
+
+    bool         bHit = false;
+    const double sMax = t1 - t0;
+    double       s    = sMax;
+    for (int i = 0; i < NumRoots; ++i)
+    {
+        if (Roots[i] >= 0 && Roots[i] <= s)
+        {
+            s    = Roots[i];
+            bHit = true;
+        }
+    }
+    if (bHit)
+        tHit = t0 + s;
+    return bHit;
+}
+
+void ElevationDataSource::PrefetchPatches(float fCol, float fRow, float fRadius)
+{
+    // Patches in memory are always resident
+    if (!m_PatchData.empty())
+        return;
+
+    // Coordinates outside of the height map are mirrored the same way GetInterpolatedHeight() does it
+    auto GetPatches = [fRadius](float fCoord, int iOffset, Uint32 NumSamples, Uint32 NumPatches, std::vector<bool>& Patches) {
+        Patches.assign(NumPatches, false);
+        const int iMin = static_cast<int>(std::floor(fCoord - fRadius)) + iOffset;
+        const int iMax = static_cast<int>(std::ceil(fCoord + fRadius)) + iOffset;
+        // Two mirror periods cover every sample
+        const int iEnd = std::min(iMax, iMin + 2 * static_cast<int>(NumSamples));
+        for (int i = iMin;; i = std::min(i + static_cast<int>(PatchDim), iEnd))
+        {
+            const Uint32 Sample = static_cast<Uint32>(MirrorCoord(i, NumSamples));
+            Patches[std::min(Sample >> PatchDimLog2, NumPatches - 1)] = true;
+            if (i == iEnd)
+                break;
+        }
+    };
+
+    std::vector<bool> PatchesX, PatchesY;
+    GetPatches(fCol, m_iColOffset, m_iNumCols, m_NumPatchesX, PatchesX);
+    GetPatches(fRow, m_iRowOffset, m_iNumRows, m_NumPatchesY, PatchesY);
+
+    const size_t PatchSize = m_PatchStride * sizeof(Uint16);
+    for (Uint32 PatchY = 0; PatchY < m_NumPatchesY; ++PatchY)
+    {
+        if (!PatchesY[PatchY])
+            continue;
+
+        for (Uint32 PatchX = 0; PatchX < m_NumPatchesX; ++PatchX)
+        {
+            if (!PatchesX[PatchX])
+                continue;
+
+            const Uint32 Patch = PatchX + PatchY * m_NumPatchesX;
+
+            auto It = m_ResidentPatchIt.find(Patch);
+            if (It != m_ResidentPatchIt.end())
+            {
+                m_ResidentPatches.splice(m_ResidentPatches.begin(), m_ResidentPatches, It->second);
+            }
+            else
+            {
+                m_ResidentPatches.push_front(Patch);
+                m_ResidentPatchIt.emplace(Patch, m_ResidentPatches.begin());
+                m_TiledFile.WillNeed(m_TiledFileDataOffset + Patch * PatchSize, PatchSize);
+            }
+        }
+    }
+
+    while (m_ResidentPatches.size() > m_MaxResidentPatches)
+    {
+        const Uint32 Patch = m_ResidentPatches.back();
+        m_ResidentPatches.pop_back();
+        m_ResidentPatchIt.erase(Patch);
+        m_TiledFile.DontNeed(m_TiledFileDataOffset + Patch * PatchSize, PatchSize);
+    }
 }
 
 } // namespace Diligent
@@ -45,23 +45,35 @@
 
 #pragma once
 
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 #include "BasicTypes.h"
 #include "BasicMath.hpp"
+#include "DebugUtilities.hpp"
+#include "MemoryMappedFile.hpp"
 
 namespace Diligent
 {
 
-// Class implementing elevation data source
+// Class implementing elevation data source.
+// The height map is stored in square patches that share border samples, so that bilinear
+// filtering never needs samples from two patches. On Win32, Linux and MacOS the source image is
+// converted once into a tiled file next to it (<file>.tiles) that is memory-mapped, so that
+// the startup time does not depend on the height map size and patches are paged in on demand.
 class ElevationDataSource
 {
 public:
     // Creates data source from the specified raw data file
     ElevationDataSource(const Char* strSrcDemFile);
+
+    // Creates data source from the height map in memory. The tiled file is not used.
+    ElevationDataSource(const Uint16* pHeights, Uint32 Width, Uint32 Height, size_t Pitch);
     virtual ~ElevationDataSource(void);
 
-    void GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch);
+    // Copies the height map rows to a linear buffer
+    void ReadRows(Uint32 StartRow, Uint32 NumRows, Uint16* pDst, size_t DstPitch) const;
 
     // Returns minimal height of the whole terrain
     Uint16 GetGlobalMinElevation() const;
@@ -85,27 +97,109 @@ public:
 
     float3 ComputeSurfaceNormal(float fCol, float fRow, float fSampleSpacing, float fHeightScale, int iStep = 1) const;
 
+    // Batched version of GetInterpolatedHeight() for Count points given by the column and row arrays.
+    // The results are the same as from the scalar method.
+    void GetInterpolatedHeights(const float* pCols, const float* pRows, float* pHeights, size_t Count, int iStep = 1) const;
+
+    // Min/max elevation of a height map region, in height map units
+    struct ElevationRange
+    {
+        Uint16 Min = 0;
+        Uint16 Max = 0;
+    };
+
+    // Returns the elevation range of the samples [StartCol, EndCol] x [StartRow, EndRow] addressed the same
+    // way as in GetInterpolatedHeight(). The interpolated surface between the samples is within this range too.
+    // The cost depends on the region perimeter rather than its area.
+    ElevationRange GetElevationRange(int StartCol, int StartRow, int EndCol, int EndRow) const;
+
+    // Same as GetElevationRange(), but returns the range of the pyramid cells that overlap the region, choosing
+    // the level at which the region spans at most a few cells. The result contains the exact range and is
+    // computed in constant time, which is what culling needs.
+    ElevationRange GetElevationBounds(int StartCol, int StartRow, int EndCol, int EndRow) const;
+
+    // Finds the first intersection of the ray with the interpolated terrain surface within fMaxDist.
+    // The ray is given in the space where x and z are the column and the row multiplied by fSampleSpacing,
+    // and y is the height multiplied by fHeightScale. The distance is measured in units of the direction length.
+    // Returns false if there is no intersection.
+    bool IntersectRay(const float3& f3Origin, const float3& f3Dir, float fSampleSpacing, float fHeightScale, float fMaxDist, float& fDist) const;
+
+    // Min/max pyramid. Cells of level 0 span GetMinMaxCellSize(0) quads along each side, every next level
+    // doubles the cell size, and the last level is a single cell that covers the whole height map.
+    // Cells are addressed in height map samples, without the offsets.
+    Uint32 GetNumMinMaxLevels() const { return m_NumMinMaxLevels; }
+    Uint32 GetMinMaxCellSize(Uint32 Level) const { return 1u << (m_MinMaxCellSizeLog2 + Level); }
+    Uint32 GetMinMaxLevelDim(Uint32 Level) const { return (m_iNumCols - 1) >> (m_MinMaxCellSizeLog2 + Level); }
+
+    ElevationRange GetMinMaxCell(Uint32 Level, Uint32 CellX, Uint32 CellY) const
+    {
+        VERIFY_EXPR(Level < m_NumMinMaxLevels && CellX < GetMinMaxLevelDim(Level) && CellY < GetMinMaxLevelDim(Level));
+        return m_pMinMaxPyramid[m_MinMaxLevelOffsets[Level] + CellX + size_t{CellY} * GetMinMaxLevelDim(Level)];
+    }
+
+    // Pages in the patches within fRadius samples around the point and marks them as recently used.
+    // Least recently used patches above the residency budget are released.
+    void PrefetchPatches(float fCol, float fRow, float fRadius);
+
     unsigned int GetNumCols() const { return m_iNumCols; }
     unsigned int GetNumRows() const { return m_iNumRows; }
 
+    // Patch dimension without the border samples shared with the next patch
+    static constexpr Uint32 PatchDimLog2 = 8;
+    static constexpr Uint32 PatchDim     = 1u << PatchDimLog2;
+
+    // Maximum size of the min/max pyramid cells of level 0, in quads
+    static constexpr Uint32 MinMaxCellSizeLog2 = 3;
+
 private:
-    inline Uint16  GetElevSample(Int32 i, Int32 j) const;
-    inline Uint16& GetElevSample(Int32 i, Int32 j);
+    inline Uint16 GetElevSample(Int32 i, Int32 j) const;
+
+    void ConvertSourceImage(const Char* strSrcDemFile);
+    void CreatePatches(const Uint8* pSrcImgData, Uint32 Width, Uint32 Height, size_t RowStride);
+    bool WriteTiledFile(const String& Path, Uint64 SrcFileSize, Int64 SrcFileTime) const;
+    bool MapTiledFile(const String& Path, Uint64 SrcFileSize, Int64 SrcFileTime);
+
+    size_t InitMinMaxPyramidLayout();
+    void   BuildMinMaxPyramid();
+    void   UpdateElevationRange(Uint32 Level, Uint32 CellX, Uint32 CellY, Uint32 FirstCol, Uint32 FirstRow, Uint32 LastCol, Uint32 LastRow, ElevationRange& Range) const;
+
+    struct RaySegment;
+    bool IntersectRaySegment(const RaySegment& Ray, double t0, double t1, double& tHit) const;
+    bool IntersectRayQuad(const RaySegment& Ray, int iCol, int iRow, double t0, double t1, double& tHit) const;
+
+    const Uint16* GetPatch(Uint32 PatchX, Uint32 PatchY) const { return m_pPatches + (size_t{PatchY} * m_NumPatchesX + PatchX) * m_PatchStride; }
 
     Uint16 m_GlobalMinElevation = 0;
     Uint16 m_GlobalMaxElevation = 0;
 
-    int m_iNumLevels = 0;
-    int m_iPatchSize = 0;
     int m_iColOffset = 0;
     int m_iRowOffset = 0;
 
-    // The whole terrain height map
-    std::vector<Uint16> m_TheHeightMap;
-
     Uint32 m_iNumCols = 0;
     Uint32 m_iNumRows = 0;
-    Uint32 m_iStride  = 0;
+
+    // Height map patches: (PatchDim + 1) x (PatchDim + 1) samples each, m_PatchStride samples apart
+    Uint32        m_NumPatchesX = 0;
+    Uint32        m_NumPatchesY = 0;
+    size_t        m_PatchStride = 0;
+    const Uint16* m_pPatches    = nullptr;
+
+    // Min/max pyramid levels are stored one after another, starting from the finest one
+    Uint32                m_MinMaxCellSizeLog2 = 0;
+    Uint32                m_NumMinMaxLevels    = 0;
+    std::vector<size_t>   m_MinMaxLevelOffsets;
+    const ElevationRange* m_pMinMaxPyramid = nullptr;
+
+    // Either the patches and the pyramid are in the mapped tiled file, or in memory if the file can't be used
+    MemoryMappedFile            m_TiledFile;
+    size_t                      m_TiledFileDataOffset = 0;
+    std::vector<Uint16>         m_PatchData;
+    std::vector<ElevationRange> m_MinMaxData;
+
+    // Most recently used patches are at the front
+    std::list<Uint32>                                       m_ResidentPatches;
+    std::unordered_map<Uint32, std::list<Uint32>::iterator> m_ResidentPatchIt;
+    size_t                                                  m_MaxResidentPatches = 0;
 };
 
 } // namespace Diligent
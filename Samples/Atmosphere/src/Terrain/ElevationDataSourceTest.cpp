@@ -0,0 +1,436 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Headless test of the elevation data source queries. Builds the data source over a synthetic height map
+// in memory and checks the min/max pyramid, the region range queries and the ray intersection against
+// brute force, using the mirrored addressing and non-zero offsets, and checks that the batched height
+// interpolation returns the same bits as the scalar one.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ElevationDataSource.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+constexpr float SamplingStep = 32.f;
+constexpr float HeightScale  = 0.1f;
+constexpr int   ColOffset    = 137;
+constexpr int   RowOffset    = -45;
+
+// Smooth hills with high frequency detail and a pseudo-random component
+std::vector<Uint16> CreateHeightMap(Uint32 Dim)
+{
+    std::vector<Uint16> HeightMap(size_t{Dim} * Dim);
+    for (Uint32 Row = 0; Row < Dim; ++Row)
+    {
+        for (Uint32 Col = 0; Col < Dim; ++Col)
+        {
+            const double x = static_cast<double>(Col);
+            const double y = static_cast<double>(Row);
+
+            const double Height = 20000.0 + 12000.0 * std::sin(x * 0.013) * std::cos(y * 0.017) + 5000.0 * std::sin(x * 0.11 + y * 0.07) + (Col * 7919u + Row * 104729u) % 1500u;
+            HeightMap[Col + Row * size_t{Dim}] = static_cast<Uint16>(Height);
+        }
+    }
+    return HeightMap;
+}
+
+int MirrorCoord(int Coord, int Dim)
+{
+    Coord            = std::abs(Coord);
+    const int Period = Coord / Dim;
+    Coord %= Dim;
+    return (Period & 0x01) ? Dim - 1 - Coord : Coord;
+}
+
+class Reference
+{
+public:
+    Reference(const std::vector<Uint16>& HeightMap, int Dim) :
+        m_HeightMap{HeightMap},
+        m_Dim{Dim}
+    {}
+
+    // Sample at the given coordinates without the offsets, same addressing as ElevationDataSource
+    Uint16 GetSample(int Col, int Row) const
+    {
+        return m_HeightMap[MirrorCoord(Col + ColOffset, m_Dim) + MirrorCoord(Row + RowOffset, m_Dim) * size_t{static_cast<Uint32>(m_Dim)}];
+    }
+
+    ElevationDataSource::ElevationRange GetRange(int StartCol, int StartRow, int EndCol, int EndRow) const
+    {
+        ElevationDataSource::ElevationRange Range;
+        Range.Min = 0xFFFF;
+        Range.Max = 0;
+        for (int Row = StartRow; Row <= EndRow; ++Row)
+        {
+            for (int Col = StartCol; Col <= EndCol; ++Col)
+            {
+                const Uint16 Elev = GetSample(Col, Row);
+
+                Range.Min = std::min(Range.Min, Elev);
+                Range.Max = std::max(Range.Max, Elev);
+            }
+        }
+        return Range;
+    }
+
+private:
+    const std::vector<Uint16>& m_HeightMap;
+    const int                  m_Dim;
+};
+
+// Marches the ray in steps much smaller than a quad and refines the first step that ends below the surface
+bool MarchRay(const ElevationDataSource& DataSource, const float3& Origin, const float3& Dir, float MaxDist, double& Dist)
+{
+    auto IsBelowSurface = [&](double t) {
+        const double Col    = (Origin.x + Dir.x * t) / SamplingStep;
+        const double Row    = (Origin.z + Dir.z * t) / SamplingStep;
+        const double Height = (Origin.y + Dir.y * t) / HeightScale;
+        return Height <= DataSource.GetInterpolatedHeight(static_cast<float>(Col), static_cast<float>(Row));
+    };
+
+    if (IsBelowSurface(0))
+    {
+        Dist = 0;
+        return true;
+    }
+
+    const double HorzLen = std::sqrt(static_cast<double>(Dir.x) * Dir.x + static_cast<double>(Dir.z) * Dir.z);
+    const double Step    = std::min(0.02 * SamplingStep / std::max(HorzLen, 1e-6), 0.5 * HeightScale / std::max(std::abs(static_cast<double>(Dir.y)), 1e-6));
+    for (double t0 = 0; t0 < MaxDist; t0 += Step)
+    {
+        const double t1 = std::min(t0 + Step, static_cast<double>(MaxDist));
+        if (IsBelowSurface(t1))
+        {
+            double a = t0, b = t1;
+            for (int i = 0; i < 40; ++i)
+            {
+                const double m = (a + b) * 0.5;
+                (IsBelowSurface(m) ? b : a) = m;
+            }
+            Dist = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TestPyramid(const ElevationDataSource& DataSource, const std::vector<Uint16>& HeightMap, Uint32 Dim)
+{
+    Uint32 NumMismatches = 0;
+    for (Uint32 Level = 0; Level < DataSource.GetNumMinMaxLevels(); ++Level)
+    {
+        const Uint32 LevelDim = DataSource.GetMinMaxLevelDim(Level);
+        const Uint32 CellSize = DataSource.GetMinMaxCellSize(Level);
+        const Uint32 CellStep = std::max(LevelDim / 7, 1u);
+        for (Uint32 CellY = 0; CellY < LevelDim; CellY += CellStep)
+        {
+            for (Uint32 CellX = 0; CellX < LevelDim; CellX += CellStep)
+            {
+                // Cells include the samples on their far borders
+                Uint16 Min = 0xFFFF, Max = 0;
+                for (Uint32 Row = CellY * CellSize; Row <= (CellY + 1) * CellSize; ++Row)
+                {
+                    for (Uint32 Col = CellX * CellSize; Col <= (CellX + 1) * CellSize; ++Col)
+                    {
+                        Min = std::min(Min, HeightMap[Col + Row * size_t{Dim}]);
+                        Max = std::max(Max, HeightMap[Col + Row * size_t{Dim}]);
+                    }
+                }
+
+                const auto Cell = DataSource.GetMinMaxCell(Level, CellX, CellY);
+                if (Cell.Min != Min || Cell.Max != Max)
+                {
+                    if (NumMismatches++ < 5)
+                        std::printf("FAILED: pyramid cell (%u, %u, %u) is [%u, %u], expected [%u, %u]\n", Level, CellX, CellY, Cell.Min, Cell.Max, Min, Max);
+                }
+            }
+        }
+    }
+
+    // ReadRows() must return the source rows
+    std::vector<Uint16> Rows(size_t{Dim} * 3);
+    for (Uint32 Row = 0; Row + 3 <= Dim; Row += Dim / 5)
+    {
+        DataSource.ReadRows(Row, 3, Rows.data(), Dim);
+        if (!std::equal(Rows.begin(), Rows.end(), HeightMap.begin() + Row * size_t{Dim}))
+        {
+            std::printf("FAILED: rows %u-%u differ from the source\n", Row, Row + 2);
+            ++NumMismatches;
+        }
+    }
+    return NumMismatches == 0;
+}
+
+bool TestRanges(const ElevationDataSource& DataSource, const Reference& Ref, int Dim)
+{
+    std::mt19937                       Rng{1};
+    std::uniform_int_distribution<int> Pos{-3 * Dim, 3 * Dim};
+    std::uniform_int_distribution<int> Size{0, Dim / 2};
+
+    constexpr int NumQueries      = 300;
+    Uint32        NumMismatches   = 0;
+    double        ExactTimeUs     = 0;
+    double        BoundsTimeUs    = 0;
+    double        BoundsLooseness = 0;
+    for (int i = 0; i < NumQueries; ++i)
+    {
+        // Regions within one copy of the height map, across the mirrored copies and larger than two copies
+        const int StartCol = Pos(Rng);
+        const int StartRow = Pos(Rng);
+        const int EndCol   = StartCol + (i % 10 == 0 ? Size(Rng) * 6 : Size(Rng) / (1 + i % 5));
+        const int EndRow   = StartRow + Size(Rng) / (1 + i % 3);
+
+        const auto Expected = Ref.GetRange(StartCol, StartRow, EndCol, EndRow);
+
+        const auto ExactStart = std::chrono::high_resolution_clock::now();
+        const auto Range      = DataSource.GetElevationRange(StartCol, StartRow, EndCol, EndRow);
+        const auto ExactEnd   = std::chrono::high_resolution_clock::now();
+        const auto Bounds     = DataSource.GetElevationBounds(StartCol, StartRow, EndCol, EndRow);
+        const auto BoundsEnd  = std::chrono::high_resolution_clock::now();
+        ExactTimeUs += std::chrono::duration<double, std::micro>(ExactEnd - ExactStart).count();
+        BoundsTimeUs += std::chrono::duration<double, std::micro>(BoundsEnd - ExactEnd).count();
+
+        if (Range.Min != Expected.Min || Range.Max != Expected.Max)
+        {
+            if (NumMismatches++ < 5)
+                std::printf("FAILED: range of [%d, %d] x [%d, %d] is [%u, %u], expected [%u, %u]\n", StartCol, EndCol, StartRow, EndRow, Range.Min, Range.Max, Expected.Min, Expected.Max);
+        }
+        if (Bounds.Min > Expected.Min || Bounds.Max < Expected.Max)
+        {
+            if (NumMismatches++ < 5)
+                std::printf("FAILED: bounds of [%d, %d] x [%d, %d] are [%u, %u], which does not contain [%u, %u]\n", StartCol, EndCol, StartRow, EndRow, Bounds.Min, Bounds.Max, Expected.Min, Expected.Max);
+        }
+        BoundsLooseness += static_cast<double>(Bounds.Max - Bounds.Min) / std::max(Expected.Max - Expected.Min, 1);
+    }
+    std::printf("    %d queries: exact range %.2f us, bounds %.2f us and %.2fx wider on average\n", NumQueries, ExactTimeUs / NumQueries, BoundsTimeUs / NumQueries, BoundsLooseness / NumQueries);
+    return NumMismatches == 0;
+}
+
+// GetInterpolatedHeights() must match GetInterpolatedHeight() exactly for every point, whichever path computes it
+bool TestBatchHeights(ElevationDataSource& DataSource, int Dim)
+{
+    std::mt19937                          Rng{3};
+    std::uniform_real_distribution<float> Coord{-3.f * static_cast<float>(Dim), 3.f * static_cast<float>(Dim)};
+    std::uniform_int_distribution<int>    IntCoord{-3 * Dim, 3 * Dim};
+    std::uniform_int_distribution<int>    Period{-6, 6};
+    std::uniform_int_distribution<int>    Boundary{-2, 2};
+
+    int OrigColOffset = 0, OrigRowOffset = 0;
+    DataSource.GetOffsets(OrigColOffset, OrigRowOffset);
+
+    const int Offsets[][2] = {{0, 0}, {ColOffset, RowOffset}, {-5 * Dim + 3, 2 * Dim - 1}};
+    const int Steps[]      = {1, 2, 4, 16};
+    // Counts that are not a multiple of the SIMD width run the scalar tail
+    const size_t Counts[] = {0, 1, 3, 4, 5, 7, 8, 33, 1001};
+
+    std::vector<float> Cols, Rows, Heights;
+    Uint32             NumMismatches = 0;
+    size_t             NumPoints     = 0;
+    for (const auto& Offset : Offsets)
+    {
+        DataSource.SetOffsets(Offset[0], Offset[1]);
+        for (int Step : Steps)
+        {
+            for (size_t Count : Counts)
+            {
+                Cols.resize(Count);
+                Rows.resize(Count);
+                for (size_t i = 0; i < Count; ++i)
+                {
+                    // Fractional coordinates, exact integers that may be multiples of the step, negative values
+                    // just below an integer, where floor() and truncation differ, and samples around the mirror
+                    // boundaries of the height map copies
+                    switch (i % 5)
+                    {
+                        case 0:
+                        case 1:
+                            Cols[i] = Coord(Rng);
+                            Rows[i] = Coord(Rng);
+                            break;
+
+                        case 2:
+                            Cols[i] = static_cast<float>(IntCoord(Rng) * (i % 10 == 2 ? Step : 1));
+                            Rows[i] = static_cast<float>(IntCoord(Rng));
+                            break;
+
+                        case 3:
+                            Cols[i] = static_cast<float>(-std::abs(IntCoord(Rng))) - 0.001f;
+                            Rows[i] = static_cast<float>(-std::abs(IntCoord(Rng))) - 0.5f;
+                            break;
+
+                        default:
+                            Cols[i] = static_cast<float>(Period(Rng) * Dim + Boundary(Rng) - Offset[0]);
+                            Rows[i] = static_cast<float>(Period(Rng) * Dim + Boundary(Rng) - Offset[1]);
+                            break;
+                    }
+                }
+
+                // Guard values after the end must not be overwritten
+                Heights.assign(Count + 4, -1.f);
+                DataSource.GetInterpolatedHeights(Cols.data(), Rows.data(), Heights.data(), Count, Step);
+                for (size_t i = 0; i < Count; ++i)
+                {
+                    const float Expected = DataSource.GetInterpolatedHeight(Cols[i], Rows[i], Step);
+                    if (std::memcmp(&Heights[i], &Expected, sizeof(float)) != 0)
+                    {
+                        if (NumMismatches++ < 5)
+                        {
+                            std::printf("FAILED: height at (%f, %f), step %d, offsets (%d, %d) is %f, expected %f\n",
+                                        Cols[i], Rows[i], Step, Offset[0], Offset[1], Heights[i], Expected);
+                        }
+                    }
+                }
+                if (std::any_of(Heights.begin() + Count, Heights.end(), [](float h) { return h != -1.f; }))
+                {
+                    std::printf("FAILED: %u heights were requested, more were written\n", static_cast<Uint32>(Count));
+                    ++NumMismatches;
+                }
+                NumPoints += Count;
+            }
+        }
+    }
+    DataSource.SetOffsets(OrigColOffset, OrigRowOffset);
+
+    std::printf("    %u points, %u mismatches\n", static_cast<Uint32>(NumPoints), NumMismatches);
+    return NumMismatches == 0;
+}
+
+bool TestRays(const ElevationDataSource& DataSource, int Dim)
+{
+    std::mt19937                          Rng{2};
+    std::uniform_real_distribution<float> U{-1, 1};
+
+    constexpr int   NumRays = 400;
+    constexpr float MaxDist = 200000;
+
+    Uint32 NumHits = 0, NumFailures = 0;
+    double MaxDistError = 0, RayTimeUs = 0;
+    for (int i = 0; i < NumRays; ++i)
+    {
+        const float  Extent = static_cast<float>(Dim) * SamplingStep * 2.f;
+        const float3 Origin{U(Rng) * Extent, 1000.f + (U(Rng) + 1.f) * 4000.f, U(Rng) * Extent};
+
+        // Mostly descending rays, some grazing, vertical and ascending ones
+        float3 Dir{U(Rng), -std::abs(U(Rng)) * (i % 4 == 0 ? 0.02f : 0.3f), U(Rng)};
+        if (i % 17 == 0)
+            Dir = float3{0, -1, 0};
+        if (i % 23 == 0)
+            Dir.y = 0.05f;
+        Dir = normalize(Dir);
+
+        float      Dist     = 0;
+        const auto RayStart = std::chrono::high_resolution_clock::now();
+        const bool IsHit    = DataSource.IntersectRay(Origin, Dir, SamplingStep, HeightScale, MaxDist, Dist);
+        const auto RayEnd   = std::chrono::high_resolution_clock::now();
+        RayTimeUs += std::chrono::duration<double, std::micro>(RayEnd - RayStart).count();
+
+        double     RefDist  = 0;
+        const bool IsRefHit = MarchRay(DataSource, Origin, Dir, MaxDist, RefDist);
+        if (IsHit && IsRefHit && std::abs(Dist - RefDist) <= 0.5)
+        {
+            MaxDistError = std::max(MaxDistError, std::abs(Dist - RefDist));
+        }
+        else if (IsHit && (!IsRefHit || Dist < RefDist))
+        {
+            // The march may step over a thin feature, so the hit can be earlier, but it must be on the surface
+            const float Col   = (Origin.x + Dir.x * Dist) / SamplingStep;
+            const float Row   = (Origin.z + Dir.z * Dist) / SamplingStep;
+            const float Error = std::abs((Origin.y + Dir.y * Dist) / HeightScale - DataSource.GetInterpolatedHeight(Col, Row));
+            if (Error > 0.05f)
+            {
+                std::printf("FAILED: ray %d hit at %.3f is %.3f units off the surface\n", i, Dist, Error);
+                ++NumFailures;
+            }
+        }
+        else if (IsHit)
+        {
+            std::printf("FAILED: ray %d hits at %.3f, the first hit is at %.3f\n", i, Dist, RefDist);
+            ++NumFailures;
+        }
+        else if (IsRefHit)
+        {
+            std::printf("FAILED: ray %d misses the surface, which it hits at %.3f\n", i, RefDist);
+            ++NumFailures;
+        }
+        NumHits += IsHit ? 1 : 0;
+    }
+    std::printf("    %d rays, %u hits: max distance error %.4f m, %.1f us per ray\n", NumRays, NumHits, MaxDistError, RayTimeUs / NumRays);
+    return NumFailures == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Uint32 Dim = argc > 1 ? static_cast<Uint32>(std::atoi(argv[1])) : 2049;
+    if (Dim < 3 || ((Dim - 1) & (Dim - 2)) != 0)
+    {
+        std::printf("Height map dimension must be 2^n+1\n");
+        return 1;
+    }
+
+    const auto HeightMap = CreateHeightMap(Dim);
+
+    ElevationDataSource DataSource{HeightMap.data(), Dim, Dim, Dim};
+    DataSource.SetOffsets(ColOffset, RowOffset);
+    std::printf("Height map %ux%u, %u pyramid levels, level 0 cells of %u quads\n", Dim, Dim, DataSource.GetNumMinMaxLevels(), DataSource.GetMinMaxCellSize(0));
+
+    const Reference Ref{HeightMap, static_cast<int>(Dim)};
+
+    bool Passed = true;
+
+    const bool PyramidPassed = TestPyramid(DataSource, HeightMap, Dim);
+    std::printf("Pyramid cells and rows: %s\n", PyramidPassed ? "passed" : "FAILED");
+    Passed = PyramidPassed && Passed;
+
+    const bool RangesPassed = TestRanges(DataSource, Ref, static_cast<int>(Dim));
+    std::printf("Region ranges and bounds: %s\n", RangesPassed ? "passed" : "FAILED");
+    Passed = RangesPassed && Passed;
+
+    const bool RaysPassed = TestRays(DataSource, static_cast<int>(Dim));
+    std::printf("Ray intersections: %s\n", RaysPassed ? "passed" : "FAILED");
+    Passed = RaysPassed && Passed;
+
+    const bool BatchPassed = TestBatchHeights(DataSource, static_cast<int>(Dim));
+    std::printf("Batched height interpolation: %s\n", BatchPassed ? "passed" : "FAILED");
+    Passed = BatchPassed && Passed;
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "MemoryMappedFile.hpp"
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#elif PLATFORM_LINUX || PLATFORM_MACOS
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Diligent
+{
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+#if PLATFORM_WIN32
+
+bool MemoryMappedFile::Open(const Char* Path)
+{
+    Close();
+
+    HANDLE hFile = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+    m_hFile = hFile;
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    m_hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_hMapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<const Uint8*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pData == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_Size = static_cast<size_t>(FileSize.QuadPart);
+
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if (m_pData != nullptr)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping != nullptr)
+        CloseHandle(m_hMapping);
+    if (m_hFile != nullptr)
+        CloseHandle(m_hFile);
+
+    m_pData    = nullptr;
+    m_Size     = 0;
+    m_hMapping = nullptr;
+    m_hFile    = nullptr;
+}
+
+void MemoryMappedFile::WillNeed(size_t Offset, size_t Size) const
+{
+    // Pages are faulted in on the first access.
+}
+
+void MemoryMappedFile::DontNeed(size_t Offset, size_t Size) const
+{
+    if (m_pData == nullptr || Offset >= m_Size)
+        return;
+
+    // Unlocking pages that are not locked removes them from the working set.
+    VirtualUnlock(const_cast<Uint8*>(m_pData) + Offset, std::min(Size, m_Size - Offset));
+}
+
+#elif PLATFORM_LINUX || PLATFORM_MACOS
+
+bool MemoryMappedFile::Open(const Char* Path)
+{
+    Close();
+
+    const int fd = open(Path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat FileStat = {};
+    if (fstat(fd, &FileStat) != 0 || FileStat.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* pData = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced.
+    close(fd);
+    if (pData == MAP_FAILED)
+        return false;
+
+    m_pData = static_cast<const Uint8*>(pData);
+    m_Size  = static_cast<size_t>(FileStat.st_size);
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if (m_pData != nullptr)
+        munmap(const_cast<Uint8*>(m_pData), m_Size);
+
+    m_pData = nullptr;
+    m_Size  = 0;
+}
+
+static void AdviseRange(const Uint8* pData, size_t DataSize, size_t Offset, size_t Size, int Advice)
+{
+    if (pData == nullptr || Offset >= DataSize)
+        return;
+
+    // The range must start at a page boundary
+    const size_t PageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t Start    = Offset / PageSize * PageSize;
+    const size_t End      = Offset + std::min(Size, DataSize - Offset);
+    madvise(const_cast<Uint8*>(pData) + Start, End - Start, Advice);
+}
+
+void MemoryMappedFile::WillNeed(size_t Offset, size_t Size) const
+{
+    AdviseRange(m_pData, m_Size, Offset, Size, MADV_WILLNEED);
+}
+
+void MemoryMappedFile::DontNeed(size_t Offset, size_t Size) const
+{
+    // File-backed pages are clean, so they are simply dropped.
+    AdviseRange(m_pData, m_Size, Offset, Size, MADV_DONTNEED);
+}
+
+#else
+
+bool MemoryMappedFile::Open(const Char* Path)
+{
+    return false;
+}
+
+void MemoryMappedFile::Close()
+{
+}
+
+void MemoryMappedFile::WillNeed(size_t Offset, size_t Size) const
+{
+}
+
+void MemoryMappedFile::DontNeed(size_t Offset, size_t Size) const
+{
+}
+
+#endif
+
+} // namespace Diligent
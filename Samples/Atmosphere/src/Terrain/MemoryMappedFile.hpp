@@ -0,0 +1,70 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Read-only memory-mapped file.
+// Memory mapping is only supported on Win32, Linux and MacOS; on other platforms Open() always fails.
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() {}
+    ~MemoryMappedFile();
+
+    // clang-format off
+    MemoryMappedFile           (const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+    // clang-format on
+
+    // Maps the whole file. The path must use native slashes.
+    bool Open(const Char* Path);
+    void Close();
+
+    const Uint8* GetData() const { return m_pData; }
+    size_t       GetSize() const { return m_Size; }
+
+    // Hints the OS that the range will be accessed soon.
+    void WillNeed(size_t Offset, size_t Size) const;
+
+    // Hints the OS that the range is not needed anymore. The pages are read from the file again when accessed.
+    void DontNeed(size_t Offset, size_t Size) const;
+
+private:
+    const Uint8* m_pData = nullptr;
+    size_t       m_Size  = 0;
+
+#if PLATFORM_WIN32
+    void* m_hFile    = nullptr;
+    void* m_hMapping = nullptr;
+#endif
+};
+
+} // namespace Diligent
@@ -0,0 +1,499 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "TerrainQuadTree.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "DebugUtilities.hpp"
+#include "Align.hpp"
+#include "ElevationDataSource.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+int FloorDiv(int a, int b)
+{
+    return (a >= 0 ? a : a - b + 1) / b;
+}
+
+} // namespace
+
+TerrainQuadTree::TerrainQuadTree(const CreateInfo& CI) :
+    // clang-format off
+    m_pDataSource  {CI.pDataSource},
+    m_PatchQuads   {CI.PatchQuads},
+    m_HeightMapDim {static_cast<int>(CI.pDataSource->GetNumCols())},
+    m_CopySize     {m_HeightMapDim - 1},
+    m_fSamplingStep{CI.fSamplingStep},
+    m_fHeightScale {CI.fHeightScale},
+    m_fEarthRadius {CI.fEarthRadius}
+// clang-format on
+{
+    VERIFY(m_pDataSource->GetNumRows() == m_pDataSource->GetNumCols(), "The height map is expected to be square");
+    VERIFY(m_PatchQuads >= 2 && IsPowerOfTwo(m_PatchQuads), "Patch quad count (", m_PatchQuads, ") must be a power of two");
+    VERIFY(m_HeightMapDim > 1 && IsPowerOfTwo(static_cast<Uint32>(m_HeightMapDim - 1)), "Height map dimension (", m_HeightMapDim, ") must be 2^n+1");
+
+    // The root must cover the hemisphere and the copies of the height map on both sides of zero. Its corner is
+    // at minus half of its size, so that the nodes that are not larger than a copy do not cross copy boundaries.
+    m_pDataSource->GetOffsets(m_iColOffset, m_iRowOffset);
+    const int MaxOffset       = std::max(std::abs(m_iColOffset), std::abs(m_iRowOffset));
+    const int RadiusInSamples = static_cast<int>(std::ceil(m_fEarthRadius / m_fSamplingStep));
+    m_NumLevels = 2;
+    while (GetNodeSize(m_NumLevels - 1) / 2 < std::max(MaxOffset + RadiusInSamples, m_CopySize))
+        ++m_NumLevels;
+    m_iRootOrigin = -GetNodeSize(m_NumLevels - 1) / 2;
+
+    ComputeBlockErrors();
+}
+
+void TerrainQuadTree::ComputeBlockErrors()
+{
+    const int Dim = m_HeightMapDim;
+
+    // The height map is read a row at a time, so that there is no linear copy of the whole height map
+    std::vector<Uint16> TopRow(Dim), BottomRow(Dim), CurrRow(Dim);
+    auto ReadRow = [&](int Row, std::vector<Uint16>& Dst) {
+        m_pDataSource->ReadRows(static_cast<Uint32>(Row), 1, Dst.data(), Dst.size());
+    };
+
+    for (Uint32 Level = 0;; ++Level)
+    {
+        const int BlockSize = GetNodeSize(Level);
+        const int NumBlocks = std::max((Dim - 1 + BlockSize - 1) / BlockSize, 1);
+        m_NumBlocks.push_back(NumBlocks);
+        m_BlockErrors.emplace_back(static_cast<size_t>(NumBlocks) * NumBlocks);
+        auto& Errors = m_BlockErrors.back();
+
+        const int Spacing = 1 << Level;
+
+        ReadRow(0, BottomRow);
+        for (int QuadRow = 0; QuadRow < Dim - 1; QuadRow += Spacing)
+        {
+            std::swap(TopRow, BottomRow);
+            ReadRow(QuadRow + Spacing, BottomRow);
+            BlockError* pBlocks = &Errors[static_cast<size_t>(QuadRow / BlockSize) * NumBlocks];
+
+            if (Level == 0)
+            {
+                // The full resolution surface has no error
+                for (int bx = 0; bx < NumBlocks; ++bx)
+                {
+                    const int FirstCol = bx * BlockSize;
+                    const int LastCol  = std::min(FirstCol + BlockSize, Dim - 1);
+
+                    int MaxStepX = 0;
+                    int MaxStepY = 0;
+                    for (int Col = FirstCol; Col < LastCol; ++Col)
+                    {
+                        MaxStepX = std::max(MaxStepX, std::abs(static_cast<int>(TopRow[Col + 1]) - static_cast<int>(TopRow[Col])));
+                        MaxStepX = std::max(MaxStepX, std::abs(static_cast<int>(BottomRow[Col + 1]) - static_cast<int>(BottomRow[Col])));
+                        MaxStepY = std::max(MaxStepY, std::abs(static_cast<int>(BottomRow[Col]) - static_cast<int>(TopRow[Col])));
+                    }
+                    MaxStepY = std::max(MaxStepY, std::abs(static_cast<int>(BottomRow[LastCol]) - static_cast<int>(TopRow[LastCol])));
+
+                    auto& Block       = pBlocks[bx];
+                    Block.fMaxStep[0] = std::max(Block.fMaxStep[0], static_cast<float>(MaxStepX));
+                    Block.fMaxStep[1] = std::max(Block.fMaxStep[1], static_cast<float>(MaxStepY));
+                }
+                continue;
+            }
+
+            // Every sample is compared with the quads that contain it, so that the samples on the block borders
+            // count for both blocks
+            for (int y = 0; y <= Spacing; ++y)
+            {
+                const Uint16* pRow = TopRow.data();
+                if (y == Spacing)
+                    pRow = BottomRow.data();
+                else if (y > 0)
+                {
+                    ReadRow(QuadRow + y, CurrRow);
+                    pRow = CurrRow.data();
+                }
+
+                // The quads of the patch mesh are split along the diagonal from (0,0) to (1,1), see CreatePatchMesh(),
+                // which is the other diagonal of the block in the copies that are mirrored in one direction.
+                // Along the row, both triangulations are linear on each side of the diagonal. The heights are
+                // scaled by the vertex spacing to keep the math in integers.
+                for (int bx = 0; bx < NumBlocks; ++bx)
+                {
+                    int       MaxDeviation[2] = {};
+                    const int EndCol          = std::min((bx + 1) * BlockSize, Dim - 1);
+                    for (int QuadCol = bx * BlockSize; QuadCol < EndCol; QuadCol += Spacing)
+                    {
+                        const int H00 = TopRow[QuadCol];
+                        const int H10 = TopRow[QuadCol + Spacing];
+                        const int H01 = BottomRow[QuadCol];
+                        const int H11 = BottomRow[QuadCol + Spacing];
+
+                        // Heights of the triangles at the start of the row
+                        const int LowerLeft  = H00 * Spacing + (H01 - H00) * y;
+                        const int UpperRight = H00 * Spacing + (H11 - H10) * y;
+                        const int LowerRight = H01 * Spacing + (H10 - H11) * (Spacing - y);
+
+                        const Uint16* pQuadRow = pRow + QuadCol;
+                        for (int x = 0; x <= Spacing; ++x)
+                        {
+                            const int Height         = static_cast<int>(pQuadRow[x]) * Spacing;
+                            const int DiagHeight     = x < y ? LowerLeft + (H11 - H01) * x : UpperRight + (H10 - H00) * x;
+                            const int AntiDiagHeight = x <= Spacing - y ? LowerLeft + (H10 - H00) * x : LowerRight + (H11 - H01) * x;
+                            MaxDeviation[0]          = std::max(MaxDeviation[0], std::abs(Height - DiagHeight));
+                            MaxDeviation[1]          = std::max(MaxDeviation[1], std::abs(Height - AntiDiagHeight));
+                        }
+                    }
+
+                    auto& Block     = pBlocks[bx];
+                    Block.fError[0] = std::max(Block.fError[0], static_cast<float>(MaxDeviation[0]) / static_cast<float>(Spacing));
+                    Block.fError[1] = std::max(Block.fError[1], static_cast<float>(MaxDeviation[1]) / static_cast<float>(Spacing));
+                }
+            }
+        }
+
+        for (int by = 0; by < NumBlocks; ++by)
+        {
+            for (int bx = 0; bx < NumBlocks; ++bx)
+            {
+                auto& Block = Errors[bx + by * static_cast<size_t>(NumBlocks)];
+                for (int i = 0; i < 2; ++i)
+                {
+                    Block.fError[i] *= m_fHeightScale;
+                    if (Level == 0)
+                    {
+                        Block.fMaxStep[i] *= m_fHeightScale;
+                        continue;
+                    }
+
+                    // The quad next to a copy boundary is stretched by one sample at all levels
+                    const auto& Children    = m_BlockErrors[Level - 1];
+                    const int   NumChildren = m_NumBlocks[Level - 1];
+                    for (int cy = by * 2; cy < std::min(by * 2 + 2, NumChildren); ++cy)
+                    {
+                        for (int cx = bx * 2; cx < std::min(bx * 2 + 2, NumChildren); ++cx)
+                            Block.fMaxStep[i] = std::max(Block.fMaxStep[i], Children[cx + cy * static_cast<size_t>(NumChildren)].fMaxStep[i]);
+                    }
+                }
+            }
+        }
+
+        if (NumBlocks == 1)
+            break;
+    }
+}
+
+TerrainQuadTree::NodeBounds TerrainQuadTree::GetNodeBounds(Uint32 Level, int X, int Y) const
+{
+    const int  Size   = GetNodeSize(Level);
+    const int2 Origin = GetNodeOrigin(Level, X, Y);
+
+    const auto HeightRange = m_pDataSource->GetElevationBounds(GetHeightMapCoord(Origin.x) - m_iColOffset, GetHeightMapCoord(Origin.y) - m_iRowOffset,
+                                                               GetHeightMapCoord(Origin.x + Size) - m_iColOffset, GetHeightMapCoord(Origin.y + Size) - m_iRowOffset);
+
+    NodeBounds Bounds;
+    Bounds.fMinHeight = static_cast<float>(HeightRange.Min) * m_fHeightScale;
+    Bounds.fMaxHeight = static_cast<float>(HeightRange.Max) * m_fHeightScale;
+
+    // Patch vertices are samples of the node, so the surfaces never deviate by more than the height range
+    Bounds.fError = Bounds.fMaxHeight - Bounds.fMinHeight;
+
+    // Nodes that are not larger than a copy of the height map cover one block of the copy. In the copies that
+    // are mirrored in one direction, the quads of the patch are split along the other diagonal of the block.
+    if (Level < m_BlockErrors.size())
+    {
+        const int  CopyX       = FloorDiv(Origin.x, m_CopySize);
+        const int  CopyY       = FloorDiv(Origin.y, m_CopySize);
+        const bool IsMirroredX = (CopyX & 0x01) != 0;
+        const bool IsMirroredY = (CopyY & 0x01) != 0;
+        const int  BlockX      = Origin.x - CopyX * m_CopySize;
+        const int  BlockY      = Origin.y - CopyY * m_CopySize;
+        const int  SrcBlockX   = (IsMirroredX ? m_CopySize - BlockX - Size : BlockX) / Size;
+        const int  SrcBlockY   = (IsMirroredY ? m_CopySize - BlockY - Size : BlockY) / Size;
+        const auto& Block      = m_BlockErrors[Level][SrcBlockX + SrcBlockY * static_cast<size_t>(m_NumBlocks[Level])];
+
+        // The quad next to the copy boundary that is farther from zero is stretched over the duplicated samples,
+        // which moves the patch surface by less than a sample, see GetHeightMapCoord()
+        auto IsStretched = [&](int Start) {
+            return (Start < 0 && Start % m_CopySize == 0) || (Start + Size > 0 && (Start + Size) % m_CopySize == 0);
+        };
+        float fError = Block.fError[IsMirroredX != IsMirroredY ? 1 : 0];
+        if (IsStretched(Origin.x))
+            fError += Block.fMaxStep[0];
+        if (IsStretched(Origin.y))
+            fError += Block.fMaxStep[1];
+
+        Bounds.fError = std::min(fError, Bounds.fError);
+    }
+    return Bounds;
+}
+
+BoundBox TerrainQuadTree::GetNodeBoundBox(Uint32 Level, int X, int Y, const NodeBounds& Bounds) const
+{
+    const int2  Origin = GetNodeOrigin(Level, X, Y);
+    const int   Size   = GetNodeSize(Level);
+    const float fMinX  = static_cast<float>(GetHeightMapCoord(Origin.x) - m_iColOffset) * m_fSamplingStep;
+    const float fMinZ  = static_cast<float>(GetHeightMapCoord(Origin.y) - m_iRowOffset) * m_fSamplingStep;
+    const float fMaxX  = static_cast<float>(GetHeightMapCoord(Origin.x + Size) - m_iColOffset) * m_fSamplingStep;
+    const float fMaxZ  = static_cast<float>(GetHeightMapCoord(Origin.y + Size) - m_iRowOffset) * m_fSamplingStep;
+
+    // Distances from the Earth axis to the nearest and the farthest points of the node
+    const float fNearestX  = clamp(0.f, fMinX, fMaxX);
+    const float fNearestZ  = clamp(0.f, fMinZ, fMaxZ);
+    const float fFarthestX = std::max(std::abs(fMinX), std::abs(fMaxX));
+    const float fFarthestZ = std::max(std::abs(fMinZ), std::abs(fMaxZ));
+
+    const float fR         = m_fEarthRadius;
+    const float fNearestR  = std::min(std::sqrt(fNearestX * fNearestX + fNearestZ * fNearestZ), fR);
+    const float fFarthestR = std::min(std::sqrt(fFarthestX * fFarthestX + fFarthestZ * fFarthestZ), fR);
+
+    // Vertices on the sphere are displaced along its normal: y = (R + h) * cos(a) - R, where sin(a) = r / R
+    const float fMaxCos = std::sqrt(fR * fR - fNearestR * fNearestR) / fR;
+    const float fMinCos = std::sqrt(fR * fR - fFarthestR * fFarthestR) / fR;
+    const float fPad    = Bounds.fMaxHeight * fFarthestR / fR;
+
+    BoundBox BB;
+    BB.Min = float3{fMinX - fPad, (fR + Bounds.fMinHeight) * fMinCos - fR, fMinZ - fPad};
+    BB.Max = float3{fMaxX + fPad, (fR + Bounds.fMaxHeight) * fMaxCos - fR, fMaxZ + fPad};
+    return BB;
+}
+
+float TerrainQuadTree::GetNodeError(Uint32 Level, const NodeBounds& Bounds) const
+{
+    // Straight edges between vertices also deviate from the sphere by the sagitta of the arc
+    const float fVertexSpacing = static_cast<float>(1 << Level) * m_fSamplingStep;
+    return Bounds.fError + fVertexSpacing * fVertexSpacing / (8.f * m_fEarthRadius);
+}
+
+float TerrainQuadTree::GetScreenError(const BoundBox& BB, float fError, const SelectionAttribs& Attribs) const
+{
+    const float3& CamPos = Attribs.f3CameraPos;
+
+    // Nearest and farthest horizontal distances and the nearest vertical distance from the camera to the box
+    const float fNearestX  = std::max(std::max(BB.Min.x - CamPos.x, CamPos.x - BB.Max.x), 0.f);
+    const float fNearestZ  = std::max(std::max(BB.Min.z - CamPos.z, CamPos.z - BB.Max.z), 0.f);
+    const float fFarthestX = std::max(std::abs(BB.Min.x - CamPos.x), std::abs(BB.Max.x - CamPos.x));
+    const float fFarthestZ = std::max(std::abs(BB.Min.z - CamPos.z), std::abs(BB.Max.z - CamPos.z));
+    const float fMinR      = std::sqrt(fNearestX * fNearestX + fNearestZ * fNearestZ);
+    const float fMaxR      = std::sqrt(fFarthestX * fFarthestX + fFarthestZ * fFarthestZ);
+    const float fDY        = std::max(std::max(BB.Min.y - CamPos.y, CamPos.y - BB.Max.y), 0.f);
+
+    const float fMinDistance = std::sqrt(fMinR * fMinR + fDY * fDY);
+    if (fMinDistance == 0)
+        return FLT_MAX;
+
+    // The error is vertical, so its projection is scaled by the sine of the angle between the view ray and
+    // the vertical, r / d, which makes the projected error at the distance d equal to e * r / d^2
+    // (Lindstrom et al., "Real-Time, Continuous Level of Detail Rendering of Height Fields", 1996).
+    // Its maximum over the box is reached at r = dy, if possible. The vertical of the sphere deviates from the y axis
+    // by the angle whose sine is the distance from the Earth axis over the radius, which adds up to sin(a) / d.
+    const float fR         = clamp(fDY, fMinR, fMaxR);
+    const float fAxisX     = std::max(std::abs(BB.Min.x), std::abs(BB.Max.x));
+    const float fAxisZ     = std::max(std::abs(BB.Min.z), std::abs(BB.Max.z));
+    const float fSinTilt   = std::min(std::sqrt(fAxisX * fAxisX + fAxisZ * fAxisZ) / m_fEarthRadius, 1.f);
+    const float fViewScale = fR / (fR * fR + fDY * fDY) + fSinTilt / fMinDistance;
+    return fError * Attribs.fProjScale * std::min(fViewScale, 1.f / fMinDistance);
+}
+
+float TerrainQuadTree::GetNodeScreenError(Uint32 Level, int X, int Y, const SelectionAttribs& Attribs) const
+{
+    const NodeBounds Bounds = GetNodeBounds(Level, X, Y);
+    return GetScreenError(GetNodeBoundBox(Level, X, Y, Bounds), GetNodeError(Level, Bounds), Attribs);
+}
+
+struct TerrainQuadTree::SelectionContext
+{
+    const SelectionAttribs&     Attribs;
+    std::vector<PatchInstance>& Patches;
+    SelectionStats              Stats;
+
+    // Distance from the camera to the horizon of the sphere
+    float fHorizonDistance = 0;
+};
+
+void TerrainQuadTree::Select(const SelectionAttribs& Attribs, std::vector<PatchInstance>& Patches, SelectionStats* pStats) const
+{
+    SelectionContext Ctx{Attribs, Patches, {}};
+
+    const float3& CamPos       = Attribs.f3CameraPos;
+    const float   fCamToCenter = length(float3{CamPos.x, CamPos.y + m_fEarthRadius, CamPos.z});
+    const float   fAltitude    = std::max(fCamToCenter - m_fEarthRadius, 0.f);
+    Ctx.fHorizonDistance       = std::sqrt(2.f * m_fEarthRadius * fAltitude + fAltitude * fAltitude);
+
+    SelectNode(Ctx, m_NumLevels - 1, 0, 0, 0, 0);
+    if (pStats != nullptr)
+        *pStats = Ctx.Stats;
+}
+
+void TerrainQuadTree::SelectNode(SelectionContext& Ctx, Uint32 Level, int X, int Y, float fParentScreenError, float fParentError) const
+{
+    ++Ctx.Stats.NumVisitedNodes;
+
+    const auto& Attribs = Ctx.Attribs;
+
+    const int2  Origin = GetNodeOrigin(Level, X, Y);
+    const int   Size   = GetNodeSize(Level);
+    const float fMinX  = static_cast<float>(GetHeightMapCoord(Origin.x) - m_iColOffset) * m_fSamplingStep;
+    const float fMinZ  = static_cast<float>(GetHeightMapCoord(Origin.y) - m_iRowOffset) * m_fSamplingStep;
+    const float fMaxX  = static_cast<float>(GetHeightMapCoord(Origin.x + Size) - m_iColOffset) * m_fSamplingStep;
+    const float fMaxZ  = static_cast<float>(GetHeightMapCoord(Origin.y + Size) - m_iRowOffset) * m_fSamplingStep;
+
+    // Nodes outside of the hemisphere are not rendered
+    const float fNearestX = clamp(0.f, fMinX, fMaxX);
+    const float fNearestZ = clamp(0.f, fMinZ, fMaxZ);
+    if (fNearestX * fNearestX + fNearestZ * fNearestZ >= m_fEarthRadius * m_fEarthRadius)
+    {
+        ++Ctx.Stats.NumCulledNodes;
+        return;
+    }
+
+    const NodeBounds Bounds = GetNodeBounds(Level, X, Y);
+    const BoundBox   BB     = GetNodeBoundBox(Level, X, Y, Bounds);
+    if (Attribs.pFrustum != nullptr && GetBoxVisibility(*Attribs.pFrustum, BB, Attribs.FrustumFlags) == BoxVisibility::Invisible)
+    {
+        ++Ctx.Stats.NumCulledNodes;
+        return;
+    }
+
+    const float3& CamPos = Attribs.f3CameraPos;
+    const float3  Delta{
+        std::max(std::max(BB.Min.x - CamPos.x, CamPos.x - BB.Max.x), 0.f),
+        std::max(std::max(BB.Min.y - CamPos.y, CamPos.y - BB.Max.y), 0.f),
+        std::max(std::max(BB.Min.z - CamPos.z, CamPos.z - BB.Max.z), 0.f),
+    };
+
+    // The terrain is never below the sphere, so a point at height h above the sphere can only be seen
+    // from the distance of up to sqrt(2Rh + h^2) plus the distance from the camera to the horizon.
+    const float fMaxHeight = Bounds.fMaxHeight;
+    if (length(Delta) > Ctx.fHorizonDistance + std::sqrt(2.f * m_fEarthRadius * fMaxHeight + fMaxHeight * fMaxHeight))
+    {
+        ++Ctx.Stats.NumCulledNodes;
+        return;
+    }
+
+    const float fError       = GetNodeError(Level, Bounds);
+    const float fScreenError = GetScreenError(BB, fError, Attribs);
+
+    if (Level > 0 && fScreenError > Attribs.fMaxScreenError)
+    {
+        // Visit the children closest to the camera first
+        const int FirstX = CamPos.x > (fMinX + fMaxX) * 0.5f ? 1 : 0;
+        const int FirstY = CamPos.z > (fMinZ + fMaxZ) * 0.5f ? 1 : 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const int ChildX = X * 2 + ((i & 0x01) ^ FirstX);
+            const int ChildY = Y * 2 + ((i >> 1) ^ FirstY);
+            SelectNode(Ctx, Level - 1, ChildX, ChildY, fScreenError, fError);
+        }
+        return;
+    }
+
+    PatchInstance Patch;
+    Patch.f2Origin = float2{static_cast<float>(Origin.x), static_cast<float>(Origin.y)};
+    Patch.fSize    = static_cast<float>(Size);
+    // The patch turns into its parent as the screen error of the parent goes down to the threshold,
+    // so that there is no popping when the parent is selected instead
+    Patch.fMorph = Level + 1 < m_NumLevels ? clamp(2.f - fParentScreenError / Attribs.fMaxScreenError, 0.f, 1.f) : 0.f;
+    // Cracks between the patch and a coarser neighbor do not exceed the error of the parent
+    Patch.fSkirtDepth = std::max(std::max(fParentError, fError), m_fSamplingStep);
+    Ctx.Patches.push_back(Patch);
+
+    ++Ctx.Stats.NumPatches;
+    Ctx.Stats.FinestLevel = std::min(Ctx.Stats.FinestLevel, Level);
+}
+
+void TerrainQuadTree::CreatePatchMesh(Uint32 PatchQuads, std::vector<float3>& Vertices, std::vector<Uint32>& Indices)
+{
+    const Uint32 GridDim = PatchQuads + 1;
+
+    Vertices.clear();
+    Indices.clear();
+    Vertices.reserve(GridDim * GridDim + GridDim * 4);
+    Indices.reserve((PatchQuads * PatchQuads + PatchQuads * 4) * 6);
+
+    for (Uint32 Row = 0; Row < GridDim; ++Row)
+    {
+        for (Uint32 Col = 0; Col < GridDim; ++Col)
+            Vertices.emplace_back(static_cast<float>(Col), static_cast<float>(Row), 0.f);
+    }
+
+    for (Uint32 Row = 0; Row < PatchQuads; ++Row)
+    {
+        for (Uint32 Col = 0; Col < PatchQuads; ++Col)
+        {
+            const Uint32 V00 = Col + Row * GridDim;
+            const Uint32 V10 = V00 + 1;
+            const Uint32 V01 = V00 + GridDim;
+            const Uint32 V11 = V01 + 1;
+
+            // clang-format off
+            Indices.insert(Indices.end(), {V00, V10, V11,
+                                           V00, V11, V01});
+            // clang-format on
+        }
+    }
+
+    // Skirts go around the patch counter-clockwise, so that they face outwards
+    const struct
+    {
+        int StartCol, StartRow;
+        int StepCol, StepRow;
+    } Edges[] = {
+        {0, 0, 1, 0},
+        {static_cast<int>(PatchQuads), 0, 0, 1},
+        {static_cast<int>(PatchQuads), static_cast<int>(PatchQuads), -1, 0},
+        {0, static_cast<int>(PatchQuads), 0, -1},
+    };
+    for (const auto& Edge : Edges)
+    {
+        const Uint32 FirstSkirtVertex = static_cast<Uint32>(Vertices.size());
+        for (Uint32 i = 0; i < GridDim; ++i)
+        {
+            const int Col = Edge.StartCol + Edge.StepCol * static_cast<int>(i);
+            const int Row = Edge.StartRow + Edge.StepRow * static_cast<int>(i);
+            Vertices.emplace_back(static_cast<float>(Col), static_cast<float>(Row), 1.f);
+        }
+
+        for (Uint32 i = 0; i < PatchQuads; ++i)
+        {
+            const Uint32 Bottom0 = FirstSkirtVertex + i;
+            const Uint32 Bottom1 = Bottom0 + 1;
+            const Uint32 Top0    = static_cast<Uint32>(Vertices[Bottom0].x) + static_cast<Uint32>(Vertices[Bottom0].y) * GridDim;
+            const Uint32 Top1    = static_cast<Uint32>(Vertices[Bottom1].x) + static_cast<Uint32>(Vertices[Bottom1].y) * GridDim;
+
+            // clang-format off
+            Indices.insert(Indices.end(), {Top0, Bottom0, Top1,
+                                           Top1, Bottom0, Bottom1});
+            // clang-format on
+        }
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "BasicMath.hpp"
+#include "AdvancedMath.hpp"
+
+namespace Diligent
+{
+
+class ElevationDataSource;
+
+// Quadtree over the mirrored height map that selects terrain patches for continuous LOD rendering.
+//
+// The tree is implicit: a node at level L (0 being the finest) covers PatchQuads << L quads along each side
+// and is rendered as a grid of PatchQuads x PatchQuads quads with the vertex spacing of 1 << L samples.
+// The tree coordinates count the quads of the mirrored copies of the height map, which are 2^n quads wide,
+// and skip the quad between the duplicated border samples of the adjacent copies, see GetHeightMapCoord().
+// This way every node that is not larger than a copy covers a block of the height map, and its geometric
+// error is one of the block errors precomputed for every level. The height range of a node is taken from
+// the min/max pyramid of the elevation data source.
+class TerrainQuadTree
+{
+public:
+    struct CreateInfo
+    {
+        // Square height map with the offsets already set. Must outlive the tree.
+        const ElevationDataSource* pDataSource = nullptr;
+
+        float fSamplingStep = 32.f;
+        float fHeightScale  = 0.1f;
+        float fEarthRadius  = 6371000.f;
+
+        // Number of quads along each side of a patch. Must be a power of two.
+        Uint32 PatchQuads = 8;
+    };
+
+    explicit TerrainQuadTree(const CreateInfo& CI);
+
+    // clang-format off
+    TerrainQuadTree           (const TerrainQuadTree&) = delete;
+    TerrainQuadTree& operator=(const TerrainQuadTree&) = delete;
+    // clang-format on
+
+    struct SelectionAttribs
+    {
+        float3 f3CameraPos;
+
+        // Nodes outside of the frustum are skipped, if it is not null
+        const ViewFrustumExt* pFrustum     = nullptr;
+        FRUSTUM_PLANE_FLAGS   FrustumFlags = FRUSTUM_PLANE_FLAG_FULL_FRUSTUM;
+
+        // Viewport height divided by 2 * tan(FOV / 2): projects the error at unit distance to pixels
+        float fProjScale = 1000.f;
+
+        // Nodes whose screen-space error exceeds this value, in pixels, are subdivided
+        float fMaxScreenError = 8.f;
+    };
+
+    // Per-instance attributes of a patch, see TerrainCLOD.fxh
+    struct PatchInstance
+    {
+        // Tree coordinates of the patch corner
+        float2 f2Origin;
+
+        // Patch size in quads
+        float fSize;
+
+        // Geomorph factor: 0 - patch geometry, 1 - geometry of the parent patch
+        float fMorph;
+
+        // Depth of the skirts that hide cracks between patches of different levels, in world units
+        float fSkirtDepth;
+    };
+
+    struct SelectionStats
+    {
+        Uint32 NumVisitedNodes = 0;
+        Uint32 NumCulledNodes  = 0;
+        Uint32 NumPatches      = 0;
+        Uint32 FinestLevel     = ~0u;
+    };
+
+    // Selects the patches that meet the screen-space error threshold, front to back, and appends them to Patches
+    void Select(const SelectionAttribs& Attribs, std::vector<PatchInstance>& Patches, SelectionStats* pStats = nullptr) const;
+
+    struct NodeBounds
+    {
+        // Maximum distance between the patch and the full resolution surface, in world units,
+        // without the curvature of the Earth
+        float fError = 0;
+
+        float fMinHeight = 0;
+        float fMaxHeight = 0;
+    };
+
+    // The error bound of the nodes that span several copies of the height map is the height range.
+    // The height range contains the exact range of the node.
+    NodeBounds GetNodeBounds(Uint32 Level, int X, int Y) const;
+
+    BoundBox GetNodeBoundBox(Uint32 Level, int X, int Y, const NodeBounds& Bounds) const;
+
+    // Projected error of the node, in pixels, that Select() compares with the threshold
+    float GetNodeScreenError(Uint32 Level, int X, int Y, const SelectionAttribs& Attribs) const;
+
+    Uint32 GetNumLevels() const { return m_NumLevels; }
+    Uint32 GetPatchQuads() const { return m_PatchQuads; }
+
+    // Node size, in quads
+    int GetNodeSize(Uint32 Level) const { return static_cast<int>(m_PatchQuads) << Level; }
+
+    // Tree coordinates of the node corner
+    int2 GetNodeOrigin(Uint32 Level, int X, int Y) const
+    {
+        const int Size = GetNodeSize(Level);
+        return int2{m_iRootOrigin + X * Size, m_iRootOrigin + Y * Size};
+    }
+
+    // Converts the tree coordinate to the height map coordinate, offsets included, that is addressed the same
+    // way as by ElevationDataSource. The coordinate is shifted by one sample for every copy boundary between
+    // it and zero. The vertex on a boundary goes to the next copy, so the last quad of the patch before the
+    // boundary also covers the quad between the duplicated samples. Same as TreeToHeightMapCoord() in TerrainCLOD.fxh.
+    int GetHeightMapCoord(int TreeCoord) const { return TreeCoord + TreeCoord / m_CopySize; }
+
+    // Creates the patch mesh shared by all instances. A vertex is (column, row, skirt flag);
+    // skirt vertices are lowered by the skirt depth. Triangles are counter-clockwise in the column-row plane,
+    // the same as the triangles of the ring meshes.
+    static void CreatePatchMesh(Uint32 PatchQuads, std::vector<float3>& Vertices, std::vector<Uint32>& Indices);
+
+private:
+    struct BlockError
+    {
+        // Geometric errors: [0] - with the quads split along the diagonal from (0,0) to (1,1)
+        // as in the patch mesh, [1] - along the other diagonal
+        float fError[2] = {};
+
+        // Maximum height differences between the adjacent samples in a row and in a column, in world units.
+        // Bound the error added by stretching the quad next to a copy boundary.
+        float fMaxStep[2] = {};
+    };
+
+    struct SelectionContext;
+
+    void  ComputeBlockErrors();
+    float GetNodeError(Uint32 Level, const NodeBounds& Bounds) const;
+    float GetScreenError(const BoundBox& BB, float fError, const SelectionAttribs& Attribs) const;
+    void  SelectNode(SelectionContext& Ctx, Uint32 Level, int X, int Y, float fParentScreenError, float fParentError) const;
+
+    const ElevationDataSource* const m_pDataSource;
+
+    Uint32 m_PatchQuads   = 0;
+    Uint32 m_NumLevels    = 0;
+    int    m_iRootOrigin  = 0;
+    int    m_HeightMapDim = 0;
+    int    m_CopySize     = 0;
+    int    m_iColOffset   = 0;
+    int    m_iRowOffset   = 0;
+
+    float m_fSamplingStep = 0;
+    float m_fHeightScale  = 0;
+    float m_fEarthRadius  = 0;
+
+    // Geometric errors of the height map blocks of every level, row by row. The block size at level L is the node size.
+    // The coarsest level has a single block; the error of the nodes above it is bounded by the height range.
+    std::vector<std::vector<BlockError>> m_BlockErrors;
+    std::vector<int>                     m_NumBlocks;
+};
+
+} // namespace Diligent
@@ -0,0 +1,382 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Headless test of the terrain quadtree. Builds the tree over a synthetic height map, checks the
+// error bounds against the full resolution surface and the invariants of the patch selection,
+// and reports the selected triangle counts at different camera altitudes.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "TerrainQuadTree.hpp"
+#include "ElevationDataSource.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+// Same as the default terrain parameters of the sample
+constexpr float SamplingStep = 32.f;
+constexpr float HeightScale  = 0.1f;
+constexpr float EarthRadius  = 6371000.f;
+constexpr int   ColOffset    = 1356;
+constexpr int   RowOffset    = 924;
+
+// Default ring meshes: the inner ring is a full 64x64 grid, other rings are 12 sectors of 16x16 quads
+constexpr Uint32 NumRings          = 15;
+constexpr Uint32 RingMeshTriangles = 64 * 64 * 2 + (NumRings - 1) * 12 * 16 * 16 * 2;
+
+float Hash(Uint32 x, Uint32 y, Uint32 Seed)
+{
+    Uint32 h = x * 374761393u + y * 668265263u + Seed * 2246822519u;
+    h        = (h ^ (h >> 13)) * 1274126177u;
+    return static_cast<float>((h ^ (h >> 16)) & 0xFFFF) / 65535.f;
+}
+
+float ValueNoise(float x, float y, Uint32 Seed)
+{
+    const float x0 = std::floor(x);
+    const float y0 = std::floor(y);
+    const float fx = x - x0;
+    const float fy = y - y0;
+    const float sx = fx * fx * (3 - 2 * fx);
+    const float sy = fy * fy * (3 - 2 * fy);
+    const auto  ix = static_cast<Uint32>(x0);
+    const auto  iy = static_cast<Uint32>(y0);
+
+    const float h0 = Hash(ix, iy, Seed) + (Hash(ix + 1, iy, Seed) - Hash(ix, iy, Seed)) * sx;
+    const float h1 = Hash(ix, iy + 1, Seed) + (Hash(ix + 1, iy + 1, Seed) - Hash(ix, iy + 1, Seed)) * sx;
+    return h0 + (h1 - h0) * sy;
+}
+
+// Fractal terrain with mountains up to 4 km
+std::vector<Uint16> CreateHeightMap(Uint32 Dim)
+{
+    std::vector<Uint16> HeightMap(size_t{Dim} * Dim);
+    for (Uint32 Row = 0; Row < Dim; ++Row)
+    {
+        for (Uint32 Col = 0; Col < Dim; ++Col)
+        {
+            float fHeight    = 0;
+            float fAmplitude = 0.5f;
+            float fFrequency = 1.f / 256.f;
+            for (Uint32 Octave = 0; Octave < 8; ++Octave)
+            {
+                fHeight += ValueNoise(static_cast<float>(Col) * fFrequency, static_cast<float>(Row) * fFrequency, Octave) * fAmplitude;
+                fAmplitude *= 0.5f;
+                fFrequency *= 2.f;
+            }
+            HeightMap[Col + Row * size_t{Dim}] = static_cast<Uint16>(fHeight * fHeight * 40000.f);
+        }
+    }
+    return HeightMap;
+}
+
+struct NodeId
+{
+    Uint32 Level;
+    int    X;
+    int    Y;
+};
+
+NodeId GetPatchNode(const TerrainQuadTree& Tree, const TerrainQuadTree::PatchInstance& Patch)
+{
+    NodeId Node{0, 0, 0};
+    while (Tree.GetNodeSize(Node.Level) < static_cast<int>(Patch.fSize))
+        ++Node.Level;
+    const int2 RootOrigin = Tree.GetNodeOrigin(Tree.GetNumLevels() - 1, 0, 0);
+    Node.X                = (static_cast<int>(Patch.f2Origin.x) - RootOrigin.x) / Tree.GetNodeSize(Node.Level);
+    Node.Y                = (static_cast<int>(Patch.f2Origin.y) - RootOrigin.y) / Tree.GetNodeSize(Node.Level);
+    return Node;
+}
+
+// Same addressing as MirrorCoord() in ElevationDataSource.cpp
+int MirrorCoord(int Coord, int Dim)
+{
+    Coord            = std::abs(Coord);
+    const int Period = Coord / Dim;
+    Coord %= Dim;
+    return (Period & 0x01) ? Dim - 1 - Coord : Coord;
+}
+
+// Checks that the node error and height range bound the distance between the patch and the full resolution
+// surface, which are compared at every height map sample that the patch covers. Returns the ratio of the actual
+// error to the bound.
+bool CheckNodeBounds(const TerrainQuadTree& Tree, const std::vector<Uint16>& HeightMap, int Dim, const NodeId& Node, float& Ratio)
+{
+    const int  Spacing  = 1 << Node.Level;
+    const int  NumQuads = static_cast<int>(Tree.GetPatchQuads());
+    const int2 Origin   = Tree.GetNodeOrigin(Node.Level, Node.X, Node.Y);
+
+    auto GetHeight = [&](int Col, int Row) {
+        return static_cast<float>(HeightMap[MirrorCoord(Col, Dim) + MirrorCoord(Row, Dim) * size_t{static_cast<Uint32>(Dim)}]);
+    };
+
+    // Height map coordinates of the patch vertices
+    std::vector<int> VertCols(NumQuads + 1), VertRows(NumQuads + 1);
+    for (int i = 0; i <= NumQuads; ++i)
+    {
+        VertCols[i] = Tree.GetHeightMapCoord(Origin.x + i * Spacing);
+        VertRows[i] = Tree.GetHeightMapCoord(Origin.y + i * Spacing);
+    }
+
+    const auto Bounds = Tree.GetNodeBounds(Node.Level, Node.X, Node.Y);
+
+    float fMaxError  = 0;
+    bool  IsInRange  = true;
+    int   QuadRow    = 0;
+    for (int Row = VertRows[0]; Row <= VertRows[NumQuads]; ++Row)
+    {
+        while (QuadRow < NumQuads - 1 && Row > VertRows[QuadRow + 1])
+            ++QuadRow;
+        const float fy = static_cast<float>(Row - VertRows[QuadRow]) / static_cast<float>(VertRows[QuadRow + 1] - VertRows[QuadRow]);
+
+        int QuadCol = 0;
+        for (int Col = VertCols[0]; Col <= VertCols[NumQuads]; ++Col)
+        {
+            while (QuadCol < NumQuads - 1 && Col > VertCols[QuadCol + 1])
+                ++QuadCol;
+            const float fx = static_cast<float>(Col - VertCols[QuadCol]) / static_cast<float>(VertCols[QuadCol + 1] - VertCols[QuadCol]);
+
+            const float H00 = GetHeight(VertCols[QuadCol], VertRows[QuadRow]);
+            const float H10 = GetHeight(VertCols[QuadCol + 1], VertRows[QuadRow]);
+            const float H01 = GetHeight(VertCols[QuadCol], VertRows[QuadRow + 1]);
+            const float H11 = GetHeight(VertCols[QuadCol + 1], VertRows[QuadRow + 1]);
+
+            // Quads of the patch mesh are split along the diagonal from (0,0) to (1,1)
+            const float fPatchHeight = fx >= fy ?
+                H00 + (H10 - H00) * fx + (H11 - H10) * fy :
+                H00 + (H01 - H00) * fy + (H11 - H01) * fx;
+
+            const float fHeight = GetHeight(Col, Row) * HeightScale;
+            fMaxError           = std::max(fMaxError, std::abs(GetHeight(Col, Row) - fPatchHeight) * HeightScale);
+            IsInRange           = IsInRange && fHeight >= Bounds.fMinHeight && fHeight <= Bounds.fMaxHeight;
+        }
+    }
+
+    Ratio = Bounds.fError > 0 ? fMaxError / Bounds.fError : 0;
+    return IsInRange && fMaxError <= Bounds.fError * 1.0001f + 1e-3f;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Uint32 Dim = argc > 1 ? static_cast<Uint32>(std::atoi(argv[1])) : 2049;
+    if (Dim < 3 || ((Dim - 1) & (Dim - 2)) != 0)
+    {
+        std::printf("Height map dimension must be 2^n+1\n");
+        return 1;
+    }
+
+    const auto HeightMap = CreateHeightMap(Dim);
+
+    ElevationDataSource DataSource{HeightMap.data(), Dim, Dim, Dim};
+    DataSource.SetOffsets(ColOffset, RowOffset);
+
+    TerrainQuadTree::CreateInfo TreeCI;
+    TreeCI.pDataSource   = &DataSource;
+    TreeCI.fSamplingStep = SamplingStep;
+    TreeCI.fHeightScale  = HeightScale;
+    TreeCI.fEarthRadius  = EarthRadius;
+
+    const auto            BuildStart = std::chrono::high_resolution_clock::now();
+    const TerrainQuadTree Tree{TreeCI};
+    const auto            BuildEnd = std::chrono::high_resolution_clock::now();
+    std::printf("Height map %ux%u, %u levels, built in %.1f ms\n", Dim, Dim, Tree.GetNumLevels(),
+                std::chrono::duration<double, std::milli>(BuildEnd - BuildStart).count());
+
+    bool Passed = true;
+
+    // Bounds must hold in every copy of the height map, including the nodes on the copy boundaries
+    // and the nodes that span several copies
+    {
+        const int  CopySize   = static_cast<int>(Dim) - 1;
+        const int2 RootOrigin = Tree.GetNodeOrigin(Tree.GetNumLevels() - 1, 0, 0);
+
+        Uint32 NumChecked = 0;
+        float  MaxRatio   = 0;
+        float  SumRatio   = 0;
+        for (Uint32 Level = 0; Level < Tree.GetNumLevels() && Tree.GetNodeSize(Level) <= CopySize * 2; ++Level)
+        {
+            const int Size        = Tree.GetNodeSize(Level);
+            const int ZeroNode    = -RootOrigin.x / Size;
+            const int CopyNodes   = std::max(CopySize / Size, 1);
+            const int NumNodes    = Size > CopySize ? 4 : 16;
+            for (int i = 0; i < NumNodes; ++i)
+            {
+                NodeId Node{Level, 0, 0};
+                if (i < 4)
+                {
+                    // Nodes on both sides of the copy boundaries
+                    Node.X = ZeroNode + (i - 2) * CopyNodes - (i & 0x01);
+                    Node.Y = ZeroNode + (1 - i) * CopyNodes - (i >> 1);
+                }
+                else
+                {
+                    Node.X = ZeroNode + static_cast<int>((Hash(i, Level, 100) * 2.f - 1.f) * static_cast<float>(CopyNodes * 3));
+                    Node.Y = ZeroNode + static_cast<int>((Hash(i, Level, 101) * 2.f - 1.f) * static_cast<float>(CopyNodes * 3));
+                }
+
+                float Ratio = 0;
+                if (!CheckNodeBounds(Tree, HeightMap, static_cast<int>(Dim), Node, Ratio))
+                {
+                    std::printf("FAILED: bounds of node (%u, %d, %d) are exceeded, error ratio %.2f\n", Node.Level, Node.X, Node.Y, Ratio);
+                    Passed = false;
+                }
+                MaxRatio = std::max(MaxRatio, Ratio);
+                SumRatio += Ratio;
+                ++NumChecked;
+            }
+        }
+        std::printf("Node bounds: %u nodes checked, actual/bound error ratio: average %.2f, max %.2f\n", NumChecked, SumRatio / static_cast<float>(NumChecked), MaxRatio);
+    }
+
+    std::vector<Uint32> PatchIndices;
+    {
+        std::vector<float3> PatchVerts;
+        TerrainQuadTree::CreatePatchMesh(Tree.GetPatchQuads(), PatchVerts, PatchIndices);
+    }
+    const Uint32 PatchTriangles = static_cast<Uint32>(PatchIndices.size() / 3);
+
+    // 1080p viewport with 45 degree vertical field of view, as in the sample
+    const float FOV        = PI_F / 4.f;
+    const float ProjScale  = 1080.f * 0.5f / std::tan(FOV * 0.5f);
+    const float Altitudes[] = {2000.f, 8000.f, 25000.f, 100000.f, 400000.f};
+
+    std::printf("\n%10s %9s %11s %13s %8s %8s %10s %10s\n", "Altitude", "Patches", "Triangles", "Full res tris", "Finest", "Visited", "Select ms", "vs rings");
+    for (float Altitude : Altitudes)
+    {
+        TerrainQuadTree::SelectionAttribs Attribs;
+        Attribs.f3CameraPos     = float3{0, Altitude, 0};
+        Attribs.fProjScale      = ProjScale;
+
+        // Selection without the frustum must cover the terrain up to the horizon exactly once
+        std::vector<TerrainQuadTree::PatchInstance> AllPatches;
+        Tree.Select(Attribs, AllPatches);
+        const float HorizonDistance = std::sqrt(2.f * EarthRadius * Altitude);
+        for (Uint32 i = 0; i < 256; ++i)
+        {
+            const float fAngle  = Hash(i, 0, 200) * 2.f * PI_F;
+            const float fRadius = std::sqrt(Hash(i, 0, 201)) * HorizonDistance * 0.5f;
+            const float fCol    = std::cos(fAngle) * fRadius / SamplingStep + ColOffset;
+            const float fRow    = std::sin(fAngle) * fRadius / SamplingStep + RowOffset;
+
+            Uint32 NumCovering = 0;
+            for (const auto& Patch : AllPatches)
+            {
+                const int Origin[2] = {static_cast<int>(Patch.f2Origin.x), static_cast<int>(Patch.f2Origin.y)};
+                const int Size      = static_cast<int>(Patch.fSize);
+                if (fCol >= Tree.GetHeightMapCoord(Origin[0]) && fCol < Tree.GetHeightMapCoord(Origin[0] + Size) &&
+                    fRow >= Tree.GetHeightMapCoord(Origin[1]) && fRow < Tree.GetHeightMapCoord(Origin[1] + Size))
+                    ++NumCovering;
+            }
+            if (NumCovering != 1)
+            {
+                std::printf("FAILED: point (%.0f, %.0f) is covered by %u patches\n", fCol, fRow, NumCovering);
+                Passed = false;
+            }
+        }
+
+        // Camera looking at the horizon, slightly down
+        const float4x4 View     = float4x4::Translation(0, -Altitude, 0) * float4x4::RotationX(0.2f);
+        const float4x4 Proj     = float4x4::Projection(FOV, 16.f / 9.f, 50.f, 4000000.f, false);
+        ViewFrustumExt Frustum;
+        ExtractViewFrustumPlanesFromMatrix(View * Proj, Frustum, true);
+        Attribs.pFrustum = &Frustum;
+
+        std::vector<TerrainQuadTree::PatchInstance> Patches;
+        TerrainQuadTree::SelectionStats             Stats;
+
+        constexpr int NumIterations = 16;
+        const auto    SelectStart   = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < NumIterations; ++i)
+        {
+            Patches.clear();
+            Tree.Select(Attribs, Patches, &Stats);
+        }
+        const auto SelectEnd = std::chrono::high_resolution_clock::now();
+
+        double FullResTriangles = 0;
+        for (const auto& Patch : Patches)
+        {
+            const NodeId Node = GetPatchNode(Tree, Patch);
+            if (Node.Level > 0 && Tree.GetNodeScreenError(Node.Level, Node.X, Node.Y, Attribs) > Attribs.fMaxScreenError)
+            {
+                std::printf("FAILED: patch (%u, %d, %d) exceeds the screen-space error threshold\n", Node.Level, Node.X, Node.Y);
+                Passed = false;
+            }
+            if (!(Patch.fMorph >= 0 && Patch.fMorph <= 1 && Patch.fSkirtDepth > 0))
+            {
+                std::printf("FAILED: patch (%u, %d, %d) has invalid morph factor or skirt depth\n", Node.Level, Node.X, Node.Y);
+                Passed = false;
+            }
+            FullResTriangles += static_cast<double>(Patch.fSize) * Patch.fSize * 2.0;
+        }
+
+        // Frustum culling only removes subtrees, so the patches must be a subset of the patches selected without it
+        Uint32 NumNotFound = 0;
+        for (const auto& Patch : Patches)
+        {
+            bool Found = false;
+            for (const auto& OtherPatch : AllPatches)
+            {
+                if (OtherPatch.f2Origin.x == Patch.f2Origin.x && OtherPatch.f2Origin.y == Patch.f2Origin.y && OtherPatch.fSize == Patch.fSize)
+                {
+                    Found = true;
+                    break;
+                }
+            }
+            NumNotFound += Found ? 0 : 1;
+        }
+        if (NumNotFound > 0)
+        {
+            std::printf("FAILED: %u patches are not selected without the frustum\n", NumNotFound);
+            Passed = false;
+        }
+
+        const Uint32 Triangles = Stats.NumPatches * PatchTriangles;
+        std::printf("%9.0fm %9u %11u %13.3g %8u %8u %10.3f %9.2fx\n", Altitude, Stats.NumPatches, Triangles, FullResTriangles,
+                    Stats.FinestLevel, Stats.NumVisitedNodes,
+                    std::chrono::duration<double, std::milli>(SelectEnd - SelectStart).count() / NumIterations,
+                    static_cast<double>(Triangles) / RingMeshTriangles);
+
+        // The quadtree must not cost more than the ring meshes, which are less accurate than the threshold
+        if (Triangles >= RingMeshTriangles)
+        {
+            std::printf("FAILED: %u triangles at %.0fm, the ring meshes have %u\n", Triangles, Altitude, RingMeshTriangles);
+            Passed = false;
+        }
+    }
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
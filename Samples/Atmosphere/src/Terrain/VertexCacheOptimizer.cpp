@@ -0,0 +1,243 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "VertexCacheOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void TriangleStripToList(const std::vector<Uint32>& Strip, std::vector<Uint32>& List)
+{
+    List.clear();
+    if (Strip.size() < 3)
+        return;
+
+    List.reserve((Strip.size() - 2) * 3);
+    for (size_t i = 2; i < Strip.size(); ++i)
+    {
+        const Uint32 V0 = Strip[i - 2];
+        const Uint32 V1 = Strip[i - 1];
+        const Uint32 V2 = Strip[i];
+        if (V0 == V1 || V1 == V2 || V0 == V2)
+            continue;
+
+        // Every odd triangle of a strip has the opposite vertex order
+        if ((i & 0x01) == 0)
+        {
+            List.push_back(V0);
+            List.push_back(V1);
+        }
+        else
+        {
+            List.push_back(V1);
+            List.push_back(V0);
+        }
+        List.push_back(V2);
+    }
+}
+
+namespace
+{
+
+// Tuning constants from the original description of the algorithm
+constexpr Uint32 MaxCacheSize      = 32;
+constexpr float  CacheDecayPower   = 1.5f;
+constexpr float  LastTriScore      = 0.75f;
+constexpr float  ValenceBoostScale = 2.0f;
+constexpr float  ValenceBoostPower = 0.5f;
+
+float ComputeVertexScore(Int32 CachePos, Uint32 NumActiveTris)
+{
+    if (NumActiveTris == 0)
+    {
+        // The vertex is not used by any remaining triangle
+        return -1.f;
+    }
+
+    float Score = 0;
+    if (CachePos >= 0)
+    {
+        if (CachePos < 3)
+        {
+            // The vertex was used by the last triangle. The score is fixed,
+            // so that the three vertices of the last triangle are not favored differently.
+            Score = LastTriScore;
+        }
+        else
+        {
+            VERIFY_EXPR(CachePos < static_cast<Int32>(MaxCacheSize));
+            const float Scaler = 1.f / static_cast<float>(MaxCacheSize - 3);
+            Score              = std::pow(1.f - static_cast<float>(CachePos - 3) * Scaler, CacheDecayPower);
+        }
+    }
+
+    // Boost the vertices with few remaining triangles, so that lone triangles are not left behind
+    Score += ValenceBoostScale * std::pow(static_cast<float>(NumActiveTris), -ValenceBoostPower);
+    return Score;
+}
+
+} // namespace
+
+void OptimizeVertexCache(Uint32* pIndices, size_t NumIndices, Uint32 NumVertices)
+{
+    VERIFY(NumIndices % 3 == 0, "Triangle list is expected");
+    const size_t NumTris = NumIndices / 3;
+    if (NumTris == 0)
+        return;
+
+    // Triangles that use every vertex. Triangles that have been added to the output are moved
+    // past the first NumActiveTris[v] entries of the vertex range.
+    std::vector<Uint32> VertTrisStart(size_t{NumVertices} + 1);
+    std::vector<Uint32> NumActiveTris(NumVertices);
+    for (size_t i = 0; i < NumIndices; ++i)
+    {
+        VERIFY_EXPR(pIndices[i] < NumVertices);
+        ++NumActiveTris[pIndices[i]];
+    }
+    for (Uint32 v = 0; v < NumVertices; ++v)
+        VertTrisStart[v + 1] = VertTrisStart[v] + NumActiveTris[v];
+
+    std::vector<Uint32> VertTris(NumIndices);
+    {
+        std::vector<Uint32> NumTrisAdded(NumVertices);
+        for (size_t i = 0; i < NumIndices; ++i)
+        {
+            const Uint32 v = pIndices[i];
+
+            VertTris[VertTrisStart[v] + NumTrisAdded[v]++] = static_cast<Uint32>(i / 3);
+        }
+    }
+
+    std::vector<Int32> CachePos(NumVertices, -1);
+    std::vector<float> VertScore(NumVertices);
+    for (Uint32 v = 0; v < NumVertices; ++v)
+        VertScore[v] = ComputeVertexScore(-1, NumActiveTris[v]);
+
+    std::vector<float> TriScore(NumTris);
+    std::vector<bool>  TriAdded(NumTris, false);
+    for (size_t t = 0; t < NumTris; ++t)
+        TriScore[t] = VertScore[pIndices[t * 3 + 0]] + VertScore[pIndices[t * 3 + 1]] + VertScore[pIndices[t * 3 + 2]];
+
+    // The cache holds up to three more vertices than MaxCacheSize while the new triangle is being added
+    std::vector<Uint32> Cache, NewCache;
+    Cache.reserve(MaxCacheSize + 3);
+    NewCache.reserve(MaxCacheSize + 3);
+
+    std::vector<Uint32> OptimizedIndices;
+    OptimizedIndices.reserve(NumIndices);
+
+    constexpr size_t InvalidTri    = ~size_t{0};
+    size_t           BestTri       = InvalidTri;
+    size_t           FirstNotAdded = 0;
+    for (size_t NumTrisAdded = 0; NumTrisAdded < NumTris; ++NumTrisAdded)
+    {
+        if (BestTri == InvalidTri)
+        {
+            // No triangle in the cache can be added - find the best remaining triangle.
+            // This happens rarely: at the start and when the current region is exhausted.
+            while (TriAdded[FirstNotAdded])
+                ++FirstNotAdded;
+
+            float BestScore = -1;
+            for (size_t t = FirstNotAdded; t < NumTris; ++t)
+            {
+                if (!TriAdded[t] && TriScore[t] > BestScore)
+                {
+                    BestScore = TriScore[t];
+                    BestTri   = t;
+                }
+            }
+        }
+        VERIFY_EXPR(BestTri != InvalidTri && !TriAdded[BestTri]);
+
+        // Add the triangle to the output and remove it from the active triangles of its vertices
+        TriAdded[BestTri]      = true;
+        const Uint32* TriVerts = &pIndices[BestTri * 3];
+        for (Uint32 i = 0; i < 3; ++i)
+        {
+            const Uint32 v = TriVerts[i];
+            OptimizedIndices.push_back(v);
+
+            Uint32* pVertTris = &VertTris[VertTrisStart[v]];
+            Uint32  Last      = --NumActiveTris[v];
+            for (Uint32 j = 0; j < Last; ++j)
+            {
+                if (pVertTris[j] == BestTri)
+                {
+                    std::swap(pVertTris[j], pVertTris[Last]);
+                    break;
+                }
+            }
+        }
+
+        // The vertices of the new triangle go to the front of the cache
+        NewCache.assign(TriVerts, TriVerts + 3);
+        for (Uint32 v : Cache)
+        {
+            if (v != TriVerts[0] && v != TriVerts[1] && v != TriVerts[2])
+                NewCache.push_back(v);
+        }
+
+        // Update the scores of all vertices that were in the cache, and of the triangles that use them
+        BestTri         = InvalidTri;
+        float BestScore = -1;
+        for (Uint32 i = 0; i < NewCache.size(); ++i)
+        {
+            const Uint32 v = NewCache[i];
+            CachePos[v]    = i < MaxCacheSize ? static_cast<Int32>(i) : -1;
+            VertScore[v]   = ComputeVertexScore(CachePos[v], NumActiveTris[v]);
+        }
+        for (Uint32 v : NewCache)
+        {
+            for (Uint32 j = 0; j < NumActiveTris[v]; ++j)
+            {
+                const Uint32  t      = VertTris[VertTrisStart[v] + j];
+                const Uint32* pVerts = &pIndices[size_t{t} * 3];
+
+                TriScore[t] = VertScore[pVerts[0]] + VertScore[pVerts[1]] + VertScore[pVerts[2]];
+                if (TriScore[t] > BestScore)
+                {
+                    BestScore = TriScore[t];
+                    BestTri   = t;
+                }
+            }
+        }
+
+        if (NewCache.size() > MaxCacheSize)
+            NewCache.resize(MaxCacheSize);
+        std::swap(Cache, NewCache);
+    }
+
+    std::copy(OptimizedIndices.begin(), OptimizedIndices.end(), pIndices);
+}
+
+} // namespace Diligent
@@ -273,14 +273,14 @@ RefCntAutoPtr<IPipelineState> CreatePipelineState(const CreatePSOInfo& CreateInf
 
     // Shader variables should typically be mutable, which means they are expected
     // to change on a per-instance basis
-    // clang-format off
-    ShaderResourceVariableDesc Vars[] = 
-    {
-        {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
-    };
-    // clang-format on
-    ResourceLayout.Variables    = Vars;
-    ResourceLayout.NumVariables = _countof(Vars);
+    std::vector<ShaderResourceVariableDesc> Vars =
+        {
+            {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+    for (Uint32 i = 0; i < CreateInfo.NumExtraVariables; ++i)
+        Vars.push_back(CreateInfo.ExtraVariables[i]);
+
+    ResourceLayout.Variables    = Vars.data();
+    ResourceLayout.NumVariables = static_cast<Uint32>(Vars.size());
 
     // Define immutable sampler for g_Texture. Immutable samplers should be used whenever possible
     // clang-format off
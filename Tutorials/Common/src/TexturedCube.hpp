@@ -78,6 +78,8 @@ struct CreatePSOInfo
     VERTEX_COMPONENT_FLAGS           Components             = VERTEX_COMPONENT_FLAG_NONE;
     LayoutElement*                   ExtraLayoutElements    = nullptr;
     Uint32                           NumExtraLayoutElements = 0;
+    ShaderResourceVariableDesc*      ExtraVariables         = nullptr;
+    Uint32                           NumExtraVariables      = 0;
     Uint8                            SampleCount            = 1;
 };
 RefCntAutoPtr<IPipelineState> CreatePipelineState(const CreatePSOInfo& CreateInfo, bool ConvertPSOutputToGamma = false);
@@ -34,6 +34,7 @@
 #include "GraphicsUtilities.h"
 #include "TextureUtilities.h"
 #include "ColorConversion.h"
+#include "Align.hpp"
 #include "../../Common/src/TexturedCube.hpp"
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
@@ -79,21 +80,24 @@ void Tutorial06_Multithreading::CreatePipelineState(std::vector<StateTransitionD
     CubePsoCI.PSFilePath           = "cube.psh";
     CubePsoCI.Components           = TexturedCube::VERTEX_COMPONENT_FLAG_POS_UV;
 
+    // Instance constants are bound with a different offset for every draw, which requires
+    // a mutable or dynamic variable.
+    ShaderResourceVariableDesc InstanceDataVar{SHADER_TYPE_VERTEX, "InstanceData", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE};
+    CubePsoCI.ExtraVariables    = &InstanceDataVar;
+    CubePsoCI.NumExtraVariables = 1;
+
     m_pPSO = TexturedCube::CreatePipelineState(CubePsoCI, m_ConvertPSOutputToGamma);
 
     // Create dynamic uniform buffer that will store our transformation matrix
     // Dynamic buffers can be frequently updated by the CPU
     CreateUniformBuffer(m_pDevice, sizeof(float4x4) * 2, "VS constants CB", &m_VSConstants);
-    CreateUniformBuffer(m_pDevice, sizeof(float4x4), "Instance constants CB", &m_InstanceConstants);
-    // Explicitly transition the buffers to RESOURCE_STATE_CONSTANT_BUFFER state
+    // Explicitly transition the buffer to RESOURCE_STATE_CONSTANT_BUFFER state
     Barriers.emplace_back(m_VSConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
-    Barriers.emplace_back(m_InstanceConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
 
-    // Since we did not explicitly specify the type for 'Constants' and 'InstanceData' variables,
-    // default type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables
+    // Since we did not explicitly specify the type for 'Constants' variable, default
+    // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables
     // never change and are bound directly to the pipeline state object.
     m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
-    m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "InstanceData")->Set(m_InstanceConstants);
 }
 
 void Tutorial06_Multithreading::LoadTextures(std::vector<StateTransitionDesc>& Barriers)
@@ -112,14 +116,38 @@ void Tutorial06_Multithreading::LoadTextures(std::vector<StateTransitionDesc>& B
         // Transition textures to shader resource state
         Barriers.emplace_back(SrcTex, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
+}
 
-    // Set texture SRV in the SRB
-    for (int tex = 0; tex < NumTextures; ++tex)
+void Tutorial06_Multithreading::CreateInstanceConstants()
+{
+    // Every subset is rendered by its own context, and the instance constants of all its draws
+    // are allocated from the ring buffer at once. The largest subset is the last one.
+    const Uint32 NumSubsets    = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
+    const Uint32 NumInstances  = static_cast<Uint32>(m_InstanceData.size());
+    const Uint32 MaxSubsetSize = NumInstances - NumInstances / NumSubsets * (NumSubsets - 1);
+    const Uint32 Stride        = AlignUp(Uint32{sizeof(float4x4)}, FrameRingAllocator::GetOffsetAlignment(m_pDevice, BIND_UNIFORM_BUFFER));
+    m_InstanceConstants.Create(m_pDevice, "Instance constants CB", BIND_UNIFORM_BUFFER, Uint64{Stride} * MaxSubsetSize, NumSubsets);
+
+    // Explicitly transition the buffer to RESOURCE_STATE_CONSTANT_BUFFER state
+    StateTransitionDesc Barrier{m_InstanceConstants.GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+
+    m_SRB.clear();
+    m_SRB.resize(NumSubsets);
+    for (auto& SubsetSRBs : m_SRB)
     {
-        // Create one Shader Resource Binding for every texture
-        // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
-        m_pPSO->CreateShaderResourceBinding(&m_SRB[tex], true);
-        m_SRB[tex]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
+        for (int tex = 0; tex < NumTextures; ++tex)
+        {
+            // Create one Shader Resource Binding for every texture
+            // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
+            auto& SRB = SubsetSRBs[tex];
+            m_pPSO->CreateShaderResourceBinding(&SRB.pSRB, true);
+            SRB.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
+
+            // The range covers one instance. RenderSubset() moves it to the instance data of every draw.
+            SRB.pInstanceDataVar = SRB.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "InstanceData");
+            SRB.pInstanceDataVar->SetBufferRange(m_InstanceConstants.GetBuffer(), 0, Stride);
+        }
     }
 }
 
@@ -131,6 +159,7 @@ void Tutorial06_Multithreading::UpdateUI()
         if (ImGui::SliderInt("Grid Size", &m_GridSize, 1, 32))
         {
             PopulateInstanceData();
+            CreateInstanceConstants();
         }
         {
             ImGui::ScopedDisabler Disable(m_MaxThreads == 0);
@@ -224,6 +253,9 @@ void Tutorial06_Multithreading::StartWorkerThreads(size_t NumThreads)
         m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
     }
     m_CmdLists.resize(NumThreads);
+
+    // The number of subsets has changed
+    CreateInstanceConstants();
 }
 
 void Tutorial06_Multithreading::StopWorkerThreads()
@@ -322,26 +354,41 @@ void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset
     Uint32 SusbsetSize  = NumInstances / NumSubsets;
     Uint32 StartInst    = SusbsetSize * Subset;
     Uint32 EndInst      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : NumInstances;
-    for (size_t inst = StartInst; inst < EndInst; ++inst)
+
+    // Write the matrices of all instances of the subset with a single map instead of mapping
+    // the buffer for every draw. Every draw then selects its matrix by offset.
+    const Uint32 Stride = AlignUp(Uint32{sizeof(float4x4)}, m_InstanceConstants.GetAlignment());
+
+    FrameRingAllocator::Allocation InstData;
+    if (m_InstanceConstants.Begin(pCtx, Subset))
+        InstData = m_InstanceConstants.Allocate(Subset, Stride * (EndInst - StartInst));
+    if (InstData)
+    {
+        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
+        {
+            auto* pMatrix = reinterpret_cast<float4x4*>(static_cast<Uint8*>(InstData.pData) + Stride * (inst - StartInst));
+            *pMatrix      = m_InstanceData[inst].Matrix;
+        }
+    }
+    m_InstanceConstants.End(pCtx, Subset);
+    if (!InstData)
+    {
+        LOG_ERROR_MESSAGE("Failed to allocate instance data");
+        return;
+    }
+
+    for (Uint32 inst = StartInst; inst < EndInst; ++inst)
     {
         const auto& CurrInstData = m_InstanceData[inst];
+        const auto& SRB          = m_SRB[Subset][CurrInstData.TextureInd];
+        SRB.pInstanceDataVar->SetBufferOffset(InstData.Offset + Stride * (inst - StartInst));
+
         // Shader resources have been explicitly transitioned to correct states, so
         // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
         // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
         // verify that all resources are in correct states. This mode only has effect
         // in debug and development builds.
-        pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-
-        {
-            // Map the buffer and write current world-view-projection matrix
-            MapHelper<float4x4> InstData(pCtx, m_InstanceConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-            if (InstData == nullptr)
-            {
-                LOG_ERROR_MESSAGE("Failed to map instance data buffer");
-                break;
-            }
-            *InstData = CurrInstData.Matrix;
-        }
+        pCtx->CommitShaderResources(SRB.pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
         pCtx->DrawIndexed(DrawAttrs);
     }
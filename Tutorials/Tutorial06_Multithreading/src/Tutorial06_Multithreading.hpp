@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <vector>
 #include <thread>
@@ -34,6 +35,7 @@
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
 #include "ThreadSignal.hpp"
+#include "FrameRingAllocator.hpp"
 
 namespace Diligent
 {
@@ -55,6 +57,7 @@ private:
     void LoadTextures(std::vector<StateTransitionDesc>& Barriers);
     void UpdateUI();
     void PopulateInstanceData();
+    void CreateInstanceConstants();
 
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
@@ -76,13 +79,21 @@ private:
     RefCntAutoPtr<IPipelineState> m_pPSO;
     RefCntAutoPtr<IBuffer>        m_CubeVertexBuffer;
     RefCntAutoPtr<IBuffer>        m_CubeIndexBuffer;
-    RefCntAutoPtr<IBuffer>        m_InstanceConstants;
     RefCntAutoPtr<IBuffer>        m_VSConstants;
 
+    // Instance matrices of all draws of a subset are written with a single map
+    FrameRingAllocator m_InstanceConstants;
+
     static constexpr int NumTextures = 4;
 
-    RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
-    RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
+    struct InstanceSRB
+    {
+        RefCntAutoPtr<IShaderResourceBinding> pSRB;
+        IShaderResourceVariable*              pInstanceDataVar = nullptr;
+    };
+    // Every subset selects its instance constants by offset, so it needs its own SRBs
+    std::vector<std::array<InstanceSRB, NumTextures>> m_SRB;
+    RefCntAutoPtr<ITextureView>                       m_TextureSRV[NumTextures];
 
     float4x4 m_ViewProjMatrix;
     float4x4 m_RotationMatrix;
@@ -33,13 +33,13 @@
 #include <cstdlib>
 
 #include "Tutorial09_Quads.hpp"
-#include "MapHelper.hpp"
 #include "GraphicsUtilities.h"
 #include "TextureUtilities.h"
 #include "ColorConversion.h"
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
 #include "CommandLineParser.hpp"
+#include "Align.hpp"
 
 namespace Diligent
 {
@@ -52,6 +52,7 @@ SampleBase* CreateSample()
 Tutorial09_Quads::~Tutorial09_Quads()
 {
     StopWorkerThreads();
+    m_FramePipeline.Stop();
 }
 
 Tutorial09_Quads::CommandLineStatus Tutorial09_Quads::ProcessCommandLine(int argc, const char* const* argv)
@@ -162,12 +163,6 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
         ShaderCI.Desc.Name = "Quad VS Batched";
         ShaderCI.FilePath  = "quad_batch.vsh";
         m_pDevice->CreateShader(ShaderCI, &pVSBatched);
-
-        // Create dynamic uniform buffer that will store our transformation matrix
-        // Dynamic buffers can be frequently updated by the CPU
-        CreateUniformBuffer(m_pDevice, sizeof(float4x4), "Instance constants CB", &m_QuadAttribsCB);
-        // Explicitly transition the buffer to RESOURCE_STATE_CONSTANT_BUFFER state
-        Barriers.emplace_back(m_QuadAttribsCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
 
     // Create pixel shaders
@@ -194,10 +189,12 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
 
     // clang-format off
     // Shader variables should typically be mutable, which means they are expected
-    // to change on a per-instance basis
+    // to change on a per-instance basis. Quad attributes are bound with a different
+    // offset for every draw, which also requires a mutable or dynamic variable.
     ShaderResourceVariableDesc Vars[] = 
     {
-        {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+        {SHADER_TYPE_PIXEL,  "g_Texture",   SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_VERTEX, "QuadAttribs", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
     };
     // clang-format on
     PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
@@ -221,12 +218,6 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
     {
         PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
         m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO[0][state]);
-
-        // Since we did not explicitly specify the type for 'QuadAttribs' variable, default
-        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
-        // change and are bound directly to the pipeline state object.
-        m_pPSO[0][state]->GetStaticVariableByName(SHADER_TYPE_VERTEX, "QuadAttribs")->Set(m_QuadAttribsCB);
-
         if (state > 0)
             VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]), "PSOs are expected to be compatible");
     }
@@ -252,6 +243,9 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
     PSOCreateInfo.pVS = pVSBatched;
     PSOCreateInfo.pPS = pPSBatched;
 
+    // Batched shaders read quad attributes from the vertex buffer
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = 1;
+
     for (int state = 0; state < NumStates; ++state)
     {
         PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
@@ -317,15 +311,6 @@ void Tutorial09_Quads::LoadTextures(std::vector<StateTransitionDesc>& Barriers)
     // Transition all textures to shader resource state
     Barriers.emplace_back(pTexArray, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
 
-    // Set texture SRV in the SRB
-    for (int tex = 0; tex < NumTextures; ++tex)
-    {
-        // Create one Shader Resource Binding for every texture
-        // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
-        m_pPSO[0][0]->CreateShaderResourceBinding(&m_SRB[tex], true);
-        m_SRB[tex]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
-    }
-
     m_pPSO[1][0]->CreateShaderResourceBinding(&m_BatchSRB, true);
     m_BatchSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TexArraySRV);
 }
@@ -338,7 +323,10 @@ void Tutorial09_Quads::UpdateUI()
         if (ImGui::InputInt("Num Quads", &m_NumQuads, 100, 1000, ImGuiInputTextFlags_EnterReturnsTrue))
         {
             m_NumQuads = clamp(m_NumQuads, 1, MaxQuads);
+            m_FramePipeline.Stop();
             InitializeQuads();
+            CreateInstanceBuffer();
+            StartFramePipeline();
         }
         if (ImGui::InputInt("Batch Size", &m_BatchSize, 1, 5))
         {
@@ -353,6 +341,17 @@ void Tutorial09_Quads::UpdateUI()
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
+        if (ImGui::SliderInt("Pipeline Depth", &m_PipelineDepth, 1, MaxPipelineDepth))
+        {
+            StartFramePipeline();
+        }
+
+        const auto& Stats = m_FramePipeline.GetStats();
+        ImGui::Text("Latency:       %.2f ms", Stats.LatencyMs);
+        ImGui::Text("Throughput:    %.1f fps", Stats.FramesPerSecond);
+        ImGui::Text("Simulation:    %.2f ms", Stats.SimulationMs);
+        ImGui::Text("Sim. wait:     %.2f ms", Stats.ProducerWaitMs);
+        ImGui::Text("Render wait:   %.2f ms", Stats.ConsumerWaitMs);
     }
     ImGui::End();
 }
@@ -371,13 +370,19 @@ void Tutorial09_Quads::Initialize(const SampleInitInfo& InitInfo)
     m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 
     InitializeQuads();
-
-    if (m_BatchSize > 1)
-        CreateInstanceBuffer();
+    StartFramePipeline();
 
     StartWorkerThreads(m_NumWorkerThreads);
 }
 
+void Tutorial09_Quads::StartFramePipeline()
+{
+    // Frames that have been simulated but not rendered are discarded
+    m_FramePipeline.Start(static_cast<Uint32>(m_PipelineDepth), [this](FrameQuads& Frame, Uint64, double ElapsedTime) {
+        SimulateFrame(Frame, ElapsedTime);
+    });
+}
+
 void Tutorial09_Quads::InitializeQuads()
 {
     m_Quads.resize(m_NumQuads);
@@ -415,9 +420,8 @@ void Tutorial09_Quads::UpdateQuads(float elapsedTime)
                       // to generate consistent distribution.
 
     std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int quad = 0; quad < m_NumQuads; ++quad)
+    for (auto& CurrInst : m_Quads)
     {
-        auto& CurrInst = m_Quads[quad];
         CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
         if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
         {
@@ -434,6 +438,36 @@ void Tutorial09_Quads::UpdateQuads(float elapsedTime)
     }
 }
 
+void Tutorial09_Quads::SimulateFrame(FrameQuads& Frame, double ElapsedTime)
+{
+    UpdateQuads(static_cast<float>(std::min(ElapsedTime, 0.25)));
+
+    Frame.resize(m_Quads.size());
+    for (size_t quad = 0; quad < m_Quads.size(); ++quad)
+    {
+        const auto& CurrInstData = m_Quads[quad];
+
+        // clang-format off
+        float2x2 ScaleMatr
+        {
+            CurrInstData.Size,               0.f,
+            0.f,               CurrInstData.Size
+        };
+        // clang-format on
+        float    sinAngle = sinf(CurrInstData.Angle);
+        float    cosAngle = cosf(CurrInstData.Angle);
+        float2x2 RotMatr(cosAngle, -sinAngle,
+                         sinAngle, cosAngle);
+        auto     Matr = ScaleMatr * RotMatr;
+
+        auto& FrameQuad                = Frame[quad];
+        FrameQuad.QuadRotationAndScale = float4{Matr.m00, Matr.m10, Matr.m01, Matr.m11};
+        FrameQuad.Pos                  = CurrInstData.Pos;
+        FrameQuad.TextureInd           = CurrInstData.TextureInd;
+        FrameQuad.StateInd             = CurrInstData.StateInd;
+    }
+}
+
 void Tutorial09_Quads::StartWorkerThreads(size_t NumThreads)
 {
     m_WorkerThreads.resize(NumThreads);
@@ -442,6 +476,9 @@ void Tutorial09_Quads::StartWorkerThreads(size_t NumThreads)
         m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
     }
     m_CmdLists.resize(NumThreads);
+
+    // The number of subsets has changed
+    CreateInstanceBuffer();
 }
 
 void Tutorial09_Quads::StopWorkerThreads()
@@ -519,92 +556,88 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
     pCtx->SetRenderTargets(1, &pRTV, m_pSwapChain->GetDepthBufferDSV(), RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
-    if (UseBatch)
-    {
-        IBuffer* pBuffs[] = {m_BatchDataBuffer};
-        pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
-    }
     DrawAttribs DrawAttrs;
     DrawAttrs.Flags       = DRAW_FLAG_VERIFY_ALL;
     DrawAttrs.NumVertices = 4;
 
     Uint32       NumSubsets   = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalQuads   = static_cast<Uint32>(m_Quads.size());
+    const auto&  Quads        = *m_pFrameQuads;
+    const Uint32 TotalQuads   = static_cast<Uint32>(Quads.size());
     const Uint32 TotalBatches = (TotalQuads + m_BatchSize - 1) / m_BatchSize;
     const Uint32 SusbsetSize  = TotalBatches / NumSubsets;
     const Uint32 StartBatch   = SusbsetSize * Subset;
     const Uint32 EndBatch     = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
+    const Uint32 StartQuad    = StartBatch * m_BatchSize;
+    const Uint32 EndQuad      = std::min(EndBatch * static_cast<Uint32>(m_BatchSize), TotalQuads);
+
+    // Write the data of all quads of the subset with a single map instead of mapping
+    // a buffer for every draw. Every draw then selects its data by offset.
+    auto&        QuadDataRing = UseBatch ? m_BatchData : m_QuadAttribs;
+    const Uint32 Stride       = UseBatch ?
+        static_cast<Uint32>(sizeof(InstanceData)) :
+        AlignUp(Uint32{sizeof(QuadAttribs)}, QuadDataRing.GetAlignment());
+
+    FrameRingAllocator::Allocation QuadData;
+    if (QuadDataRing.Begin(pCtx, Subset))
+        QuadData = QuadDataRing.Allocate(Subset, Stride * (EndQuad - StartQuad));
+    if (QuadData)
+    {
+        for (Uint32 inst = StartQuad; inst < EndQuad; ++inst)
+        {
+            const auto& CurrInstData = Quads[inst];
+
+            auto* pDst = static_cast<Uint8*>(QuadData.pData) + Stride * (inst - StartQuad);
+            if (UseBatch)
+            {
+                auto& CurrQuad                = *reinterpret_cast<InstanceData*>(pDst);
+                CurrQuad.QuadRotationAndScale = CurrInstData.QuadRotationAndScale;
+                CurrQuad.QuadCenter           = CurrInstData.Pos;
+                CurrQuad.TexArrInd            = static_cast<float>(CurrInstData.TextureInd);
+            }
+            else
+            {
+                auto& Attribs                  = *reinterpret_cast<QuadAttribs*>(pDst);
+                Attribs.g_QuadRotationAndScale = CurrInstData.QuadRotationAndScale;
+                Attribs.g_QuadCenter           = float4{CurrInstData.Pos.x, CurrInstData.Pos.y, 0, 0};
+            }
+        }
+    }
+    QuadDataRing.End(pCtx, Subset);
+    if (!QuadData)
+    {
+        LOG_ERROR_MESSAGE("Failed to allocate quad data");
+        return;
+    }
+
     for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
     {
-        const Uint32 StartInst = batch * m_BatchSize;
-        const Uint32 EndInst   = std::min(StartInst + static_cast<Uint32>(m_BatchSize), static_cast<Uint32>(m_NumQuads));
+        const Uint32 StartInst  = batch * m_BatchSize;
+        const Uint32 EndInst    = std::min(StartInst + static_cast<Uint32>(m_BatchSize), TotalQuads);
+        const Uint32 DataOffset = QuadData.Offset + Stride * (StartInst - StartQuad);
 
         // Set the pipeline state
-        auto StateInd = m_Quads[StartInst].StateInd;
+        auto StateInd = Quads[StartInst].StateInd;
         pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
 
-        MapHelper<InstanceData> BatchData;
+        // Shader resources have been explicitly transitioned to correct states, so
+        // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
+        // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
+        // verify that all resources are in correct states. This mode only has effect
+        // in debug and development builds
         if (UseBatch)
         {
+            IBuffer* pBuffs[]  = {m_BatchData.GetBuffer()};
+            Uint64   Offsets[] = {DataOffset};
+            pCtx->SetVertexBuffers(0, _countof(pBuffs), pBuffs, Offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
             pCtx->CommitShaderResources(m_BatchSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-            BatchData.Map(pCtx, m_BatchDataBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
         }
-
-        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
+        else
         {
-            const auto& CurrInstData = m_Quads[inst];
-            // Shader resources have been explicitly transitioned to correct states, so
-            // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
-            // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
-            // verify that all resources are in correct states. This mode only has effect
-            // in debug and development builds
-            if (!UseBatch)
-                pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-
-            {
-                // clang-format off
-                float2x2 ScaleMatr
-                {
-                    CurrInstData.Size,               0.f,
-                    0.f,               CurrInstData.Size
-                };
-                // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
-                float2x2 RotMatr(cosAngle, -sinAngle,
-                                 sinAngle, cosAngle);
-                auto     Matr = ScaleMatr * RotMatr;
-
-                float4 QuadRotationAndScale(Matr.m00, Matr.m10, Matr.m01, Matr.m11);
-
-                if (UseBatch)
-                {
-                    auto& CurrQuad                = BatchData[inst - StartInst];
-                    CurrQuad.QuadRotationAndScale = QuadRotationAndScale;
-                    CurrQuad.QuadCenter           = CurrInstData.Pos;
-                    CurrQuad.TexArrInd            = static_cast<float>(CurrInstData.TextureInd);
-                }
-                else
-                {
-                    struct QuadAttribs
-                    {
-                        float4 g_QuadRotationAndScale;
-                        float4 g_QuadCenter;
-                    };
-
-                    // Map the buffer and write current world-view-projection matrix
-                    MapHelper<QuadAttribs> InstData(pCtx, m_QuadAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-
-                    InstData->g_QuadRotationAndScale = QuadRotationAndScale;
-                    InstData->g_QuadCenter.x         = CurrInstData.Pos.x;
-                    InstData->g_QuadCenter.y         = CurrInstData.Pos.y;
-                }
-            }
+            const auto& SRB = m_SRB[Subset][Quads[StartInst].TextureInd];
+            SRB.pQuadAttribsVar->SetBufferOffset(DataOffset);
+            pCtx->CommitShaderResources(SRB.pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
         }
 
-        if (UseBatch)
-            BatchData.Unmap();
-
         DrawAttrs.NumInstances = EndInst - StartInst;
         pCtx->Draw(DrawAttrs);
     }
@@ -625,6 +658,9 @@ void Tutorial09_Quads::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
+    // Take the oldest simulated frame. The simulation thread keeps working on the next frames meanwhile.
+    m_pFrameQuads = &m_FramePipeline.AcquireFrame();
+
     if (!m_WorkerThreads.empty())
     {
         m_NumThreadsCompleted.store(0);
@@ -657,22 +693,54 @@ void Tutorial09_Quads::Render()
         m_NumThreadsReady.store(0);
         m_GotoNextFrameSignal.Trigger(true);
     }
+
+    // All commands of the frame have been recorded and the quad data has been copied to the GPU buffers
+    m_FramePipeline.ReleaseFrame();
+    m_pFrameQuads = nullptr;
 }
 
 void Tutorial09_Quads::CreateInstanceBuffer()
 {
-    // Create instance data buffer that will store transformation matrices
-    BufferDesc InstBuffDesc;
-    InstBuffDesc.Name = "Batch data buffer";
-    // Use default usage as this buffer will only be updated when grid size changes
-    InstBuffDesc.Usage          = USAGE_DYNAMIC;
-    InstBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
-    InstBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-    InstBuffDesc.Size           = sizeof(InstanceData) * m_BatchSize;
-    m_BatchDataBuffer.Release();
-    m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_BatchDataBuffer);
-    StateTransitionDesc Barrier(m_BatchDataBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
-    m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+    // Every subset is rendered by its own context, and the data of all its quads is allocated
+    // from the ring buffer at once. The largest subset is the last one.
+    const Uint32 NumSubsets       = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
+    const Uint32 TotalBatches     = (static_cast<Uint32>(m_NumQuads) + m_BatchSize - 1) / m_BatchSize;
+    const Uint32 MaxSubsetBatches = TotalBatches - TotalBatches / NumSubsets * (NumSubsets - 1);
+    const Uint32 MaxSubsetQuads   = MaxSubsetBatches * static_cast<Uint32>(m_BatchSize);
+
+    if (m_BatchSize > 1)
+    {
+        // Per-instance data is read from the vertex buffer
+        m_BatchData.Create(m_pDevice, "Batch data buffer", BIND_VERTEX_BUFFER, Uint64{sizeof(InstanceData)} * MaxSubsetQuads, NumSubsets);
+        StateTransitionDesc Barrier(m_BatchData.GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+    }
+    else
+    {
+        const Uint32 Stride = AlignUp(Uint32{sizeof(QuadAttribs)}, FrameRingAllocator::GetOffsetAlignment(m_pDevice, BIND_UNIFORM_BUFFER));
+        m_QuadAttribs.Create(m_pDevice, "Quad attribs CB", BIND_UNIFORM_BUFFER, Uint64{Stride} * MaxSubsetQuads, NumSubsets);
+        // Explicitly transition the buffer to RESOURCE_STATE_CONSTANT_BUFFER state
+        StateTransitionDesc Barrier(m_QuadAttribs.GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+
+        m_SRB.clear();
+        m_SRB.resize(NumSubsets);
+        for (auto& SubsetSRBs : m_SRB)
+        {
+            for (int tex = 0; tex < NumTextures; ++tex)
+            {
+                // Create one Shader Resource Binding for every texture
+                // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
+                auto& SRB = SubsetSRBs[tex];
+                m_pPSO[0][0]->CreateShaderResourceBinding(&SRB.pSRB, true);
+                SRB.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
+
+                // The range covers one quad. RenderSubset() moves it to the attributes of every draw.
+                SRB.pQuadAttribsVar = SRB.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "QuadAttribs");
+                SRB.pQuadAttribsVar->SetBufferRange(m_QuadAttribs.GetBuffer(), 0, Stride);
+            }
+        }
+    }
 }
 
 void Tutorial09_Quads::Update(double CurrTime, double ElapsedTime)
@@ -680,7 +748,7 @@ void Tutorial09_Quads::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
     UpdateUI();
 
-    UpdateQuads(static_cast<float>(std::min(ElapsedTime, 0.25)));
+    // Quads are updated by the frame pipeline
 }
 
 } // namespace Diligent
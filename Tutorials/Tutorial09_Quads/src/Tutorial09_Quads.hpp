@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <vector>
 #include <thread>
@@ -34,6 +35,8 @@
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
 #include "ThreadSignal.hpp"
+#include "FrameRingAllocator.hpp"
+#include "FramePipeline.hpp"
 
 namespace Diligent
 {
@@ -62,6 +65,7 @@ private:
     void InitializeQuads();
     void CreateInstanceBuffer();
     void UpdateQuads(float elapsedTime);
+    void StartFramePipeline();
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
     template <bool UseBatch>
@@ -82,14 +86,23 @@ private:
 
     static constexpr int          NumStates = 5;
     RefCntAutoPtr<IPipelineState> m_pPSO[2][NumStates];
-    RefCntAutoPtr<IBuffer>        m_QuadAttribsCB;
-    RefCntAutoPtr<IBuffer>        m_BatchDataBuffer;
 
-    static constexpr int                  NumTextures = 4;
-    RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
-    RefCntAutoPtr<IShaderResourceBinding> m_BatchSRB;
-    RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
-    RefCntAutoPtr<ITextureView>           m_TexArraySRV;
+    // Quad data of all draws of a subset is written with a single map
+    FrameRingAllocator m_QuadAttribs;
+    FrameRingAllocator m_BatchData;
+
+    static constexpr int NumTextures = 4;
+
+    struct QuadSRB
+    {
+        RefCntAutoPtr<IShaderResourceBinding> pSRB;
+        IShaderResourceVariable*              pQuadAttribsVar = nullptr;
+    };
+    // Every subset selects its quad attributes by offset, so it needs its own SRBs
+    std::vector<std::array<QuadSRB, NumTextures>> m_SRB;
+    RefCntAutoPtr<IShaderResourceBinding>         m_BatchSRB;
+    RefCntAutoPtr<ITextureView>                   m_TextureSRV[NumTextures];
+    RefCntAutoPtr<ITextureView>                   m_TexArraySRV;
 
     static constexpr int MaxQuads     = 100000;
     static constexpr int MaxBatchSize = 100;
@@ -110,14 +123,41 @@ private:
         int    TextureInd = 0;
         int    StateInd   = 0;
     };
+    // Only accessed by the simulation thread while the frame pipeline is running
     std::vector<QuadData> m_Quads;
 
+    // Everything the render thread needs to draw a quad
+    struct QuadFrameData
+    {
+        float4 QuadRotationAndScale;
+        float2 Pos;
+        int    TextureInd = 0;
+        int    StateInd   = 0;
+    };
+    using FrameQuads = std::vector<QuadFrameData>;
+    void SimulateFrame(FrameQuads& Frame, double ElapsedTime);
+
+    // Quads are simulated on a separate thread up to m_PipelineDepth - 1 frames
+    // ahead of the frame that is being rendered
+    FramePipeline<FrameQuads> m_FramePipeline;
+    const FrameQuads*         m_pFrameQuads = nullptr;
+
+    static constexpr int MaxPipelineDepth = 4;
+
+    int m_PipelineDepth = 2;
+
     struct InstanceData
     {
         float4 QuadRotationAndScale;
         float2 QuadCenter;
         float  TexArrInd;
     };
+
+    struct QuadAttribs
+    {
+        float4 g_QuadRotationAndScale;
+        float4 g_QuadCenter;
+    };
 };
 
 } // namespace Diligent
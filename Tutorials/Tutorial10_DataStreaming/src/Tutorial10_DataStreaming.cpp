@@ -34,6 +34,7 @@
 
 #include "Tutorial10_DataStreaming.hpp"
 #include "MapHelper.hpp"
+#include "Align.hpp"
 #include "GraphicsUtilities.h"
 #include "TextureUtilities.h"
 #include "ColorConversion.h"
@@ -162,7 +163,8 @@ void Tutorial10_DataStreaming::ModifyEngineInitInfo(const ModifyEngineInitInfoAt
     {
         auto& EngineVkCI = static_cast<EngineVkCreateInfo&>(Attribs.EngineCI);
 
-        EngineVkCI.DynamicHeapSize     = 128 << 20;
+        // Up to 1M polygons are streamed every frame
+        EngineVkCI.DynamicHeapSize     = 256 << 20;
         EngineVkCI.DynamicHeapPageSize = 2 << 20;
     }
 #endif
@@ -244,12 +246,6 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
         ShaderCI.Desc.Name = "Polygon VS Batched";
         ShaderCI.FilePath  = "polygon_batch.vsh";
         m_pDevice->CreateShader(ShaderCI, &pVSBatched);
-
-        // Create dynamic uniform buffer that will store our transformation matrix
-        // Dynamic buffers can be frequently updated by the CPU
-        CreateUniformBuffer(m_pDevice, sizeof(float4x4), "Instance constants CB", &m_PolygonAttribsCB);
-        // Transition the buffer to RESOURCE_STATE_CONSTANT_BUFFER state
-        Barriers.emplace_back(m_PolygonAttribsCB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     }
 
     // Create a pixel shader
@@ -283,11 +279,13 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
 
     // Shader variables should typically be mutable, which means they are expected
-    // to change on a per-instance basis
+    // to change on a per-instance basis. Polygon attributes are selected by buffer offset,
+    // which is not allowed for static variables.
     // clang-format off
     ShaderResourceVariableDesc Vars[] = 
     {
-        {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+        {SHADER_TYPE_PIXEL,  "g_Texture",      SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_VERTEX, "PolygonAttribs", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
     };
     PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
     PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
@@ -310,10 +308,6 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     {
         PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
         m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO[0][state]);
-        // Since we did not explicitly specify the type for 'PolygonAttribs' variable, default
-        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
-        // change and are bound directly to the pipeline state object.
-        m_pPSO[0][state]->GetStaticVariableByName(SHADER_TYPE_VERTEX, "PolygonAttribs")->Set(m_PolygonAttribsCB);
 
         if (state > 0)
             VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]), "PSOs are expected to be compatible");
@@ -342,6 +336,9 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     PSOCreateInfo.pVS = pVSBatched;
     PSOCreateInfo.pPS = pPSBatched;
 
+    // Batched shaders read polygon attributes from the vertex buffer
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = 1;
+
     for (int state = 0; state < NumStates; ++state)
     {
         PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
@@ -407,15 +404,6 @@ void Tutorial10_DataStreaming::LoadTextures(std::vector<StateTransitionDesc>& Ba
     // Transition texture array to shader resource state
     Barriers.emplace_back(pTexArray, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
 
-    // Set texture SRV in the SRB
-    for (int tex = 0; tex < NumTextures; ++tex)
-    {
-        // Create one Shader Resource Binding for every texture
-        // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
-        m_pPSO[0][0]->CreateShaderResourceBinding(&m_SRB[tex], true);
-        m_SRB[tex]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
-    }
-
     m_pPSO[1][0]->CreateShaderResourceBinding(&m_BatchSRB, true);
     m_BatchSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TexArraySRV);
 }
@@ -425,7 +413,7 @@ void Tutorial10_DataStreaming::UpdateUI()
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
     if (ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
     {
-        if (ImGui::InputInt("Num Polygons", &m_NumPolygons, 100, 1000, ImGuiInputTextFlags_EnterReturnsTrue))
+        if (ImGui::InputInt("Num Polygons", &m_NumPolygons, 1000, 100000, ImGuiInputTextFlags_EnterReturnsTrue))
         {
             m_NumPolygons = clamp(m_NumPolygons, 1, MaxPolygons);
             InitializePolygons();
@@ -433,7 +421,6 @@ void Tutorial10_DataStreaming::UpdateUI()
         if (ImGui::InputInt("Batch Size", &m_BatchSize, 1, 5))
         {
             m_BatchSize = clamp(m_BatchSize, 1, MaxBatchSize);
-            CreateInstanceBuffer();
         }
         {
             ImGui::ScopedDisabler Disable(m_MaxThreads == 0);
@@ -448,6 +435,10 @@ void Tutorial10_DataStreaming::UpdateUI()
         {
             ImGui::Checkbox("Persistent map", &m_bAllowPersistentMap);
         }
+
+        ImGui::Text("Throughput: %.2f M polygons/s", m_PolygonsPerSecond * 1e-6);
+        ImGui::Text("Streaming:  %.1f MB/s", m_StreamedMBPerSec);
+        ImGui::Text("Chunks:     %.1f / frame", m_ChunksPerFrame);
     }
     ImGui::End();
 }
@@ -471,14 +462,13 @@ void Tutorial10_DataStreaming::Initialize(const SampleInitInfo& InitInfo)
     Barriers.emplace_back(m_StreamingVB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
     Barriers.emplace_back(m_StreamingIB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
 
+    CreatePolygonDataBuffers(Barriers);
+
     InitializePolygonGeometry();
     InitializePolygons();
 
     m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 
-    if (m_BatchSize > 1)
-        CreateInstanceBuffer();
-
     StartWorkerThreads(m_NumWorkerThreads);
 }
 
@@ -506,9 +496,17 @@ void Tutorial10_DataStreaming::InitializePolygonGeometry()
     }
 }
 
+void Tutorial10_DataStreaming::PolygonArrays::Resize(size_t Count)
+{
+    for (auto* pArray : {&PosX, &PosY, &MoveDirX, &MoveDirY, &Size, &Angle, &RotSpeed})
+        pArray->resize(Count);
+    for (auto* pArray : {&TextureInd, &StateInd, &NumVerts})
+        pArray->resize(Count);
+}
+
 void Tutorial10_DataStreaming::InitializePolygons()
 {
-    m_Polygons.resize(m_NumPolygons);
+    m_Polygons.Resize(m_NumPolygons);
 
     std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
                       // to generate consistent distribution.
@@ -522,61 +520,64 @@ void Tutorial10_DataStreaming::InitializePolygons()
     std::uniform_int_distribution<Int32>  state_distr(0, NumStates - 1);
     std::uniform_int_distribution<Int32>  num_verts_distr(MinPolygonVerts, MaxPolygonVerts);
 
+    auto& P = m_Polygons;
     for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
     {
-        auto& CurrInst     = m_Polygons[Polygon];
-        CurrInst.Size      = scale_distr(gen);
-        CurrInst.Angle     = angle_distr(gen);
-        CurrInst.Pos.x     = pos_distr(gen);
-        CurrInst.Pos.y     = pos_distr(gen);
-        CurrInst.MoveDir.x = move_dir_distr(gen);
-        CurrInst.MoveDir.y = move_dir_distr(gen);
-        CurrInst.RotSpeed  = rot_distr(gen);
+        P.Size[Polygon]     = scale_distr(gen);
+        P.Angle[Polygon]    = angle_distr(gen);
+        P.PosX[Polygon]     = pos_distr(gen);
+        P.PosY[Polygon]     = pos_distr(gen);
+        P.MoveDirX[Polygon] = move_dir_distr(gen);
+        P.MoveDirY[Polygon] = move_dir_distr(gen);
+        P.RotSpeed[Polygon] = rot_distr(gen);
         // Texture array index
-        CurrInst.TextureInd = tex_distr(gen);
-        CurrInst.StateInd   = state_distr(gen);
-        CurrInst.NumVerts   = num_verts_distr(gen);
+        P.TextureInd[Polygon] = static_cast<Uint8>(tex_distr(gen));
+        P.StateInd[Polygon]   = static_cast<Uint8>(state_distr(gen));
+        P.NumVerts[Polygon]   = static_cast<Uint8>(num_verts_distr(gen));
     }
 }
 
-std::pair<Diligent::Uint32, Diligent::Uint32> Tutorial10_DataStreaming::WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum)
+// Returns the new rotation speed of a polygon that bounced off the window border.
+// The value is a hash of the polygon index and the frame number rather than the next value of
+// a shared generator, so polygons can be updated by any thread in any order.
+static float BounceRotationSpeed(Uint32 Polygon, Uint32 Frame)
 {
-    // Request memory for vertices and indices
-    auto  VBOffset   = m_StreamingVB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Verts.size()) * sizeof(float2), CtxNum);
-    auto  IBOffset   = m_StreamingIB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Inds.size()) * sizeof(Uint32), CtxNum);
-    auto* VertexData = reinterpret_cast<float2*>(reinterpret_cast<Uint8*>(m_StreamingVB->GetMappedCPUAddress(CtxNum)) + VBOffset);
-    auto* IndexData  = reinterpret_cast<Uint32*>(reinterpret_cast<Uint8*>(m_StreamingIB->GetMappedCPUAddress(CtxNum)) + IBOffset);
-    memcpy(VertexData, PolygonGeo.Verts.data(), PolygonGeo.Verts.size() * sizeof(float2));
-    memcpy(IndexData, PolygonGeo.Inds.data(), PolygonGeo.Inds.size() * sizeof(Uint32));
-
-    m_StreamingVB->Release(CtxNum);
-    m_StreamingIB->Release(CtxNum);
-
-    return {VBOffset, IBOffset};
+    Uint32 h = Polygon * 0x9E3779B1u ^ Frame * 0x85EBCA77u;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    // Map the upper 24 bits to [-PI/2, +PI/2)
+    return (static_cast<float>(h >> 8) * (1.f / 16777216.f) - 0.5f) * PI_F;
 }
 
-void Tutorial10_DataStreaming::UpdatePolygons(float elapsedTime)
+void Tutorial10_DataStreaming::UpdatePolygons(Uint32 StartPolygon, Uint32 EndPolygon)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
-
-    std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
-    {
-        auto& CurrInst = m_Polygons[Polygon];
-        CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
-        if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
+    const float  dt    = m_ElapsedTime;
+    const Uint32 Frame = m_FrameIndex;
+
+    float* const PosX     = m_Polygons.PosX.data();
+    float* const PosY     = m_Polygons.PosY.data();
+    float* const MoveDirX = m_Polygons.MoveDirX.data();
+    float* const MoveDirY = m_Polygons.MoveDirY.data();
+    float* const Angle    = m_Polygons.Angle.data();
+    float* const RotSpeed = m_Polygons.RotSpeed.data();
+    for (Uint32 Polygon = StartPolygon; Polygon < EndPolygon; ++Polygon)
+    {
+        Angle[Polygon] += RotSpeed[Polygon] * dt;
+        if (std::abs(PosX[Polygon] + MoveDirX[Polygon] * dt) > 0.95f)
         {
-            CurrInst.MoveDir.x *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
+            MoveDirX[Polygon] *= -1.f;
+            RotSpeed[Polygon] = BounceRotationSpeed(Polygon, Frame);
         }
-        CurrInst.Pos.x += CurrInst.MoveDir.x * elapsedTime;
-        if (std::abs(CurrInst.Pos.y + CurrInst.MoveDir.y * elapsedTime) > 0.95)
+        PosX[Polygon] += MoveDirX[Polygon] * dt;
+        if (std::abs(PosY[Polygon] + MoveDirY[Polygon] * dt) > 0.95f)
         {
-            CurrInst.MoveDir.y *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
+            MoveDirY[Polygon] *= -1.f;
+            RotSpeed[Polygon] = BounceRotationSpeed(Polygon, Frame);
         }
-        CurrInst.Pos.y += CurrInst.MoveDir.y * elapsedTime;
+        PosY[Polygon] += MoveDirY[Polygon] * dt;
     }
 }
 
@@ -588,6 +589,7 @@ void Tutorial10_DataStreaming::StartWorkerThreads(size_t NumThreads)
         m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
     }
     m_CmdLists.resize(NumThreads);
+    m_SubsetStats.assign(1 + NumThreads, SubsetStats{});
 }
 
 void Tutorial10_DataStreaming::StopWorkerThreads()
@@ -669,94 +671,152 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     DrawAttrs.Flags     = DRAW_FLAG_VERIFY_ALL;
 
     Uint32       NumSubsets    = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.size());
-    const Uint32 TotalBatches  = (TotalPolygons + m_BatchSize - 1) / m_BatchSize;
+    const Uint32 TotalPolygons = static_cast<Uint32>(m_NumPolygons);
+    const Uint32 BatchSize     = static_cast<Uint32>(m_BatchSize);
+    const Uint32 TotalBatches  = (TotalPolygons + BatchSize - 1) / BatchSize;
     const Uint32 SusbsetSize   = TotalBatches / NumSubsets;
     const Uint32 StartBatch    = SusbsetSize * Subset;
     const Uint32 EndBatch      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
-    for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
-    {
-        const Uint32 StartInst = batch * m_BatchSize;
-        const Uint32 EndInst   = std::min(StartInst + static_cast<Uint32>(m_BatchSize), static_cast<Uint32>(m_NumPolygons));
 
-        // Set pipeline state
-        auto StateInd = m_Polygons[StartInst].StateInd;
-        pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
+    // Every subset updates its own polygons, so the simulation runs on all threads in parallel
+    UpdatePolygons(std::min(StartBatch * BatchSize, TotalPolygons), std::min(EndBatch * BatchSize, TotalPolygons));
 
-        const auto&  PolygonGeo = m_PolygonGeo[m_Polygons[StartInst].NumVerts];
-        auto         Offsets    = WritePolygon(PolygonGeo, pCtx, Subset);
-        const Uint64 offsets[]  = {Offsets.first, 0};
-        IBuffer*     pBuffs[]   = {m_StreamingVB->GetBuffer(), m_BatchDataBuffer};
-        pCtx->SetVertexBuffers(0, UseBatch ? 2 : 1, pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+    const auto&  P             = m_Polygons;
+    auto&        PolygonData   = UseBatch ? m_BatchData : m_PolygonAttribs;
+    const Uint32 Stride        = UseBatch ?
+        static_cast<Uint32>(sizeof(InstanceData)) :
+        AlignUp(Uint32{sizeof(PolygonAttribs)}, PolygonData.GetAlignment());
+    const Uint32 MaxIndsInStreamingBuffer = MaxVertsInStreamingBuffer * 3;
 
-        pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), Offsets.second, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+    auto& Stats = m_SubsetStats[Subset];
+    Stats       = {};
+    for (Uint32 ChunkStartBatch = StartBatch; ChunkStartBatch < EndBatch;)
+    {
+        // Find the batches that fit into the streaming buffers and the polygon data ring
+        const Uint32 ChunkStartInst = ChunkStartBatch * BatchSize;
 
-        MapHelper<InstanceData> BatchData;
-        if (UseBatch)
+        Uint32 ChunkEndBatch = ChunkStartBatch;
+        Uint32 NumChunkVerts = 0;
+        Uint32 NumChunkInds  = 0;
+        for (; ChunkEndBatch < EndBatch; ++ChunkEndBatch)
         {
-            pCtx->CommitShaderResources(m_BatchSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
-            BatchData.Map(pCtx, m_BatchDataBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+            const Uint32 StartInst = ChunkEndBatch * BatchSize;
+            const Uint32 EndInst   = std::min(StartInst + BatchSize, TotalPolygons);
+            const Uint32 NumVerts  = P.NumVerts[StartInst];
+            const Uint32 NumInds   = (NumVerts - 2) * 3;
+            if (ChunkEndBatch > ChunkStartBatch &&
+                (NumChunkVerts + NumVerts > MaxVertsInStreamingBuffer ||
+                 NumChunkInds + NumInds > MaxIndsInStreamingBuffer ||
+                 EndInst - ChunkStartInst > MaxPolygonsPerChunk))
+                break;
+            NumChunkVerts += NumVerts;
+            NumChunkInds += NumInds;
         }
+        const Uint32 ChunkEndInst = std::min(ChunkEndBatch * BatchSize, TotalPolygons);
+
+        // Write the geometry and the attributes of all polygons of the chunk with a single map of every buffer.
+        // The geometry is appended to the streaming buffers with MAP_FLAG_NO_OVERWRITE until they are full.
+        const Uint32 VBOffset = m_StreamingVB->Allocate(pCtx, NumChunkVerts * Uint32{sizeof(float2)}, Subset);
+        const Uint32 IBOffset = m_StreamingIB->Allocate(pCtx, NumChunkInds * Uint32{sizeof(Uint32)}, Subset);
+        auto*        pVerts   = static_cast<Uint8*>(m_StreamingVB->GetMappedCPUAddress(Subset));
+        auto*        pInds    = static_cast<Uint8*>(m_StreamingIB->GetMappedCPUAddress(Subset));
 
-        for (Uint32 inst = StartInst; inst < EndInst; ++inst)
+        FrameRingAllocator::Allocation ChunkData;
+        if (PolygonData.Begin(pCtx, Subset))
+            ChunkData = PolygonData.Allocate(Subset, Stride * (ChunkEndInst - ChunkStartInst));
+
+        const bool DataMapped = pVerts != nullptr && pInds != nullptr && ChunkData;
+        if (DataMapped)
         {
-            const auto& CurrInstData = m_Polygons[inst];
-            // Shader resources have been explicitly transitioned to correct states, so
-            // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
-            // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
-            // verify that all resources are in correct states. This mode only has effect
-            // in debug and development builds
-            if (!UseBatch)
-                pCtx->CommitShaderResources(m_SRB[CurrInstData.TextureInd], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            auto* pDstVerts = reinterpret_cast<float2*>(pVerts + VBOffset);
+            auto* pDstInds  = reinterpret_cast<Uint32*>(pInds + IBOffset);
+            for (Uint32 batch = ChunkStartBatch; batch < ChunkEndBatch; ++batch)
+            {
+                const auto& PolygonGeo = m_PolygonGeo[P.NumVerts[batch * BatchSize]];
+                memcpy(pDstVerts, PolygonGeo.Verts.data(), PolygonGeo.Verts.size() * sizeof(float2));
+                memcpy(pDstInds, PolygonGeo.Inds.data(), PolygonGeo.Inds.size() * sizeof(Uint32));
+                pDstVerts += PolygonGeo.Verts.size();
+                pDstInds += PolygonGeo.Inds.size();
+            }
 
+            for (Uint32 inst = ChunkStartInst; inst < ChunkEndInst; ++inst)
             {
-                // clang-format off
-                float2x2 ScaleMatr
-                {   
-                    CurrInstData.Size, 0.f,
-                    0.f,               CurrInstData.Size
-                };
-                // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
-                float2x2 RotMatr(cosAngle, -sinAngle,
-                                 sinAngle, cosAngle);
-
-                auto Matr = ScaleMatr * RotMatr;
-
-                float4 PolygonRotationAndScale(Matr.m00, Matr.m10, Matr.m01, Matr.m11);
+                const float Size     = P.Size[inst];
+                const float sinAngle = sinf(P.Angle[inst]);
+                const float cosAngle = cosf(P.Angle[inst]);
+                // Scale * Rotation matrix, packed as (m00, m10, m01, m11)
+                const float4 PolygonRotationAndScale{Size * cosAngle, Size * sinAngle, -Size * sinAngle, Size * cosAngle};
 
+                auto* pDst = static_cast<Uint8*>(ChunkData.pData) + Stride * (inst - ChunkStartInst);
                 if (UseBatch)
                 {
-                    auto& CurrPolygon                   = BatchData[inst - StartInst];
+                    auto& CurrPolygon                   = *reinterpret_cast<InstanceData*>(pDst);
                     CurrPolygon.PolygonRotationAndScale = PolygonRotationAndScale;
-                    CurrPolygon.PolygonCenter           = CurrInstData.Pos;
-                    CurrPolygon.TexArrInd               = static_cast<float>(CurrInstData.TextureInd);
+                    CurrPolygon.PolygonCenter           = float2{P.PosX[inst], P.PosY[inst]};
+                    CurrPolygon.TexArrInd               = static_cast<float>(P.TextureInd[inst]);
                 }
                 else
                 {
-                    struct PolygonAttribs
-                    {
-                        float4 g_PolygonRotationAndScale;
-                        float4 g_PolygonCenter;
-                    };
-
-                    // Map the buffer and write current world-view-projection matrix
-                    MapHelper<PolygonAttribs> InstData(pCtx, m_PolygonAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-
-                    InstData->g_PolygonRotationAndScale = PolygonRotationAndScale;
-                    InstData->g_PolygonCenter.x         = CurrInstData.Pos.x;
-                    InstData->g_PolygonCenter.y         = CurrInstData.Pos.y;
+                    auto& Attribs                     = *reinterpret_cast<PolygonAttribs*>(pDst);
+                    Attribs.g_PolygonRotationAndScale = PolygonRotationAndScale;
+                    Attribs.g_PolygonCenter           = float4{P.PosX[inst], P.PosY[inst], 0, 0};
                 }
             }
         }
+        m_StreamingVB->Release(Subset);
+        m_StreamingIB->Release(Subset);
+        PolygonData.End(pCtx, Subset);
+        if (!DataMapped)
+        {
+            LOG_ERROR_MESSAGE("Failed to map polygon data");
+            break;
+        }
 
-        if (UseBatch)
-            BatchData.Unmap();
+        Stats.StreamedBytes += NumChunkVerts * sizeof(float2) + NumChunkInds * sizeof(Uint32) + Stride * (ChunkEndInst - ChunkStartInst);
+        Stats.NumChunks += 1;
 
-        DrawAttrs.NumIndices   = static_cast<Uint32>(PolygonGeo.Inds.size());
-        DrawAttrs.NumInstances = EndInst - StartInst;
-        pCtx->DrawIndexed(DrawAttrs);
+        Uint32 BatchVBOffset = VBOffset;
+        Uint32 BatchIBOffset = IBOffset;
+        for (Uint32 batch = ChunkStartBatch; batch < ChunkEndBatch; ++batch)
+        {
+            const Uint32 StartInst  = batch * BatchSize;
+            const Uint32 EndInst    = std::min(StartInst + BatchSize, TotalPolygons);
+            const Uint32 DataOffset = ChunkData.Offset + Stride * (StartInst - ChunkStartInst);
+            const auto&  PolygonGeo = m_PolygonGeo[P.NumVerts[StartInst]];
+
+            // Set pipeline state
+            pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][P.StateInd[StartInst]]);
+
+            const Uint64 offsets[] = {BatchVBOffset, DataOffset};
+            IBuffer*     pBuffs[]  = {m_StreamingVB->GetBuffer(), m_BatchData.GetBuffer()};
+            pCtx->SetVertexBuffers(0, UseBatch ? 2 : 1, pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+            pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), BatchIBOffset, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+            // Shader resources have been explicitly transitioned to correct states, so
+            // RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode is not needed.
+            // Instead, we use RESOURCE_STATE_TRANSITION_MODE_VERIFY mode to
+            // verify that all resources are in correct states. This mode only has effect
+            // in debug and development builds
+            if (UseBatch)
+            {
+                pCtx->CommitShaderResources(m_BatchSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            }
+            else
+            {
+                const auto& SRB = m_SRB[Subset][P.TextureInd[StartInst]];
+                SRB.pPolygonAttribsVar->SetBufferOffset(DataOffset);
+                pCtx->CommitShaderResources(SRB.pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            }
+
+            DrawAttrs.NumIndices   = static_cast<Uint32>(PolygonGeo.Inds.size());
+            DrawAttrs.NumInstances = EndInst - StartInst;
+            pCtx->DrawIndexed(DrawAttrs);
+
+            BatchVBOffset += static_cast<Uint32>(PolygonGeo.Verts.size() * sizeof(float2));
+            BatchIBOffset += static_cast<Uint32>(PolygonGeo.Inds.size() * sizeof(Uint32));
+        }
+
+        ChunkStartBatch = ChunkEndBatch;
     }
 
     m_StreamingVB->Flush(Subset);
@@ -813,20 +873,45 @@ void Tutorial10_DataStreaming::Render()
         m_NumThreadsReady.store(0);
         m_GotoNextFrameSignal.Trigger(true);
     }
+
+    // Worker threads have finished the subsets, so their statistics can be read
+    for (const auto& Stats : m_SubsetStats)
+    {
+        m_StatsBytes += Stats.StreamedBytes;
+        m_StatsChunks += Stats.NumChunks;
+    }
+    ++m_StatsFrames;
 }
 
-void Tutorial10_DataStreaming::CreateInstanceBuffer()
+void Tutorial10_DataStreaming::CreatePolygonDataBuffers(std::vector<StateTransitionDesc>& Barriers)
 {
-    // Create instance data buffer that will store transformation matrices
-    BufferDesc InstBuffDesc;
-    InstBuffDesc.Name = "Batch data buffer";
-    // Use default usage as this buffer will only be updated when grid size changes
-    InstBuffDesc.Usage          = USAGE_DYNAMIC;
-    InstBuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
-    InstBuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-    InstBuffDesc.Size           = sizeof(InstanceData) * m_BatchSize;
-    m_BatchDataBuffer.Release();
-    m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_BatchDataBuffer);
+    // Every context, including the immediate one, allocates the data of one chunk at a time
+    const Uint32 NumContextSlots = 1 + static_cast<Uint32>(m_pDeferredContexts.size());
+
+    // Per-instance data of batched draws is read from the vertex buffer
+    m_BatchData.Create(m_pDevice, "Batch data buffer", BIND_VERTEX_BUFFER, Uint64{sizeof(InstanceData)} * MaxPolygonsPerChunk, NumContextSlots);
+    Barriers.emplace_back(m_BatchData.GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+
+    const Uint32 Stride = AlignUp(Uint32{sizeof(PolygonAttribs)}, FrameRingAllocator::GetOffsetAlignment(m_pDevice, BIND_UNIFORM_BUFFER));
+    m_PolygonAttribs.Create(m_pDevice, "Polygon attribs CB", BIND_UNIFORM_BUFFER, Uint64{Stride} * MaxPolygonsPerChunk, NumContextSlots);
+    Barriers.emplace_back(m_PolygonAttribs.GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
+
+    m_SRB.resize(NumContextSlots);
+    for (auto& CtxSRBs : m_SRB)
+    {
+        for (int tex = 0; tex < NumTextures; ++tex)
+        {
+            // Create one Shader Resource Binding for every texture
+            // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
+            auto& SRB = CtxSRBs[tex];
+            m_pPSO[0][0]->CreateShaderResourceBinding(&SRB.pSRB, true);
+            SRB.pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV[tex]);
+
+            // The range covers one polygon. RenderSubset() moves it to the attributes of every draw.
+            SRB.pPolygonAttribsVar = SRB.pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "PolygonAttribs");
+            SRB.pPolygonAttribsVar->SetBufferRange(m_PolygonAttribs.GetBuffer(), 0, Stride);
+        }
+    }
 }
 
 void Tutorial10_DataStreaming::Update(double CurrTime, double ElapsedTime)
@@ -834,7 +919,22 @@ void Tutorial10_DataStreaming::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
     UpdateUI();
 
-    UpdatePolygons(static_cast<float>(std::min(ElapsedTime, 0.25)));
+    // Polygons are updated by RenderSubset() on the thread that renders them
+    m_ElapsedTime = static_cast<float>(std::min(ElapsedTime, 0.25));
+    ++m_FrameIndex;
+
+    m_StatsTime += ElapsedTime;
+    if (m_StatsTime >= 0.5)
+    {
+        m_PolygonsPerSecond = static_cast<double>(m_NumPolygons) * m_StatsFrames / m_StatsTime;
+        m_StreamedMBPerSec  = static_cast<double>(m_StatsBytes) / (1 << 20) / m_StatsTime;
+        m_ChunksPerFrame    = m_StatsFrames > 0 ? static_cast<double>(m_StatsChunks) / m_StatsFrames : 0;
+
+        m_StatsTime   = 0;
+        m_StatsFrames = 0;
+        m_StatsBytes  = 0;
+        m_StatsChunks = 0;
+    }
 }
 
 } // namespace Diligent
@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <vector>
@@ -35,6 +36,7 @@
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
 #include "ThreadSignal.hpp"
+#include "FrameRingAllocator.hpp"
 
 namespace Diligent
 {
@@ -62,8 +64,8 @@ private:
 
     void InitializePolygons();
     void InitializePolygonGeometry();
-    void CreateInstanceBuffer();
-    void UpdatePolygons(float elapsedTime);
+    void CreatePolygonDataBuffers(std::vector<StateTransitionDesc>& Barriers);
+    void UpdatePolygons(Uint32 StartPolygon, Uint32 EndPolygon);
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
 
@@ -86,20 +88,31 @@ private:
 
     static constexpr const int    NumStates = 5;
     RefCntAutoPtr<IPipelineState> m_pPSO[2][NumStates];
-    RefCntAutoPtr<IBuffer>        m_PolygonAttribsCB;
-    RefCntAutoPtr<IBuffer>        m_BatchDataBuffer;
 
-    static constexpr const int             MaxVertsInStreamingBuffer = 1024;
+    static constexpr const Uint32          MaxVertsInStreamingBuffer = 1 << 16;
     std::unique_ptr<class StreamingBuffer> m_StreamingVB;
     std::unique_ptr<class StreamingBuffer> m_StreamingIB;
 
-    static constexpr int                  NumTextures = 4;
-    RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
-    RefCntAutoPtr<IShaderResourceBinding> m_BatchSRB;
-    RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
-    RefCntAutoPtr<ITextureView>           m_TexArraySRV;
+    // Polygons are streamed in chunks: the geometry and the per-draw data of all polygons
+    // of a chunk are written with a single map of every buffer
+    static constexpr const Uint32 MaxPolygonsPerChunk = 4096;
+    FrameRingAllocator            m_PolygonAttribs;
+    FrameRingAllocator            m_BatchData;
 
-    static constexpr int MaxPolygons  = 100000;
+    static constexpr int NumTextures = 4;
+
+    struct PolygonSRB
+    {
+        RefCntAutoPtr<IShaderResourceBinding> pSRB;
+        IShaderResourceVariable*              pPolygonAttribsVar = nullptr;
+    };
+    // Every context selects polygon attributes by offset, so it needs its own SRBs
+    std::vector<std::array<PolygonSRB, NumTextures>> m_SRB;
+    RefCntAutoPtr<IShaderResourceBinding>            m_BatchSRB;
+    RefCntAutoPtr<ITextureView>                      m_TextureSRV[NumTextures];
+    RefCntAutoPtr<ITextureView>                      m_TexArraySRV;
+
+    static constexpr int MaxPolygons  = 1000000;
     static constexpr int MaxBatchSize = 100;
 
     int m_NumPolygons = 1000;
@@ -108,18 +121,34 @@ private:
     int m_MaxThreads       = 8;
     int m_NumWorkerThreads = 4;
 
-    struct PolygonData
+    // Polygon data is kept in structure-of-arrays layout so that the update loop only
+    // touches the attributes it changes
+    struct PolygonArrays
     {
-        float2 Pos;
-        float2 MoveDir;
-        float  Size       = 0;
-        float  Angle      = 0;
-        float  RotSpeed   = 0;
-        int    TextureInd = 0;
-        int    StateInd   = 0;
-        int    NumVerts   = 0;
+        std::vector<float> PosX;
+        std::vector<float> PosY;
+        std::vector<float> MoveDirX;
+        std::vector<float> MoveDirY;
+        std::vector<float> Size;
+        std::vector<float> Angle;
+        std::vector<float> RotSpeed;
+        std::vector<Uint8> TextureInd;
+        std::vector<Uint8> StateInd;
+        std::vector<Uint8> NumVerts;
+
+        void Resize(size_t Count);
+    };
+    PolygonArrays m_Polygons;
+
+    // Polygons are updated by the thread that renders them, using the time step of the current frame
+    float  m_ElapsedTime = 0;
+    Uint32 m_FrameIndex  = 0;
+
+    struct PolygonAttribs
+    {
+        float4 g_PolygonRotationAndScale;
+        float4 g_PolygonCenter;
     };
-    std::vector<PolygonData> m_Polygons;
 
     struct InstanceData
     {
@@ -137,7 +166,22 @@ private:
     };
     std::vector<PolygonGeometry> m_PolygonGeo;
     bool                         m_bAllowPersistentMap = false;
-    std::pair<Uint32, Uint32>    WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum);
+
+    // Every subset only writes its own statistics
+    struct SubsetStats
+    {
+        Uint64 StreamedBytes = 0;
+        Uint32 NumChunks     = 0;
+    };
+    std::vector<SubsetStats> m_SubsetStats;
+
+    double m_StatsTime         = 0;
+    Uint32 m_StatsFrames       = 0;
+    Uint64 m_StatsBytes        = 0;
+    Uint64 m_StatsChunks       = 0;
+    double m_PolygonsPerSecond = 0;
+    double m_StreamedMBPerSec  = 0;
+    double m_ChunksPerFrame    = 0;
 };
 
 } // namespace Diligent
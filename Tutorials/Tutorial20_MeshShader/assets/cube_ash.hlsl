@@ -4,7 +4,13 @@
 #define SHOW_STATISTICS 1
 #endif
 
-// Statistics buffer contains the global counter of visible objects
+// Statistics buffer contains the global counters, see DrawStatistics in Tutorial20_MeshShader.hpp:
+//  0 - visible cubes
+//  4 - visible octree nodes
+//  8 - octree nodes tested
+// 12 - octree nodes culled by the frustum
+// 16 - voxels culled by the HiZ test
+// 20 - triangles emitted
 RWByteAddressBuffer Statistics : register(u0);
 
 // Ordered voxel position buffer
@@ -31,7 +37,7 @@ bool GetRenderOption(uint bit)
 bool IsInCameraFrustum(float4 basePosAndScale)
 {
     float4 center = float4(basePosAndScale.xyz, 1.0f);
-    float radius = 0.71f * abs(basePosAndScale.z);   // => diagonal (center-max point) = sqrt(2) * half_width / 4.0f | => 1/2 sqrt(2) * half_width
+    float radius = 0.8661f * basePosAndScale.w;   // => half of the cube diagonal = sqrt(3) / 2 * width
     
     for (int i = 0; i < 6; ++i)
     {
@@ -41,123 +47,84 @@ bool IsInCameraFrustum(float4 basePosAndScale)
     return true;
 }
 
-// Get themminium Z value, the minimum bound vertex poitions, and the perspectiveDivide for the given Z value
-float GetMinBoundVertex(float4 BasePosAndScale, out float4 minXmaxXminYmaxY)
+// Projects the box to the screen and returns its UV rectangle [minU, minV, maxU, maxV] and its closest depth.
+// Returns false if the box crosses the camera plane, in which case the rectangle is unbounded and
+// the box must be treated as visible.
+bool ProjectBox(float4 basePosAndScale, out float4 uvRect, out float minZ)
 {
-    float3 basePos = BasePosAndScale.xyz;
-    float halfScale = BasePosAndScale.w * 0.5;
-    
-    // Create all corner positions at once using vector operations
-    float4x3 corners1 = float4x3(
-        basePos + float3(-halfScale, -halfScale, -halfScale),
-        basePos + float3(-halfScale, -halfScale, halfScale),
-        basePos + float3(-halfScale, halfScale, -halfScale),
-        basePos + float3(-halfScale, halfScale, halfScale)
-    );
-    
-    float4x3 corners2 = float4x3(
-        basePos + float3(halfScale, -halfScale, -halfScale),
-        basePos + float3(halfScale, -halfScale, halfScale),
-        basePos + float3(halfScale, halfScale, -halfScale),
-        basePos + float3(halfScale, halfScale, halfScale)
-    );
-    
-    // Transform first batch
-    float4 clipPos1 = mul(float4(corners1[0].xyz, 1.0), g_Constants.ViewProjMat);
-    float4 clipPos2 = mul(float4(corners1[1].xyz, 1.0), g_Constants.ViewProjMat);
-    float4 clipPos3 = mul(float4(corners1[2].xyz, 1.0), g_Constants.ViewProjMat);
-    float4 clipPos4 = mul(float4(corners1[3].xyz, 1.0), g_Constants.ViewProjMat);
-        
-    clipPos1 /= clipPos1.w; clipPos1 = clamp(clipPos1, -1, 1);
-    clipPos2 /= clipPos2.w; clipPos2 = clamp(clipPos2, -1, 1);
-    clipPos3 /= clipPos3.w; clipPos3 = clamp(clipPos3, -1, 1);
-    clipPos4 /= clipPos4.w; clipPos4 = clamp(clipPos4, -1, 1);
-    
-    // Initialize min/max values with first batch
-    minXmaxXminYmaxY.x = min(min(clipPos1.x, clipPos2.x), min(clipPos3.x, clipPos4.x));
-    minXmaxXminYmaxY.y = max(max(clipPos1.x, clipPos2.x), max(clipPos3.x, clipPos4.x));
-    minXmaxXminYmaxY.z = min(min(clipPos1.y, clipPos2.y), min(clipPos3.y, clipPos4.y));
-    minXmaxXminYmaxY.w = max(max(clipPos1.y, clipPos2.y), max(clipPos3.y, clipPos4.y));
-    
-    float minZ = min(min(clipPos1.z, clipPos2.z), min(clipPos3.z, clipPos4.z));
-    
-    // Transform second batch
-    clipPos1 = mul(float4(corners2[0].xyz, 1.0), g_Constants.ViewProjMat);
-    clipPos2 = mul(float4(corners2[1].xyz, 1.0), g_Constants.ViewProjMat);
-    clipPos3 = mul(float4(corners2[2].xyz, 1.0), g_Constants.ViewProjMat);
-    clipPos4 = mul(float4(corners2[3].xyz, 1.0), g_Constants.ViewProjMat);
-    
-    clipPos1 /= clipPos1.w; clipPos1 = clamp(clipPos1, -1, 1);
-    clipPos2 /= clipPos2.w; clipPos2 = clamp(clipPos2, -1, 1);
-    clipPos3 /= clipPos3.w; clipPos3 = clamp(clipPos3, -1, 1);
-    clipPos4 /= clipPos4.w; clipPos4 = clamp(clipPos4, -1, 1);
-    
-    // Update min/max values with second batch
-    minXmaxXminYmaxY.x = min(min(min(clipPos1.x, clipPos2.x), min(clipPos3.x, clipPos4.x)), minXmaxXminYmaxY.x);
-    minXmaxXminYmaxY.y = max(max(max(clipPos1.x, clipPos2.x), max(clipPos3.x, clipPos4.x)), minXmaxXminYmaxY.y);
-    minXmaxXminYmaxY.z = min(min(min(clipPos1.y, clipPos2.y), min(clipPos3.y, clipPos4.y)), minXmaxXminYmaxY.z);
-    minXmaxXminYmaxY.w = max(max(max(clipPos1.y, clipPos2.y), max(clipPos3.y, clipPos4.y)), minXmaxXminYmaxY.w);
-    
-    float minZ2 = min(min(clipPos1.z, clipPos2.z), min(clipPos3.z, clipPos4.z));
-    
-    return saturate(min(minZ, minZ2));
-}
-
-// HiZ occlusion culling in linear ndc space
-bool IsVisible(OctreeLeafNode node, uint I)
-{    
-    if (node.VoxelBufDataCount == 0)    // empty nodes are ignored (can occur due to draw task alignment)
-        return false;
+    float halfScale = basePosAndScale.w * 0.5;
     
-    //                                                      Meshlet                                                         Octree Node
-    float4 worldPosAndScale = GetRenderOption(0) ? VoxelPositionBuffer[node.VoxelBufStartIndex + I].BasePosAndScale : node.BasePosAndScale;
-    //float4 worldPosAndScale = VoxelPositionBuffer[node.VoxelBufStartIndex + I].BasePosAndScale;
-    
-    // Calculate min Z value of the transformed bounding box
-    float4 clipPosVertices   = float4(0.f, 0.f, 0.f, 0.f); // also get min and max x- and y-values for screen-space box to check 
-    float  perspectiveDivide = 0.f;
-    float  minZ              = GetMinBoundVertex(worldPosAndScale, clipPosVertices);
-    
-    // Keep in mind, that maxY will be minY and the other way around, since clip space Y begins at the lower end of the screen,
-    // and screen space begins at the upper end of the screen
-    float2 upperLeftBounding    = float2(clipPosVertices.x, clipPosVertices.w);     // minX maxY
-    float2 upperRightBounding   = float2(clipPosVertices.y, clipPosVertices.w);     // maxX maxY
-    float2 lowerLeftBounding    = float2(clipPosVertices.x, clipPosVertices.z);     // minX minY
-    float2 lowerRightBounding   = float2(clipPosVertices.y, clipPosVertices.z);     // maxX minY
+    // Box corners in clip space are the projected center plus/minus the scaled matrix rows,
+    // which replaces eight full vertex transforms with one.
+    float4 center = mul(float4(basePosAndScale.xyz, 1.0), g_Constants.ViewProjMat);
+    float4 axisX  = g_Constants.ViewProjMat[0] * halfScale;
+    float4 axisY  = g_Constants.ViewProjMat[1] * halfScale;
+    float4 axisZ  = g_Constants.ViewProjMat[2] * halfScale;
     
-    // Now I have four ndc positions which are the corner positions of my minZ-rect
+    float minW = center.w - abs(axisX.w) - abs(axisY.w) - abs(axisZ.w);
+    if (minW <= 1e-5)
+    {
+        uvRect = float4(0.0, 0.0, 1.0, 1.0);
+        minZ   = 0.0;
+        return false;
+    }
     
-    // Convert NDC coordinates to UV space [0,1]
-    float2 upperLeftBoundingUV = float2(upperLeftBounding.x * 0.5 + 0.5, upperLeftBounding.y * -0.5 + 0.5);
-    float2 upperRightBoundingUV = float2(upperRightBounding.x * 0.5 + 0.5, upperRightBounding.y * -0.5 + 0.5);
-    float2 lowerLeftBoundingUV = float2(lowerLeftBounding.x * 0.5 + 0.5, lowerLeftBounding.y * -0.5 + 0.5);
-    float2 lowerRightBoundingUV = float2(lowerRightBounding.x * 0.5 + 0.5, lowerRightBounding.y * -0.5 + 0.5);
+    float2 ndcMin = float2(+1e+30, +1e+30);
+    float2 ndcMax = float2(-1e+30, -1e+30);
+    minZ = 1e+30;
     
+    [unroll]
+    for (uint i = 0; i < 8; ++i)
+    {
+        float4 corner = center + ((i & 1u) ? axisX : -axisX) + ((i & 2u) ? axisY : -axisY) + ((i & 4u) ? axisZ : -axisZ);
+        float3 ndc    = corner.xyz / corner.w;
+        
+        ndcMin = min(ndcMin, ndc.xy);
+        ndcMax = max(ndcMax, ndc.xy);
+        minZ   = min(minZ, ndc.z);
+    }
     
-    uint numLevels = 1; // At least one mip level is assumed
-    uint width = 0;
-    uint height = 0;
+    // All corners are in front of the camera, so clamping the rectangle is safe.
+    // Clip space Y points up while texture V points down.
+    ndcMin = clamp(ndcMin, -1.0, 1.0);
+    ndcMax = clamp(ndcMax, -1.0, 1.0);
+    uvRect = float4(ndcMin.x * 0.5 + 0.5, ndcMax.y * -0.5 + 0.5,
+                    ndcMax.x * 0.5 + 0.5, ndcMin.y * -0.5 + 0.5);
+    minZ   = saturate(minZ);
+    return true;
+}
+
+// HiZ occlusion culling in linear ndc space
+bool IsBoxVisible(float4 worldPosAndScale)
+{
+    float4 uvRect;
+    float  minZ;
+    if (!ProjectBox(worldPosAndScale, uvRect, minZ))
+        return true;
     
-    uint outVar;
+    uint width     = 0;
+    uint height    = 0;
+    uint numLevels = 1;
     HiZPyramid.GetDimensions(0, width, height, numLevels);
-  
-    float2 boxSizeUV = float2(
-        max(upperRightBoundingUV.x, lowerRightBoundingUV.x) - min(upperLeftBoundingUV.x, lowerLeftBoundingUV.x),
-        max(upperLeftBoundingUV.y, upperRightBoundingUV.y) - min(lowerLeftBoundingUV.y, lowerRightBoundingUV.y)) * 
-        float2(width, height);
     
-    float boxPixelArea = boxSizeUV.x * boxSizeUV.y;
-    float idealMipLevel = log2(sqrt(boxPixelArea));
+    uint2 dims  = uint2(width, height);
+    uint2 minPx = min(uint2(uvRect.xy * float2(dims)), dims - 1);
+    uint2 maxPx = min(uint2(uvRect.zw * float2(dims)), dims - 1);
     
-    uint targetMipLevel = uint(min(max(round(idealMipLevel), 0), numLevels - 1));
+    // Select the finest mip where a texel is at least as large as the rectangle, so that
+    // the rectangle always falls into a 2x2 texel footprint.
+    uint extent    = max(maxPx.x - minPx.x, maxPx.y - minPx.y);
+    uint targetMip = extent > 1 ? firstbithigh(extent - 1) + 1 : 0;
+    targetMip      = min(targetMip, numLevels - 1);
     
-    uint2 texDims;
-    HiZPyramid.GetDimensions(targetMipLevel, texDims.x, texDims.y, outVar);
+    uint2 mipDims = max(dims >> targetMip, uint2(1, 1));
+    uint2 minTex  = min(minPx >> targetMip, mipDims - 1);
+    uint2 maxTex  = min(maxPx >> targetMip, mipDims - 1);
     
-    float hiZDepthUL = HiZPyramid.Load(int3(uint2(upperLeftBoundingUV * texDims), targetMipLevel));
-    float hiZDepthUR = HiZPyramid.Load(int3(uint2(upperRightBoundingUV * texDims), targetMipLevel));
-    float hiZDepthLL = HiZPyramid.Load(int3(uint2(lowerLeftBoundingUV * texDims), targetMipLevel));
-    float hiZDepthLR = HiZPyramid.Load(int3(uint2(lowerRightBoundingUV * texDims), targetMipLevel));
+    float hiZDepthUL = HiZPyramid.Load(int3(minTex.x, minTex.y, targetMip));
+    float hiZDepthUR = HiZPyramid.Load(int3(maxTex.x, minTex.y, targetMip));
+    float hiZDepthLL = HiZPyramid.Load(int3(minTex.x, maxTex.y, targetMip));
+    float hiZDepthLR = HiZPyramid.Load(int3(maxTex.x, maxTex.y, targetMip));
     
     float maxHiZDepth = max(max(hiZDepthLL, hiZDepthLR), max(hiZDepthUL, hiZDepthUR));
 
@@ -166,10 +133,45 @@ bool IsVisible(OctreeLeafNode node, uint I)
     return !(maxHiZDepth < minZ && abs(maxHiZDepth - minZ) > 0.0000001f);
 }
 
+bool IsVisible(OctreeLeafNode node, uint I)
+{    
+    if (node.VoxelBufDataCount == 0)    // empty nodes are ignored (can occur due to draw task alignment)
+        return false;
+    
+    //                                                      Meshlet                                                         Octree Node
+    float4 worldPosAndScale = GetRenderOption(0) ? VoxelPositionBuffer[node.VoxelBufStartIndex + I].BasePosAndScale : node.BasePosAndScale;
+    
+    return IsBoxVisible(worldPosAndScale);
+}
+
+// Bounds of one of the 2x2x2 sub-blocks of the node
+float4 GetSubBlockPosAndScale(float4 nodePosAndScale, uint subBlock)
+{
+    float  quarterScale = nodePosAndScale.w * 0.25;
+    float3 offset       = float3((subBlock & 1u) ? quarterScale : -quarterScale,
+                                 (subBlock & 2u) ? quarterScale : -quarterScale,
+                                 (subBlock & 4u) ? quarterScale : -quarterScale);
+    return float4(nodePosAndScale.xyz + offset, nodePosAndScale.w * 0.5);
+}
+
+// Index of the 2x2x2 sub-block that contains the voxel center (same bit layout as AABB::Octant())
+uint GetSubBlockIndex(float4 nodePosAndScale, float3 voxelPos)
+{
+    return (voxelPos.x > nodePosAndScale.x ? 1u : 0u) |
+           (voxelPos.y > nodePosAndScale.y ? 2u : 0u) |
+           (voxelPos.z > nodePosAndScale.z ? 4u : 0u);
+}
+
 // The number of cubes that are visible by the camera,
 // computed by every thread group
 groupshared uint s_TaskCount;
 groupshared uint s_OctreeNodeCount;
+groupshared uint s_HiZCulledCount;
+
+// Hierarchical meshlet culling: the node is tested once, and if it is not occluded,
+// its 2x2x2 sub-blocks are tested by the first 8 threads. Voxels inherit the
+// visibility of the sub-block that contains them.
+groupshared uint s_SubBlockMask;
 
 [numthreads(GROUP_SIZE, 1, 1)]
 void main(in uint I  : SV_GroupIndex,
@@ -181,6 +183,7 @@ void main(in uint I  : SV_GroupIndex,
     {
         s_TaskCount = 0;
         s_OctreeNodeCount = 0;
+        s_HiZCulledCount = 0;
     }
 #endif
 
@@ -197,13 +200,61 @@ void main(in uint I  : SV_GroupIndex,
     int taskCount = (int) node.RandomValue.y;
     int padding = (int) node.RandomValue.z;
 
+    // Render options are uniform across the group, so the barriers below are not divergent
+    const bool hierarchicalCulling = GetRenderOption(1) && GetRenderOption(7);
+    if (hierarchicalCulling)
+    {
+        if (I == 0)
+        {
+            s_SubBlockMask = (node.VoxelBufDataCount > 0 && IsBoxVisible(node.BasePosAndScale)) ? 0xFFu : 0u;
+        }
+        GroupMemoryBarrierWithGroupSync();
+        
+        // Every node that passes is refined: the HiZ pyramid only stores the farthest depth, so a passing node
+        // can't be proven fully visible, and any of its sub-blocks may still be occluded. Occluded and empty
+        // nodes skip the sub-block tests.
+        const bool nodeVisible = s_SubBlockMask != 0;
+        GroupMemoryBarrierWithGroupSync();
+        
+        if (nodeVisible && I < 8)
+        {
+            if (!IsBoxVisible(GetSubBlockPosAndScale(node.BasePosAndScale, I)))
+                InterlockedAnd(s_SubBlockMask, ~(1u << I));
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
     // Access node indices for each thread    
+    const bool validVoxel = node.VoxelBufDataCount > 0 && I < node.VoxelBufDataCount;
+    const bool inFrustum  = GetRenderOption(2) == false || IsInCameraFrustum(node.BasePosAndScale);
+
+    bool notOccluded = true;
+    if (hierarchicalCulling)
+    {
+        notOccluded = false;
+        if (I < node.VoxelBufDataCount)
+        {
+            float3 voxelPos = VoxelPositionBuffer[node.VoxelBufStartIndex + I].BasePosAndScale.xyz;
+            notOccluded     = (s_SubBlockMask & (1u << GetSubBlockIndex(node.BasePosAndScale, voxelPos))) != 0;
+        }
+    }
+    else
+    {
+        notOccluded = GetRenderOption(1) == false || IsVisible(node, I);
+    }
+
     uint cullVoxel = 0;
-    cullVoxel += !(node.VoxelBufDataCount > 0);
-    cullVoxel += !(I < node.VoxelBufDataCount);
-    cullVoxel += (GetRenderOption(2) == true && IsInCameraFrustum(node.BasePosAndScale)) ? 0 : 1;
-    cullVoxel += (GetRenderOption(1) == false || IsVisible(node, I)) ? 0 : 1;
-    //cullVoxel += node.VoxelBufDataCount == GROUP_
+    cullVoxel += validVoxel ? 0 : 1;
+    cullVoxel += inFrustum ? 0 : 1;
+    cullVoxel += notOccluded ? 0 : 1;
+
+#if SHOW_STATISTICS
+    if (validVoxel && inFrustum && !notOccluded)
+    {
+        uint temp;
+        InterlockedAdd(s_HiZCulledCount, 1, temp);
+    }
+#endif
     
     if (cullVoxel == 0) // only draw valid voxels
     {
@@ -245,6 +296,12 @@ void main(in uint I  : SV_GroupIndex,
         
         uint orig_value_ocn_count;
         Statistics.InterlockedAdd(4, s_OctreeNodeCount, orig_value_ocn_count);
+
+        uint orig_value;
+        Statistics.InterlockedAdd(8, 1, orig_value);
+        Statistics.InterlockedAdd(12, inFrustum ? 0 : 1, orig_value);
+        Statistics.InterlockedAdd(16, s_HiZCulledCount, orig_value);
+        Statistics.InterlockedAdd(20, s_TaskCount * 12, orig_value); // 12 triangles per cube, see cube_msh.hlsl
 #endif
     }
     
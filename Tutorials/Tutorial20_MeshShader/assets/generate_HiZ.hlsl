@@ -29,6 +29,25 @@ void main(uint3 DTid : SV_DispatchThreadID)
     // Find the maximum Z value (assuming reverse Z -> nearest z value)
     float maxZ = max(max(z1, z2), max(z3, z4));
 
+    // For odd input dimensions the last output column/row also covers the remaining input texel,
+    // otherwise that texel would be missing from all coarser levels and culling would not be conservative.
+    bool extraColumn = DTid.x == OutputDimensions.x - 1 && InputPos.x + 2 < InputDimensions.x;
+    bool extraRow    = DTid.y == OutputDimensions.y - 1 && InputPos.y + 2 < InputDimensions.y;
+    if (extraColumn)
+    {
+        maxZ = max(maxZ, InputTexture[uint2(InputPos.x + 2, InputPos.y)]);
+        maxZ = max(maxZ, InputTexture[uint2(InputPos.x + 2, min(InputPos.y + 1, InputDimensions.y - 1))]);
+    }
+    if (extraRow)
+    {
+        maxZ = max(maxZ, InputTexture[uint2(InputPos.x, InputPos.y + 2)]);
+        maxZ = max(maxZ, InputTexture[uint2(min(InputPos.x + 1, InputDimensions.x - 1), InputPos.y + 2)]);
+    }
+    if (extraColumn && extraRow)
+    {
+        maxZ = max(maxZ, InputTexture[InputPos + uint2(2, 2)]);
+    }
+
     // Write the result
     OutputTexture[DTid.xy] = maxZ;
 }
\ No newline at end of file
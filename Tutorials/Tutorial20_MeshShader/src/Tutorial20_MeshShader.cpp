@@ -34,7 +34,10 @@
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
 #include "FastRand.hpp"
+#include "CommandLineParser.hpp"
+#include "Align.hpp"
 #include <set>
+#include <algorithm>
 #include <unordered_set>
 #include <d3d12.h>
 #include "../../../../DiligentCore/Graphics/GraphicsEngineD3D12/include/d3dx12_win.h"
@@ -54,12 +57,6 @@ namespace Diligent
     {
         #include "../assets/structures.fxh"
         
-        struct DrawStatistics
-        {
-            Uint32 visibleCubes;
-            Uint32 visibleOctreeNodes;
-        };
-        
         static_assert(sizeof(OctreeLeafNode) % 16 == 0, "Structure must be 16-byte aligned");
     
     } // namespace
@@ -130,21 +127,8 @@ namespace Diligent
         m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pStatisticsBuffer);
         VERIFY_EXPR(m_pStatisticsBuffer != nullptr);
     
-        // Staging buffer is needed to read the data from statistics buffer.
-    
-        BuffDesc.Name           = "Statistics staging buffer";
-        BuffDesc.Usage          = USAGE_STAGING;
-        BuffDesc.BindFlags      = BIND_NONE;
-        BuffDesc.Mode           = BUFFER_MODE_UNDEFINED;
-        BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
-        BuffDesc.Size           = sizeof(DrawStatistics) * m_StatisticsHistorySize;
-    
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pStatisticsStaging);
-        VERIFY_EXPR(m_pStatisticsStaging != nullptr);
-    
-        FenceDesc FDesc;
-        FDesc.Name = "Statistics available";
-        m_pDevice->CreateFence(FDesc, &m_pStatisticsAvailable);
+        // Staging ring is needed to read the data from statistics buffer without stalling.
+        m_StatisticsReadback.Create(m_pDevice, "Statistics staging buffer", m_StatisticsHistorySize);
     }
     
     void Tutorial20_MeshShader::CreateConstantsBuffer()
@@ -240,26 +224,55 @@ namespace Diligent
             task.RandomValue.x = Rnd();
             task.RandomValue.y = 0;
             task.RandomValue.z = 0;
-            VERIFY_EXPR(task.BasePosAndScale.w >= 4);
+            VERIFY_EXPR(task.BasePosAndScale.w >= 2);
         }
 
         for (auto& task : depthPrepassOTNodes)
         {
             task.BestOccluderCount = static_cast<int>(depthPrepassOTNodes.size());
-            VERIFY_EXPR(task.BasePositionAndScale.w >= 4);
+            VERIFY_EXPR(task.BasePositionAndScale.w >= 2);
         }
 
         // Bind buffer resources to GPU
         BindSortedIndexBuffer(orderedVoxelDataBuffer);
         BindOctreeNodeBuffer(OTLeafNodes);
         BindBestOccluderBuffer(depthPrepassOTNodes);
+
+        m_CPUOctreeNodes      = OTLeafNodes;
+        m_CPUVoxels           = orderedVoxelDataBuffer;
+        m_HasCullingReference = false;
         
         // Set draw task count
         m_DrawTaskCount = static_cast<Uint32>(OTLeafNodes.size());
-        VERIFY_EXPR(m_DrawTaskCount % ASGroupSize == 0);
+        VERIFY_EXPR(m_DrawTaskCount % m_ASGroupSize == 0);
 
         m_DepthPassDrawTaskCount = static_cast<Uint32>(depthPrepassOTNodes.size());
-        VERIFY_EXPR(m_DepthPassDrawTaskCount % ASGroupSize == 0);
+        VERIFY_EXPR(m_DepthPassDrawTaskCount % m_ASGroupSize == 0);
+    }
+
+    void Tutorial20_MeshShader::RebuildScene()
+    {
+        // Buffers and pipelines may still be referenced by the frames in flight
+        m_pImmediateContext->WaitForIdle();
+
+        delete m_pOcclusionOctreeRoot;
+        m_pOcclusionOctreeRoot = nullptr;
+
+        m_pSRB.Release();
+        m_pPSO.Release();
+        m_pDepthOnlySRB.Release();
+        m_pDepthOnlyPSO.Release();
+        m_pHiZComputeSRB.Release();
+        m_pHiZComputePSO.Release();
+        m_pHiZConstantBuffer.Release();
+        m_pOverdrawTexture.Release();
+        m_pVoxelPosBuffer.Release();
+        m_pOctreeNodeBuffer.Release();
+        m_pBestOccluderBuffer.Release();
+
+        // The octree leaf capacity and the GROUP_SIZE shader permutation must match
+        CreateDrawTasksFromMesh("models/binvox/" + fileName + ".binvox");
+        CreatePipelineState();
     }
 
     void Tutorial20_MeshShader::PopulateOctree(std::string OTmodelPath)
@@ -267,7 +280,7 @@ namespace Diligent
         BinvoxData data = read_binvox(OTmodelPath);
 
         AABB worldBounds       = {{0, 0, 0}, {(float)data.width, (float)data.height, (float)data.depth}};
-        m_pOcclusionOctreeRoot = new OctreeNode<VoxelOC::OctreeLeafNode>(worldBounds, OTVoxelBoundBuffer, (size_t)(worldBounds.max.x - worldBounds.min.x), worldBounds, ASGroupSize);
+        m_pOcclusionOctreeRoot = new OctreeNode<VoxelOC::OctreeLeafNode>(worldBounds, OTVoxelBoundBuffer, (size_t)(worldBounds.max.x - worldBounds.min.x), worldBounds, m_LeafCapacity);
 
         for (int z = 0; z < data.depth; ++z)
         {
@@ -308,8 +321,8 @@ namespace Diligent
     void Tutorial20_MeshShader::BindOctreeNodeBuffer(std::vector<VoxelOC::OctreeLeafNode>& octreeNodeBuffer)
     {
         // Realign octree node buffer
-        octreeNodeBuffer.resize(octreeNodeBuffer.size() + ASGroupSize - (octreeNodeBuffer.size() % ASGroupSize));
-        VERIFY_EXPR(octreeNodeBuffer.size() % ASGroupSize == 0);
+        octreeNodeBuffer.resize(AlignUp(octreeNodeBuffer.size(), size_t{m_ASGroupSize}));
+        VERIFY_EXPR(octreeNodeBuffer.size() % m_ASGroupSize == 0);
 
         BufferDesc BuffDesc;
         BuffDesc.Name              = "Octree node buffer";
@@ -332,8 +345,8 @@ namespace Diligent
         if (depthPrepassOTNodes.size() == 0) return;
 
         // Realign deoth prepass octree node buffer
-        depthPrepassOTNodes.resize(depthPrepassOTNodes.size() + ASGroupSize - (depthPrepassOTNodes.size() % ASGroupSize));
-        VERIFY_EXPR(depthPrepassOTNodes.size() % ASGroupSize == 0);
+        depthPrepassOTNodes.resize(AlignUp(depthPrepassOTNodes.size(), size_t{m_ASGroupSize}));
+        VERIFY_EXPR(depthPrepassOTNodes.size() % m_ASGroupSize == 0);
 
         BufferDesc BuffDesc;
         BuffDesc.Name              = "Best occluder nodes buffer";
@@ -392,7 +405,7 @@ namespace Diligent
         ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
     
         ShaderMacroHelper Macros;
-        Macros.AddShaderMacro("GROUP_SIZE", ASGroupSize);
+        Macros.AddShaderMacro("GROUP_SIZE", m_ASGroupSize);
     
         ShaderCI.Macros = Macros;
     
@@ -672,6 +685,8 @@ namespace Diligent
 
     void Tutorial20_MeshShader::DepthPrepass()
     {
+        m_Profiler.Begin(m_pImmediateContext, DepthPrepassScope);
+
         m_pImmediateContext->SetPipelineState(m_pDepthOnlyPSO);
         m_pImmediateContext->CommitShaderResources(m_pDepthOnlySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
@@ -682,7 +697,7 @@ namespace Diligent
 
         // Draw best occluders. Task count doesn't change, since the buffers are all the same, we just discard 
         // more invocations.
-        VERIFY_EXPR(m_DepthPassDrawTaskCount % ASGroupSize == 0);
+        VERIFY_EXPR(m_DepthPassDrawTaskCount % m_ASGroupSize == 0);
 
         DrawMeshAttribs drawAttrs{m_DepthPassDrawTaskCount, DRAW_FLAG_VERIFY_ALL};
         m_pImmediateContext->DrawMesh(drawAttrs);
@@ -700,6 +715,8 @@ namespace Diligent
 
         m_pImmediateContext->CopyTexture(storeDepthBufAttribs);
 
+        m_Profiler.End(m_pImmediateContext, DepthPrepassScope);
+
         // Generate HiZ and set compute shader resources accordingly
         GenerateHiZ();
     }
@@ -759,6 +776,8 @@ namespace Diligent
 
     void Tutorial20_MeshShader::GenerateHiZ()
     {
+        ScopeProfiler::ScopedTimer HiZTimer{m_Profiler, m_pImmediateContext, HiZBuildScope};
+
         StateTransitionDesc HiZResourceBarrier;
         HiZResourceBarrier.pResource      = m_pHiZPyramidTexture;
         HiZResourceBarrier.OldState       = RESOURCE_STATE_COPY_DEST;
@@ -823,6 +842,56 @@ namespace Diligent
         //m_pImmediateContext->Flush();
     }
     
+    void Tutorial20_MeshShader::RunCullingReference()
+    {
+        // Read back the level 0 of the HiZ pyramid and rebuild the remaining levels on the CPU
+        const auto& HiZDesc = m_pHiZPyramidTexture->GetDesc();
+
+        TextureDesc StagingDesc;
+        StagingDesc.Name           = "HiZ readback texture";
+        StagingDesc.Type           = RESOURCE_DIM_TEX_2D;
+        StagingDesc.Width          = HiZDesc.Width;
+        StagingDesc.Height         = HiZDesc.Height;
+        StagingDesc.Format         = HiZDesc.Format;
+        StagingDesc.MipLevels      = 1;
+        StagingDesc.Usage          = USAGE_STAGING;
+        StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+
+        RefCntAutoPtr<ITexture> pStagingTex;
+        m_pDevice->CreateTexture(StagingDesc, nullptr, &pStagingTex);
+        VERIFY_EXPR(pStagingTex != nullptr);
+
+        CopyTextureAttribs CopyAttribs{m_pHiZPyramidTexture, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                       pStagingTex, RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+        CopyAttribs.SrcMipLevel = 0;
+        CopyAttribs.DstMipLevel = 0;
+        m_pImmediateContext->CopyTexture(CopyAttribs);
+
+        // This is a debugging tool, so stalling the GPU is acceptable
+        m_pImmediateContext->WaitForIdle();
+
+        MappedTextureSubresource MappedData;
+        m_pImmediateContext->MapTextureSubresource(pStagingTex, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+        if (MappedData.pData == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Failed to map the HiZ readback texture");
+            return;
+        }
+
+        VoxelOC::HiZPyramidCPU HiZ;
+        HiZ.Build(static_cast<const float*>(MappedData.pData), StagingDesc.Width, StagingDesc.Height, static_cast<size_t>(MappedData.Stride / sizeof(float)));
+        m_pImmediateContext->UnmapTextureSubresource(pStagingTex, 0, 0);
+
+        m_CullingReference    = VoxelOC::CompareMeshletCulling(m_CPUOctreeNodes, m_CPUVoxels, m_ViewProjMatrix, HiZ, m_ASGroupSize);
+        m_HasCullingReference = true;
+
+        LOG_INFO_MESSAGE("Meshlet culling reference: ", m_CullingReference.PerVoxelBoxTests, " per-voxel box tests, ",
+                         m_CullingReference.HierarchicalBoxTests, " hierarchical box tests, ",
+                         m_CullingReference.WronglyCulled, " wrongly culled voxels, ",
+                         m_CullingReference.ProjectionMismatches, " projection mismatches, ",
+                         m_CullingReference.NonConservativeTests, " non-conservative HiZ tests");
+    }
+
     void Tutorial20_MeshShader::UpdateUI()
     {
         ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
@@ -834,9 +903,26 @@ namespace Diligent
             ImGui::Checkbox("Enable Occlusion Culling", &m_OcclusionCulling);
             if (m_OcclusionCulling)
             {
-                static const char* items[] = {"Cull Octree Nodes", "Cull Meshlets"};
+                static const char* items[] = {"Cull Octree Nodes", "Cull Meshlets", "Hierarchical (Node + 2x2x2)"};
                 ImGui::Combo("Culling Mode", &m_CullMode, items, IM_ARRAYSIZE(items));
                 ImGui::SliderFloat("Depth Bias", &m_OCThreshold, 0.0f, 0.1f, "%.5f", ImGuiSliderFlags_Logarithmic);
+
+                if (ImGui::Button("Compare Meshlet Culling (CPU)"))
+                    m_RunCullingReference = true;
+                ImGui::HelpMarker("Evaluates the per-voxel and the hierarchical culling for the current view on the CPU");
+
+                if (m_HasCullingReference)
+                {
+                    const auto& Ref = m_CullingReference;
+                    ImGui::Text("Box tests: %llu per-voxel, %llu hierarchical (%.1f%%)",
+                                static_cast<unsigned long long>(Ref.PerVoxelBoxTests),
+                                static_cast<unsigned long long>(Ref.HierarchicalBoxTests),
+                                Ref.PerVoxelBoxTests > 0 ? 100.0 * static_cast<double>(Ref.HierarchicalBoxTests) / static_cast<double>(Ref.PerVoxelBoxTests) : 0.0);
+                    ImGui::Text("Visible voxels: %u per-voxel, %u hierarchical", Ref.PerVoxelVisible, Ref.HierarchicalVisible);
+                    ImGui::Text("Wrongly culled voxels: %u", Ref.WronglyCulled);
+                    ImGui::Text("Projection mismatches: %u", Ref.ProjectionMismatches);
+                    ImGui::Text("Non-conservative HiZ tests: %u", Ref.NonConservativeTests);
+                }
             }
             
 
@@ -870,10 +956,179 @@ namespace Diligent
 
             ImGui::Text("Visible cubes: %d", m_VisibleCubes);
             ImGui::Text("Visible octree nodes: %d", m_VisibleOTNodes);
+            if (m_StatisticsReadback.HasData())
+            {
+                const DrawStatistics& Stats = m_StatisticsReadback.GetLatest();
+                ImGui::Text("Octree nodes tested: %u", Stats.octreeNodesTested);
+                ImGui::Text("Nodes culled by frustum: %u", Stats.octreeNodesCulledByFrustum);
+                ImGui::Text("Voxels culled by HiZ: %u", Stats.voxelsCulledByHiZ);
+                ImGui::Text("Triangles emitted: %u", Stats.trianglesEmitted);
+                ImGui::Text("Statistics latency: %u frames", m_StatisticsReadback.GetLatency());
+            }
+
+            ImGui::Spacing();
+            ImGui::Text("GPU Timings");
+            m_Profiler.UpdateUI();
+            m_Profiler.UpdateCaptureUI(TraceFileName);
+
+            ImGui::Spacing();
+            ImGui::Text("Octree Configuration");
+
+            if (m_Sweep.Active)
+            {
+                ImGui::Text("Running sweep: config %d / %d (%d x %d)",
+                            static_cast<int>(m_Sweep.ConfigIdx + 1), static_cast<int>(m_Sweep.Configs.size()),
+                            m_ASGroupSize, m_LeafCapacity);
+            }
+            else
+            {
+                static const char* SizeNames[] = {"32", "64", "128"};
+                static_assert(_countof(SizeNames) == _countof(ASGroupSizes), "Size names do not match group sizes");
+                static_assert(_countof(SizeNames) == _countof(LeafCapacities), "Size names do not match leaf capacities");
+
+                int GroupSizeIdx = 0;
+                while (ASGroupSizes[GroupSizeIdx] != m_ASGroupSize)
+                    ++GroupSizeIdx;
+                int LeafCapacityIdx = 0;
+                while (LeafCapacities[LeafCapacityIdx] != m_LeafCapacity)
+                    ++LeafCapacityIdx;
+
+                bool Rebuild = false;
+                if (ImGui::Combo("AS Group Size", &GroupSizeIdx, SizeNames, IM_ARRAYSIZE(SizeNames)))
+                {
+                    m_ASGroupSize  = ASGroupSizes[GroupSizeIdx];
+                    m_LeafCapacity = (std::min)(m_LeafCapacity, m_ASGroupSize);
+                    Rebuild        = true;
+                }
+                if (ImGui::Combo("Leaf Capacity", &LeafCapacityIdx, SizeNames, IM_ARRAYSIZE(SizeNames)))
+                {
+                    m_LeafCapacity = LeafCapacities[LeafCapacityIdx];
+                    m_ASGroupSize  = (std::max)(m_ASGroupSize, m_LeafCapacity);
+                    Rebuild        = true;
+                }
+                ImGui::HelpMarker("Leaf capacity can't exceed the group size: every amplification group processes one octree node.");
+
+                if (Rebuild)
+                    RebuildScene();
+
+                if (ImGui::Button("Run Configuration Sweep"))
+                    StartConfigSweep();
+            }
+
+            for (const auto& Res : m_Sweep.Results)
+            {
+                ImGui::Text("%3d x %3d: %.3f ms frame, %.3f ms render, GPU %.3f / %.3f / %.3f ms", Res.ASGroupSize, Res.LeafCapacity,
+                            Res.AvgFrameTime * 1000.0, Res.AvgRenderTime * 1000.0,
+                            Res.DepthPrepassGpuTime, Res.HiZBuildGpuTime, Res.MainPassGpuTime);
+            }
         }
         ImGui::End();
     }
 
+    void Tutorial20_MeshShader::StartConfigSweep()
+    {
+        m_Sweep = {};
+        for (Uint32 GroupSize : ASGroupSizes)
+        {
+            for (Uint32 Capacity : LeafCapacities)
+            {
+                if (Capacity <= GroupSize)
+                    m_Sweep.Configs.emplace_back(GroupSize, Capacity);
+            }
+        }
+        m_Sweep.Active = true;
+
+        m_ASGroupSize  = m_Sweep.Configs[0].first;
+        m_LeafCapacity = m_Sweep.Configs[0].second;
+        RebuildScene();
+    }
+
+    void Tutorial20_MeshShader::UpdateConfigSweep(double ElapsedTime)
+    {
+        // Statistics of the previous frame are available at this point
+        ++m_Sweep.FrameIdx;
+        if (m_Sweep.FrameIdx == SweepWarmupFrames)
+        {
+            // GPU times of the measured frames are accumulated from here on. Timestamps lag a few
+            // frames behind, so the first samples still come from the warmup, which is harmless.
+            m_Profiler.ResetTotals();
+        }
+        if (m_Sweep.FrameIdx > SweepWarmupFrames)
+        {
+            m_Sweep.FrameTimeSum += ElapsedTime;
+            m_Sweep.RenderTimeSum += !frameRenderTimes.empty() ? frameRenderTimes.back() : 0.0;
+            m_Sweep.VisibleSum += m_VisibleCubes;
+        }
+
+        // Every configuration is measured along the same camera path
+        const Uint32 TotalFrames = SweepWarmupFrames + SweepMeasureFrames;
+        UpdateOrbitCamera(2.0f * PI_F * static_cast<float>(m_Sweep.FrameIdx) / static_cast<float>(TotalFrames));
+
+        if (m_Sweep.FrameIdx < TotalFrames)
+            return;
+
+        ConfigSweepResult Res;
+        Res.ASGroupSize     = m_ASGroupSize;
+        Res.LeafCapacity    = m_LeafCapacity;
+        Res.DrawTaskCount   = m_DrawTaskCount;
+        Res.BestOccluders   = m_DepthPassDrawTaskCount;
+        Res.AvgFrameTime    = m_Sweep.FrameTimeSum / SweepMeasureFrames;
+        Res.AvgRenderTime   = m_Sweep.RenderTimeSum / SweepMeasureFrames;
+        Res.AvgVisibleCubes = m_Sweep.VisibleSum / SweepMeasureFrames;
+
+        const auto GetAvgGpuTime = [this](const char* Scope) //
+        {
+            const ScopeProfiler::ScopeStats* pStats = m_Profiler.FindScope(Scope);
+            return pStats != nullptr ? pStats->GetTotalAvgGpuTimeMs() : 0.0;
+        };
+        Res.DepthPrepassGpuTime = GetAvgGpuTime(DepthPrepassScope);
+        Res.HiZBuildGpuTime     = GetAvgGpuTime(HiZBuildScope);
+        Res.MainPassGpuTime     = GetAvgGpuTime(MainPassScope);
+        m_Sweep.Results.push_back(Res);
+
+        m_Sweep.FrameIdx      = 0;
+        m_Sweep.FrameTimeSum  = 0;
+        m_Sweep.RenderTimeSum = 0;
+        m_Sweep.VisibleSum    = 0;
+
+        if (++m_Sweep.ConfigIdx < m_Sweep.Configs.size())
+        {
+            m_ASGroupSize  = m_Sweep.Configs[m_Sweep.ConfigIdx].first;
+            m_LeafCapacity = m_Sweep.Configs[m_Sweep.ConfigIdx].second;
+            RebuildScene();
+        }
+        else
+        {
+            m_Sweep.Active = false;
+            WriteConfigSweepReport();
+        }
+    }
+
+    void Tutorial20_MeshShader::WriteConfigSweepReport() const
+    {
+        const std::string ReportPath = fileName + "_config_sweep.csv";
+
+        std::fstream ReportFile;
+        ReportFile.open(ReportPath, std::ios_base::out);
+        if (!ReportFile.is_open())
+        {
+            LOG_ERROR_MESSAGE("Failed to open ", ReportPath, " for writing");
+            return;
+        }
+
+        ReportFile << "group_size,leaf_capacity,draw_tasks,best_occluders,frame_time_ms,render_time_ms,visible_cubes,"
+                      "depth_prepass_gpu_ms,hiz_build_gpu_ms,main_pass_gpu_ms\n";
+        for (const auto& Res : m_Sweep.Results)
+        {
+            ReportFile << Res.ASGroupSize << ',' << Res.LeafCapacity << ',' << Res.DrawTaskCount << ',' << Res.BestOccluders << ','
+                       << Res.AvgFrameTime * 1000.0 << ',' << Res.AvgRenderTime * 1000.0 << ',' << Res.AvgVisibleCubes << ','
+                       << Res.DepthPrepassGpuTime << ',' << Res.HiZBuildGpuTime << ',' << Res.MainPassGpuTime << "\n";
+        }
+        ReportFile.close();
+
+        LOG_INFO_MESSAGE("Octree configuration sweep written to ", ReportPath);
+    }
+
     void Tutorial20_MeshShader::WindowResize(Uint32 Width, Uint32 Height)
     {
         CreateHiZTextures();
@@ -883,7 +1138,39 @@ namespace Diligent
     {
         SampleBase::ModifyEngineInitInfo(Attribs);
     
-        Attribs.EngineCI.Features.MeshShaders = DEVICE_FEATURE_STATE_ENABLED;
+        Attribs.EngineCI.Features.MeshShaders      = DEVICE_FEATURE_STATE_ENABLED;
+        Attribs.EngineCI.Features.TimestampQueries = DEVICE_FEATURE_STATE_OPTIONAL;
+    }
+
+    Tutorial20_MeshShader::CommandLineStatus Tutorial20_MeshShader::ProcessCommandLine(int argc, const char* const* argv)
+    {
+        CommandLineParser ArgsParser{argc, argv};
+        ArgsParser.Parse("as_group_size", m_ASGroupSize);
+        ArgsParser.Parse("leaf_capacity", m_LeafCapacity);
+        ArgsParser.Parse("config_sweep", m_SweepOnStartup);
+
+        // Captures a trace of the first frames, e.g. to see how the passes of a configuration overlap
+        int TraceFrames = 0;
+        if (ArgsParser.Parse("trace_frames", TraceFrames) && TraceFrames > 0)
+            m_Profiler.BeginCapture(static_cast<Uint32>(TraceFrames), TraceFileName);
+
+        if (std::find(std::begin(ASGroupSizes), std::end(ASGroupSizes), m_ASGroupSize) == std::end(ASGroupSizes))
+        {
+            LOG_WARNING_MESSAGE("Unsupported amplification shader group size ", m_ASGroupSize, ". Using 64.");
+            m_ASGroupSize = 64;
+        }
+        if (std::find(std::begin(LeafCapacities), std::end(LeafCapacities), m_LeafCapacity) == std::end(LeafCapacities))
+        {
+            LOG_WARNING_MESSAGE("Unsupported octree leaf capacity ", m_LeafCapacity, ". Using 64.");
+            m_LeafCapacity = 64;
+        }
+        if (m_LeafCapacity > m_ASGroupSize)
+        {
+            LOG_WARNING_MESSAGE("Octree leaf capacity (", m_LeafCapacity, ") can't exceed the group size (", m_ASGroupSize, ")");
+            m_LeafCapacity = m_ASGroupSize;
+        }
+
+        return CommandLineStatus::OK;
     }
 
     void Tutorial20_MeshShader::Initialize(const SampleInitInfo& InitInfo)
@@ -906,6 +1193,36 @@ namespace Diligent
         CreateStatisticsBuffer();
         CreateConstantsBuffer();
         CreatePipelineState();
+
+        m_Profiler.Initialize(m_pDevice);
+
+        if (m_SweepOnStartup)
+            StartConfigSweep();
+    }
+
+    void Tutorial20_MeshShader::UpdateOrbitCamera(float Angle)
+    {
+        // Fixed center point (the model's center)
+        const float Radius       = 400.0f;
+        const float CameraHeight = 100.0f;
+
+        // Calculate orbiting camera position - switched sin/cos for correct rotation direction
+        float3 cameraPos = float3{
+            SceneCenter.x + Radius * std::sin(Angle), // Switched to sin
+            SceneCenter.y + CameraHeight + (std::sin(Angle) + 1) * 100,
+            SceneCenter.z + Radius * std::cos(Angle) // Switched to cos
+        };
+
+        // Set camera position to orbit point
+        fpc.SetPos(cameraPos);
+
+        // Always look at center
+        float3 lookDir = normalize(SceneCenter - cameraPos);
+        float  pitch   = std::asin(lookDir.y);
+        float  yaw     = std::atan2(lookDir.x, lookDir.z); // Switched order to match coordinate system
+
+        // Set camera orientation to look at center
+        fpc.SetRotation(-yaw, pitch); // Negated yaw to correct rotation direction
     }
 
     float angle = 0.0f;
@@ -942,13 +1259,14 @@ namespace Diligent
             CBConstants->DepthBias      = m_OCThreshold;
             
             CBConstants->RenderOptions = 0;
-            CBConstants->RenderOptions |= (m_CullMode << 0);
+            CBConstants->RenderOptions |= ((m_CullMode == CULL_MODE_MESHLETS ? 1 : 0) << 0);
             CBConstants->RenderOptions |= ((m_OcclusionCulling ? 1 : 0) << 1);
             CBConstants->RenderOptions |= ((m_FrustumCulling ? 1 : 0) << 2);
             CBConstants->RenderOptions |= ((m_ShowOnlyBestOccluders ? 1 : 0) << 3);
             CBConstants->RenderOptions |= ((m_UseLight ? 1 : 0) << 4);
             CBConstants->RenderOptions |= ((m_MSDebugViz ? 1 : 0) << 5);
             CBConstants->RenderOptions |= ((m_OTDebugViz ? 1 : 0) << 6);
+            CBConstants->RenderOptions |= ((m_CullMode == CULL_MODE_HIERARCHICAL ? 1 : 0) << 7);
 
             // Calculate frustum planes from view-projection matrix.
             if (m_SyncCamPosition)
@@ -973,6 +1291,13 @@ namespace Diligent
             m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.0f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
         }        
 
+        // The HiZ pyramid for this frame is ready at this point
+        if (m_RunCullingReference)
+        {
+            RunCullingReference();
+            m_RunCullingReference = false;
+        }
+
         // Reset pipeline state to normally draw to back buffer
         m_pImmediateContext->SetPipelineState(m_pPSO);
 
@@ -985,45 +1310,29 @@ namespace Diligent
         m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
 
-        // Amplification shader executes 32 threads per group and the task count must be aligned to 32
-        // to prevent loss of tasks or access outside of the data array.
-        VERIFY_EXPR(m_DrawTaskCount % ASGroupSize == 0);
+        // Amplification shader executes GROUP_SIZE threads per group and the task count must be aligned
+        // to the group size to prevent loss of tasks or access outside of the data array.
+        VERIFY_EXPR(m_DrawTaskCount % m_ASGroupSize == 0);
     
+
+        m_Profiler.Begin(m_pImmediateContext, MainPassScope);
         DrawMeshAttribs drawAttrs{m_DrawTaskCount, DRAW_FLAG_VERIFY_ALL};
         m_pImmediateContext->DrawMesh(drawAttrs);
+        m_Profiler.End(m_pImmediateContext, MainPassScope);
     
         // Copy statistics to staging buffer
         {
             m_VisibleCubes = 0;
     
-            m_pImmediateContext->CopyBuffer(m_pStatisticsBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
-                                            m_pStatisticsStaging, static_cast<Uint32>(m_FrameId % m_StatisticsHistorySize) * sizeof(DrawStatistics), sizeof(DrawStatistics),
-                                            RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    
-            // We should use synchronizations to safely access the mapped memory.
-            m_pImmediateContext->EnqueueSignal(m_pStatisticsAvailable, m_FrameId);
-    
-            // Read statistics from previous frame.
-            Uint64 AvailableFrameId = m_pStatisticsAvailable->GetCompletedValue();
-    
-            // Synchronize
-            if (m_FrameId - AvailableFrameId > m_StatisticsHistorySize)
-            {
-                // In theory we should never get here as we wait for more than enough
-                // frames.
-                AvailableFrameId = m_FrameId - m_StatisticsHistorySize;
-                m_pStatisticsAvailable->Wait(AvailableFrameId);
-            }
-    
-            // Read the staging data
-            if (AvailableFrameId > 0)
+            // The copy is skipped if all staging slots are still in flight, the render thread never waits.
+            m_StatisticsReadback.Enqueue(m_pImmediateContext, m_pStatisticsBuffer);
+
+            // Read statistics from the newest completed frame.
+            m_StatisticsReadback.Poll(m_pImmediateContext);
+            if (m_StatisticsReadback.HasData())
             {
-                MapHelper<DrawStatistics> StagingData(m_pImmediateContext, m_pStatisticsStaging, MAP_READ, MAP_FLAG_DO_NOT_WAIT);
-                if (StagingData)
-                {
-                    m_VisibleCubes   = StagingData[AvailableFrameId % m_StatisticsHistorySize].visibleCubes;
-                    m_VisibleOTNodes = StagingData[AvailableFrameId % m_StatisticsHistorySize].visibleOctreeNodes;
-                }
+                m_VisibleCubes   = m_StatisticsReadback.GetLatest().visibleCubes;
+                m_VisibleOTNodes = m_StatisticsReadback.GetLatest().visibleOctreeNodes;
             }
 
 #ifdef TESTING_ANIM
@@ -1065,10 +1374,11 @@ namespace Diligent
             m_pImmediateContext->SetRenderTargets(0, nullptr, nullptr, RESOURCE_STATE_TRANSITION_MODE_NONE);
             m_pImmediateContext->Flush();
             m_pImmediateContext->FinishFrame();
-            
-            ++m_FrameId;
         }
 
+        // Reads the timestamps of the frame issued NumFramesInFlight frames ago
+        m_Profiler.EndFrame();
+
         frameRenderTimes.push_back(renderTimer.GetElapsedTime());
     }
 
@@ -1079,12 +1389,12 @@ namespace Diligent
         
         SampleBase::Update(CurrTime, ElapsedTime);
         UpdateUI();
+
+        if (m_Sweep.Active)
+            UpdateConfigSweep(ElapsedTime);
         
 #ifdef TESTING_ANIM
 
-        // Fixed center point (the model's center)
-        const float  Radius        = 400.0f;
-        const float  CameraHeight  = 100.0f;
         const float  RotationSpeed = 0.05f;
 
         if (angle >= 2.0f * PI_F)
@@ -1125,24 +1435,8 @@ namespace Diligent
             SampleBase::~SampleBase();*/
         }
             
-        // Calculate orbiting camera position - switched sin/cos for correct rotation direction
-        angle    = static_cast<float>(CurrTime) * RotationSpeed * 2.0f * PI_F;
-        float3 cameraPos = float3{
-            SceneCenter.x + Radius * std::sin(angle), // Switched to sin
-            SceneCenter.y + CameraHeight + (std::sin(angle) + 1) * 100,
-            SceneCenter.z + Radius * std::cos(angle) // Switched to cos
-        };
-
-        // Set camera position to orbit point
-        fpc.SetPos(cameraPos);
-
-        // Always look at center
-        float3 lookDir = normalize(SceneCenter - cameraPos);
-        float  pitch   = std::asin(lookDir.y);
-        float  yaw     = std::atan2(lookDir.x, lookDir.z); // Switched order to match coordinate system
-
-        // Set camera orientation to look at center
-        fpc.SetRotation(-yaw, pitch); // Negated yaw to correct rotation direction
+        angle = static_cast<float>(CurrTime) * RotationSpeed * 2.0f * PI_F;
+        UpdateOrbitCamera(angle);
     
 #endif
 
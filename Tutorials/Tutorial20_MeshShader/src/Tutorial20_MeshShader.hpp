@@ -31,6 +31,9 @@
 #include "BasicMath.hpp"
 #include "FirstPersonCamera.hpp"
 #include "octree/octree.h"
+#include "culling/hiz_culling.h"
+#include "GpuReadbackRing.hpp"
+#include "ScopeProfiler.hpp"
 #include <AdvancedMath.hpp>
 #include <Timer.hpp>
 
@@ -46,11 +49,14 @@ namespace Diligent
         virtual void Update(double CurrTime, double ElapsedTime) override final;
     
         virtual const Char* GetSampleName() const override final { return "Tutorial20: Mesh shader"; }
+
+        virtual CommandLineStatus ProcessCommandLine(int argc, const char* const* argv) override final;
     
         ~Tutorial20_MeshShader();
     
     private:
         void CreateDrawTasksFromMesh(std::string meshPath);
+        void RebuildScene();
         void PopulateOctree(std::string OTmodelPath);
         void CreateDrawTasks();
         
@@ -65,6 +71,13 @@ namespace Diligent
 
         void LoadTexture();
         void UpdateUI();
+        void RunCullingReference();
+
+        // Octree configuration sweep
+        void StartConfigSweep();
+        void UpdateConfigSweep(double ElapsedTime);
+        void WriteConfigSweepReport() const;
+        void UpdateOrbitCamera(float Angle);
 
         void WindowResize(Uint32 Width, Uint32 Height) override;
 
@@ -76,14 +89,62 @@ namespace Diligent
         RefCntAutoPtr<IBuffer>      m_CubeBuffer;
         RefCntAutoPtr<ITextureView> m_CubeTextureSRV;
     
-        RefCntAutoPtr<IBuffer> m_pStatisticsBuffer;
-        RefCntAutoPtr<IBuffer> m_pStatisticsStaging;
-        RefCntAutoPtr<IFence>  m_pStatisticsAvailable;
-        Uint64                 m_FrameId               = 1; // Can't signal 0
-        const Uint32           m_StatisticsHistorySize = 8;
-    
-        static constexpr Int32 ASGroupSize = 64; // max 1024
+        // Must match the layout of the Statistics buffer in cube_ash.hlsl
+        struct DrawStatistics
+        {
+            Uint32 visibleCubes;
+            Uint32 visibleOctreeNodes;
+            Uint32 octreeNodesTested;
+            Uint32 octreeNodesCulledByFrustum;
+            Uint32 voxelsCulledByHiZ;
+            Uint32 trianglesEmitted;
+        };
+
+        RefCntAutoPtr<IBuffer>          m_pStatisticsBuffer;
+        GpuReadbackRing<DrawStatistics> m_StatisticsReadback;
+        const Uint32                    m_StatisticsHistorySize = 8;
     
+        // Supported amplification shader group sizes and octree leaf capacities. Every group
+        // processes one octree node, so the leaf capacity must never exceed the group size.
+        static constexpr Uint32 ASGroupSizes[]   = {32, 64, 128};
+        static constexpr Uint32 LeafCapacities[] = {32, 64, 128};
+
+        Uint32 m_ASGroupSize  = 64; // GROUP_SIZE shader macro, max 1024
+        Uint32 m_LeafCapacity = 64; // Max number of voxels per octree leaf
+
+        struct ConfigSweepResult
+        {
+            Uint32 ASGroupSize         = 0;
+            Uint32 LeafCapacity        = 0;
+            Uint32 DrawTaskCount       = 0;
+            Uint32 BestOccluders       = 0;
+            double AvgFrameTime        = 0;
+            double AvgRenderTime       = 0;
+            double AvgVisibleCubes     = 0;
+            double DepthPrepassGpuTime = 0; // ms
+            double HiZBuildGpuTime     = 0; // ms
+            double MainPassGpuTime     = 0; // ms
+        };
+
+        // Sweeps all valid (group size, leaf capacity) combinations along the orbit camera path
+        struct ConfigSweepState
+        {
+            bool   Active        = false;
+            size_t ConfigIdx     = 0;
+            Uint32 FrameIdx      = 0;
+            double FrameTimeSum  = 0;
+            double RenderTimeSum = 0;
+            double VisibleSum    = 0;
+
+            std::vector<std::pair<Uint32, Uint32>> Configs;
+            std::vector<ConfigSweepResult>         Results;
+        };
+        ConfigSweepState m_Sweep;
+        bool             m_SweepOnStartup = false;
+
+        static constexpr Uint32 SweepWarmupFrames  = 32;
+        static constexpr Uint32 SweepMeasureFrames = 256;
+
         Uint32                 m_DrawTaskCount          = 0;
         Uint32                 m_DepthPassDrawTaskCount = 0;
         float                  m_HiZSampleValue         = 0.f;
@@ -140,11 +201,34 @@ namespace Diligent
         float       m_OCThreshold    = 0.0f;
         bool        m_OcclusionCulling = true;
         int         m_CullMode       = 0;
+
+        enum CULL_MODE : int
+        {
+            CULL_MODE_OCTREE_NODES = 0,
+            CULL_MODE_MESHLETS,
+            CULL_MODE_HIERARCHICAL
+        };
+
+        // CPU copies of the GPU buffers for the culling reference
+        std::vector<VoxelOC::OctreeLeafNode> m_CPUOctreeNodes;
+        std::vector<VoxelOC::VoxelBufData>   m_CPUVoxels;
+
+        bool                              m_RunCullingReference = false;
+        bool                              m_HasCullingReference = false;
+        VoxelOC::MeshletCullingComparison m_CullingReference;
     
         float3 SceneCenter{60, 115, 20};
         std::vector<unsigned long long> visibleVoxels;
         std::vector<unsigned long long> visibleOctreeNodes;
 
+        // GPU/CPU time of the depth prepass, HiZ build and main mesh pass, and their trace captures
+        ScopeProfiler m_Profiler;
+
+        static constexpr const char* DepthPrepassScope = "Depth Prepass";
+        static constexpr const char* HiZBuildScope     = "HiZ Build";
+        static constexpr const char* MainPassScope     = "Main Pass";
+        static constexpr const char* TraceFileName     = "Tutorial20_trace.json";
+
         Timer               updateTimer;
         Timer               renderTimer;
         std::vector<double> frameUpdateTimes;
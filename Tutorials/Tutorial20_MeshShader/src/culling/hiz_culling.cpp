@@ -0,0 +1,329 @@
+#include "hiz_culling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace Diligent;
+
+namespace VoxelOC
+{
+    void HiZPyramidCPU::Build(const float* pDepth, Uint32 Width, Uint32 Height, size_t RowStride)
+    {
+        VERIFY_EXPR(pDepth != nullptr && Width > 0 && Height > 0);
+
+        // Same mip count as CreateHiZTextures()
+        const Uint32 MipLevelCount = 1 + static_cast<Uint32>(std::floor(std::log2((std::max)(Width, Height))));
+
+        m_Mips.clear();
+        m_Mips.resize(MipLevelCount);
+
+        MipLevel& Mip0 = m_Mips[0];
+        Mip0.Width     = Width;
+        Mip0.Height    = Height;
+        Mip0.Depth.resize(size_t{Width} * Height);
+        for (Uint32 y = 0; y < Height; ++y)
+            std::copy(pDepth + y * RowStride, pDepth + y * RowStride + Width, Mip0.Depth.begin() + size_t{y} * Width);
+
+        for (Uint32 mip = 1; mip < MipLevelCount; ++mip)
+        {
+            const MipLevel& Src = m_Mips[mip - 1];
+            MipLevel&       Dst = m_Mips[mip];
+            Dst.Width           = (std::max)(Width >> mip, 1u);
+            Dst.Height          = (std::max)(Height >> mip, 1u);
+            Dst.Depth.resize(size_t{Dst.Width} * Dst.Height);
+
+            for (Uint32 y = 0; y < Dst.Height; ++y)
+            {
+                for (Uint32 x = 0; x < Dst.Width; ++x)
+                {
+                    const Uint32 x0 = x * 2;
+                    const Uint32 y0 = y * 2;
+                    const Uint32 x1 = (std::min)(x0 + 1, Src.Width - 1);
+                    const Uint32 y1 = (std::min)(y0 + 1, Src.Height - 1);
+
+                    const float z1 = Src.Depth[size_t{y0} * Src.Width + x0];
+                    const float z2 = Src.Depth[size_t{y0} * Src.Width + x1];
+                    const float z3 = Src.Depth[size_t{y1} * Src.Width + x0];
+                    const float z4 = Src.Depth[size_t{y1} * Src.Width + x1];
+
+                    float MaxZ = (std::max)((std::max)(z1, z2), (std::max)(z3, z4));
+
+                    // The last column/row of odd-sized levels also covers the remaining source texel
+                    const bool ExtraColumn = x == Dst.Width - 1 && x0 + 2 < Src.Width;
+                    const bool ExtraRow    = y == Dst.Height - 1 && y0 + 2 < Src.Height;
+                    if (ExtraColumn)
+                    {
+                        MaxZ = (std::max)(MaxZ, Src.Depth[size_t{y0} * Src.Width + x0 + 2]);
+                        MaxZ = (std::max)(MaxZ, Src.Depth[size_t{y1} * Src.Width + x0 + 2]);
+                    }
+                    if (ExtraRow)
+                    {
+                        MaxZ = (std::max)(MaxZ, Src.Depth[size_t{y0 + 2} * Src.Width + x0]);
+                        MaxZ = (std::max)(MaxZ, Src.Depth[size_t{y0 + 2} * Src.Width + x1]);
+                    }
+                    if (ExtraColumn && ExtraRow)
+                        MaxZ = (std::max)(MaxZ, Src.Depth[size_t{y0 + 2} * Src.Width + x0 + 2]);
+
+                    Dst.Depth[size_t{y} * Dst.Width + x] = MaxZ;
+                }
+            }
+        }
+    }
+
+    float HiZPyramidCPU::Load(Uint32 x, Uint32 y, Uint32 Mip) const
+    {
+        // Out-of-bounds loads return 0 on the GPU
+        if (Mip >= m_Mips.size())
+            return 0;
+
+        const MipLevel& Level = m_Mips[Mip];
+        if (x >= Level.Width || y >= Level.Height)
+            return 0;
+
+        return Level.Depth[size_t{y} * Level.Width + x];
+    }
+
+    namespace
+    {
+        // Pixel rectangle at level 0 covered by the UV rectangle, as computed by IsBoxVisible() in cube_ash.hlsl
+        void GetPixelRect(const float4& UVRect, const HiZPyramidCPU& HiZ, uint2& MinPx, uint2& MaxPx)
+        {
+            const Uint32 Width  = HiZ.GetWidth(0);
+            const Uint32 Height = HiZ.GetHeight(0);
+
+            MinPx = uint2{(std::min)(static_cast<Uint32>(UVRect.x * static_cast<float>(Width)), Width - 1),
+                          (std::min)(static_cast<Uint32>(UVRect.y * static_cast<float>(Height)), Height - 1)};
+            MaxPx = uint2{(std::min)(static_cast<Uint32>(UVRect.z * static_cast<float>(Width)), Width - 1),
+                          (std::min)(static_cast<Uint32>(UVRect.w * static_cast<float>(Height)), Height - 1)};
+        }
+
+        bool IsOccluded(float MaxHiZDepth, float MinZ)
+        {
+            return MaxHiZDepth < MinZ && std::abs(MaxHiZDepth - MinZ) > 0.0000001f;
+        }
+    } // namespace
+
+    bool ProjectBox(const float4& BasePosAndScale, const float4x4& ViewProj, float4& UVRect, float& MinZ)
+    {
+        const float HalfScale = BasePosAndScale.w * 0.5f;
+
+        const float4 Center = float4{BasePosAndScale.x, BasePosAndScale.y, BasePosAndScale.z, 1.f} * ViewProj;
+        const float4 AxisX  = float4{ViewProj.m[0][0], ViewProj.m[0][1], ViewProj.m[0][2], ViewProj.m[0][3]} * HalfScale;
+        const float4 AxisY  = float4{ViewProj.m[1][0], ViewProj.m[1][1], ViewProj.m[1][2], ViewProj.m[1][3]} * HalfScale;
+        const float4 AxisZ  = float4{ViewProj.m[2][0], ViewProj.m[2][1], ViewProj.m[2][2], ViewProj.m[2][3]} * HalfScale;
+
+        const float MinW = Center.w - std::abs(AxisX.w) - std::abs(AxisY.w) - std::abs(AxisZ.w);
+        if (MinW <= 1e-5f)
+        {
+            UVRect = float4{0, 0, 1, 1};
+            MinZ   = 0;
+            return false;
+        }
+
+        float2 NDCMin{+FLT_MAX, +FLT_MAX};
+        float2 NDCMax{-FLT_MAX, -FLT_MAX};
+        MinZ = +FLT_MAX;
+        for (Uint32 i = 0; i < 8; ++i)
+        {
+            float4 Corner = Center;
+            Corner        = (i & 1u) ? Corner + AxisX : Corner - AxisX;
+            Corner        = (i & 2u) ? Corner + AxisY : Corner - AxisY;
+            Corner        = (i & 4u) ? Corner + AxisZ : Corner - AxisZ;
+
+            NDCMin.x = (std::min)(NDCMin.x, Corner.x / Corner.w);
+            NDCMin.y = (std::min)(NDCMin.y, Corner.y / Corner.w);
+            NDCMax.x = (std::max)(NDCMax.x, Corner.x / Corner.w);
+            NDCMax.y = (std::max)(NDCMax.y, Corner.y / Corner.w);
+            MinZ     = (std::min)(MinZ, Corner.z / Corner.w);
+        }
+
+        NDCMin.x = clamp(NDCMin.x, -1.f, 1.f);
+        NDCMin.y = clamp(NDCMin.y, -1.f, 1.f);
+        NDCMax.x = clamp(NDCMax.x, -1.f, 1.f);
+        NDCMax.y = clamp(NDCMax.y, -1.f, 1.f);
+
+        UVRect = float4{NDCMin.x * 0.5f + 0.5f, NDCMax.y * -0.5f + 0.5f,
+                        NDCMax.x * 0.5f + 0.5f, NDCMin.y * -0.5f + 0.5f};
+        MinZ   = clamp(MinZ, 0.f, 1.f);
+        return true;
+    }
+
+    bool ProjectBoxBruteForce(const float4& BasePosAndScale, const float4x4& ViewProj, float4& UVRect, float& MinZ)
+    {
+        const float HalfScale = BasePosAndScale.w * 0.5f;
+
+        float4 Corners[8];
+        for (Uint32 i = 0; i < 8; ++i)
+        {
+            const float4 Pos{
+                BasePosAndScale.x + ((i & 1u) ? HalfScale : -HalfScale),
+                BasePosAndScale.y + ((i & 2u) ? HalfScale : -HalfScale),
+                BasePosAndScale.z + ((i & 4u) ? HalfScale : -HalfScale),
+                1.f};
+            Corners[i] = Pos * ViewProj;
+            if (Corners[i].w <= 1e-5f)
+            {
+                UVRect = float4{0, 0, 1, 1};
+                MinZ   = 0;
+                return false;
+            }
+        }
+
+        float MinX = +FLT_MAX;
+        float MaxX = -FLT_MAX;
+        float MinY = +FLT_MAX;
+        float MaxY = -FLT_MAX;
+        MinZ       = +FLT_MAX;
+        for (const float4& Corner : Corners)
+        {
+            MinX = (std::min)(MinX, Corner.x / Corner.w);
+            MaxX = (std::max)(MaxX, Corner.x / Corner.w);
+            MinY = (std::min)(MinY, Corner.y / Corner.w);
+            MaxY = (std::max)(MaxY, Corner.y / Corner.w);
+            MinZ = (std::min)(MinZ, Corner.z / Corner.w);
+        }
+
+        UVRect = float4{clamp(MinX, -1.f, 1.f) * 0.5f + 0.5f, clamp(MaxY, -1.f, 1.f) * -0.5f + 0.5f,
+                        clamp(MaxX, -1.f, 1.f) * 0.5f + 0.5f, clamp(MinY, -1.f, 1.f) * -0.5f + 0.5f};
+        MinZ   = clamp(MinZ, 0.f, 1.f);
+        return true;
+    }
+
+    bool IsBoxVisible(const float4& BasePosAndScale, const float4x4& ViewProj, const HiZPyramidCPU& HiZ)
+    {
+        float4 UVRect;
+        float  MinZ = 0;
+        if (!ProjectBox(BasePosAndScale, ViewProj, UVRect, MinZ))
+            return true;
+
+        uint2 MinPx, MaxPx;
+        GetPixelRect(UVRect, HiZ, MinPx, MaxPx);
+
+        // Finest mip where a texel is at least as large as the rectangle
+        const Uint32 Extent = (std::max)(MaxPx.x - MinPx.x, MaxPx.y - MinPx.y);
+
+        Uint32 TargetMip = 0;
+        while ((1u << TargetMip) < Extent)
+            ++TargetMip;
+        TargetMip = (std::min)(TargetMip, HiZ.GetMipCount() - 1);
+
+        const Uint32 MipWidth  = HiZ.GetWidth(TargetMip);
+        const Uint32 MipHeight = HiZ.GetHeight(TargetMip);
+        const Uint32 MinTexX   = (std::min)(MinPx.x >> TargetMip, MipWidth - 1);
+        const Uint32 MinTexY   = (std::min)(MinPx.y >> TargetMip, MipHeight - 1);
+        const Uint32 MaxTexX   = (std::min)(MaxPx.x >> TargetMip, MipWidth - 1);
+        const Uint32 MaxTexY   = (std::min)(MaxPx.y >> TargetMip, MipHeight - 1);
+
+        const float MaxHiZDepth = (std::max)((std::max)(HiZ.Load(MinTexX, MinTexY, TargetMip), HiZ.Load(MaxTexX, MinTexY, TargetMip)),
+                                             (std::max)(HiZ.Load(MinTexX, MaxTexY, TargetMip), HiZ.Load(MaxTexX, MaxTexY, TargetMip)));
+
+        return !IsOccluded(MaxHiZDepth, MinZ);
+    }
+
+    bool IsBoxVisibleBruteForce(const float4& BasePosAndScale, const float4x4& ViewProj, const HiZPyramidCPU& HiZ)
+    {
+        float4 UVRect;
+        float  MinZ = 0;
+        if (!ProjectBoxBruteForce(BasePosAndScale, ViewProj, UVRect, MinZ))
+            return true;
+
+        uint2 MinPx, MaxPx;
+        GetPixelRect(UVRect, HiZ, MinPx, MaxPx);
+
+        // The box is occluded only if every depth buffer pixel it covers is in front of it
+        float MaxDepth = 0;
+        for (Uint32 y = MinPx.y; y <= MaxPx.y; ++y)
+        {
+            for (Uint32 x = MinPx.x; x <= MaxPx.x; ++x)
+                MaxDepth = (std::max)(MaxDepth, HiZ.Load(x, y, 0));
+        }
+
+        return !IsOccluded(MaxDepth, MinZ);
+    }
+
+    float4 GetSubBlockPosAndScale(const float4& NodePosAndScale, Uint32 SubBlock)
+    {
+        const float QuarterScale = NodePosAndScale.w * 0.25f;
+        return float4{
+            NodePosAndScale.x + ((SubBlock & 1u) ? QuarterScale : -QuarterScale),
+            NodePosAndScale.y + ((SubBlock & 2u) ? QuarterScale : -QuarterScale),
+            NodePosAndScale.z + ((SubBlock & 4u) ? QuarterScale : -QuarterScale),
+            NodePosAndScale.w * 0.5f};
+    }
+
+    Uint32 GetSubBlockIndex(const float4& NodePosAndScale, const float3& VoxelPos)
+    {
+        return (VoxelPos.x > NodePosAndScale.x ? 1u : 0u) |
+            (VoxelPos.y > NodePosAndScale.y ? 2u : 0u) |
+            (VoxelPos.z > NodePosAndScale.z ? 4u : 0u);
+    }
+
+    MeshletCullingComparison CompareMeshletCulling(const std::vector<OctreeLeafNode>& Nodes,
+                                                   const std::vector<VoxelBufData>&   Voxels,
+                                                   const float4x4&                    ViewProj,
+                                                   const HiZPyramidCPU&               HiZ,
+                                                   Uint32                             GroupSize)
+    {
+        MeshletCullingComparison Res;
+
+        for (const OctreeLeafNode& Node : Nodes)
+        {
+            if (Node.VoxelBufIndexCount == 0)
+                continue;
+
+            const float4 NodePosAndScale{Node.BasePosAndScale.x, Node.BasePosAndScale.y, Node.BasePosAndScale.z, Node.BasePosAndScale.w};
+
+            // Every thread of the group runs the voxel test in the per-voxel mode, including idle ones
+            Res.PerVoxelBoxTests += GroupSize;
+
+            // One test for the node, plus eight for the sub-blocks if the node passes
+            Uint32 SubBlockMask = IsBoxVisible(NodePosAndScale, ViewProj, HiZ) ? 0xFFu : 0u;
+            ++Res.HierarchicalBoxTests;
+            if (SubBlockMask != 0)
+            {
+                for (Uint32 SubBlock = 0; SubBlock < 8; ++SubBlock)
+                {
+                    if (!IsBoxVisible(GetSubBlockPosAndScale(NodePosAndScale, SubBlock), ViewProj, HiZ))
+                        SubBlockMask &= ~(1u << SubBlock);
+                }
+                Res.HierarchicalBoxTests += 8;
+            }
+
+            {
+                // Validate the projection against eight full vertex transforms
+                float4 UVRect, UVRectRef;
+                float  MinZ = 0, MinZRef = 0;
+                const bool Projected    = ProjectBox(NodePosAndScale, ViewProj, UVRect, MinZ);
+                const bool ProjectedRef = ProjectBoxBruteForce(NodePosAndScale, ViewProj, UVRectRef, MinZRef);
+
+                constexpr float Eps = 1e-4f;
+                if (Projected != ProjectedRef ||
+                    std::abs(UVRect.x - UVRectRef.x) > Eps || std::abs(UVRect.y - UVRectRef.y) > Eps ||
+                    std::abs(UVRect.z - UVRectRef.z) > Eps || std::abs(UVRect.w - UVRectRef.w) > Eps ||
+                    std::abs(MinZ - MinZRef) > Eps)
+                {
+                    ++Res.ProjectionMismatches;
+                }
+            }
+
+            for (int i = 0; i < Node.VoxelBufIndexCount; ++i)
+            {
+                const auto&  Voxel = Voxels[static_cast<size_t>(Node.VoxelBufStartIndex) + i].BasePosAndScale;
+                const float4 VoxelPosAndScale{Voxel.x, Voxel.y, Voxel.z, Voxel.w};
+
+                const bool PerVoxelVisible     = IsBoxVisible(VoxelPosAndScale, ViewProj, HiZ);
+                const bool HierarchicalVisible = (SubBlockMask & (1u << GetSubBlockIndex(NodePosAndScale, float3{Voxel.x, Voxel.y, Voxel.z}))) != 0;
+
+                Res.PerVoxelVisible += PerVoxelVisible ? 1 : 0;
+                Res.HierarchicalVisible += HierarchicalVisible ? 1 : 0;
+                Res.WronglyCulled += (PerVoxelVisible && !HierarchicalVisible) ? 1 : 0;
+
+                // The 2x2 HiZ test may keep occluded voxels, but must never cull a visible one
+                Res.NonConservativeTests += (!PerVoxelVisible && IsBoxVisibleBruteForce(VoxelPosAndScale, ViewProj, HiZ)) ? 1 : 0;
+            }
+        }
+
+        return Res;
+    }
+}
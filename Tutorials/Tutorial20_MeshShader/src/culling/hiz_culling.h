@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <BasicMath.hpp>
+#include "../DrawTask.h"
+
+namespace VoxelOC
+{
+    // CPU copy of the HiZ pyramid. Mip levels are reduced with the same 2x2 max filter as generate_HiZ.hlsl.
+    class HiZPyramidCPU
+    {
+    public:
+        // RowStride is given in floats
+        void Build(const float* pDepth, Diligent::Uint32 Width, Diligent::Uint32 Height, size_t RowStride);
+
+        Diligent::Uint32 GetMipCount() const { return static_cast<Diligent::Uint32>(m_Mips.size()); }
+        Diligent::Uint32 GetWidth(Diligent::Uint32 Mip) const { return m_Mips[Mip].Width; }
+        Diligent::Uint32 GetHeight(Diligent::Uint32 Mip) const { return m_Mips[Mip].Height; }
+
+        float Load(Diligent::Uint32 x, Diligent::Uint32 y, Diligent::Uint32 Mip) const;
+
+    private:
+        struct MipLevel
+        {
+            Diligent::Uint32   Width  = 0;
+            Diligent::Uint32   Height = 0;
+            std::vector<float> Depth;
+        };
+        std::vector<MipLevel> m_Mips;
+    };
+
+    // CPU twin of ProjectBox() in cube_ash.hlsl. Computes the screen UV rectangle [minU, minV, maxU, maxV] and the
+    // closest depth of the box. Returns false if the box crosses the camera plane and can't be projected.
+    bool ProjectBox(const Diligent::float4& BasePosAndScale, const Diligent::float4x4& ViewProj, Diligent::float4& UVRect, float& MinZ);
+
+    // Reference projection that transforms all eight corners
+    bool ProjectBoxBruteForce(const Diligent::float4& BasePosAndScale, const Diligent::float4x4& ViewProj, Diligent::float4& UVRect, float& MinZ);
+
+    // CPU twin of IsBoxVisible() in cube_ash.hlsl
+    bool IsBoxVisible(const Diligent::float4& BasePosAndScale, const Diligent::float4x4& ViewProj, const HiZPyramidCPU& HiZ);
+
+    // Reference occlusion test that reads every depth buffer pixel covered by the box
+    bool IsBoxVisibleBruteForce(const Diligent::float4& BasePosAndScale, const Diligent::float4x4& ViewProj, const HiZPyramidCPU& HiZ);
+
+    // Bounds of one of the 2x2x2 sub-blocks of a node, see GetSubBlockPosAndScale() in cube_ash.hlsl
+    Diligent::float4 GetSubBlockPosAndScale(const Diligent::float4& NodePosAndScale, Diligent::Uint32 SubBlock);
+
+    // Index of the sub-block that contains the voxel center, see GetSubBlockIndex() in cube_ash.hlsl
+    Diligent::Uint32 GetSubBlockIndex(const Diligent::float4& NodePosAndScale, const Diligent::float3& VoxelPos);
+
+    struct MeshletCullingComparison
+    {
+        // Number of box tests (8 vertex transforms and 4 HiZ loads each) executed by the amplification shader
+        Diligent::Uint64 PerVoxelBoxTests     = 0;
+        Diligent::Uint64 HierarchicalBoxTests = 0;
+
+        Diligent::Uint32 PerVoxelVisible     = 0;
+        Diligent::Uint32 HierarchicalVisible = 0;
+
+        // Voxels culled by the hierarchical mode that the per-voxel mode keeps. Must be zero for
+        // the hierarchical mode to be conservative.
+        Diligent::Uint32 WronglyCulled = 0;
+
+        // Nodes whose projected rectangle or depth differ from the brute-force projection
+        Diligent::Uint32 ProjectionMismatches = 0;
+
+        // Voxels culled by the HiZ test although some covered depth buffer pixel is behind them
+        Diligent::Uint32 NonConservativeTests = 0;
+    };
+
+    // Evaluates the per-voxel ("Cull Meshlets") and the hierarchical occlusion culling modes on the CPU
+    // for the same view and HiZ pyramid. Frustum culling is identical in both modes and is not applied.
+    MeshletCullingComparison CompareMeshletCulling(const std::vector<OctreeLeafNode>& Nodes,
+                                                   const std::vector<VoxelBufData>&   Voxels,
+                                                   const Diligent::float4x4&          ViewProj,
+                                                   const HiZPyramidCPU&               HiZ,
+                                                   Diligent::Uint32                   GroupSize);
+}
@@ -0,0 +1,241 @@
+// Headless test of the CPU twins of the amplification shader culling. Compares ProjectBox() with the projection
+// of all eight corners and IsBoxVisible() with the test that reads every covered depth buffer pixel, for seeded
+// random boxes and views, on HiZ pyramids with odd and non-power-of-two mip sizes.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "hiz_culling.h"
+
+using namespace Diligent;
+using namespace VoxelOC;
+
+namespace
+{
+    constexpr float NearPlane = 0.5f;
+    constexpr float FarPlane  = 200.f;
+
+    enum BOX_PLACEMENT : Uint32
+    {
+        BOX_PLACEMENT_IN_FRONT = 0, // Inside the depth range, mostly on screen
+        BOX_PLACEMENT_OFF_SCREEN,   // Inside the depth range, partly or fully outside of the screen
+        BOX_PLACEMENT_NEAR_PLANE,   // Crosses the near plane or the camera plane
+        BOX_PLACEMENT_BEHIND,       // Behind the camera
+        BOX_PLACEMENT_COUNT
+    };
+
+    const char* const PlacementNames[] = {"in front", "off screen", "near plane", "behind"};
+
+    struct Stats
+    {
+        Uint32 NumBoxes[BOX_PLACEMENT_COUNT]      = {};
+        Uint32 NumProjected[BOX_PLACEMENT_COUNT]  = {};
+        Uint32 NumCulled[BOX_PLACEMENT_COUNT]     = {};
+        Uint32 NumMismatches[BOX_PLACEMENT_COUNT] = {};
+    };
+
+    // Depth buffer with a far background, a few near rectangles that occlude most of the screen
+    // and some noise, so that both occluded and visible boxes are generated
+    std::vector<float> GenerateDepth(std::mt19937& Rng, Uint32 Width, Uint32 Height)
+    {
+        std::uniform_real_distribution<float> Unorm{0.f, 1.f};
+
+        std::vector<float> Depth(size_t{Width} * Height);
+        for (float& z : Depth)
+            z = 0.98f + 0.02f * Unorm(Rng);
+
+        for (Uint32 Rect = 0; Rect < 6; ++Rect)
+        {
+            const Uint32 x0 = static_cast<Uint32>(Unorm(Rng) * Width);
+            const Uint32 y0 = static_cast<Uint32>(Unorm(Rng) * Height);
+            const Uint32 x1 = (std::min)(x0 + 1 + static_cast<Uint32>((0.3f + 0.7f * Unorm(Rng)) * Width), Width);
+            const Uint32 y1 = (std::min)(y0 + 1 + static_cast<Uint32>((0.3f + 0.7f * Unorm(Rng)) * Height), Height);
+            const float  z  = 0.2f + 0.7f * Unorm(Rng);
+            for (Uint32 y = y0; y < y1; ++y)
+            {
+                for (Uint32 x = x0; x < x1; ++x)
+                    Depth[size_t{y} * Width + x] = (std::min)(Depth[size_t{y} * Width + x], z);
+            }
+        }
+        return Depth;
+    }
+
+    // Returns the box center in view space. Aspect is the width / height ratio of the screen.
+    float3 GenerateViewSpaceCenter(std::mt19937& Rng, BOX_PLACEMENT Placement, float Size, float TanHalfFov, float Aspect)
+    {
+        std::uniform_real_distribution<float> Snorm{-1.f, 1.f};
+        std::uniform_real_distribution<float> Unorm{0.f, 1.f};
+
+        float3 Center;
+        switch (Placement)
+        {
+            case BOX_PLACEMENT_IN_FRONT:
+            case BOX_PLACEMENT_OFF_SCREEN:
+            {
+                // Uniform in 1 / z, so that most boxes are close enough to cover several pixels
+                Center.z = 1.f / (1.f / (NearPlane + Size) - Unorm(Rng) * (1.f / (NearPlane + Size) - 1.f / FarPlane));
+                // Screen extent is [-1, 1] in these units
+                const float Range = Placement == BOX_PLACEMENT_IN_FRONT ? 0.9f : 2.5f;
+                Center.x          = Snorm(Rng) * Range * Center.z * TanHalfFov * Aspect;
+                Center.y          = Snorm(Rng) * Range * Center.z * TanHalfFov;
+                break;
+            }
+
+            case BOX_PLACEMENT_NEAR_PLANE:
+                Center.z = NearPlane + Snorm(Rng) * Size;
+                Center.x = Snorm(Rng) * Size * 2.f;
+                Center.y = Snorm(Rng) * Size * 2.f;
+                break;
+
+            case BOX_PLACEMENT_BEHIND:
+                Center.z = -Size - Unorm(Rng) * 50.f;
+                Center.x = Snorm(Rng) * 50.f;
+                Center.y = Snorm(Rng) * 50.f;
+                break;
+
+            default:
+                break;
+        }
+        return Center;
+    }
+
+    bool TestView(Uint32 Width, Uint32 Height, Uint32 Seed, Uint32 NumBoxes, Stats& Res)
+    {
+        std::mt19937                          Rng{Seed};
+        std::uniform_real_distribution<float> Unorm{0.f, 1.f};
+
+        const std::vector<float> Depth = GenerateDepth(Rng, Width, Height);
+
+        HiZPyramidCPU HiZ;
+        HiZ.Build(Depth.data(), Width, Height, Width);
+
+        const float Fov    = 0.5f + Unorm(Rng) * 1.5f;
+        const float Aspect = static_cast<float>(Width) / static_cast<float>(Height);
+
+        // The camera is at the origin, so that the view matrix is a pure rotation and the
+        // world-space position of a box is its view-space position times the transposed matrix
+        const float4x4 View     = float4x4::RotationY(Unorm(Rng) * 6.2831853f) * float4x4::RotationX((Unorm(Rng) - 0.5f) * 3.1415926f);
+        const float4x4 ViewProj = View * float4x4::Projection(Fov, Aspect, NearPlane, FarPlane, false);
+        const float4x4 InvView  = View.Transpose();
+
+        float MaxAbsElement = 0;
+        for (Uint32 r = 0; r < 4; ++r)
+        {
+            for (Uint32 c = 0; c < 4; ++c)
+                MaxAbsElement = (std::max)(MaxAbsElement, std::abs(ViewProj.m[r][c]));
+        }
+
+        bool Passed = true;
+        for (Uint32 i = 0; i < NumBoxes; ++i)
+        {
+            const BOX_PLACEMENT Placement = static_cast<BOX_PLACEMENT>(i % BOX_PLACEMENT_COUNT);
+
+            // Box sizes from a fraction of a pixel to a large part of the screen
+            const float  Size        = 0.01f * std::pow(1000.f, Unorm(Rng));
+            const float3 ViewCenter  = GenerateViewSpaceCenter(Rng, Placement, Size, std::tan(Fov * 0.5f), Aspect);
+            const float4 WorldCenter = float4{ViewCenter.x, ViewCenter.y, ViewCenter.z, 1.f} * InvView;
+            const float4 BasePosAndScale{WorldCenter.x, WorldCenter.y, WorldCenter.z, Size};
+
+            ++Res.NumBoxes[Placement];
+
+            float4     UVRect, UVRectRef;
+            float      MinZ = 0, MinZRef = 0;
+            const bool Projected    = ProjectBox(BasePosAndScale, ViewProj, UVRect, MinZ);
+            const bool ProjectedRef = ProjectBoxBruteForce(BasePosAndScale, ViewProj, UVRectRef, MinZRef);
+            Res.NumProjected[Placement] += Projected ? 1 : 0;
+
+            // Both projections compute the corners in single precision, so their results may differ by a few ulps of the
+            // clip-space coordinates. The error of the projected coordinates grows with the magnitude of the clip-space
+            // coordinates relative to w, which is large for big world coordinates, wide screens and corners close to the
+            // camera plane.
+            const float HalfScale = Size * 0.5f;
+            const float MinW      = (WorldCenter * ViewProj).w -
+                HalfScale * (std::abs(ViewProj.m[0][3]) + std::abs(ViewProj.m[1][3]) + std::abs(ViewProj.m[2][3]));
+            const float ClipScale = (std::abs(WorldCenter.x) + std::abs(WorldCenter.y) + std::abs(WorldCenter.z) + 3.f * HalfScale + 1.f) * MaxAbsElement;
+
+            bool Mismatch = false;
+            if (Projected != ProjectedRef)
+            {
+                // The fast projection computes the w of the nearest corner from the center and the axes. Rounding
+                // may only put the corner on the other side of the threshold if it is at the camera plane anyway.
+                Mismatch = std::abs(MinW) > ClipScale * 1e-5f;
+            }
+            else if (Projected)
+            {
+                const float Eps = 1e-5f + ClipScale / MinW * 1e-5f;
+                Mismatch        = std::abs(UVRect.x - UVRectRef.x) > Eps || std::abs(UVRect.y - UVRectRef.y) > Eps ||
+                    std::abs(UVRect.z - UVRectRef.z) > Eps || std::abs(UVRect.w - UVRectRef.w) > Eps ||
+                    std::abs(MinZ - MinZRef) > Eps;
+            }
+            if (Mismatch)
+            {
+                if (Res.NumMismatches[Placement] < 5)
+                {
+                    std::printf("FAILED: %ux%u view %u box %u (%s): ProjectBox() = %d [%f %f %f %f] %f, brute force = %d [%f %f %f %f] %f\n",
+                                Width, Height, Seed, i, PlacementNames[Placement],
+                                Projected, UVRect.x, UVRect.y, UVRect.z, UVRect.w, MinZ,
+                                ProjectedRef, UVRectRef.x, UVRectRef.y, UVRectRef.z, UVRectRef.w, MinZRef);
+                }
+                ++Res.NumMismatches[Placement];
+                Passed = false;
+            }
+
+            // The 2x2 HiZ test reads a coarser mip than the box covers, so it may keep occluded boxes,
+            // but it must never cull a box that has a covered depth buffer pixel behind it.
+            const bool Visible    = IsBoxVisible(BasePosAndScale, ViewProj, HiZ);
+            const bool VisibleRef = IsBoxVisibleBruteForce(BasePosAndScale, ViewProj, HiZ);
+            Res.NumCulled[Placement] += Visible ? 0 : 1;
+            if (!Visible && VisibleRef)
+            {
+                if (Res.NumMismatches[Placement] < 5)
+                {
+                    std::printf("FAILED: %ux%u view %u box %u (%s) is culled by IsBoxVisible() but not by the brute-force test\n",
+                                Width, Height, Seed, i, PlacementNames[Placement]);
+                }
+                ++Res.NumMismatches[Placement];
+                Passed = false;
+            }
+        }
+        return Passed;
+    }
+} // namespace
+
+int main()
+{
+    // Odd and non-power-of-two sizes exercise the extra column and row of the HiZ reduction
+    const uint2 Resolutions[] = {
+        {640, 360},
+        {317, 181},
+        {255, 129},
+        {256, 256},
+        {1000, 3},
+        {7, 513},
+        {1, 1},
+    };
+
+    bool  Passed = true;
+    Stats Res;
+    for (const uint2& Res0 : Resolutions)
+    {
+        for (Uint32 Seed = 0; Seed < 8; ++Seed)
+            Passed = TestView(Res0.x, Res0.y, Seed, 4000, Res) && Passed;
+    }
+
+    for (Uint32 Placement = 0; Placement < BOX_PLACEMENT_COUNT; ++Placement)
+    {
+        std::printf("%-10s: %6u boxes, %6u projected, %6u culled, %u mismatches\n", PlacementNames[Placement],
+                    Res.NumBoxes[Placement], Res.NumProjected[Placement], Res.NumCulled[Placement], Res.NumMismatches[Placement]);
+    }
+
+    // Make sure that the test exercises both outcomes of the occlusion test
+    if (Res.NumCulled[BOX_PLACEMENT_IN_FRONT] == 0 || Res.NumCulled[BOX_PLACEMENT_IN_FRONT] == Res.NumBoxes[BOX_PLACEMENT_IN_FRONT])
+    {
+        std::printf("FAILED: the generated boxes are either all visible or all culled\n");
+        Passed = false;
+    }
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
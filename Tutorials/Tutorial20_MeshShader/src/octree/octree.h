@@ -2,6 +2,7 @@
 
 #include <DirectXMath.h>
 #include <array>
+#include <cmath>
 #include <vector>
 #include <set>
 #include "../DrawTask.h"
@@ -105,7 +106,7 @@ public:
     {
         if (!isLeaf) return;
 
-        VERIFY_EXPR(bounds.max.x - bounds.min.x >= 4);
+        VERIFY_EXPR(bounds.max.x - bounds.min.x >= 2);
 
         DirectX::XMFLOAT3 center = {
                 (bounds.min.x + bounds.max.x) * 0.5f,
@@ -154,7 +155,7 @@ public:
                 }
                 else
                 {
-                    VERIFY_EXPR(currentNode->bounds.CenterAndScale().w >= 4);
+                    VERIFY_EXPR(currentNode->bounds.CenterAndScale().w >= 2);
                     // Need to split this node
                     currentNode->SplitNode();
 
@@ -207,53 +208,32 @@ public:
 
     /*
      
-        For MaxObjectsPerLeaf = 4 :
-     
-        Tight and Full:                 Not Tight but Full:
-        --------------                  -----------------------------
-        | ----  ---- |                  | ----  ----                |
-        | |  |  |  | |                  | |  |  |  |                |
-        | ----  ---- |                  | ----  ----                |
-        | ----  ---- |                  | ----  ----                |
-        | |  |  |  | |                  | |  |  |  |                |
-        | ----  ---- |                  | ----  ----                |
-        --------------                  |                           |
-                                        |                           |
-                                        |                           |
-                                        |                           |
-                                        -----------------------------
+        Full:                           Not Full:
+        --------------                  --------------
+        | ----  ---- |                  | ----  ---- |
+        | |  |  |  | |                  | |  |  |  | |
+        | ----  ---- |                  | ----  ---- |
+        | ----  ---- |                  | ----       |
+        | |  |  |  | |                  | |  |       |
+        | ----  ---- |                  | ----       |
+        --------------                  --------------
+
+        Fullness only depends on the occupied voxel cells, not on the leaf capacity,
+        which only decides when a leaf is split.
     */
 
-    // A tight node is a leaf node which is not bigger than the boundaries of the individual voxels summed! 
-   /* bool IsTight() const
-    {
-        double exp = 1.0 / 3.0;
-        double base = maxObjectsPerLeaf;
-        
-        float boundDimension = (bounds.max.x - bounds.min.x);
-        double overfullVoxelDimension = std::ceil((GetVoxelSize() * 2) * pow(base, exp));
-        
-        return boundDimension <= overfullVoxelDimension;
-    }*/
-
-    bool IsTight() const
+    // Number of voxel cells along each side of the node
+    size_t GetCellsPerSide() const
     {
-        VERIFY_EXPR(isLeaf);
-
-        double exp  = 1.0 / 3.0;
-        double base = maxObjectsPerLeaf;
-
-        float  boundDimension         = (bounds.max.x - bounds.min.x);
-        double overfullVoxelDimension = std::ceil((GetVoxelSize() * 2) * pow(base, exp));
-
-        return boundDimension <= overfullVoxelDimension;
+        const float boundDimension = (bounds.max.x - bounds.min.x);
+        return static_cast<size_t>(std::round(boundDimension / (GetVoxelSize() * 2)));
     }
 
-    bool IsLeafAndTight() const
+    // Number of voxel cells the node covers
+    size_t GetCellCount() const
     {
-        if (!isLeaf) return false;
-
-        return IsTight();
+        const size_t cellsPerSide = GetCellsPerSide();
+        return cellsPerSide * cellsPerSide * cellsPerSide;
     }
 
     /// <summary>
@@ -262,14 +242,11 @@ public:
     /// <returns>True, if full, false if not</returns>
     bool IsFull() const
     {
-        // Node is leaf and holds the maximum amount of voxels per leaf
-        if (IsLeafAndTight() && objectIndices.size() >= maxObjectsPerLeaf)
-        {
-            return true;
-        }
-        else if (isLeaf)
+        // Every voxel cell of the leaf is occupied. Voxels are unique per cell.
+        if (isLeaf)
         {
-            return false;
+            VERIFY_EXPR(objectIndices.size() <= GetCellCount());
+            return !objectIndices.empty() && objectIndices.size() == GetCellCount();
         }
         else if (!isLeaf)
         {
@@ -0,0 +1,362 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "BuildingTextures.hpp"
+#include "BuildingTexturesAVX2.hpp"
+
+#include <algorithm>
+
+#include "BasicMath.hpp"
+#include "DebugUtilities.hpp"
+
+// The kernels use SSE2 on all x86 targets and the AVX2 kernels of BuildingTexturesAVX2.cpp
+// when the CPU supports them. Other platforms use the scalar code.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define BUILDING_TEXTURES_SSE2 1
+#else
+#    define BUILDING_TEXTURES_SSE2 0
+#endif
+
+#if BUILDING_TEXTURES_SSE2
+#    include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <intrin.h>
+#    include <immintrin.h>
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+bool CpuSupportsAVX2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 0);
+    if (CpuInfo[0] < 7)
+        return false;
+    __cpuid(CpuInfo, 1);
+    // The OS must save the YMM registers
+    const bool OSXSave = (CpuInfo[2] & (1 << 27)) != 0;
+    const bool AVX     = (CpuInfo[2] & (1 << 28)) != 0;
+    if (!OSXSave || !AVX || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(CpuInfo, 7, 0);
+    return (CpuInfo[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // Also checks that the OS saves the YMM registers
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+const bool UseAVX2 = BuildingTexturesAVX2Compiled() && CpuSupportsAVX2();
+
+// Alpha component - brightness of self-emission
+static constexpr Uint32 WallColor = F4Color_To_RGBA8Unorm({0.225f, 0.125f, 0.025f, 0.0f});
+
+static constexpr float WindowEmission = 0.04f;
+static constexpr float NeonEmission   = 0.16f;
+
+static constexpr Uint32 WindowColors[] = {
+    F4Color_To_RGBA8Unorm({0.98f, 0.92f, 0.51f, WindowEmission}),
+    WallColor,
+    WallColor,
+    F4Color_To_RGBA8Unorm({0.77f, 1.00f, 0.97f, WindowEmission}),
+    F4Color_To_RGBA8Unorm({1.00f, 0.87f, 0.66f, WindowEmission}),
+    WallColor,
+    F4Color_To_RGBA8Unorm({1.00f, 0.64f, 0.99f, WindowEmission}),
+    WallColor,
+    F4Color_To_RGBA8Unorm({0.95f, 0.95f, 0.95f, WindowEmission}),
+    F4Color_To_RGBA8Unorm({0.87f, 0.99f, 0.61f, WindowEmission}),
+    WallColor,
+    WallColor //
+};
+
+static constexpr Uint32 NeonColors[] = {
+    F4Color_To_RGBA8Unorm({0.900f, 0.376f, 0.940f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({1.000f, 0.200f, 0.200f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({0.250f, 0.930f, 0.950f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({0.970f, 0.470f, 0.168f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({0.208f, 0.953f, 0.188f, NeonEmission}) //
+};
+
+static constexpr Uint32 WindowSizePxX          = 8;
+static constexpr Uint32 WindowSizePxY          = 4;
+static constexpr Uint32 WindowWithBorderSizePx = 16;
+static constexpr Uint32 WndOffsetX             = (WindowWithBorderSizePx - WindowSizePxX) / 2;
+static constexpr Uint32 WndOffsetY             = (WindowWithBorderSizePx - WindowSizePxY) / 2;
+
+static constexpr Uint32 NeonLineSize       = 16;
+static constexpr Uint32 NeonLineBorder1    = 12;
+static constexpr Uint32 NeonLineBorder2    = 4;
+static constexpr Uint32 NeonLineWithBorder = NeonLineBorder1 + NeonLineSize + NeonLineBorder2;
+
+inline Uint32 Combine(Uint32 Lhs, Uint32 Rhs)
+{
+    return Lhs ^ ((Rhs << 8) | (Rhs >> 8));
+}
+
+void FillPixels(Uint32* Dst, Uint32 Count, Uint32 Color)
+{
+    Uint32 x = UseAVX2 ? FillPixels_AVX2(Dst, Count, Color) : 0;
+#if BUILDING_TEXTURES_SSE2
+    const __m128i Color4 = _mm_set1_epi32(static_cast<int>(Color));
+    for (; x + 4 <= Count; x += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + x), Color4);
+#endif
+    std::fill_n(Dst + x, Count - x, Color);
+}
+
+// Writes one row of a window cell: wall, window, wall
+inline void StoreWindowCellRow(Uint32* Dst, Uint32 Color)
+{
+    static_assert(WindowWithBorderSizePx == 16 && WndOffsetX == 4 && WindowSizePxX == 8, "The code below assumes 4 + 8 + 4 pixel layout");
+#if BUILDING_TEXTURES_SSE2
+    const __m128i Wall4  = _mm_set1_epi32(static_cast<int>(WallColor));
+    const __m128i Color4 = _mm_set1_epi32(static_cast<int>(Color));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + 0), Wall4);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + 4), Color4);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + 8), Color4);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + 12), Wall4);
+#else
+    FillPixels(Dst, WndOffsetX, WallColor);
+    FillPixels(Dst + WndOffsetX, WindowSizePxX, Color);
+    FillPixels(Dst + WndOffsetX + WindowSizePxX, WindowWithBorderSizePx - WndOffsetX - WindowSizePxX, WallColor);
+#endif
+}
+
+void GenWindowsRow(Uint32* Row, Uint32 W, Uint32 y, Uint32 Hash)
+{
+    const Uint32 ly = y % WindowWithBorderSizePx;
+    if (ly < WndOffsetY || ly >= WndOffsetY + WindowSizePxY)
+    {
+        FillPixels(Row, W, WallColor);
+        return;
+    }
+
+    // Combine() only XORs its left argument, so the part of the color index that
+    // does not depend on x is the same for the whole row.
+    const Uint32 RowKey = Combine(Combine(0u, (y / WindowWithBorderSizePx) * 0x9e3), Hash * 0x681);
+
+    Uint32 x = 0;
+    if (UseAVX2)
+    {
+        // The colors of a batch of cells are computed first, so that the stores run in a single call
+        Uint32 CellColors[64];
+        while (x + WindowWithBorderSizePx <= W)
+        {
+            const Uint32 NumCells = std::min((W - x) / WindowWithBorderSizePx, Uint32{_countof(CellColors)});
+            for (Uint32 Cell = 0; Cell < NumCells; ++Cell)
+            {
+                const Uint32 ColIndex = Combine(RowKey, (x / WindowWithBorderSizePx + Cell) * 0x5a2);
+                CellColors[Cell]      = WindowColors[ColIndex % _countof(WindowColors)];
+            }
+            StoreWindowCellRows_AVX2(Row + x, CellColors, NumCells, WallColor);
+            x += NumCells * WindowWithBorderSizePx;
+        }
+    }
+    for (; x + WindowWithBorderSizePx <= W; x += WindowWithBorderSizePx)
+    {
+        const Uint32 ColIndex = Combine(RowKey, (x / WindowWithBorderSizePx) * 0x5a2);
+        StoreWindowCellRow(Row + x, WindowColors[ColIndex % _countof(WindowColors)]);
+    }
+    for (; x < W; ++x)
+    {
+        const Uint32 lx = x % WindowWithBorderSizePx;
+        Uint32       col = WallColor;
+        if (lx >= WndOffsetX && lx < WindowSizePxX + WndOffsetX)
+        {
+            const Uint32 ColIndex = Combine(RowKey, (x / WindowWithBorderSizePx) * 0x5a2);
+            col                   = WindowColors[ColIndex % _countof(WindowColors)];
+        }
+        Row[x] = col;
+    }
+}
+
+inline Uint32 BoxFilter2x2(Uint32 c0, Uint32 c1, Uint32 c2, Uint32 c3)
+{
+    Uint32 Result = 0;
+    for (Uint32 Shift = 0; Shift < 32; Shift += 8)
+    {
+        const Uint32 Sum = ((c0 >> Shift) & 0xFFu) + ((c1 >> Shift) & 0xFFu) + ((c2 >> Shift) & 0xFFu) + ((c3 >> Shift) & 0xFFu);
+        Result |= ((Sum + 2) >> 2) << Shift;
+    }
+
+    // disable self-emission
+    const Uint32 NumEmissionPix = ((c0 >> 24) != 0) + ((c1 >> 24) != 0) + ((c2 >> 24) != 0) + ((c3 >> 24) != 0);
+    if (NumEmissionPix <= 2)
+        Result &= 0x00FFFFFFu;
+
+    return Result;
+}
+
+#if BUILDING_TEXTURES_SSE2
+// Filters 8 texels of two source rows into 4 destination texels
+inline __m128i BoxFilter2x2_SSE2(const Uint32* Row0, const Uint32* Row1)
+{
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128i r0a  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0));
+    const __m128i r0b  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + 4));
+    const __m128i r1a  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1));
+    const __m128i r1b  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + 4));
+
+    // Vertical sums of 16-bit channels: Lo holds texels 0 and 1, Hi holds texels 2 and 3
+    __m128i aLo = _mm_add_epi16(_mm_unpacklo_epi8(r0a, Zero), _mm_unpacklo_epi8(r1a, Zero));
+    __m128i aHi = _mm_add_epi16(_mm_unpackhi_epi8(r0a, Zero), _mm_unpackhi_epi8(r1a, Zero));
+    __m128i bLo = _mm_add_epi16(_mm_unpacklo_epi8(r0b, Zero), _mm_unpacklo_epi8(r1b, Zero));
+    __m128i bHi = _mm_add_epi16(_mm_unpackhi_epi8(r0b, Zero), _mm_unpackhi_epi8(r1b, Zero));
+    // Horizontal sums end up in the low 64 bits
+    aLo = _mm_add_epi16(aLo, _mm_srli_si128(aLo, 8));
+    aHi = _mm_add_epi16(aHi, _mm_srli_si128(aHi, 8));
+    bLo = _mm_add_epi16(bLo, _mm_srli_si128(bLo, 8));
+    bHi = _mm_add_epi16(bHi, _mm_srli_si128(bHi, 8));
+
+    const __m128i Two  = _mm_set1_epi16(2);
+    const __m128i SumA = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(aLo, aHi), Two), 2);
+    const __m128i SumB = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(bLo, bHi), Two), 2);
+    const __m128i Avg  = _mm_packus_epi16(SumA, SumB);
+
+    // Count emissive texels
+    const __m128i AlphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i One       = _mm_set1_epi32(1);
+    const auto    Emissive  = [&](__m128i p) {
+        return _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(p, AlphaMask), Zero), One);
+    };
+    __m128i NumA = _mm_add_epi32(Emissive(r0a), Emissive(r1a));
+    __m128i NumB = _mm_add_epi32(Emissive(r0b), Emissive(r1b));
+    NumA         = _mm_add_epi32(NumA, _mm_srli_epi64(NumA, 32));
+    NumB         = _mm_add_epi32(NumB, _mm_srli_epi64(NumB, 32));
+
+    const __m128i Num       = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(NumA), _mm_castsi128_ps(NumB), _MM_SHUFFLE(2, 0, 2, 0)));
+    const __m128i KeepAlpha = _mm_cmpgt_epi32(Num, _mm_set1_epi32(2));
+    return _mm_and_si128(Avg, _mm_or_si128(KeepAlpha, _mm_set1_epi32(0x00FFFFFF)));
+}
+#endif
+
+
+} // namespace
+
+void GenBuildingTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice, Uint32 CurrTime, Uint32 FirstRow, Uint32 EndRow)
+{
+    VERIFY_EXPR(Width >= NeonLineWithBorder && Height >= NeonLineWithBorder && EndRow <= Height);
+
+    const Uint32 Hash  = ((Slice * 0xacd) << (CurrTime & 2)) ^ (CurrTime * 0x4c44);
+    const Uint32 Hash2 = Slice * 0x79b3;
+
+    TexLayerType TexType = TexLayerType::Wall;
+    if (Slice > 0)
+        TexType = static_cast<TexLayerType>((Slice - 1) % static_cast<Uint32>(TexLayerType::Count) + 1);
+
+    const bool HasWindows = (TexType == TexLayerType::Windows ||
+                             TexType == TexLayerType::WindowsAndRightNeonLine ||
+                             TexType == TexLayerType::WindowsAndTopNeonLine);
+    const bool RightNeon  = (TexType == TexLayerType::WallAndRightNeonLine || TexType == TexLayerType::WindowsAndRightNeonLine);
+    const bool TopNeon    = (TexType == TexLayerType::WallAndTopNeonLine || TexType == TexLayerType::WindowsAndTopNeonLine);
+    const auto NeonColor  = NeonColors[(Hash2 ^ (Hash2 >> 4)) % _countof(NeonColors)];
+
+    for (Uint32 y = FirstRow; y < EndRow; ++y)
+    {
+        Uint32* Row = Pixels + size_t{y} * Width;
+
+        // The top neon line covers whole rows
+        if (TopNeon && y >= Height - NeonLineWithBorder)
+        {
+            const Uint32 ly = y - (Height - NeonLineWithBorder);
+            FillPixels(Row, Width, (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColor : WallColor);
+            continue;
+        }
+
+        if (HasWindows)
+            GenWindowsRow(Row, Width, y, Hash);
+        else
+            FillPixels(Row, Width, WallColor);
+
+        if (RightNeon)
+        {
+            Uint32* Line = Row + Width - NeonLineWithBorder;
+            FillPixels(Line, NeonLineBorder1, WallColor);
+            FillPixels(Line + NeonLineBorder1, NeonLineSize, NeonColor);
+            FillPixels(Line + NeonLineBorder1 + NeonLineSize, NeonLineBorder2, WallColor);
+        }
+    }
+}
+
+void GenBuildingTextureMip(const Uint32* SrcPixels, Uint32 SrcW, Uint32 SrcH, Uint32* DstPixels, Uint32 DstW, Uint32 DstH, Uint32 FirstRow, Uint32 EndRow)
+{
+    VERIFY_EXPR(SrcW >= 2 && SrcH >= 2);
+    VERIFY_EXPR(DstW * 2 <= SrcW && DstH * 2 <= SrcH && EndRow <= DstH);
+
+    for (Uint32 y = FirstRow; y < EndRow; ++y)
+    {
+        const Uint32* Row0 = SrcPixels + size_t{y} * 2 * SrcW;
+        const Uint32* Row1 = Row0 + SrcW;
+        Uint32*       Dst  = DstPixels + size_t{y} * DstW;
+
+        Uint32 x = UseAVX2 ? GenBuildingTextureMipRow_AVX2(Row0, Row1, Dst, DstW) : 0;
+#if BUILDING_TEXTURES_SSE2
+        for (; x + 4 <= DstW; x += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + x), BoxFilter2x2_SSE2(Row0 + x * 2, Row1 + x * 2));
+#endif
+        for (; x < DstW; ++x)
+            Dst[x] = BoxFilter2x2(Row0[x * 2], Row0[x * 2 + 1], Row1[x * 2], Row1[x * 2 + 1]);
+    }
+}
+
+void GenBuildingTextureMips(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 MipLevels)
+{
+    Uint32 SrcOffset = 0;
+    for (Uint32 Mipmap = 1; Mipmap < MipLevels; ++Mipmap)
+    {
+        const auto   SrcW      = std::max(1u, Width >> (Mipmap - 1));
+        const auto   SrcH      = std::max(1u, Height >> (Mipmap - 1));
+        const Uint32 DstOffset = SrcOffset + SrcW * SrcH;
+        const auto   DstW      = std::max(1u, Width >> Mipmap);
+        const auto   DstH      = std::max(1u, Height >> Mipmap);
+
+        GenBuildingTextureMip(Pixels + SrcOffset, SrcW, SrcH, Pixels + DstOffset, DstW, DstH, 0, DstH);
+        SrcOffset = DstOffset;
+    }
+}
+
+const char* GetBuildingTextureKernelISA()
+{
+    if (UseAVX2)
+        return "AVX2";
+#if BUILDING_TEXTURES_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace Diligent
@@ -0,0 +1,60 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+enum class TexLayerType
+{
+    Wall                    = 0,
+    WallAndRightNeonLine    = 1,
+    WallAndTopNeonLine      = 2,
+    Windows                 = 3,
+    WindowsAndRightNeonLine = 4,
+    WindowsAndTopNeonLine   = 5,
+    Count                   = 5, // ignore 'Wall'
+};
+
+/// Generates rows [FirstRow, EndRow) of the top mip level of the building atlas slice.
+/// Pixels points to the first row of the slice.
+void GenBuildingTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice, Uint32 CurrTime, Uint32 FirstRow, Uint32 EndRow);
+
+/// Computes rows [FirstRow, EndRow) of a mip level from the previous level with a 2x2 box filter.
+/// Self-emission is disabled in texels where fewer than three source texels are emissive.
+void GenBuildingTextureMip(const Uint32* SrcPixels, Uint32 SrcW, Uint32 SrcH, Uint32* DstPixels, Uint32 DstW, Uint32 DstH, Uint32 FirstRow, Uint32 EndRow);
+
+/// Generates mip levels 1 .. MipLevels-1 of a slice from its top level. All levels are stored one after another.
+void GenBuildingTextureMips(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 MipLevels);
+
+/// Instruction set used by the texture kernels: "AVX2", "SSE2" or "scalar".
+const char* GetBuildingTextureKernelISA();
+
+} // namespace Diligent
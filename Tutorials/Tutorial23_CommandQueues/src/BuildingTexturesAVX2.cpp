@@ -0,0 +1,149 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// This file is compiled with -mavx2 (/arch:AVX2 with MSVC) on x86, see CMakeLists.txt. It must not use inline
+// functions or templates of other headers (e.g. std::fill_n): the linker may pick their AVX2 copies for the
+// callers in other files, which would then fail on CPUs without AVX2.
+
+#include "BuildingTexturesAVX2.hpp"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#endif
+
+namespace Diligent
+{
+
+#if defined(__AVX2__)
+
+namespace
+{
+
+// Filters 16 texels of two source rows into 8 destination texels.
+// Same as BoxFilter2x2_SSE2 in every 128-bit lane, followed by a cross-lane permutation.
+inline __m256i BoxFilter2x2_AVX2(const Uint32* Row0, const Uint32* Row1)
+{
+    const __m256i Zero = _mm256_setzero_si256();
+    const __m256i r0a  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row0));
+    const __m256i r0b  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row0 + 8));
+    const __m256i r1a  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row1));
+    const __m256i r1b  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Row1 + 8));
+
+    __m256i aLo = _mm256_add_epi16(_mm256_unpacklo_epi8(r0a, Zero), _mm256_unpacklo_epi8(r1a, Zero));
+    __m256i aHi = _mm256_add_epi16(_mm256_unpackhi_epi8(r0a, Zero), _mm256_unpackhi_epi8(r1a, Zero));
+    __m256i bLo = _mm256_add_epi16(_mm256_unpacklo_epi8(r0b, Zero), _mm256_unpacklo_epi8(r1b, Zero));
+    __m256i bHi = _mm256_add_epi16(_mm256_unpackhi_epi8(r0b, Zero), _mm256_unpackhi_epi8(r1b, Zero));
+    aLo         = _mm256_add_epi16(aLo, _mm256_srli_si256(aLo, 8));
+    aHi         = _mm256_add_epi16(aHi, _mm256_srli_si256(aHi, 8));
+    bLo         = _mm256_add_epi16(bLo, _mm256_srli_si256(bLo, 8));
+    bHi         = _mm256_add_epi16(bHi, _mm256_srli_si256(bHi, 8));
+
+    const __m256i Two  = _mm256_set1_epi16(2);
+    const __m256i SumA = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(aLo, aHi), Two), 2);
+    const __m256i SumB = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(bLo, bHi), Two), 2);
+    const __m256i Avg  = _mm256_packus_epi16(SumA, SumB);
+
+    const __m256i AlphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m256i One       = _mm256_set1_epi32(1);
+    const auto    Emissive  = [&](__m256i p) {
+        return _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(p, AlphaMask), Zero), One);
+    };
+    __m256i NumA = _mm256_add_epi32(Emissive(r0a), Emissive(r1a));
+    __m256i NumB = _mm256_add_epi32(Emissive(r0b), Emissive(r1b));
+    NumA         = _mm256_add_epi32(NumA, _mm256_srli_epi64(NumA, 32));
+    NumB         = _mm256_add_epi32(NumB, _mm256_srli_epi64(NumB, 32));
+
+    const __m256i Num       = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(NumA), _mm256_castsi256_ps(NumB), _MM_SHUFFLE(2, 0, 2, 0)));
+    const __m256i KeepAlpha = _mm256_cmpgt_epi32(Num, _mm256_set1_epi32(2));
+    const __m256i Result    = _mm256_and_si256(Avg, _mm256_or_si256(KeepAlpha, _mm256_set1_epi32(0x00FFFFFF)));
+
+    // Texels are ordered 0-1, 4-5, 2-3, 6-7
+    return _mm256_permute4x64_epi64(Result, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+} // namespace
+
+bool BuildingTexturesAVX2Compiled()
+{
+    return true;
+}
+
+Uint32 FillPixels_AVX2(Uint32* Dst, Uint32 Count, Uint32 Color)
+{
+    const __m256i Color8 = _mm256_set1_epi32(static_cast<int>(Color));
+
+    Uint32 x = 0;
+    for (; x + 8 <= Count; x += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dst + x), Color8);
+    return x;
+}
+
+void StoreWindowCellRows_AVX2(Uint32* Dst, const Uint32* CellColors, Uint32 NumCells, Uint32 WallColor)
+{
+    const __m256i Wall8 = _mm256_set1_epi32(static_cast<int>(WallColor));
+    for (Uint32 Cell = 0; Cell < NumCells; ++Cell, Dst += 16)
+    {
+        const __m256i Color8 = _mm256_set1_epi32(static_cast<int>(CellColors[Cell]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dst + 0), _mm256_blend_epi32(Wall8, Color8, 0xF0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dst + 8), _mm256_blend_epi32(Color8, Wall8, 0xF0));
+    }
+}
+
+Uint32 GenBuildingTextureMipRow_AVX2(const Uint32* Row0, const Uint32* Row1, Uint32* Dst, Uint32 DstW)
+{
+    Uint32 x = 0;
+    for (; x + 8 <= DstW; x += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dst + x), BoxFilter2x2_AVX2(Row0 + x * 2, Row1 + x * 2));
+    return x;
+}
+
+#else
+
+// Not an x86 target: BuildingTextures.cpp never calls the functions below
+
+bool BuildingTexturesAVX2Compiled()
+{
+    return false;
+}
+
+Uint32 FillPixels_AVX2(Uint32*, Uint32, Uint32)
+{
+    return 0;
+}
+
+void StoreWindowCellRows_AVX2(Uint32*, const Uint32*, Uint32, Uint32)
+{
+}
+
+Uint32 GenBuildingTextureMipRow_AVX2(const Uint32*, const Uint32*, Uint32*, Uint32)
+{
+    return 0;
+}
+
+#endif
+
+} // namespace Diligent
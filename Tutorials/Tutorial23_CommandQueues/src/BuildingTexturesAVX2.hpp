@@ -0,0 +1,52 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+// AVX2 versions of the building texture kernels. BuildingTexturesAVX2.cpp is the only file that is compiled
+// with AVX2 code generation, and BuildingTextures.cpp only calls these functions after checking that the CPU
+// supports AVX2. Every kernel processes a whole number of 8-texel chunks and returns how many texels it wrote;
+// the caller finishes the rest with the SSE2 or the scalar code.
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Returns true if BuildingTexturesAVX2.cpp was compiled with AVX2 code generation.
+bool BuildingTexturesAVX2Compiled();
+
+/// Fills Dst[0 .. 8*floor(Count/8)) with Color.
+Uint32 FillPixels_AVX2(Uint32* Dst, Uint32 Count, Uint32 Color);
+
+/// Writes NumCells window cell rows (4 wall texels, 8 window texels, 4 wall texels), one color per cell.
+void StoreWindowCellRows_AVX2(Uint32* Dst, const Uint32* CellColors, Uint32 NumCells, Uint32 WallColor);
+
+/// Box-filters the source rows Row0 and Row1 into Dst, see GenBuildingTextureMip.
+Uint32 GenBuildingTextureMipRow_AVX2(const Uint32* Row0, const Uint32* Row1, Uint32* Dst, Uint32 DstW);
+
+} // namespace Diligent
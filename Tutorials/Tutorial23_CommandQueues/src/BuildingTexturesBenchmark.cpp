@@ -0,0 +1,295 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Headless benchmark of the building texture kernels. Compares every kernel with
+// the scalar code the sample used before and reports pixels per second.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BuildingTextures.hpp"
+#include "BasicMath.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+namespace Reference
+{
+
+static constexpr Uint32 WallColor = F4Color_To_RGBA8Unorm({0.225f, 0.125f, 0.025f, 0.0f});
+
+static constexpr float WindowEmission = 0.04f;
+static constexpr float NeonEmission   = 0.16f;
+
+static constexpr Uint32 WindowColors[] = {
+    F4Color_To_RGBA8Unorm({0.98f, 0.92f, 0.51f, WindowEmission}),
+    WallColor,
+    WallColor,
+    F4Color_To_RGBA8Unorm({0.77f, 1.00f, 0.97f, WindowEmission}),
+    F4Color_To_RGBA8Unorm({1.00f, 0.87f, 0.66f, WindowEmission}),
+    WallColor,
+    F4Color_To_RGBA8Unorm({1.00f, 0.64f, 0.99f, WindowEmission}),
+    WallColor,
+    F4Color_To_RGBA8Unorm({0.95f, 0.95f, 0.95f, WindowEmission}),
+    F4Color_To_RGBA8Unorm({0.87f, 0.99f, 0.61f, WindowEmission}),
+    WallColor,
+    WallColor //
+};
+
+static constexpr Uint32 NeonColors[] = {
+    F4Color_To_RGBA8Unorm({0.900f, 0.376f, 0.940f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({1.000f, 0.200f, 0.200f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({0.250f, 0.930f, 0.950f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({0.970f, 0.470f, 0.168f, NeonEmission}),
+    F4Color_To_RGBA8Unorm({0.208f, 0.953f, 0.188f, NeonEmission}) //
+};
+
+static constexpr Uint32 WindowSizePxX          = 8;
+static constexpr Uint32 WindowSizePxY          = 4;
+static constexpr Uint32 WindowWithBorderSizePx = 16;
+
+static constexpr Uint32 NeonLineSize       = 16;
+static constexpr Uint32 NeonLineBorder1    = 12;
+static constexpr Uint32 NeonLineBorder2    = 4;
+static constexpr Uint32 NeonLineWithBorder = NeonLineBorder1 + NeonLineSize + NeonLineBorder2;
+
+void GenWallTexture(Uint32* Pixels, const Uint32 W, const Uint32 H)
+{
+    for (Uint32 y = 0; y < H; ++y)
+    {
+        for (Uint32 x = 0; x < W; ++x)
+            Pixels[x + y * W] = WallColor;
+    }
+}
+
+void GenRightNeonLine(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash2)
+{
+    const Uint32 ColIndex = (Hash2 ^ (Hash2 >> 4)) % _countof(NeonColors);
+    for (Uint32 y = 0; y < H; ++y)
+    {
+        for (Uint32 x = W - NeonLineWithBorder; x < W; ++x)
+        {
+            const Uint32 lx   = x - (W - NeonLineWithBorder);
+            Pixels[x + y * W] = (lx >= NeonLineBorder1 && lx < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
+        }
+    }
+}
+
+void GenTopNeonLine(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash2)
+{
+    const Uint32 ColIndex = (Hash2 ^ (Hash2 >> 4)) % _countof(NeonColors);
+    for (Uint32 y = H - NeonLineWithBorder; y < H; ++y)
+    {
+        for (Uint32 x = 0; x < W; ++x)
+        {
+            const Uint32 ly   = y - (H - NeonLineWithBorder);
+            Pixels[x + y * W] = (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
+        }
+    }
+}
+
+inline Uint32 Combine(Uint32 Lhs, Uint32 Rhs)
+{
+    return Lhs ^ ((Rhs << 8) | (Rhs >> 8));
+}
+
+void GenWindowsTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash)
+{
+    const Uint32 WndOffsetX = (WindowWithBorderSizePx - WindowSizePxX) / 2;
+    const Uint32 WndOffsetY = (WindowWithBorderSizePx - WindowSizePxY) / 2;
+
+    for (Uint32 y = 0; y < H; ++y)
+    {
+        for (Uint32 x = 0; x < W; ++x)
+        {
+            Uint32 col = WallColor;
+
+            Uint32 lx = x % WindowWithBorderSizePx;
+            Uint32 ly = y % WindowWithBorderSizePx;
+
+            if ((lx >= WndOffsetX && lx < WindowSizePxX + WndOffsetX) &&
+                (ly >= WndOffsetY && ly < WindowSizePxY + WndOffsetY))
+            {
+                Uint32 ColIndex = Combine(0u, (x / WindowWithBorderSizePx) * 0x5a2);
+                ColIndex        = Combine(ColIndex, (y / WindowWithBorderSizePx) * 0x9e3);
+                ColIndex        = Combine(ColIndex, Hash * 0x681);
+
+                col = WindowColors[ColIndex % _countof(WindowColors)];
+            }
+
+            Pixels[x + y * W] = col;
+        }
+    }
+}
+
+void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice, Uint32 CurrTime)
+{
+    const Uint32 Hash  = ((Slice * 0xacd) << (CurrTime & 2)) ^ (CurrTime * 0x4c44);
+    const Uint32 Hash2 = Slice * 0x79b3;
+
+    TexLayerType TexType = TexLayerType::Wall;
+    if (Slice > 0)
+        TexType = static_cast<TexLayerType>((Slice - 1) % static_cast<Uint32>(TexLayerType::Count) + 1);
+
+    switch (TexType)
+    {
+        case TexLayerType::Wall:
+        case TexLayerType::WallAndRightNeonLine:
+        case TexLayerType::WallAndTopNeonLine:
+            GenWallTexture(Pixels, Width, Height);
+            break;
+        default:
+            GenWindowsTexture(Pixels, Width, Height, Hash);
+    }
+    if (TexType == TexLayerType::WallAndRightNeonLine || TexType == TexLayerType::WindowsAndRightNeonLine)
+        GenRightNeonLine(Pixels, Width, Height, Hash2);
+    if (TexType == TexLayerType::WallAndTopNeonLine || TexType == TexLayerType::WindowsAndTopNeonLine)
+        GenTopNeonLine(Pixels, Width, Height, Hash2);
+}
+
+void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, Uint32* DstPixels, const Uint32 DstW, const Uint32 DstH)
+{
+    for (Uint32 y = 0; y < DstH; ++y)
+    {
+        for (Uint32 x = 0; x < DstW; ++x)
+        {
+            float4 c0  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 0) * SrcW]);
+            float4 c1  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 0) * SrcW]);
+            float4 c2  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 1) * SrcW]);
+            float4 c3  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 1) * SrcW]);
+            float4 col = (c0 + c1 + c2 + c3) * 0.25f;
+
+            // disable self-emission
+            Uint32 NumEmissionPix = (c0.a > 0.f) + (c1.a > 0.f) + (c2.a > 0.f) + (c3.a > 0.f);
+            if (NumEmissionPix <= 2)
+                col.a = 0.f;
+
+            DstPixels[x + y * DstW] = F4Color_To_RGBA8Unorm(col);
+        }
+    }
+}
+
+} // namespace Reference
+
+template <typename FuncType>
+double MeasureSeconds(Uint32 NumRuns, FuncType&& Func)
+{
+    const auto Start = std::chrono::high_resolution_clock::now();
+    for (Uint32 i = 0; i < NumRuns; ++i)
+        Func();
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+Uint32 MaxChannelDifference(const std::vector<Uint32>& Lhs, const std::vector<Uint32>& Rhs)
+{
+    Uint32 MaxDiff = 0;
+    for (size_t i = 0; i < Lhs.size(); ++i)
+    {
+        for (Uint32 Shift = 0; Shift < 32; Shift += 8)
+        {
+            const int Diff = std::abs(static_cast<int>((Lhs[i] >> Shift) & 0xFF) - static_cast<int>((Rhs[i] >> Shift) & 0xFF));
+            MaxDiff        = std::max(MaxDiff, static_cast<Uint32>(Diff));
+        }
+    }
+    return MaxDiff;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Uint32 Size    = 512;
+    Uint32 NumRuns = 50;
+    for (int a = 1; a < argc; ++a)
+    {
+        if (strcmp(argv[a], "-size") == 0 && a + 1 < argc)
+            Size = static_cast<Uint32>(atoi(argv[++a]));
+        else if (strcmp(argv[a], "-runs") == 0 && a + 1 < argc)
+            NumRuns = static_cast<Uint32>(atoi(argv[++a]));
+        else
+        {
+            fprintf(stderr, "error: unrecognized argument '%s'\n", argv[a]);
+            fprintf(stderr, "usage: Tutorial23_TextureBenchmark [-size <texture size>] [-runs <count>]\n");
+            return -1;
+        }
+    }
+    if (Size < 64 || (Size & (Size - 1)) != 0 || NumRuns == 0)
+    {
+        fprintf(stderr, "error: texture size must be a power of two >= 64 and the run count must not be zero\n");
+        return -1;
+    }
+
+    printf("Building texture kernels (%s), %ux%u, %u runs\n", GetBuildingTextureKernelISA(), Size, Size, NumRuns);
+    printf("%-26s %12s %12s %8s %9s\n", "Kernel", "Ref Mpix/s", "New Mpix/s", "Speedup", "Max diff");
+
+    const double NumPixels = static_cast<double>(Size) * Size * NumRuns;
+
+    bool AllMatch = true;
+
+    static const char* LayerNames[] = {"Wall", "WallAndRightNeonLine", "WallAndTopNeonLine", "Windows", "WindowsAndRightNeonLine", "WindowsAndTopNeonLine"};
+    for (Uint32 Slice = 0; Slice <= static_cast<Uint32>(TexLayerType::Count); ++Slice)
+    {
+        std::vector<Uint32> Ref(size_t{Size} * Size), New(size_t{Size} * Size);
+
+        const double RefTime = MeasureSeconds(NumRuns, [&]() { Reference::GenTexture(Ref.data(), Size, Size, Slice, 7); });
+        const double NewTime = MeasureSeconds(NumRuns, [&]() { GenBuildingTexture(New.data(), Size, Size, Slice, 7, 0, Size); });
+
+        const Uint32 MaxDiff = MaxChannelDifference(Ref, New);
+        AllMatch             = AllMatch && MaxDiff == 0;
+        printf("%-26s %12.1f %12.1f %7.1fx %9u\n", LayerNames[Slice], NumPixels / RefTime * 1e-6, NumPixels / NewTime * 1e-6, RefTime / NewTime, MaxDiff);
+    }
+
+    {
+        // Downsample a windows texture, which has emissive and non-emissive texels
+        std::vector<Uint32> Src(size_t{Size} * Size);
+        GenBuildingTexture(Src.data(), Size, Size, static_cast<Uint32>(TexLayerType::WindowsAndTopNeonLine), 7, 0, Size);
+
+        const Uint32        DstSize = Size / 2;
+        std::vector<Uint32> Ref(size_t{DstSize} * DstSize), New(size_t{DstSize} * DstSize);
+
+        const double RefTime = MeasureSeconds(NumRuns, [&]() { Reference::GenMipmap(Src.data(), Size, Ref.data(), DstSize, DstSize); });
+        const double NewTime = MeasureSeconds(NumRuns, [&]() { GenBuildingTextureMip(Src.data(), Size, Size, New.data(), DstSize, DstSize, 0, DstSize); });
+
+        // The kernels average integers and round halves up, the reference rounds floats: ties may differ by one
+        const Uint32 MaxDiff = MaxChannelDifference(Ref, New);
+        AllMatch             = AllMatch && MaxDiff <= 1;
+        // Source pixels per second
+        printf("%-26s %12.1f %12.1f %7.1fx %9u\n", "Mip (2x2 box)", NumPixels / RefTime * 1e-6, NumPixels / NewTime * 1e-6, RefTime / NewTime, MaxDiff);
+    }
+
+    if (!AllMatch)
+    {
+        fprintf(stderr, "error: kernel output does not match the reference\n");
+        return 1;
+    }
+    return 0;
+}
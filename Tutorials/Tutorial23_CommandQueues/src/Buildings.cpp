@@ -25,8 +25,11 @@
  */
 
 #include <random>
+#include <thread>
 
 #include "Buildings.hpp"
+#include "Align.hpp"
+#include "BuildingTextures.hpp"
 #include "MapHelper.hpp"
 #include "PlatformMisc.hpp"
 
@@ -60,18 +63,6 @@ struct Vertex
 };
 using IndexType = Uint32;
 
-enum class TexLayerType
-{
-    Wall                    = 0,
-    WallAndRightNeonLine    = 1,
-    WallAndTopNeonLine      = 2,
-    Windows                 = 3,
-    WindowsAndRightNeonLine = 4,
-    WindowsAndTopNeonLine   = 5,
-    Count                   = 5, // ignore 'Wall'
-};
-
-
 struct Building
 {
     float2 Center = {0.f, 0.f};
@@ -633,38 +624,38 @@ void Buildings::CreateResources(IDeviceContext* pContext)
         // Resource is used in multiple contexts, so disable automatic resource transitions.
         m_OpaqueTexAtlas->SetState(RESOURCE_STATE_UNKNOWN);
 
-#if USE_STAGING_TEXTURE
-        TexDesc.Name           = "Buildings staging texture atlas";
-        TexDesc.BindFlags      = BIND_NONE;
-        TexDesc.Usage          = USAGE_STAGING;
-        TexDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        m_Device->CreateTexture(TexDesc, nullptr, &m_OpaqueTexAtlasStaging);
-
-        VERIFY_EXPR((m_OpaqueTexAtlasStaging->GetState() & RESOURCE_STATE_COPY_SOURCE) != 0);
-        m_OpaqueTexAtlasStaging->SetState(RESOURCE_STATE_UNKNOWN);
-#endif
 
         Uint32 SliceSize = 0;
         for (Uint32 Mip = 0; Mip < TexDesc.MipLevels; ++Mip)
             SliceSize += std::max(1u, TexDesc.Width >> Mip) * std::max(1u, TexDesc.Height >> Mip);
 
-        m_OpaqueTexAtlasPixels.resize(size_t{SliceSize} * size_t{TexDesc.ArraySize});
-        m_GenTexTask.Pixels.resize(SliceSize);
+        m_OpaqueTexAtlasSlices.resize(TexDesc.ArraySize);
+        for (auto& SlicePixels : m_OpaqueTexAtlasSlices)
+            SlicePixels.resize(SliceSize);
         m_OpaqueTexAtlasSliceSize = SliceSize * 4;
 
+        m_StagingSliceSize = 0;
+        for (Uint32 Mip = 0; Mip < TexDesc.MipLevels; ++Mip)
+        {
+            const Uint32 W = std::max(1u, TexDesc.Width >> Mip);
+            const Uint32 H = std::max(1u, TexDesc.Height >> Mip);
+            m_StagingSliceSize += AlignUp(AlignUp(W * 4, StagingRowAlignment) * H, StagingOffsetAlignment);
+        }
+
         // Initialize content
         GenerateOpaqueTexture();
-        Uint32 Unused;
-        UpdateAtlas(pContext, ~0u, Unused);
+        UploadOpaqueTexture(pContext);
         pContext->Flush();
 
-        // Begin texture generation in async thread
+        // Begin texture generation in the worker threads
+        VERIFY_EXPR(m_GenTexJobs.empty());
+        m_GenTexSliceInFlight.assign(TexDesc.ArraySize, false);
+        m_GenTexJobs.resize(std::min(Uint32{MaxGenTexJobs}, TexDesc.ArraySize));
+        for (auto& pJob : m_GenTexJobs)
         {
-            m_GenTexTask.ArraySlice = 0;
-            m_GenTexTask.Time       = CurrentTime;
-
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::Initial);
+            pJob = std::make_unique<GenTexJob>();
+            pJob->Pixels.resize(SliceSize);
+            SubmitGenTexJob(pJob.get());
         }
     }
 
@@ -676,13 +667,6 @@ void Buildings::Initialize(IRenderDevice* pDevice, IBuffer* pDrawConstants, Uint
     m_Device               = pDevice;
     m_DrawConstants        = pDrawConstants;
     m_ImmediateContextMask = ImmediateContextMask;
-
-#if USE_STAGING_TEXTURE
-    FenceDesc FenceCI;
-    FenceCI.Name = "Upload complete fence";
-    FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
-    m_Device->CreateFence(FenceCI, &m_UploadCompleteFence);
-#endif
 }
 
 void Buildings::CreatePSO(const ScenePSOCreateAttribs& Attr)
@@ -798,407 +782,210 @@ void Buildings::BeforeDraw(IDeviceContext* pContext, const SceneDrawAttribs& Att
         ConstData->AmbientLight  = Attr.AmbientLight;
     }
 
-    // Resources must be manually transitioned to required state.
+    // The atlas is transitioned to SHADER_RESOURCE state and back by the frame graph in the graphics pass.
     // Vulkan:     correct pipeline barrier must contain pixel shader stages, which are not supported in transfer context.
     // DirectX 12: the texture is used as a pixel shader resource and must be transitioned in graphics context.
-    const StateTransitionDesc Barriers[] = {
-        {m_OpaqueTexAtlas, m_OpaqueTexAtlasDefaultState, RESOURCE_STATE_SHADER_RESOURCE},
-        {m_DrawConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE} //
-    };
-    pContext->TransitionResourceStates(_countof(Barriers), Barriers);
-}
-
-void Buildings::AfterDraw(IDeviceContext* pContext)
-{
-    // Resources must be manually transitioned to required state.
-    const StateTransitionDesc Barrier{m_OpaqueTexAtlas, RESOURCE_STATE_SHADER_RESOURCE, m_OpaqueTexAtlasDefaultState};
+    const StateTransitionDesc Barrier{m_DrawConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
     pContext->TransitionResourceStates(1, &Barrier);
 }
 
-// Alpha component - brightness of self-emission
-static constexpr Uint32 WallColor = F4Color_To_RGBA8Unorm({0.225f, 0.125f, 0.025f, 0.0f});
-
-static constexpr float WindowEmission = 0.04f;
-static constexpr float NeonEmission   = 0.16f;
-
-static constexpr Uint32 WindowColors[] = {
-    F4Color_To_RGBA8Unorm({0.98f, 0.92f, 0.51f, WindowEmission}),
-    WallColor,
-    WallColor,
-    F4Color_To_RGBA8Unorm({0.77f, 1.00f, 0.97f, WindowEmission}),
-    F4Color_To_RGBA8Unorm({1.00f, 0.87f, 0.66f, WindowEmission}),
-    WallColor,
-    F4Color_To_RGBA8Unorm({1.00f, 0.64f, 0.99f, WindowEmission}),
-    WallColor,
-    F4Color_To_RGBA8Unorm({0.95f, 0.95f, 0.95f, WindowEmission}),
-    F4Color_To_RGBA8Unorm({0.87f, 0.99f, 0.61f, WindowEmission}),
-    WallColor,
-    WallColor //
-};
-
-static constexpr Uint32 NeonColors[] = {
-    F4Color_To_RGBA8Unorm({0.900f, 0.376f, 0.940f, NeonEmission}),
-    F4Color_To_RGBA8Unorm({1.000f, 0.200f, 0.200f, NeonEmission}),
-    F4Color_To_RGBA8Unorm({0.250f, 0.930f, 0.950f, NeonEmission}),
-    F4Color_To_RGBA8Unorm({0.970f, 0.470f, 0.168f, NeonEmission}),
-    F4Color_To_RGBA8Unorm({0.208f, 0.953f, 0.188f, NeonEmission}) //
-};
-
-static constexpr Uint32 WindowSizePxX          = 8;
-static constexpr Uint32 WindowSizePxY          = 4;
-static constexpr Uint32 WindowWithBorderSizePx = 16;
-
-static constexpr Uint32 NeonLineSize       = 16;
-static constexpr Uint32 NeonLineBorder1    = 12;
-static constexpr Uint32 NeonLineBorder2    = 4;
-static constexpr Uint32 NeonLineWithBorder = NeonLineBorder1 + NeonLineSize + NeonLineBorder2;
-
-
-static void GenWallTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash)
-{
-    for (Uint32 y = 0; y < H; ++y)
-    {
-        for (Uint32 x = 0; x < W; ++x)
-        {
-            Pixels[x + y * W] = WallColor;
-        }
-    }
-}
-
-static void GenWallAndRightNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
-{
-    GenWallTexture(Pixels, W, H, Hash);
-
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
-
-    for (Uint32 y = 0; y < H; ++y)
-    {
-        for (Uint32 x = W - NeonLineWithBorder; x < W; ++x)
-        {
-            const Uint32 lx   = x - (W - NeonLineWithBorder);
-            const auto   col  = (lx >= NeonLineBorder1 && lx < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
-    }
-}
-
-static void GenWallAndTopNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
+void Buildings::UploadOpaqueTexture(IDeviceContext* pContext)
 {
-    GenWallTexture(Pixels, W, H, Hash);
-
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
-
-    for (Uint32 y = H - NeonLineWithBorder; y < H; ++y)
-    {
-        for (Uint32 x = 0; x < W; ++x)
-        {
-            const Uint32 ly   = y - (H - NeonLineWithBorder);
-            const auto   col  = (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
-    }
-}
-
-inline Uint32 Combine(Uint32 Lhs, Uint32 Rhs)
-{
-    return Lhs ^ ((Rhs << 8) | (Rhs >> 8));
-}
-
-static void GenWindowsTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash)
-{
-    const Uint32 WndOffsetX = (WindowWithBorderSizePx - WindowSizePxX) / 2;
-    const Uint32 WndOffsetY = (WindowWithBorderSizePx - WindowSizePxY) / 2;
-
-    for (Uint32 y = 0; y < H; ++y)
-    {
-        for (Uint32 x = 0; x < W; ++x)
-        {
-            Uint32 col = WallColor;
-
-            Uint32 lx = x % WindowWithBorderSizePx;
-            Uint32 ly = y % WindowWithBorderSizePx;
-
-            if ((lx >= WndOffsetX && lx < WindowSizePxX + WndOffsetX) &&
-                (ly >= WndOffsetY && ly < WindowSizePxY + WndOffsetY))
-            {
-                Uint32 ColIndex = Combine(0u, (x / WindowWithBorderSizePx) * 0x5a2);
-                ColIndex        = Combine(ColIndex, (y / WindowWithBorderSizePx) * 0x9e3);
-                ColIndex        = Combine(ColIndex, Hash * 0x681);
-
-                col = WindowColors[ColIndex % _countof(WindowColors)];
-            }
-
-            Pixels[x + y * W] = col;
-        }
-    }
-}
-
-static void GenWindowsAndRightNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
-{
-    GenWindowsTexture(Pixels, W, H, Hash);
-
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
+    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-    for (Uint32 y = 0; y < H; ++y)
+    // The whole atlas is only uploaded once, so use the implicit staging memory of UpdateTexture().
+    if (m_OpaqueTexAtlasDefaultState != RESOURCE_STATE_COPY_DEST)
     {
-        for (Uint32 x = W - NeonLineWithBorder; x < W; ++x)
-        {
-            const Uint32 lx   = x - (W - NeonLineWithBorder);
-            const auto   col  = (lx >= NeonLineBorder1 && lx < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
+        const StateTransitionDesc Barrier{m_OpaqueTexAtlas, m_OpaqueTexAtlasDefaultState, RESOURCE_STATE_COPY_DEST};
+        pContext->TransitionResourceStates(1, &Barrier);
     }
-}
 
-static void GenWindowsAndTopNeonLineTexture(Uint32* Pixels, const Uint32 W, const Uint32 H, const Uint32 Hash, const Uint32 Hash2)
-{
-    GenWindowsTexture(Pixels, W, H, Hash);
-
-    Uint32 ColIndex = Hash2 ^ (Hash2 >> 4);
-    ColIndex        = ColIndex % _countof(NeonColors);
-
-    for (Uint32 y = H - NeonLineWithBorder; y < H; ++y)
+    for (Uint32 Slice = 0; Slice < TexDesc.ArraySize; ++Slice)
     {
-        for (Uint32 x = 0; x < W; ++x)
+        Uint32 Offset = 0;
+        for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
         {
-            const Uint32 ly   = y - (H - NeonLineWithBorder);
-            const auto   col  = (ly >= NeonLineBorder1 && ly < NeonLineBorder1 + NeonLineSize) ? NeonColors[ColIndex] : WallColor;
-            Pixels[x + y * W] = col;
-        }
-    }
-}
-
-static void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, const Uint32 SrcH, Uint32* DstPixels, const Uint32 DstW, const Uint32 DstH)
-{
-    VERIFY_EXPR(SrcW >= 2 && SrcH >= 2);
+            const auto W = std::max(1u, TexDesc.Width >> Mipmap);
+            const auto H = std::max(1u, TexDesc.Height >> Mipmap);
 
-    for (Uint32 y = 0; y < DstH; ++y)
-    {
-        for (Uint32 x = 0; x < DstW; ++x)
-        {
-            float4 c0  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 0) * SrcW]);
-            float4 c1  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 0) * SrcW]);
-            float4 c2  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 1) * SrcW]);
-            float4 c3  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 1) * SrcW]);
-            float4 col = (c0 + c1 + c2 + c3) * 0.25f;
-
-            // disable self-emission
-            Uint32 NumEmissionPix = (c0.a > 0.f) + (c1.a > 0.f) + (c2.a > 0.f) + (c3.a > 0.f);
-            if (NumEmissionPix <= 2)
-                col.a = 0.f;
-
-            DstPixels[x + y * DstW] = F4Color_To_RGBA8Unorm(col);
+            TextureSubResData SubRes;
+            SubRes.Stride = Uint64{W} * 4u;
+            SubRes.pData  = &m_OpaqueTexAtlasSlices[Slice][Offset];
+            Box Region{0u, W, 0u, H};
+            pContext->UpdateTexture(m_OpaqueTexAtlas, Mipmap, Slice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
+            Offset += W * H;
         }
     }
-}
 
-static void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice, Uint32 CurrTime)
-{
-    const Uint32 Hash  = ((Slice * 0xacd) << (CurrTime & 2)) ^ (CurrTime * 0x4c44);
-    const Uint32 Hash2 = Slice * 0x79b3;
-
-    TexLayerType TexType = TexLayerType::Wall;
-    if (Slice > 0)
-        TexType = static_cast<TexLayerType>((Slice - 1) % static_cast<Uint32>(TexLayerType::Count) + 1);
-
-    switch (TexType)
+    if (m_OpaqueTexAtlasDefaultState != RESOURCE_STATE_COPY_DEST)
     {
-        // clang-format off
-        case TexLayerType::Wall:                    GenWallTexture(Pixels, Width, Height, Hash);                           break;
-        case TexLayerType::WallAndRightNeonLine:    GenWallAndRightNeonLineTexture(Pixels, Width, Height, Hash, Hash2);    break;
-        case TexLayerType::WallAndTopNeonLine:      GenWallAndTopNeonLineTexture(Pixels, Width, Height, Hash, Hash2);      break;
-        case TexLayerType::Windows:                 GenWindowsTexture(Pixels, Width, Height, Hash);                        break;
-        case TexLayerType::WindowsAndRightNeonLine: GenWindowsAndRightNeonLineTexture(Pixels, Width, Height, Hash, Hash2); break;
-        case TexLayerType::WindowsAndTopNeonLine:   GenWindowsAndTopNeonLineTexture(Pixels, Width, Height, Hash, Hash2);   break;
-        // clang-format on
-        default:
-            UNEXPECTED("Unknown texture layer type");
+        const StateTransitionDesc Barrier{m_OpaqueTexAtlas, RESOURCE_STATE_COPY_DEST, m_OpaqueTexAtlasDefaultState};
+        pContext->TransitionResourceStates(1, &Barrier);
     }
 }
 
-
 void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRateMb, Uint32& ActualTransferRateMb)
 {
+    ActualTransferRateMb = 0;
     if (RequiredTransferRateMb == 0)
         return;
 
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-    // Try to read a new texture
-    for (Uint32 i = 0; i < 100; ++i)
+    // Take all slices that have been generated since the last update. The old pixels of the slice
+    // become the buffer of the job's next slice, so no pixels are copied.
+    GenTexJob* pJob = nullptr;
+    while (m_CompletedGenTexJobs.TryPop(pJob))
     {
-        TaskStatus Expected = TaskStatus::TexReady;
-        if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::CopyTex, std::memory_order_acquire, std::memory_order_relaxed))
-        {
-            Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * m_GenTexTask.ArraySlice;
-            memcpy(&m_OpaqueTexAtlasPixels[Offset], m_GenTexTask.Pixels.data(), m_OpaqueTexAtlasSliceSize);
-
-            // Update task parameters
-            m_GenTexTask.ArraySlice = (m_GenTexTask.ArraySlice + 1) % TexDesc.ArraySize;
-            m_GenTexTask.Time       = CurrentTime;
+        m_OpaqueTexAtlasSlices[pJob->Slice].swap(pJob->Pixels);
+        m_GenTexSliceInFlight[pJob->Slice] = false;
+        SubmitGenTexJob(pJob);
+    }
 
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::CopyTex);
-            break;
-        }
+    // The ring only grows. The old buffer is released when the GPU is done with it.
+    const Uint32 RingSizeMb = std::max(std::min(RequiredTransferRateMb * UploadRingFrames, Uint32{MaxUploadRingSizeMb}),
+                                       (m_StagingSliceSize >> 20) + 1u);
+    if (RingSizeMb > m_UploadRingSizeMb)
+    {
+        m_UploadRing.Create(m_Device, pContext, "Buildings upload ring", Uint64{RingSizeMb} << 20, m_ImmediateContextMask);
+        m_UploadRingSizeMb = RingSizeMb;
     }
 
-#if USE_STAGING_TEXTURE
-    m_UploadCompleteFence->Wait(m_UploadCompleteFenceValue);
-#endif
+    if (!m_UploadRing.Begin(pContext))
+        return;
 
     pContext->BeginDebugGroup("Update textures");
 
-    // Resources must be manually transitioned to required state.
-    // Vulkan:     allowed any state which is supported by transfer queue.
-    // DirectX 12: resource transition from copy to graphics/compute queue requires resource to be in COMMON state.
-    if (m_OpaqueTexAtlasDefaultState != RESOURCE_STATE_COPY_DEST)
-    {
-        const StateTransitionDesc Barrier{m_OpaqueTexAtlas, m_OpaqueTexAtlasDefaultState, RESOURCE_STATE_COPY_DEST};
-        pContext->TransitionResourceStates(1, &Barrier);
-    }
+    // The atlas is transitioned to COPY_DEST state and back to the default state by the frame graph.
 
-    Uint32       CopiedCpuToGpu = 0;
-    const Uint32 FirstSlice     = m_m_OpaqueTexAtlasOffset;
+    const Uint64 RequiredBytes  = Uint64{RequiredTransferRateMb} << 20;
+    Uint64       CopiedCpuToGpu = 0;
+    Uint32       NumSlices      = 0;
 
     // Each frame we copy pixels from CPU side to GPU side.
-    for (Uint32 SliceInd = 0; SliceInd < TexDesc.ArraySize; ++SliceInd)
+    for (; NumSlices < TexDesc.ArraySize && CopiedCpuToGpu < RequiredBytes; ++NumSlices)
     {
-        Uint32 Slice  = (FirstSlice + SliceInd) % TexDesc.ArraySize;
-        Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
+        // If the GPU still copies from the whole ring, the remaining slices are uploaded in the next frames.
+        const auto Staging = m_UploadRing.Allocate(m_StagingSliceSize, StagingOffsetAlignment);
+        if (!Staging)
+            break;
+
+        const Uint32  Slice         = (m_m_OpaqueTexAtlasOffset + NumSlices) % TexDesc.ArraySize;
+        const Uint32* pSrcPixels    = m_OpaqueTexAtlasSlices[Slice].data();
+        Uint8*        pStagingData  = static_cast<Uint8*>(Staging.pData);
+        Uint64        StagingOffset = Staging.Offset;
         for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
         {
-            const auto W = std::max(1u, TexDesc.Width >> Mipmap);
-            const auto H = std::max(1u, TexDesc.Height >> Mipmap);
+            const auto   W       = std::max(1u, TexDesc.Width >> Mipmap);
+            const auto   H       = std::max(1u, TexDesc.Height >> Mipmap);
+            const Uint32 RowSize = W * 4;
+            const Uint32 Stride  = AlignUp(RowSize, StagingRowAlignment);
+            const Uint32 MipSize = AlignUp(Stride * H, StagingOffsetAlignment);
+
+            if (Stride == RowSize)
+            {
+                memcpy(pStagingData, pSrcPixels, size_t{RowSize} * H);
+            }
+            else
+            {
+                for (Uint32 y = 0; y < H; ++y)
+                    memcpy(pStagingData + y * Stride, pSrcPixels + y * W, RowSize);
+            }
 
-#if USE_STAGING_TEXTURE
-            MappedTextureSubresource SubRes;
-            pContext->MapTextureSubresource(m_OpaqueTexAtlasStaging, Mipmap, Slice, MAP_WRITE, MAP_FLAG_DO_NOT_WAIT | MAP_FLAG_DISCARD | MAP_FLAG_NO_OVERWRITE, nullptr, SubRes);
-            memcpy(SubRes.pData, &m_OpaqueTexAtlasPixels[Offset], W * H * 4);
-            pContext->UnmapTextureSubresource(m_OpaqueTexAtlasStaging, Mipmap, Slice);
-
-            CopyTextureAttribs Attribs;
-            Attribs.pSrcTexture = m_OpaqueTexAtlasStaging;
-            Attribs.SrcMipLevel = Mipmap;
-            Attribs.SrcSlice    = Slice;
-            Attribs.pDstTexture = m_OpaqueTexAtlas;
-            Attribs.DstMipLevel = Mipmap;
-            Attribs.DstSlice    = Slice;
-            pContext->CopyTexture(Attribs);
-#else
             TextureSubResData SubRes;
-            SubRes.Stride = Uint64{W} * 4u;
-            SubRes.pData = &m_OpaqueTexAtlasPixels[Offset];
+            SubRes.pSrcBuffer = m_UploadRing.GetBuffer();
+            SubRes.SrcOffset  = StagingOffset;
+            SubRes.Stride     = Stride;
             Box Region{0u, W, 0u, H};
             pContext->UpdateTexture(m_OpaqueTexAtlas, Mipmap, Slice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
-#endif
-            CopiedCpuToGpu += W * H * 4;
-            Offset += W * H;
-        }
 
-        m_m_OpaqueTexAtlasOffset = Slice;
+            pSrcPixels += W * H;
+            pStagingData += MipSize;
+            StagingOffset += MipSize;
+        }
 
-        ActualTransferRateMb = (CopiedCpuToGpu >> 20) + (CopiedCpuToGpu >> 21); // round bytes to Mb
-        if (ActualTransferRateMb >= RequiredTransferRateMb)
-            break;
+        CopiedCpuToGpu += m_OpaqueTexAtlasSliceSize;
     }
 
-    // Resources must be manually transitioned to required states.
-    // Vulkan:     any state supported by transfer queue is allowed.
-    // DirectX 12: resource transition from graphics/compute to copy queue requires resource to be in COMMON state.
-    if (m_OpaqueTexAtlasDefaultState != RESOURCE_STATE_COPY_DEST)
-    {
-        const StateTransitionDesc Barrier{m_OpaqueTexAtlas, RESOURCE_STATE_COPY_DEST, m_OpaqueTexAtlasDefaultState};
-        pContext->TransitionResourceStates(1, &Barrier);
-    }
+    m_m_OpaqueTexAtlasOffset = (m_m_OpaqueTexAtlasOffset + NumSlices) % TexDesc.ArraySize;
 
     pContext->EndDebugGroup();
 
-#if USE_STAGING_TEXTURE
-    pContext->EnqueueSignal(m_UploadCompleteFence, ++m_UploadCompleteFenceValue);
-#endif
+    // Signals the ring's fence after the copies
+    m_UploadRing.End(pContext);
+
+    ActualTransferRateMb = static_cast<Uint32>((CopiedCpuToGpu + (1u << 19)) >> 20); // round bytes to Mb
 }
 
 Buildings::Buildings()
 {
-    m_GenTexThreadLooping.store(true);
-    m_GenTexThread = std::thread{&Buildings::ThreadProc, this};
+    // Thread 0 of the job system is the render thread, which only submits the jobs
+    const Uint32 NumWorkers = clamp(std::thread::hardware_concurrency() / 2, 1u, Uint32{MaxGenTexThreads});
+    m_GenTexJobSystem       = std::make_unique<JobSystem>(NumWorkers + 1);
 }
 
 Buildings::~Buildings()
 {
-    m_GenTexThreadLooping.store(false);
-    m_GenTexThread.join();
+    // The jobs reference the atlas and the completion queue, so finish them before the members are destroyed
+    m_GenTexJobSystem->Wait(m_GenTexJobGroup);
 }
 
-void Buildings::ThreadProc()
+void Buildings::SubmitGenTexJob(GenTexJob* pJob)
 {
-    while (m_GenTexThreadLooping.load())
-    {
-        for (Uint32 i = 0; i < 100; ++i)
-        {
-            // Check the task status.
-            // If task status is 'NewTask' then change status to GenTex,
-            // invalidate CPU cache to make changes from another thread visible to current thread.
-            TaskStatus Expected = TaskStatus::NewTask;
-            if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::GenTex, std::memory_order_acquire, std::memory_order_relaxed))
-            {
-                const auto& TexDesc   = m_OpaqueTexAtlas->GetDesc();
-                const auto  Slice     = m_GenTexTask.ArraySlice;
-                Uint32      SrcOffset = 0;
-                GenTexture(&m_GenTexTask.Pixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, m_GenTexTask.Time);
+    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-                for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
-                {
-                    const Uint32* SrcPixels = &m_GenTexTask.Pixels[SrcOffset];
-                    const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-                    const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-                    const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-                    Uint32*       DstPixels = &m_GenTexTask.Pixels[DstOffset];
-                    const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-                    const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-                    GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-                    SrcOffset = DstOffset;
-                }
+    // Do not start a slice that is still being generated by another job. There are never more
+    // jobs than slices, and the slice of the resubmitted job is free, so the loop terminates.
+    while (m_GenTexSliceInFlight[m_NextGenTexSlice])
+        m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
 
-                // Change status to 'TexReady' and flush CPU cache to make local changes visible for other threads.
-                const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::TexReady, std::memory_order_release);
-                VERIFY_EXPR(OldStatus == TaskStatus::GenTex);
+    pJob->Slice       = m_NextGenTexSlice;
+    pJob->Time        = CurrentTime;
+    m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
 
-                break;
-            }
-        }
-        std::this_thread::sleep_for(std::chrono::microseconds{1});
-    }
+    m_GenTexSliceInFlight[pJob->Slice] = true;
+
+    m_GenTexJobSystem->Submit(m_GenTexJobGroup, [this, pJob](Uint32) {
+        GenerateSlice(pJob->Pixels, pJob->Slice, pJob->Time);
+
+        const bool Pushed = m_CompletedGenTexJobs.TryPush(pJob);
+        VERIFY(Pushed, "The queue must be large enough to hold all jobs");
+        (void)Pushed;
+    });
+}
+
+void Buildings::GenerateSlice(std::vector<Uint32>& Pixels, Uint32 Slice, Uint32 Time) const
+{
+    const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
+    GenBuildingTexture(Pixels.data(), TexDesc.Width, TexDesc.Height, Slice, Time, 0, TexDesc.Height);
+    GenBuildingTextureMips(Pixels.data(), TexDesc.Width, TexDesc.Height, TexDesc.MipLevels);
 }
 
 void Buildings::GenerateOpaqueTexture()
 {
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-    for (Uint32 Slice = 0; Slice < TexDesc.ArraySize; ++Slice)
-    {
-        Uint32 SrcOffset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
-        GenTexture(&m_OpaqueTexAtlasPixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, 0u);
+    // The whole atlas is generated at startup, so split every slice into bands of rows
+    // to keep all cores busy even when there are fewer slices than threads.
+    constexpr Uint32 RowsPerJob    = 64;
+    const Uint32     BandsPerSlice = (TexDesc.Height + RowsPerJob - 1) / RowsPerJob;
 
-        for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
+    JobSystem Jobs;
+    Jobs.ParallelFor(TexDesc.ArraySize * BandsPerSlice, 1, [&](Uint32, Uint32 Begin, Uint32 End) {
+        for (Uint32 Job = Begin; Job < End; ++Job)
         {
-            const Uint32* SrcPixels = &m_OpaqueTexAtlasPixels[SrcOffset];
-            const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-            const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-            const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-            Uint32*       DstPixels = &m_OpaqueTexAtlasPixels[DstOffset];
-            const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-            const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-            GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-            SrcOffset = DstOffset;
+            const Uint32 Slice    = Job / BandsPerSlice;
+            const Uint32 FirstRow = (Job % BandsPerSlice) * RowsPerJob;
+            const Uint32 EndRow   = std::min(FirstRow + RowsPerJob, TexDesc.Height);
+            GenBuildingTexture(m_OpaqueTexAtlasSlices[Slice].data(), TexDesc.Width, TexDesc.Height, Slice, 0u, FirstRow, EndRow);
         }
-    }
+    });
+
+    // Mip levels depend on the whole top level of the slice
+    Jobs.ParallelFor(TexDesc.ArraySize, 1, [&](Uint32, Uint32 Begin, Uint32 End) {
+        for (Uint32 Slice = Begin; Slice < End; ++Slice)
+            GenBuildingTextureMips(m_OpaqueTexAtlasSlices[Slice].data(), TexDesc.Width, TexDesc.Height, TexDesc.MipLevels);
+    });
 }
 
 } // namespace Diligent
@@ -26,14 +26,13 @@
 
 #pragma once
 
-#include <thread>
-#include <atomic>
+#include <memory>
+#include <vector>
 
 #include "Terrain.hpp"
-
-// Single staging texture allocates less memory, but spends more time
-// than when UpdateTexture() is used with implicit staging buffer.
-#define USE_STAGING_TEXTURE 0
+#include "JobSystem.hpp"
+#include "MPMCQueue.hpp"
+#include "StagingUploadRing.hpp"
 
 namespace Diligent
 {
@@ -50,10 +49,15 @@ public:
 
     void BeforeDraw(IDeviceContext* pContext, const SceneDrawAttribs& Attr);
     void Draw(IDeviceContext* pContext);
-    void AfterDraw(IDeviceContext* pContext);
 
+    // The atlas must be in COPY_DEST state.
     void UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRateMb, Uint32& ActualTransferRateMb);
 
+    // The atlas is used on the transfer and graphics queues, so it is synchronized by the frame graph.
+    // Between the passes the atlas is in the default state.
+    ITexture*      GetOpaqueTexAtlas() const { return m_OpaqueTexAtlas; }
+    RESOURCE_STATE GetOpaqueTexAtlasDefaultState() const { return m_OpaqueTexAtlasDefaultState; }
+
     Uint32 GetOpaqueTexAtlasDataSize() const
     {
         const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
@@ -61,8 +65,17 @@ public:
     }
 
 private:
+    struct GenTexJob
+    {
+        std::vector<Uint32> Pixels;
+        Uint32              Slice = 0;
+        Uint32              Time  = 0;
+    };
+
     void GenerateOpaqueTexture();
-    void ThreadProc();
+    void UploadOpaqueTexture(IDeviceContext* pContext);
+    void GenerateSlice(std::vector<Uint32>& Pixels, Uint32 Slice, Uint32 Time) const;
+    void SubmitGenTexJob(GenTexJob* pJob);
 
     RefCntAutoPtr<IRenderDevice> m_Device;
     Uint64                       m_ImmediateContextMask = 0;
@@ -82,33 +95,33 @@ private:
     Uint32      m_m_OpaqueTexAtlasOffset = 0;
 
 
-    std::vector<Uint32> m_OpaqueTexAtlasPixels;
-    Uint32              m_OpaqueTexAtlasSliceSize = 0; // in bytes
-
-    enum class TaskStatus : Uint32
-    {
-        NewTask  = 0,
-        GenTex   = 1,
-        TexReady = 2,
-        CopyTex  = 3,
-        Initial  = ~0u,
-    };
-    struct GenTexTask
-    {
-        std::atomic<TaskStatus> Status{TaskStatus::Initial}; // protects access to other fields
-        std::vector<Uint32>     Pixels;
-        Uint32                  ArraySlice = 0;
-        Uint32                  Time       = 0;
-    };
-    GenTexTask        m_GenTexTask;
-    std::thread       m_GenTexThread;
-    std::atomic<bool> m_GenTexThreadLooping{false};
-
-#if USE_STAGING_TEXTURE
-    RefCntAutoPtr<ITexture> m_OpaqueTexAtlasStaging;
-    RefCntAutoPtr<IFence>   m_UploadCompleteFence;
-    Uint64                  m_UploadCompleteFenceValue = 0;
-#endif
+    // Pixels of every atlas slice with all its mip levels
+    std::vector<std::vector<Uint32>> m_OpaqueTexAtlasSlices;
+    Uint32                           m_OpaqueTexAtlasSliceSize = 0; // in bytes
+
+    // Slices are regenerated in the background by the workers of a job system. Every job owns a pixel buffer
+    // that is swapped with the atlas slice when the job is complete. The render thread only submits jobs,
+    // it never waits for them while the application is running.
+    static constexpr Uint32 MaxGenTexThreads = 4;
+    static constexpr Uint32 MaxGenTexJobs    = MaxGenTexThreads * 2;
+
+    std::unique_ptr<JobSystem>              m_GenTexJobSystem;
+    JobSystem::JobGroup                     m_GenTexJobGroup;
+    std::vector<std::unique_ptr<GenTexJob>> m_GenTexJobs;
+    MPMCQueue<GenTexJob*>                   m_CompletedGenTexJobs{MaxGenTexJobs};
+    std::vector<bool>                       m_GenTexSliceInFlight;
+    Uint32                                  m_NextGenTexSlice = 0;
+
+    // Slices are copied to the atlas from a staging ring that holds the uploads of several frames,
+    // so writing the next slices never waits for the copies of the previous frames.
+    static constexpr Uint32 UploadRingFrames       = 3;
+    static constexpr Uint32 MaxUploadRingSizeMb    = 256;
+    static constexpr Uint32 StagingRowAlignment    = 256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+    static constexpr Uint32 StagingOffsetAlignment = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+    StagingUploadRing m_UploadRing;
+    Uint32            m_UploadRingSizeMb = 0;
+    Uint32            m_StagingSliceSize = 0; // in bytes, with all mip levels and row padding
 
 public:
     Uint32 CurrentTime = 0;
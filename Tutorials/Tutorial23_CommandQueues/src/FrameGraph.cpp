@@ -0,0 +1,475 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "FrameGraph.hpp"
+
+#include <algorithm>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+static const char* GetQueueName(FrameGraph::QUEUE Queue)
+{
+    switch (Queue)
+    {
+        // clang-format off
+        case FrameGraph::QUEUE_GRAPHICS: return "graphics";
+        case FrameGraph::QUEUE_COMPUTE:  return "compute";
+        case FrameGraph::QUEUE_TRANSFER: return "transfer";
+        // clang-format on
+        default:
+            UNEXPECTED("Unexpected queue");
+            return "";
+    }
+}
+
+FrameGraph::~FrameGraph()
+{
+    WaitForIdle();
+}
+
+void FrameGraph::Initialize(IRenderDevice* pDevice, IDeviceContext* const* ppContexts)
+{
+    m_pDevice = pDevice;
+    if (m_pDevice == nullptr)
+        return;
+
+    Uint32 NumQueues = 0;
+    for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+    {
+        m_Queues[q].pContext = ppContexts[q];
+        if (m_Queues[q].pContext != nullptr)
+            ++NumQueues;
+    }
+
+    // Fences are only needed to synchronize queues.
+    if (NumQueues < 2)
+        return;
+
+    for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+    {
+        auto& Queue = m_Queues[q];
+        if (Queue.pContext == nullptr)
+            continue;
+
+        const std::string Name = std::string{"Frame graph "} + GetQueueName(static_cast<QUEUE>(q)) + " queue fence";
+
+        FenceDesc Desc;
+        Desc.Name = Name.c_str();
+        Desc.Type = FENCE_TYPE_GENERAL;
+        m_pDevice->CreateFence(Desc, &Queue.pFence);
+    }
+}
+
+FrameGraph::ResourceId FrameGraph::AddResource(const char* Name, RESOURCE_STATE HomeState)
+{
+    ResourceInfo Res;
+    Res.Name      = Name;
+    Res.HomeState = HomeState;
+    Res.State     = HomeState;
+    m_Resources.push_back(std::move(Res));
+    return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+void FrameGraph::SetResourceTexture(ResourceId Id, ITexture* pTexture)
+{
+    VERIFY_EXPR(Id < m_Resources.size());
+    VERIFY(m_Resources[Id].State == m_Resources[Id].HomeState, "Resource must be in the home state when the texture is changed");
+    m_Resources[Id].pTexture = pTexture;
+}
+
+void FrameGraph::AddPass(const char* Name, QUEUE Queue, std::initializer_list<ResourceAccess> Accesses, PassFunc Func)
+{
+    VERIFY_EXPR(Queue < QUEUE_COUNT);
+    VERIFY(IsCpuOnly() || m_Queues[Queue].pContext != nullptr, "Pass '", Name, "' uses the ", GetQueueName(Queue), " queue, which is not available");
+
+    Pass NewPass;
+    NewPass.Name     = Name;
+    NewPass.Queue    = Queue;
+    NewPass.Accesses = Accesses;
+    NewPass.Func     = std::move(Func);
+
+#ifdef DILIGENT_DEBUG
+    for (size_t i = 0; i < NewPass.Accesses.size(); ++i)
+    {
+        VERIFY(NewPass.Accesses[i].Id < m_Resources.size(), "Pass '", Name, "' accesses an unknown resource");
+        for (size_t j = i + 1; j < NewPass.Accesses.size(); ++j)
+            VERIFY(NewPass.Accesses[i].Id != NewPass.Accesses[j].Id, "Pass '", Name, "' accesses resource '", m_Resources[NewPass.Accesses[i].Id].Name, "' more than once");
+    }
+#endif
+
+    m_Passes.push_back(std::move(NewPass));
+}
+
+FrameGraph::SignalPoint FrameGraph::FindSignal(QUEUE Queue, Uint64 Ordinal)
+{
+    auto& Signals = m_Queues[Queue].Signals;
+
+    // The first signal after the pass also covers it.
+    auto It = std::lower_bound(Signals.begin(), Signals.end(), Ordinal,
+                               [](const SignalPoint& Pt, Uint64 Ord) { return Pt.Ordinal < Ord; });
+    if (It != Signals.end())
+        return *It;
+
+    // The pass did not signal because no pass of its frame on another queue needed it,
+    // e.g. the passes have changed since then. Signal now: everything submitted to the queue so far is covered.
+    Signal(Queue, true);
+    ++m_Stats.NumLateSignals;
+    return Signals.back();
+}
+
+void FrameGraph::Signal(QUEUE Queue, bool Flush)
+{
+    auto& Q = m_Queues[Queue];
+
+    SignalPoint Pt;
+    Pt.Ordinal      = Q.NumPasses;
+    Pt.Value        = ++Q.LastSignal;
+    Pt.Known        = Q.Known;
+    Pt.Known[Queue] = Q.NumPasses;
+
+    // Only the most recent signals are ever waited for, older ones are covered by the remaining signals.
+    constexpr size_t MaxSignals = 64;
+    if (Q.Signals.size() >= MaxSignals)
+        Q.Signals.erase(Q.Signals.begin(), Q.Signals.begin() + MaxSignals / 2);
+    Q.Signals.push_back(Pt);
+
+    if (Q.pFence != nullptr)
+    {
+        Q.pContext->EnqueueSignal(Q.pFence, Pt.Value);
+        if (Flush)
+            Q.pContext->Flush();
+    }
+
+    if (IsCpuOnly() && Q.LastHistoryIdx < m_History.size())
+        m_History[Q.LastHistoryIdx].SignalValue = Pt.Value;
+
+    ++m_Stats.NumSignals;
+}
+
+void FrameGraph::Execute()
+{
+    m_Stats           = {};
+    m_Stats.NumPasses = static_cast<Uint32>(m_Passes.size());
+
+    // A pass signals its queue fence only if a pass on another queue has a conflicting access.
+    // Passes of the previous frame stand in for the passes of the next frame, which e.g. read
+    // the other half of double-buffered resources. Passes of the next frames run after this frame is
+    // submitted, so only the signals that are waited for within the frame must be flushed right away.
+    // The graphics queue is flushed by Present().
+    std::vector<bool> NeedSignal(m_Passes.size(), false);
+    std::vector<bool> NeedFlush(m_Passes.size(), false);
+    for (size_t i = 0; i < m_Passes.size(); ++i)
+    {
+        const auto& Src = m_Passes[i];
+
+        auto FindConflicts = [&](const std::vector<Pass>& Passes, bool IsCurrentFrame) {
+            for (size_t j = 0; j < Passes.size(); ++j)
+            {
+                const auto& Dst = Passes[j];
+                if (Src.Queue == Dst.Queue)
+                    continue;
+
+                for (const auto& SrcAccess : Src.Accesses)
+                {
+                    for (const auto& DstAccess : Dst.Accesses)
+                    {
+                        if (IsConflict(SrcAccess, DstAccess))
+                        {
+                            NeedSignal[i] = true;
+                            if ((IsCurrentFrame && j > i) || Src.Queue != QUEUE_GRAPHICS)
+                                NeedFlush[i] = true;
+                        }
+                    }
+                }
+            }
+        };
+        FindConflicts(m_Passes, true);
+        FindConflicts(m_PrevPasses, false);
+    }
+
+    for (size_t i = 0; i < m_Passes.size(); ++i)
+    {
+        auto& CurrPass = m_Passes[i];
+        auto& Q        = m_Queues[CurrPass.Queue];
+
+        // Find the last passes on other queues that this pass depends on.
+        Clock Required = {};
+        for (const auto& Access : CurrPass.Accesses)
+        {
+            const auto& Res = m_Resources[Access.Id];
+            if (Res.LastWriter.Ordinal != 0 && Res.LastWriter.Queue != CurrPass.Queue)
+                Required[Res.LastWriter.Queue] = std::max(Required[Res.LastWriter.Queue], Res.LastWriter.Ordinal);
+
+            if (Access.Write)
+            {
+                for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+                {
+                    if (q != CurrPass.Queue)
+                        Required[q] = std::max(Required[q], Res.LastReaders[q]);
+                }
+            }
+        }
+
+        std::array<SignalPoint, QUEUE_COUNT> Waits;
+        std::array<bool, QUEUE_COUNT>        UseWait = {};
+        for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+        {
+            UseWait[q] = q != CurrPass.Queue && Required[q] > Q.Known[q];
+            if (UseWait[q])
+                Waits[q] = FindSignal(static_cast<QUEUE>(q), Required[q]);
+        }
+
+        // Skip waits that are implied by the other waits of the pass.
+        for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+        {
+            for (Uint32 r = 0; r < QUEUE_COUNT && UseWait[q]; ++r)
+            {
+                if (r != q && UseWait[r] && Waits[r].Known[q] >= Required[q])
+                    UseWait[q] = false;
+            }
+        }
+
+        ScheduledPass Record;
+        for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+        {
+            if (!UseWait[q])
+                continue;
+
+            if (Q.pContext != nullptr)
+                Q.pContext->DeviceWaitForFence(m_Queues[q].pFence, Waits[q].Value);
+
+            for (Uint32 r = 0; r < QUEUE_COUNT; ++r)
+                Q.Known[r] = std::max(Q.Known[r], Waits[q].Known[r]);
+
+            Record.Waits.push_back({static_cast<QUEUE>(q), Waits[q].Value});
+            ++m_Stats.NumWaits;
+        }
+
+        // Move resources out of their home state.
+        m_Barriers.clear();
+        for (const auto& Access : CurrPass.Accesses)
+        {
+            auto& Res = m_Resources[Access.Id];
+            if (Res.State == Access.State)
+                continue;
+
+            if (Res.pTexture != nullptr)
+                m_Barriers.emplace_back(Res.pTexture, Res.State, Access.State);
+            Res.State = Access.State;
+            ++m_Stats.NumBarriers;
+        }
+        if (!m_Barriers.empty() && Q.pContext != nullptr)
+            Q.pContext->TransitionResourceStates(static_cast<Uint32>(m_Barriers.size()), m_Barriers.data());
+
+        const Uint64 Ordinal = ++Q.NumPasses;
+        if (IsCpuOnly())
+        {
+            Record.Name      = CurrPass.Name;
+            Record.Queue     = CurrPass.Queue;
+            Record.Ordinal   = Ordinal;
+            Record.Accesses  = CurrPass.Accesses;
+            Q.LastHistoryIdx = m_History.size();
+            m_History.push_back(std::move(Record));
+        }
+        else if (CurrPass.Func)
+        {
+            CurrPass.Func(Q.pContext);
+        }
+
+        // Return resources to their home state, unless the next pass that uses the resource
+        // runs on the same queue and needs the same state.
+        m_Barriers.clear();
+        for (const auto& Access : CurrPass.Accesses)
+        {
+            auto& Res = m_Resources[Access.Id];
+            if (Res.State == Res.HomeState)
+                continue;
+
+            const ResourceAccess* pNextAccess = nullptr;
+            QUEUE                 NextQueue   = CurrPass.Queue;
+            for (size_t j = i + 1; j < m_Passes.size() && pNextAccess == nullptr; ++j)
+            {
+                for (const auto& NextAccess : m_Passes[j].Accesses)
+                {
+                    if (NextAccess.Id == Access.Id)
+                    {
+                        pNextAccess = &NextAccess;
+                        NextQueue   = m_Passes[j].Queue;
+                        break;
+                    }
+                }
+            }
+            if (pNextAccess != nullptr && NextQueue == CurrPass.Queue && pNextAccess->State == Res.State)
+                continue;
+
+            if (Res.pTexture != nullptr)
+                m_Barriers.emplace_back(Res.pTexture, Res.State, Res.HomeState);
+            Res.State = Res.HomeState;
+            ++m_Stats.NumBarriers;
+        }
+        if (!m_Barriers.empty() && Q.pContext != nullptr)
+            Q.pContext->TransitionResourceStates(static_cast<Uint32>(m_Barriers.size()), m_Barriers.data());
+
+        for (const auto& Access : CurrPass.Accesses)
+        {
+            auto& Res = m_Resources[Access.Id];
+            if (Access.Write)
+            {
+                Res.LastWriter  = {CurrPass.Queue, Ordinal};
+                Res.LastReaders = {};
+            }
+            else
+            {
+                Res.LastReaders[CurrPass.Queue] = Ordinal;
+            }
+        }
+
+        if (NeedSignal[i])
+            Signal(CurrPass.Queue, NeedFlush[i]);
+    }
+
+    m_PrevPasses.clear();
+    for (auto& CurrPass : m_Passes)
+    {
+        // Release the resources captured by the callback.
+        CurrPass.Func = nullptr;
+        m_PrevPasses.push_back(std::move(CurrPass));
+    }
+    m_Passes.clear();
+}
+
+void FrameGraph::WaitForIdle()
+{
+    for (Uint32 q = 0; q < QUEUE_COUNT; ++q)
+    {
+        auto& Q = m_Queues[q];
+        if (Q.pFence == nullptr || Q.NumPasses == 0)
+            continue;
+
+        Signal(static_cast<QUEUE>(q), true);
+        Q.pFence->Wait(Q.LastSignal);
+    }
+}
+
+bool FrameGraph::ValidateSchedule(const std::vector<ScheduledPass>& Passes, std::string& Error)
+{
+    auto PassName = [&](size_t Idx) {
+        return std::string{"'"} + Passes[Idx].Name + "' (" + GetQueueName(Passes[Idx].Queue) + " queue, pass " + std::to_string(Passes[Idx].Ordinal) + ")";
+    };
+
+    // Clocks of the passes on other queues that are known to be complete when the pass starts
+    std::vector<Clock>              StartClocks(Passes.size());
+    std::array<size_t, QUEUE_COUNT> LastPass;
+    std::array<Uint64, QUEUE_COUNT> LastSignal = {};
+    constexpr size_t                None       = ~size_t{0};
+    LastPass.fill(None);
+
+    for (size_t i = 0; i < Passes.size(); ++i)
+    {
+        const auto& CurrPass = Passes[i];
+        const auto  q        = CurrPass.Queue;
+
+        Clock Start = {};
+        if (LastPass[q] != None)
+        {
+            Start    = StartClocks[LastPass[q]];
+            Start[q] = Passes[LastPass[q]].Ordinal;
+        }
+        if (CurrPass.Ordinal != Start[q] + 1)
+        {
+            Error = PassName(i) + " is out of order";
+            return false;
+        }
+        if (CurrPass.SignalValue != 0)
+        {
+            if (CurrPass.SignalValue <= LastSignal[q])
+            {
+                Error = PassName(i) + " signals fence value " + std::to_string(CurrPass.SignalValue) + " that is not greater than the previous value";
+                return false;
+            }
+            LastSignal[q] = CurrPass.SignalValue;
+        }
+
+        for (const auto& Wait : CurrPass.Waits)
+        {
+            if (Wait.Queue == q)
+            {
+                Error = PassName(i) + " waits for its own queue";
+                return false;
+            }
+
+            // The fence reaches the value when the first pass that signals a value not less than it completes.
+            size_t Signaled = None;
+            for (size_t j = 0; j < i && Signaled == None; ++j)
+            {
+                if (Passes[j].Queue == Wait.Queue && Passes[j].SignalValue >= Wait.Value)
+                    Signaled = j;
+            }
+            if (Signaled == None)
+            {
+                Error = PassName(i) + " waits for " + GetQueueName(Wait.Queue) + " queue fence value " + std::to_string(Wait.Value) + " that is never signaled";
+                return false;
+            }
+
+            Clock End       = StartClocks[Signaled];
+            End[Wait.Queue] = Passes[Signaled].Ordinal;
+            for (Uint32 r = 0; r < QUEUE_COUNT; ++r)
+            {
+                if (r != q)
+                    Start[r] = std::max(Start[r], End[r]);
+            }
+        }
+        StartClocks[i] = Start;
+        LastPass[q]    = i;
+
+        for (size_t j = 0; j < i; ++j)
+        {
+            const auto& PrevPass = Passes[j];
+            if (PrevPass.Queue == q || Start[PrevPass.Queue] >= PrevPass.Ordinal)
+                continue;
+
+            for (const auto& PrevAccess : PrevPass.Accesses)
+            {
+                for (const auto& Access : CurrPass.Accesses)
+                {
+                    if (IsConflict(PrevAccess, Access))
+                    {
+                        Error = PassName(i) + " accesses resource " + std::to_string(Access.Id) + " used by " + PassName(j) + " without waiting for it";
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,221 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Fence.h"
+#include "Texture.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Schedules the passes of a frame over the graphics, compute and transfer queues.
+///
+/// Every frame the passes are added in submission order together with the queue they run on and
+/// the resources they read and write. The graph remembers the last writer and the readers of every
+/// resource across frames, so a compute pass that generates data for frame N+1 only waits for the
+/// graphics pass of frame N-1 that read the same resource, and overlaps with the graphics passes of frame N.
+///
+/// Fences and barriers are kept to a minimum:
+///  - a pass waits for another queue only if the wait is not already implied by earlier waits;
+///  - a pass signals its queue fence only if a pass on another queue accesses one of its resources;
+///  - a resource stays in its home state between passes. A pass that needs another state transitions
+///    the resource in its own context and returns it home at the end, unless the next pass that uses
+///    the resource in this frame runs on the same queue in the same state.
+///
+/// When initialized without a device, the graph runs in CPU-only mode: pass callbacks are not invoked,
+/// but every submitted pass is recorded so that the schedule can be checked with ValidateSchedule().
+class FrameGraph
+{
+public:
+    enum QUEUE : Uint8
+    {
+        QUEUE_GRAPHICS = 0,
+        QUEUE_COMPUTE,
+        QUEUE_TRANSFER,
+        QUEUE_COUNT
+    };
+
+    using ResourceId = Uint32;
+
+    static constexpr ResourceId InvalidResource = ~0u;
+
+    struct ResourceAccess
+    {
+        ResourceId     Id    = InvalidResource;
+        RESOURCE_STATE State = RESOURCE_STATE_UNKNOWN;
+        bool           Write = false;
+    };
+
+    using PassFunc = std::function<void(IDeviceContext*)>;
+
+    struct FenceWait
+    {
+        QUEUE  Queue = QUEUE_GRAPHICS;
+        Uint64 Value = 0;
+    };
+
+    /// A pass as it was submitted.
+    struct ScheduledPass
+    {
+        std::string                 Name;
+        QUEUE                       Queue       = QUEUE_GRAPHICS;
+        Uint64                      Ordinal     = 0; // 1-based index of the pass in its queue
+        Uint64                      SignalValue = 0; // queue fence value signaled after the pass, or 0
+        std::vector<FenceWait>      Waits;
+        std::vector<ResourceAccess> Accesses;
+    };
+
+    struct Statistics
+    {
+        Uint32 NumPasses      = 0;
+        Uint32 NumWaits       = 0;
+        Uint32 NumSignals     = 0;
+        Uint32 NumLateSignals = 0; // signals for passes of earlier frames that did not signal when they were submitted
+        Uint32 NumBarriers    = 0;
+    };
+
+    FrameGraph() {}
+    ~FrameGraph();
+
+    // clang-format off
+    FrameGraph(const FrameGraph&)            = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+    // clang-format on
+
+    /// ppContexts must contain QUEUE_COUNT contexts; a queue whose context is null must not be used.
+    /// If pDevice is null, the graph runs in CPU-only mode and contexts are ignored.
+    void Initialize(IRenderDevice* pDevice, IDeviceContext* const* ppContexts);
+
+    /// Registers a resource that is shared between passes. The resource must be in the home state
+    /// when it is not used by any pass.
+    ResourceId AddResource(const char* Name, RESOURCE_STATE HomeState);
+
+    /// Sets the texture that is transitioned when passes need the resource in a state other than the home state.
+    /// The resource is only used for synchronization if the texture is null.
+    void SetResourceTexture(ResourceId Id, ITexture* pTexture);
+
+    /// Adds a pass to the current frame. Passes are submitted in the order they are added.
+    void AddPass(const char* Name, QUEUE Queue, std::initializer_list<ResourceAccess> Accesses, PassFunc Func);
+
+    /// Submits the passes added since the last call. The graphics queue context is not flushed
+    /// unless a pass of this frame on another queue waits for it.
+    void Execute();
+
+    /// Blocks until all submitted passes are complete.
+    void WaitForIdle();
+
+    bool IsCpuOnly() const { return m_pDevice == nullptr; }
+
+    /// Returns the passes submitted so far in CPU-only mode.
+    const std::vector<ScheduledPass>& GetHistory() const { return m_History; }
+
+    /// Returns the statistics of the last executed frame.
+    const Statistics& GetStatistics() const { return m_Stats; }
+
+    /// Checks that every pair of conflicting accesses from different queues is ordered by fence waits
+    /// and that every wait is for a value that was signaled earlier. Returns false and sets Error otherwise.
+    static bool ValidateSchedule(const std::vector<ScheduledPass>& Passes, std::string& Error);
+
+private:
+    // Clock[q] is the ordinal of the last pass on queue q that is known to be complete
+    using Clock = std::array<Uint64, QUEUE_COUNT>;
+
+    struct PassRef
+    {
+        QUEUE  Queue   = QUEUE_GRAPHICS;
+        Uint64 Ordinal = 0;
+    };
+
+    struct ResourceInfo
+    {
+        std::string    Name;
+        RESOURCE_STATE HomeState = RESOURCE_STATE_UNKNOWN;
+        RESOURCE_STATE State     = RESOURCE_STATE_UNKNOWN;
+        ITexture*      pTexture  = nullptr;
+
+        // Ordinal of the last writer and of the last reader on each queue since that write
+        PassRef LastWriter;
+        Clock   LastReaders = {};
+    };
+
+    struct SignalPoint
+    {
+        Uint64 Ordinal = 0;
+        Uint64 Value   = 0;
+        Clock  Known   = {}; // passes known to be complete when the signaled pass completes
+    };
+
+    struct QueueInfo
+    {
+        IDeviceContext*          pContext = nullptr;
+        RefCntAutoPtr<IFence>    pFence;
+        Uint64                   NumPasses  = 0;
+        Uint64                   LastSignal = 0;
+        Clock                    Known      = {};
+        std::vector<SignalPoint> Signals;
+
+        // Index of the last pass of the queue in the history
+        size_t LastHistoryIdx = ~size_t{0};
+    };
+
+    struct Pass
+    {
+        std::string                 Name;
+        QUEUE                       Queue = QUEUE_GRAPHICS;
+        std::vector<ResourceAccess> Accesses;
+        PassFunc                    Func;
+    };
+
+    static bool IsConflict(const ResourceAccess& Lhs, const ResourceAccess& Rhs)
+    {
+        return Lhs.Id == Rhs.Id && (Lhs.Write || Rhs.Write);
+    }
+
+    SignalPoint FindSignal(QUEUE Queue, Uint64 Ordinal);
+    void        Signal(QUEUE Queue, bool Flush);
+
+    RefCntAutoPtr<IRenderDevice>       m_pDevice;
+    std::array<QueueInfo, QUEUE_COUNT> m_Queues;
+    std::vector<ResourceInfo>          m_Resources;
+    std::vector<Pass>                  m_Passes;
+    std::vector<Pass>                  m_PrevPasses;
+    std::vector<ScheduledPass>         m_History;
+    Statistics                         m_Stats;
+    std::vector<StateTransitionDesc>   m_Barriers;
+};
+
+} // namespace Diligent
@@ -0,0 +1,259 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+// Headless test of the frame graph. Runs the passes of the tutorial in CPU-only mode and checks the
+// recorded schedules with FrameGraph::ValidateSchedule(), and checks that ValidateSchedule() rejects
+// schedules that are not synchronized.
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FrameGraph.hpp"
+#include "FramePasses.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+constexpr RESOURCE_STATE OpaqueTexAtlasState = RESOURCE_STATE_COMMON;
+
+bool Validate(const FrameGraph& Graph, const char* Test)
+{
+    std::string Error;
+    if (FrameGraph::ValidateSchedule(Graph.GetHistory(), Error))
+        return true;
+
+    std::printf("FAILED: %s: %s\n", Test, Error.c_str());
+    return false;
+}
+
+// Every configuration for a few frames
+bool TestConfigs()
+{
+    bool Passed = true;
+    for (Uint32 Config = 0; Config < 16; ++Config)
+    {
+        FrameGraph Graph;
+        Graph.Initialize(nullptr, nullptr);
+
+        const auto Res             = RegisterFramePassResources(Graph, OpaqueTexAtlasState);
+        const bool DoubleBuffering = (Config & 0x08) != 0;
+        for (Uint32 Frame = 0; Frame < 6; ++Frame)
+        {
+            FramePassesAttribs Attribs;
+            Attribs.AsyncCompute    = (Config & 0x01) != 0;
+            Attribs.AsyncTransfer   = (Config & 0x02) != 0;
+            Attribs.Upload          = (Config & 0x04) != 0;
+            Attribs.TerrainUpdateId = DoubleBuffering ? Frame & 1u : 0u;
+            Attribs.TerrainDrawId   = DoubleBuffering ? 1u - (Frame & 1u) : 0u;
+            AddFramePasses(Graph, Res, Attribs, {});
+            Graph.Execute();
+        }
+
+        const std::string Test = "configuration " + std::to_string(Config);
+        Passed                 = Validate(Graph, Test.c_str()) && Passed;
+    }
+    return Passed;
+}
+
+// Async compute, async transfer, upload and double buffering are toggled at random every frame, as the UI of the
+// tutorial allows. Passes of a frame then wait for passes of the previous frames that did not signal, because
+// no pass of their frame needed it, which the graph handles with late signals.
+void RunRandomFrames(FrameGraph& Graph, Uint32 Seed, Uint32 NumFrames, Uint32& NumLateSignals)
+{
+    std::mt19937 Rng{Seed};
+
+    Graph.Initialize(nullptr, nullptr);
+
+    const auto Res = RegisterFramePassResources(Graph, OpaqueTexAtlasState);
+
+    bool DoubleBuffering = true;
+    for (Uint32 Frame = 0; Frame < NumFrames; ++Frame)
+    {
+        if (Rng() % 8 == 0)
+            DoubleBuffering = !DoubleBuffering;
+
+        FramePassesAttribs Attribs;
+        Attribs.AsyncCompute    = (Rng() & 1) != 0;
+        Attribs.AsyncTransfer   = (Rng() & 1) != 0;
+        Attribs.Upload          = (Rng() & 1) != 0;
+        Attribs.TerrainUpdateId = DoubleBuffering ? Frame & 1u : 0u;
+        Attribs.TerrainDrawId   = DoubleBuffering ? 1u - (Frame & 1u) : 0u;
+        AddFramePasses(Graph, Res, Attribs, {});
+        Graph.Execute();
+
+        NumLateSignals += Graph.GetStatistics().NumLateSignals;
+    }
+}
+
+bool TestRandomToggling()
+{
+    constexpr Uint32 NumRuns   = 500;
+    constexpr Uint32 NumFrames = 100;
+
+    bool   Passed         = true;
+    Uint32 NumLateSignals = 0;
+    for (Uint32 Run = 0; Run < NumRuns && Passed; ++Run)
+    {
+        FrameGraph Graph;
+        RunRandomFrames(Graph, Run, NumFrames, NumLateSignals);
+
+        const std::string Test = "random run " + std::to_string(Run);
+        Passed                 = Validate(Graph, Test.c_str()) && Passed;
+    }
+
+    if (NumLateSignals == 0)
+    {
+        std::printf("FAILED: random runs did not produce late signals\n");
+        Passed = false;
+    }
+    std::printf("Random toggling: %u runs of %u frames, %u late signals\n", NumRuns, NumFrames, NumLateSignals);
+    return Passed;
+}
+
+// The graph only waits when it must, so a schedule without any one of its waits is not synchronized
+bool TestRemovedWaits()
+{
+    bool   Passed   = true;
+    Uint32 NumWaits = 0;
+    for (Uint32 Run = 0; Run < 20; ++Run)
+    {
+        FrameGraph Graph;
+        Uint32     NumLateSignals = 0;
+        RunRandomFrames(Graph, 1000 + Run, 30, NumLateSignals);
+
+        const auto& History = Graph.GetHistory();
+        for (size_t i = 0; i < History.size(); ++i)
+        {
+            for (size_t w = 0; w < History[i].Waits.size(); ++w)
+            {
+                auto Mutated = History;
+                Mutated[i].Waits.erase(Mutated[i].Waits.begin() + w);
+
+                std::string Error;
+                if (FrameGraph::ValidateSchedule(Mutated, Error))
+                {
+                    std::printf("FAILED: schedule of run %u without wait %u of pass %u is accepted\n", Run, static_cast<Uint32>(w), static_cast<Uint32>(i));
+                    Passed = false;
+                }
+                ++NumWaits;
+            }
+        }
+    }
+    std::printf("Removed waits: %u schedules checked\n", NumWaits);
+    return Passed;
+}
+
+FrameGraph::ScheduledPass MakePass(FrameGraph::QUEUE Queue, Uint64 Ordinal, Uint64 SignalValue, std::vector<FrameGraph::FenceWait> Waits, std::vector<FrameGraph::ResourceAccess> Accesses)
+{
+    FrameGraph::ScheduledPass Pass;
+    Pass.Name        = "Pass";
+    Pass.Queue       = Queue;
+    Pass.Ordinal     = Ordinal;
+    Pass.SignalValue = SignalValue;
+    Pass.Waits       = std::move(Waits);
+    Pass.Accesses    = std::move(Accesses);
+    return Pass;
+}
+
+bool TestSchedules()
+{
+    constexpr auto G = FrameGraph::QUEUE_GRAPHICS;
+    constexpr auto C = FrameGraph::QUEUE_COMPUTE;
+    constexpr auto T = FrameGraph::QUEUE_TRANSFER;
+
+    const FrameGraph::ResourceAccess Write = {0, RESOURCE_STATE_UNORDERED_ACCESS, true};
+    const FrameGraph::ResourceAccess Read  = {0, RESOURCE_STATE_SHADER_RESOURCE, false};
+    const FrameGraph::ResourceAccess Other = {1, RESOURCE_STATE_SHADER_RESOURCE, true};
+
+    struct Case
+    {
+        const char*                            Name;
+        bool                                   Valid;
+        std::vector<FrameGraph::ScheduledPass> Passes;
+    };
+    const Case Cases[] = {
+        {"write, then read on another queue after a wait", true, {MakePass(C, 1, 1, {}, {Write}), MakePass(G, 1, 0, {{C, 1}}, {Read})}},
+        {"writes of different resources", true, {MakePass(C, 1, 0, {}, {Write}), MakePass(G, 1, 0, {}, {Other})}},
+        {"reads on different queues", true, {MakePass(C, 1, 0, {}, {Read}), MakePass(G, 1, 0, {}, {Read})}},
+        {"wait implied by a wait of an earlier pass on the queue", true, {MakePass(C, 1, 1, {}, {Write}), MakePass(G, 1, 0, {{C, 1}}, {}), MakePass(G, 2, 0, {}, {Read})}},
+        {"wait implied by a chain of waits", true, {MakePass(C, 1, 1, {}, {Write}), MakePass(T, 1, 1, {{C, 1}}, {}), MakePass(G, 1, 0, {{T, 1}}, {Read})}},
+
+        {"read after write without a wait", false, {MakePass(C, 1, 1, {}, {Write}), MakePass(G, 1, 0, {}, {Read})}},
+        {"write after read without a wait", false, {MakePass(G, 1, 1, {}, {Read}), MakePass(C, 1, 0, {}, {Write})}},
+        {"write after write without a wait", false, {MakePass(G, 1, 1, {}, {Write}), MakePass(T, 1, 0, {}, {Write})}},
+        {"wait for a value that is never signaled", false, {MakePass(C, 1, 1, {}, {Write}), MakePass(G, 1, 0, {{C, 2}}, {Read})}},
+        {"wait for a value signaled by a later pass", false, {MakePass(G, 1, 0, {{C, 1}}, {Read}), MakePass(C, 1, 1, {}, {Write})}},
+        {"wait for a signal that precedes the write", false, {MakePass(C, 1, 1, {}, {}), MakePass(C, 2, 2, {}, {Write}), MakePass(G, 1, 0, {{C, 1}}, {Read})}},
+        {"wait for the wrong queue", false, {MakePass(C, 1, 1, {}, {Write}), MakePass(T, 1, 1, {}, {}), MakePass(G, 1, 0, {{T, 1}}, {Read})}},
+        {"wait for the own queue", false, {MakePass(G, 1, 1, {}, {}), MakePass(G, 2, 0, {{G, 1}}, {})}},
+        {"chain broken by a wait that precedes the write", false, {MakePass(T, 1, 1, {}, {}), MakePass(C, 1, 1, {{T, 1}}, {Write}), MakePass(G, 1, 0, {{T, 1}}, {Read})}},
+        {"passes of a queue out of order", false, {MakePass(G, 2, 0, {}, {}), MakePass(G, 1, 0, {}, {})}},
+        {"fence value that does not increase", false, {MakePass(C, 1, 2, {}, {}), MakePass(C, 2, 2, {}, {})}},
+    };
+
+    bool Passed = true;
+    for (const auto& Test : Cases)
+    {
+        std::string Error;
+        if (FrameGraph::ValidateSchedule(Test.Passes, Error) != Test.Valid)
+        {
+            std::printf("FAILED: schedule '%s' is %s\n", Test.Name, Test.Valid ? ("rejected: " + Error).c_str() : "accepted");
+            Passed = false;
+        }
+    }
+    return Passed;
+}
+
+} // namespace
+
+int main()
+{
+    bool Passed = true;
+
+    const bool ConfigsPassed = TestConfigs();
+    std::printf("All configurations: %s\n", ConfigsPassed ? "passed" : "FAILED");
+    Passed = ConfigsPassed && Passed;
+
+    const bool TogglingPassed = TestRandomToggling();
+    std::printf("Random toggling: %s\n", TogglingPassed ? "passed" : "FAILED");
+    Passed = TogglingPassed && Passed;
+
+    const bool RemovedWaitsPassed = TestRemovedWaits();
+    std::printf("Removed waits: %s\n", RemovedWaitsPassed ? "passed" : "FAILED");
+    Passed = RemovedWaitsPassed && Passed;
+
+    const bool SchedulesPassed = TestSchedules();
+    std::printf("Hand-written schedules: %s\n", SchedulesPassed ? "passed" : "FAILED");
+    Passed = SchedulesPassed && Passed;
+
+    std::printf("\n%s\n", Passed ? "PASSED" : "FAILED");
+    return Passed ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#include "FramePasses.hpp"
+
+namespace Diligent
+{
+
+FramePassResources RegisterFramePassResources(FrameGraph& Graph, RESOURCE_STATE OpaqueTexAtlasState)
+{
+    FramePassResources Res;
+    Res.HeightMap[0]   = Graph.AddResource("Terrain height map 0", RESOURCE_STATE_UNORDERED_ACCESS);
+    Res.HeightMap[1]   = Graph.AddResource("Terrain height map 1", RESOURCE_STATE_UNORDERED_ACCESS);
+    Res.NormalMap[0]   = Graph.AddResource("Terrain normal map 0", RESOURCE_STATE_UNORDERED_ACCESS);
+    Res.NormalMap[1]   = Graph.AddResource("Terrain normal map 1", RESOURCE_STATE_UNORDERED_ACCESS);
+    Res.OpaqueTexAtlas = Graph.AddResource("Buildings texture atlas", OpaqueTexAtlasState);
+    return Res;
+}
+
+void AddFramePasses(FrameGraph& Graph, const FramePassResources& Res, const FramePassesAttribs& Attribs, const FramePassFuncs& Funcs)
+{
+    // With double buffering, the compute pass generates the terrain for the next frame
+    // and overlaps with the graphics passes that draw the terrain generated in the previous frame.
+    const auto ComputeQueue = Attribs.AsyncCompute ? FrameGraph::QUEUE_COMPUTE : FrameGraph::QUEUE_GRAPHICS;
+    Graph.AddPass("Compute pass", ComputeQueue,
+                  {
+                      {Res.HeightMap[Attribs.TerrainUpdateId], RESOURCE_STATE_UNORDERED_ACCESS, true},
+                      {Res.NormalMap[Attribs.TerrainUpdateId], RESOURCE_STATE_UNORDERED_ACCESS, true},
+                  },
+                  Funcs.Compute);
+
+    if (Attribs.Upload)
+    {
+        // Vulkan:     allowed any state which is supported by transfer queue.
+        // DirectX 12: resource transition between copy and graphics queues requires resource to be in COMMON state,
+        //             which is the atlas default state.
+        const auto TransferQueue = Attribs.AsyncTransfer ? FrameGraph::QUEUE_TRANSFER : FrameGraph::QUEUE_GRAPHICS;
+        Graph.AddPass("Transfer pass", TransferQueue,
+                      {
+                          {Res.OpaqueTexAtlas, RESOURCE_STATE_COPY_DEST, true},
+                      },
+                      Funcs.Upload);
+    }
+
+    Graph.AddPass("Graphics pass 1", FrameGraph::QUEUE_GRAPHICS,
+                  {
+                      {Res.HeightMap[Attribs.TerrainDrawId], RESOURCE_STATE_SHADER_RESOURCE, false},
+                      {Res.NormalMap[Attribs.TerrainDrawId], RESOURCE_STATE_SHADER_RESOURCE, false},
+                      {Res.OpaqueTexAtlas, RESOURCE_STATE_SHADER_RESOURCE, false},
+                  },
+                  Funcs.Graphics1);
+
+    Graph.AddPass("Graphics pass 2", FrameGraph::QUEUE_GRAPHICS, {}, Funcs.Graphics2);
+}
+
+} // namespace Diligent
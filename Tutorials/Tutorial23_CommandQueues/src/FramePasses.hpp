@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+
+#pragma once
+
+#include "FrameGraph.hpp"
+
+namespace Diligent
+{
+
+/// Resources that are shared between the queues
+struct FramePassResources
+{
+    FrameGraph::ResourceId HeightMap[2]   = {};
+    FrameGraph::ResourceId NormalMap[2]   = {};
+    FrameGraph::ResourceId OpaqueTexAtlas = {};
+};
+
+/// Registers the shared resources in the graph. OpaqueTexAtlasState is the default state of the buildings texture atlas.
+FramePassResources RegisterFramePassResources(FrameGraph& Graph, RESOURCE_STATE OpaqueTexAtlasState);
+
+struct FramePassesAttribs
+{
+    bool   AsyncCompute    = false;
+    bool   AsyncTransfer   = false;
+    bool   Upload          = false;
+    Uint32 TerrainUpdateId = 0;
+    Uint32 TerrainDrawId   = 0;
+};
+
+/// Callbacks of the passes. They are not invoked in CPU-only mode and may be empty there.
+struct FramePassFuncs
+{
+    FrameGraph::PassFunc Compute;
+    FrameGraph::PassFunc Upload;
+    FrameGraph::PassFunc Graphics1;
+    FrameGraph::PassFunc Graphics2;
+};
+
+/// Adds the passes of one frame of the tutorial to the graph.
+void AddFramePasses(FrameGraph& Graph, const FramePassResources& Res, const FramePassesAttribs& Attribs, const FramePassFuncs& Funcs);
+
+} // namespace Diligent
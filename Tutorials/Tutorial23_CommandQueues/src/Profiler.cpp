@@ -33,173 +33,95 @@ namespace Diligent
 static constexpr float GraphWidth  = 500.f;
 static constexpr float GraphHeight = 100.f;
 
-void Profiler::Initialize(IRenderDevice* pDevice)
+static const char* GetPassName(Profiler::PASS_TYPE Pass)
 {
-    m_Device  = pDevice;
-    m_FrameId = 0;
-
-    QueryDesc queryDesc;
-    queryDesc.Name = "Timestamp query";
-    queryDesc.Type = QUERY_TYPE_TIMESTAMP;
-
-    m_SupportsTransferQueueProfiling = pDevice->GetDeviceInfo().Features.TransferQueueTimestampQueries;
-
-    for (auto& Frame : m_FrameHistory)
+    switch (Pass)
     {
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics1.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics1.GpuTimeQueryEnd);
-
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics2.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Graphics2.GpuTimeQueryEnd);
-
-        m_Device->CreateQuery(queryDesc, &Frame.Compute.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Compute.GpuTimeQueryEnd);
-
-        m_Device->CreateQuery(queryDesc, &Frame.Transfer.GpuTimeQueryBegin);
-        m_Device->CreateQuery(queryDesc, &Frame.Transfer.GpuTimeQueryEnd);
+        // clang-format off
+        case Profiler::FRAME:      return "Frame";
+        case Profiler::GRAPHICS_1: return "Graphics pass 1";
+        case Profiler::GRAPHICS_2: return "Graphics pass 2";
+        case Profiler::COMPUTE:    return "Compute pass";
+        case Profiler::TRANSFER:   return "Upload pass";
+        // clang-format on
+        default:
+            UNEXPECTED("Unknown pass type");
+            return "";
     }
 }
 
-void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
+void Profiler::Initialize(IRenderDevice* pDevice)
 {
-    if (m_Device == nullptr)
-        return;
+    m_Profiler.Initialize(pDevice);
+    m_Profiler.SetThreadName("Main thread");
+}
 
-    const auto BeginCounters = [&](auto& Pass) //
-    {
-        Pass.QuerySupported = (pContext != nullptr && ((pContext->GetDesc().QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK) > COMMAND_QUEUE_TYPE_TRANSFER || m_SupportsTransferQueueProfiling));
-        if (Pass.QuerySupported)
-        {
-            pContext->EndQuery(Pass.GpuTimeQueryBegin);
-        }
-        Pass.CpuTImeBegin = TimePoint::clock::now();
-    };
+void Profiler::CaptureTrace(Uint32 NumFrames)
+{
+    m_Profiler.BeginCapture(NumFrames, TraceFileName);
+}
 
-    auto& Frame = m_FrameHistory[m_FrameId];
-    switch (PassType)
-    {
-        case GRAPHICS_1:
-            BeginCounters(Frame.Graphics1);
-            break;
-        case GRAPHICS_2:
-            BeginCounters(Frame.Graphics2);
-            break;
-        case COMPUTE:
-            BeginCounters(Frame.Compute);
-            break;
-        case TRANSFER:
-            BeginCounters(Frame.Transfer);
-            break;
-        case FRAME:
-            BeginCounters(Frame.Frame);
-            break;
-        default:
-            UNEXPECTED("Unknown pass type");
-    }
+void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
+{
+    m_Profiler.Begin(pContext, GetPassName(PassType));
 }
 
 void Profiler::End(IDeviceContext* pContext, PASS_TYPE PassType)
 {
-    if (m_Device == nullptr)
-        return;
-
-    const auto EndCounters = [pContext](auto& Pass) //
-    {
-        if (Pass.QuerySupported)
-        {
-            pContext->EndQuery(Pass.GpuTimeQueryEnd);
-            Pass.Queried = true;
-        }
-        Pass.CpuTImeEnd = TimePoint::clock::now();
-    };
-
-    auto& Frame = m_FrameHistory[m_FrameId];
-    switch (PassType)
-    {
-        case GRAPHICS_1:
-            EndCounters(Frame.Graphics1);
-            break;
-        case GRAPHICS_2:
-            EndCounters(Frame.Graphics2);
-            break;
-        case COMPUTE:
-            EndCounters(Frame.Compute);
-            break;
-        case TRANSFER:
-            EndCounters(Frame.Transfer);
-            break;
-        case FRAME:
-            EndCounters(Frame.Frame);
-            break;
-        default:
-            UNEXPECTED("Unknown pass type");
-    }
+    m_Profiler.End(pContext, GetPassName(PassType));
 }
 
 void Profiler::SetCpuToGpuTransferRate(Uint32 RateInMb)
 {
-    m_TempCpuToGpuTransferRateMb = RateInMb;
+    m_AccumCpuToGpuTransferMb += RateInMb;
 }
 
 void Profiler::Update(double ElapsedTime)
 {
-    if (m_Device == nullptr)
+    if (!m_Profiler.IsInitialized())
         return;
 
-    ++m_FrameId;
+    m_Profiler.EndFrame();
 
-    // Read query data
+    // A pass has the GPU times of the last frame read back if its sample count has grown
+    m_PrevFrame = m_CurrFrame;
+    for (Uint32 Pass = 0; Pass < PASS_COUNT; ++Pass)
     {
-        auto& Frame = m_FrameHistory[m_FrameId];
-
-        const auto ReadTime = [](IQuery* pQuery, double& Time) //
-        {
-            Time = 0.0;
-            QueryDataTimestamp TimeData;
-            if (pQuery->GetData(&TimeData, sizeof(TimeData), true))
-                Time = static_cast<double>(TimeData.Counter) / static_cast<double>(TimeData.Frequency);
-        };
+        const ScopeProfiler::ScopeStats* pStats = m_Profiler.FindScope(GetPassName(static_cast<PASS_TYPE>(Pass)));
 
-        const auto UpdatePass = [ReadTime](PassCounters& Pass) //
+        PassTimes& Times = m_CurrFrame[Pass];
+        Times.Queried    = pStats != nullptr && pStats->NumGpuSamples != m_NumGpuSamples[Pass];
+        if (Times.Queried)
         {
-            if (Pass.QuerySupported && Pass.Queried)
-            {
-                ReadTime(Pass.GpuTimeQueryBegin, Pass.GpuTimeBegin);
-                ReadTime(Pass.GpuTimeQueryEnd, Pass.GpuTimeEnd);
-                VERIFY_EXPR(Pass.GpuTimeEnd >= Pass.GpuTimeBegin);
-                VERIFY_EXPR(Pass.CpuTImeEnd > Pass.CpuTImeBegin);
-            }
-        };
-
-        UpdatePass(Frame.Graphics1);
-        UpdatePass(Frame.Graphics2);
-        UpdatePass(Frame.Compute);
-        UpdatePass(Frame.Transfer);
+            Times.GpuBegin        = pStats->LastGpuBegin;
+            Times.GpuEnd          = pStats->LastGpuEnd;
+            m_NumGpuSamples[Pass] = pStats->NumGpuSamples;
+        }
     }
 
     // Update UI
     m_AccumTime += ElapsedTime;
     if (m_AccumTime > UpdateInterval)
     {
-        m_AccumTime = 0.0;
+        // Report the transfer rate sustained over the whole interval rather than the amount of the last frame
+        const double CpuToGpuTransferRateMb = m_AccumCpuToGpuTransferMb / m_AccumTime;
+
+        m_AccumTime               = 0.0;
+        m_AccumCpuToGpuTransferMb = 0.0;
 
-        auto&       Curr = m_FrameHistory[m_FrameId];
-        const auto& Prev = m_FrameHistory[(m_FrameId - 1) % m_FrameHistory.size()];
+        const FrameTimes& Curr = m_CurrFrame;
+        const FrameTimes& Prev = m_PrevFrame;
 
-        const auto CalcFrameTimes = [](const Frame& f, double& Begin, double& End) //
+        const auto CalcFrameTimes = [](const FrameTimes& f, double& Begin, double& End) //
         {
-            const auto CalcPassTimes = [&Begin, &End](const PassCounters& p) //
+            for (Uint32 Pass = GRAPHICS_1; Pass < PASS_COUNT; ++Pass)
             {
-                if (p.Queried)
+                if (f[Pass].Queried)
                 {
-                    Begin = std::min(Begin, p.GpuTimeBegin);
-                    End   = std::max(End, p.GpuTimeEnd);
+                    Begin = std::min(Begin, f[Pass].GpuBegin);
+                    End   = std::max(End, f[Pass].GpuEnd);
                 }
-            };
-            CalcPassTimes(f.Graphics1);
-            CalcPassTimes(f.Graphics2);
-            CalcPassTimes(f.Compute);
-            CalcPassTimes(f.Transfer);
+            }
         };
         double CurrFrameBegin = 1.0e+100;
         double CurrFrameEnd   = 0.0;
@@ -212,18 +134,20 @@ void Profiler::Update(double ElapsedTime)
         const auto  StartTime = PrevFrameBegin;
         const auto  EndTime   = CurrFrameEnd;
         const float Scale     = GraphWidth / static_cast<float>(EndTime - StartTime);
-        const auto  CalcGraph = [StartTime, Scale](Graph& g, const Frame& f) //
+        const auto  CalcGraph = [StartTime, Scale](Graph& g, const FrameTimes& f) //
         {
-            const float MinW = 2.f;
-
-            g.Gfx1X   = f.Graphics1.Queried ? static_cast<float>(f.Graphics1.GpuTimeBegin - StartTime) * Scale : 0.f;
-            g.Gfx1W   = f.Graphics1.Queried ? std::max(MinW, static_cast<float>(f.Graphics1.GpuTimeEnd - f.Graphics1.GpuTimeBegin) * Scale) : 0.1f;
-            g.Gfx2X   = f.Graphics2.Queried ? static_cast<float>(f.Graphics2.GpuTimeBegin - StartTime) * Scale : 0.f;
-            g.Gfx2W   = f.Graphics2.Queried ? std::max(MinW, static_cast<float>(f.Graphics2.GpuTimeEnd - f.Graphics2.GpuTimeBegin) * Scale) : 0.1f;
-            g.CompX   = f.Compute.Queried ? static_cast<float>(f.Compute.GpuTimeBegin - StartTime) * Scale : 0.f;
-            g.CompW   = f.Compute.Queried ? std::max(MinW, static_cast<float>(f.Compute.GpuTimeEnd - f.Compute.GpuTimeBegin) * Scale) : 0.1f;
-            g.TransfX = f.Transfer.Queried ? static_cast<float>(f.Transfer.GpuTimeBegin - StartTime) * Scale : 0.f;
-            g.TransfW = f.Transfer.Queried ? std::max(MinW, static_cast<float>(f.Transfer.GpuTimeEnd - f.Transfer.GpuTimeBegin) * Scale) : 0.1f;
+            const auto CalcPass = [&](PASS_TYPE Pass, float& X, float& W) //
+            {
+                const float MinW = 2.f;
+
+                const PassTimes& p = f[Pass];
+                X                  = p.Queried ? static_cast<float>(p.GpuBegin - StartTime) * Scale : 0.f;
+                W                  = p.Queried ? std::max(MinW, static_cast<float>(p.GpuEnd - p.GpuBegin) * Scale) : 0.1f;
+            };
+            CalcPass(GRAPHICS_1, g.Gfx1X, g.Gfx1W);
+            CalcPass(GRAPHICS_2, g.Gfx2X, g.Gfx2W);
+            CalcPass(COMPUTE, g.CompX, g.CompW);
+            CalcPass(TRANSFER, g.TransfX, g.TransfW);
         };
         CalcGraph(m_Graph1, Prev);
         CalcGraph(m_Graph2, Curr);
@@ -255,29 +179,34 @@ void Profiler::Update(double ElapsedTime)
             stream << std::endl;
         };
 
-        const auto Gfx1Time   = Curr.Graphics1.GpuTimeEnd - Curr.Graphics1.GpuTimeBegin;
-        const auto Gfx2Time   = Curr.Graphics2.GpuTimeEnd - Curr.Graphics2.GpuTimeBegin;
-        const auto CompTime   = Curr.Compute.GpuTimeEnd - Curr.Compute.GpuTimeBegin;
-        const auto TransfTime = Curr.Transfer.GpuTimeEnd - Curr.Transfer.GpuTimeBegin;
+        // Pass durations are averaged by the scope profiler over its rolling window
+        const auto GetPassTimes = [this](PASS_TYPE Pass, double& GpuTime, double& CpuTime) //
+        {
+            const ScopeProfiler::ScopeStats* pStats = m_Profiler.FindScope(GetPassName(Pass));
+
+            GpuTime = pStats != nullptr ? pStats->AvgGpuTimeMs * 1.0e-3 : 0.0;
+            CpuTime = pStats != nullptr ? pStats->AvgCpuTimeMs * 1.0e-3 : 0.0;
+        };
+        double FrameGpuTime, Gfx1Time, Gfx2Time, CompTime, TransfTime;
+        double CpuFrameTime, CpuGfx1Time, CpuGfx2Time, CpuCompTime, CpuTransfTime;
+        GetPassTimes(FRAME, FrameGpuTime, CpuFrameTime);
+        GetPassTimes(GRAPHICS_1, Gfx1Time, CpuGfx1Time);
+        GetPassTimes(GRAPHICS_2, Gfx2Time, CpuGfx2Time);
+        GetPassTimes(COMPUTE, CompTime, CpuCompTime);
+        GetPassTimes(TRANSFER, TransfTime, CpuTransfTime);
 
         std::stringstream values1_ss;
         values1_ss.precision(1);
         values1_ss.flags(std::ios_base::fixed);
         values1_ss << "GPU" << std::endl;
         TimeToStr(values1_ss, CurrFrameEnd - CurrFrameBegin);
-        TimeToStr(values1_ss, Curr.Graphics1.GpuTimeBegin - Prev.Graphics1.GpuTimeBegin);
+        TimeToStr(values1_ss, Curr[GRAPHICS_1].GpuBegin - Prev[GRAPHICS_1].GpuBegin);
         TimeToStr(values1_ss, Gfx1Time + Gfx2Time);
         TimeToStr(values1_ss, CompTime);
         TimeToStr(values1_ss, TransfTime);
-        ByteSizeToStr(values1_ss, m_TempCpuToGpuTransferRateMb / ElapsedTime);
+        ByteSizeToStr(values1_ss, CpuToGpuTransferRateMb);
         m_GpuCountersStr = values1_ss.str();
 
-        const auto CpuGfx1Time   = std::chrono::duration_cast<SecondsD>(Curr.Graphics1.CpuTImeEnd - Curr.Graphics1.CpuTImeBegin).count();
-        const auto CpuGfx2Time   = std::chrono::duration_cast<SecondsD>(Curr.Graphics2.CpuTImeEnd - Curr.Graphics2.CpuTImeBegin).count();
-        const auto CpuCompTime   = std::chrono::duration_cast<SecondsD>(Curr.Compute.CpuTImeEnd - Curr.Compute.CpuTImeBegin).count();
-        const auto CpuTransfTime = std::chrono::duration_cast<SecondsD>(Curr.Transfer.CpuTImeEnd - Curr.Transfer.CpuTImeBegin).count();
-        const auto CpuFrameTime  = std::chrono::duration_cast<SecondsD>(Curr.Frame.CpuTImeEnd - Curr.Frame.CpuTImeBegin).count();
-
         std::stringstream values2_ss;
         values2_ss.precision(1);
         values2_ss.flags(std::ios_base::fixed);
@@ -289,24 +218,11 @@ void Profiler::Update(double ElapsedTime)
         TimeToStr(values2_ss, CpuTransfTime);
         m_CpuCountersStr = values2_ss.str();
     }
-
-    // Clear state
-    {
-        auto& Curr = m_FrameHistory[m_FrameId];
-
-        Curr.Graphics1.Queried = false;
-        Curr.Graphics2.Queried = false;
-        Curr.Compute.Queried   = false;
-        Curr.Transfer.Queried  = false;
-        Curr.Frame.Queried     = false;
-
-        m_TempCpuToGpuTransferRateMb = 0;
-    }
 }
 
 void Profiler::UpdateUI()
 {
-    if (m_Device == nullptr)
+    if (!m_Profiler.IsInitialized())
         return;
 
     ImGui::SetNextWindowPos(ImVec2(240, 10), ImGuiCond_FirstUseEver);
@@ -401,6 +317,9 @@ void Profiler::UpdateUI()
             ImGui::SameLine(0.f, 20.f);
             ImGui::TextDisabled("%s", m_CpuCountersStr.c_str());
         }
+
+        ImGui::Separator();
+        m_Profiler.UpdateCaptureUI(TraceFileName);
     }
     ImGui::End();
 }
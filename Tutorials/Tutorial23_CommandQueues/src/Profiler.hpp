@@ -27,12 +27,13 @@
 #pragma once
 
 #include <array>
-#include <chrono>
 #include "SampleBase.hpp"
+#include "ScopeProfiler.hpp"
 
 namespace Diligent
 {
 
+// Times the passes of the sample with ScopeProfiler and shows how they overlap on the GPU
 class Profiler
 {
 public:
@@ -43,59 +44,42 @@ public:
         GRAPHICS_2,
         COMPUTE,
         TRANSFER,
+        PASS_COUNT
     };
 
-    Profiler() noexcept :
-        m_FrameId{0}
-    {}
-
     void Initialize(IRenderDevice* pDevice);
 
     void Begin(IDeviceContext* pContext, PASS_TYPE Pass);
     void End(IDeviceContext* pContext, PASS_TYPE Pass);
+    /// Adds the amount of data uploaded in the current frame
     void SetCpuToGpuTransferRate(Uint32 RateInMb);
 
     void UpdateUI();
     void Update(double ElapsedTime);
 
-private:
-    using TimePoint = std::chrono::high_resolution_clock::time_point;
-    using SecondsD  = std::chrono::duration<double>;
+    /// Captures a trace of NumFrames frames and writes it to TraceFileName.
+    /// May be called before Initialize().
+    void CaptureTrace(Uint32 NumFrames);
 
-    RefCntAutoPtr<IRenderDevice> m_Device;
+    static constexpr const char* TraceFileName = "Tutorial23_trace.json";
 
-    static constexpr Uint32 NumFramesPOT   = 3;
-    static constexpr float  UpdateInterval = 1.f / 5.f;
+private:
+    static constexpr float UpdateInterval = 1.f / 5.f;
 
-    Uint32 m_FrameId : NumFramesPOT;
-    Uint32 m_TempCpuToGpuTransferRateMb     = 0;
-    bool   m_SupportsTransferQueueProfiling = false;
+    ScopeProfiler m_Profiler;
 
-    struct PassCounters
+    // GPU times of the passes in a frame read back by the profiler, in seconds
+    struct PassTimes
     {
-        RefCntAutoPtr<IQuery> GpuTimeQueryBegin;
-        RefCntAutoPtr<IQuery> GpuTimeQueryEnd;
-
-        // time in seconds
-        double GpuTimeBegin = 0.0;
-        double GpuTimeEnd   = 0.0;
-
-        TimePoint CpuTImeBegin = {};
-        TimePoint CpuTImeEnd   = {};
-
-        bool QuerySupported = false;
-        bool Queried        = false;
+        double GpuBegin = 0.0;
+        double GpuEnd   = 0.0;
+        bool   Queried  = false;
     };
+    using FrameTimes = std::array<PassTimes, PASS_COUNT>;
 
-    struct Frame
-    {
-        PassCounters Frame;
-        PassCounters Graphics1;
-        PassCounters Graphics2;
-        PassCounters Compute;
-        PassCounters Transfer;
-    };
-    std::array<Frame, (1 << NumFramesPOT)> m_FrameHistory = {};
+    FrameTimes                     m_PrevFrame;
+    FrameTimes                     m_CurrFrame;
+    std::array<Uint32, PASS_COUNT> m_NumGpuSamples = {};
 
     struct Graph
     {
@@ -112,7 +96,8 @@ private:
     Graph  m_Graph2;
     String m_GpuCountersStr;
     String m_CpuCountersStr;
-    double m_AccumTime = 0.0;
+    double m_AccumTime               = 0.0;
+    double m_AccumCpuToGpuTransferMb = 0.0;
 };
 
 } // namespace Diligent
@@ -342,8 +342,7 @@ void Terrain::Update(IDeviceContext* pContext)
     pContext->SetPipelineState(m_GenPSO);
 
     // Terrain height and normal maps can not be transitioned here because has UNKNOWN state.
-    const auto Id = DoubleBuffering ? m_FrameId : 0;
-    pContext->CommitShaderResources(m_GenSRB[Id], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pContext->CommitShaderResources(m_GenSRB[GetUpdateTargetId()], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
     DispatchComputeAttribs dispatchAttrs;
     dispatchAttrs.ThreadGroupCountX = TexDesc.Width / m_ComputeGroupSize;
@@ -405,30 +404,19 @@ void Terrain::BeforeDraw(IDeviceContext* pContext, const SceneDrawAttribs& Attr)
         ConstData->AmbientLight  = Attr.AmbientLight;
     }
 
-    // Resources must be manually transitioned to required state.
+    // Height and normal maps are transitioned to SHADER_RESOURCE state and back by the frame graph in the graphics pass.
     // Vulkan:     the correct pipeline barrier must contains vertex and pixel shader stages which is not supported in compute context.
     // DirectX 12: height map used as non-pixel shader resource and can be transitioned in compute context,
     //             but normal map used as pixel shader resource and must be transitioned in graphics context.
-    const Uint32              Id         = DoubleBuffering ? 1 - m_FrameId : 0;
     const StateTransitionDesc Barriers[] = {
-        {m_HeightMap[Id], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE},
-        {m_NormalMap[Id], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE},
         {m_TerrainConstants[1], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE},
         {m_DrawConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE} //
     };
     pContext->TransitionResourceStates(_countof(Barriers), Barriers);
 }
 
-void Terrain::AfterDraw(IDeviceContext* pContext)
+void Terrain::AfterDraw()
 {
-    // Resources must be manually transitioned to required state.
-    const Uint32              Id         = DoubleBuffering ? 1 - m_FrameId : 0;
-    const StateTransitionDesc Barriers[] = {
-        {m_HeightMap[Id], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS},
-        {m_NormalMap[Id], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS} //
-    };
-    pContext->TransitionResourceStates(_countof(Barriers), Barriers);
-
     ++m_FrameId;
 }
 
@@ -64,10 +64,20 @@ public:
 
     void BeforeDraw(IDeviceContext* pContext, const SceneDrawAttribs& Attr);
     void Draw(IDeviceContext* pContext);
-    void AfterDraw(IDeviceContext* pContext);
+    void AfterDraw();
 
     void Recreate(IDeviceContext* pContext);
 
+    // Height and normal maps are used on the compute and graphics queues, so they are synchronized by the frame graph.
+    // Between the passes the maps are in UNORDERED_ACCESS state.
+    ITexture* GetHeightMap(Uint32 Id) const { return m_HeightMap[Id]; }
+    ITexture* GetNormalMap(Uint32 Id) const { return m_NormalMap[Id]; }
+
+    // Index of the maps that are written by the next Update()
+    Uint32 GetUpdateTargetId() const { return DoubleBuffering ? m_FrameId : 0; }
+    // Index of the maps that are read by the next Draw()
+    Uint32 GetDrawSourceId() const { return DoubleBuffering ? 1 - m_FrameId : 0; }
+
 private:
     RefCntAutoPtr<IRenderDevice> m_Device;
     Uint64                       m_ImmediateContextMask = 0;
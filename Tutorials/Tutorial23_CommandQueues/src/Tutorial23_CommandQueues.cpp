@@ -32,6 +32,7 @@
 #include "ImGuiUtils.hpp"
 #include "PlatformMisc.hpp"
 #include "ShaderMacroHelper.hpp"
+#include "CommandLineParser.hpp"
 
 namespace Diligent
 {
@@ -51,12 +52,7 @@ SampleBase* CreateSample()
 
 Tutorial23_CommandQueues::~Tutorial23_CommandQueues()
 {
-    if (m_GraphicsCtxFence)
-        m_GraphicsCtxFence->Wait(m_GraphicsCtxFenceValue);
-    if (m_ComputeCtxFence)
-        m_ComputeCtxFence->Wait(m_ComputeCtxFenceValue);
-    if (m_TransferCtxFence)
-        m_TransferCtxFence->Wait(m_TransferCtxFenceValue);
+    m_FrameGraph.WaitForIdle();
 }
 
 void Tutorial23_CommandQueues::CreatePostProcessPSO(IShaderSourceInputStreamFactory* pShaderSourceFactory)
@@ -257,26 +253,14 @@ void Tutorial23_CommandQueues::Initialize(const SampleInitInfo& InitInfo)
     m_Camera.SetMoveSpeed(5.f);
     m_Camera.SetSpeedUpScales(5.f, 10.f);
 
-    // Create fence for each context
-    const auto DevType = m_pDevice->GetDeviceInfo().Type;
-    if (DevType == RENDER_DEVICE_TYPE_D3D12 || DevType == RENDER_DEVICE_TYPE_VULKAN || DevType == RENDER_DEVICE_TYPE_METAL)
-    {
-        FenceDesc FenceCI;
-        FenceCI.Type = FENCE_TYPE_GENERAL;
-
-        FenceCI.Name = "Graphics context fence";
-        m_pDevice->CreateFence(FenceCI, &m_GraphicsCtxFence);
-
-        FenceCI.Name = "Compute context fence";
-        m_pDevice->CreateFence(FenceCI, &m_ComputeCtxFence);
-
-        if (m_TransferCtx)
-        {
-            FenceCI.Name = "Transfer context fence";
-            m_pDevice->CreateFence(FenceCI, &m_TransferCtxFence);
-        }
-    }
+    // The frame graph creates a fence for each queue
+    IDeviceContext* pQueueContexts[FrameGraph::QUEUE_COUNT] = {};
+    pQueueContexts[FrameGraph::QUEUE_GRAPHICS]              = m_pImmediateContext;
+    pQueueContexts[FrameGraph::QUEUE_COMPUTE]               = m_ComputeCtx;
+    pQueueContexts[FrameGraph::QUEUE_TRANSFER]              = m_TransferCtx;
+    m_FrameGraph.Initialize(m_pDevice, pQueueContexts);
 
+    const auto DevType = m_pDevice->GetDeviceInfo().Type;
     if (DevType == RENDER_DEVICE_TYPE_D3D11)
         m_Glow = false; // not supported
 
@@ -338,10 +322,13 @@ void Tutorial23_CommandQueues::Initialize(const SampleInitInfo& InitInfo)
         m_Profiler.Initialize(m_pDevice);
     }
 
-    // Signal first value to graphics fence.
-    // Compute and transfer contexts will wait for this fence.
-    if (m_GraphicsCtxFence)
-        m_pImmediateContext->EnqueueSignal(m_GraphicsCtxFence, ++m_GraphicsCtxFenceValue);
+    m_FrameGraphRes = RegisterFramePassResources(m_FrameGraph, m_Buildings.GetOpaqueTexAtlasDefaultState());
+
+    m_FramePassFuncs.Compute   = [this](IDeviceContext* pContext) { ComputePass(pContext); };
+    m_FramePassFuncs.Upload    = [this](IDeviceContext* pContext) { UploadPass(pContext); };
+    m_FramePassFuncs.Graphics1 = [this](IDeviceContext*) { GraphicsPass1(); };
+    m_FramePassFuncs.Graphics2 = [this](IDeviceContext*) { GraphicsPass2(); };
+
     m_pImmediateContext->Flush();
 
     if (m_ComputeCtx)
@@ -356,6 +343,18 @@ void Tutorial23_CommandQueues::Initialize(const SampleInitInfo& InitInfo)
     }
 }
 
+Tutorial23_CommandQueues::CommandLineStatus Tutorial23_CommandQueues::ProcessCommandLine(int argc, const char* const* argv)
+{
+    CommandLineParser ArgsParser{argc, argv};
+
+    // Captures a trace of the first frames, e.g. to compare queue utilization on different machines
+    int TraceFrames = 0;
+    if (ArgsParser.Parse("trace_frames", TraceFrames) && TraceFrames > 0)
+        m_Profiler.CaptureTrace(static_cast<Uint32>(TraceFrames));
+
+    return CommandLineStatus::OK;
+}
+
 void Tutorial23_CommandQueues::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs)
 {
     SampleBase::ModifyEngineInitInfo(Attribs);
@@ -442,81 +441,34 @@ void Tutorial23_CommandQueues::ModifyEngineInitInfo(const ModifyEngineInitInfoAt
     }
 }
 
-void Tutorial23_CommandQueues::ComputePass()
+void Tutorial23_CommandQueues::ComputePass(IDeviceContext* pContext)
 {
-    auto ComputeCtx = m_UseAsyncCompute ? m_ComputeCtx : m_pImmediateContext;
-
     const float DebugColor[] = {0.f, 1.f, 0.f, 1.f};
-    ComputeCtx->BeginDebugGroup("Compute pass", DebugColor);
+    pContext->BeginDebugGroup("Compute pass", DebugColor);
 
-    m_Profiler.Begin(ComputeCtx, Profiler::COMPUTE);
+    m_Profiler.Begin(pContext, Profiler::COMPUTE);
 
-    if (m_UseAsyncCompute)
-    {
-        // Wait until graphics pass finishes working with terrain height and normal maps
-        ComputeCtx->DeviceWaitForFence(m_GraphicsCtxFence, m_GraphicsCtxFenceValue);
-    }
+    m_Terrain.Update(pContext);
 
-    m_Terrain.Update(ComputeCtx);
+    m_Profiler.End(pContext, Profiler::COMPUTE);
 
-    m_Profiler.End(ComputeCtx, Profiler::COMPUTE);
-
-    ComputeCtx->EndDebugGroup(); // Compute pass
-
-    if (m_UseAsyncCompute)
-    {
-        ComputeCtx->EnqueueSignal(m_ComputeCtxFence, ++m_ComputeCtxFenceValue);
-        ComputeCtx->Flush();
-
-        if (m_Terrain.DoubleBuffering)
-        {
-            // Wait for compute queue previous pass.
-            m_pImmediateContext->DeviceWaitForFence(m_ComputeCtxFence, m_ComputeCtxFenceValue - 1);
-        }
-        else
-        {
-            // Wait for compute queue current pass.
-            m_pImmediateContext->DeviceWaitForFence(m_ComputeCtxFence, m_ComputeCtxFenceValue);
-        }
-    }
+    pContext->EndDebugGroup(); // Compute pass
 }
 
-void Tutorial23_CommandQueues::UploadPass()
+void Tutorial23_CommandQueues::UploadPass(IDeviceContext* pContext)
 {
-    const Uint32 TransferRate = GetCpuToGpuTransferRateMb();
-
-    if (m_TransferCtx == nullptr || TransferRate == 0)
-        return;
-
-    auto TransferCtx = m_UseAsyncTransfer ? m_TransferCtx : m_pImmediateContext;
-
     const float DebugColor[] = {0.f, 0.f, 1.f, 1.f};
-    TransferCtx->BeginDebugGroup("Transfer pass", DebugColor);
+    pContext->BeginDebugGroup("Transfer pass", DebugColor);
 
-    m_Profiler.Begin(TransferCtx, Profiler::TRANSFER);
-
-    if (m_UseAsyncTransfer)
-    {
-        // Wait until graphics pass finishes with m_BuildingsTexAtlas.
-        TransferCtx->DeviceWaitForFence(m_GraphicsCtxFence, m_GraphicsCtxFenceValue);
-    }
+    m_Profiler.Begin(pContext, Profiler::TRANSFER);
 
     Uint32 CpuToGpuTransferRateMb = 0;
-    m_Buildings.UpdateAtlas(TransferCtx, TransferRate, CpuToGpuTransferRateMb);
+    m_Buildings.UpdateAtlas(pContext, GetCpuToGpuTransferRateMb(), CpuToGpuTransferRateMb);
     m_Profiler.SetCpuToGpuTransferRate(CpuToGpuTransferRateMb);
 
-    m_Profiler.End(TransferCtx, Profiler::TRANSFER);
-
-    TransferCtx->EndDebugGroup(); // Transfer pass
-
-    if (m_UseAsyncTransfer)
-    {
-        TransferCtx->EnqueueSignal(m_TransferCtxFence, ++m_TransferCtxFenceValue);
-        TransferCtx->Flush();
+    m_Profiler.End(pContext, Profiler::TRANSFER);
 
-        // Wait for transfer queue
-        m_pImmediateContext->DeviceWaitForFence(m_TransferCtxFence, m_TransferCtxFenceValue);
-    }
+    pContext->EndDebugGroup(); // Transfer pass
 }
 
 void Tutorial23_CommandQueues::GraphicsPass1()
@@ -528,6 +480,7 @@ void Tutorial23_CommandQueues::GraphicsPass1()
 
     // Make all resource transitions before and after drawing.
     // Transitions and copy operations will break render pass which is slow in tile-based renderer.
+    // Terrain maps and buildings texture atlas are transitioned by the frame graph before and after the pass.
     m_Terrain.BeforeDraw(m_pImmediateContext, Attribs);
     m_Buildings.BeforeDraw(m_pImmediateContext, Attribs);
 
@@ -557,19 +510,7 @@ void Tutorial23_CommandQueues::GraphicsPass1()
         m_pImmediateContext->EndDebugGroup(); // Graphics pass 1
     }
 
-    m_Terrain.AfterDraw(m_pImmediateContext);
-    m_Buildings.AfterDraw(m_pImmediateContext);
-
-    if (m_UseAsyncCompute || m_UseAsyncTransfer)
-    {
-        // Notify compute context that graphics context finished working with terrain height and normal maps.
-        // Notify transfer context that graphics context finished working with buildings texture atlas.
-        m_pImmediateContext->EnqueueSignal(m_GraphicsCtxFence, ++m_GraphicsCtxFenceValue);
-
-        // When used double buffering compute pass may overlap with whole frame.
-        if (!m_Terrain.DoubleBuffering || m_UseAsyncTransfer)
-            m_pImmediateContext->Flush();
-    }
+    m_Terrain.AfterDraw();
 }
 
 void Tutorial23_CommandQueues::GraphicsPass2()
@@ -599,11 +540,23 @@ void Tutorial23_CommandQueues::Render()
 {
     m_Profiler.Begin(nullptr, Profiler::FRAME);
 
-    ComputePass();
-    UploadPass();
+    // Terrain maps are recreated when the terrain size changes.
+    for (Uint32 i = 0; i < 2; ++i)
+    {
+        m_FrameGraph.SetResourceTexture(m_FrameGraphRes.HeightMap[i], m_Terrain.GetHeightMap(i));
+        m_FrameGraph.SetResourceTexture(m_FrameGraphRes.NormalMap[i], m_Terrain.GetNormalMap(i));
+    }
+    m_FrameGraph.SetResourceTexture(m_FrameGraphRes.OpaqueTexAtlas, m_Buildings.GetOpaqueTexAtlas());
+
+    FramePassesAttribs Attribs;
+    Attribs.AsyncCompute    = m_UseAsyncCompute;
+    Attribs.AsyncTransfer   = m_UseAsyncTransfer;
+    Attribs.Upload          = m_TransferCtx != nullptr && GetCpuToGpuTransferRateMb() != 0;
+    Attribs.TerrainUpdateId = m_Terrain.GetUpdateTargetId();
+    Attribs.TerrainDrawId   = m_Terrain.GetDrawSourceId();
+    AddFramePasses(m_FrameGraph, m_FrameGraphRes, Attribs, m_FramePassFuncs);
 
-    GraphicsPass1();
-    GraphicsPass2();
+    m_FrameGraph.Execute();
 
     if (m_ComputeCtx)
         m_ComputeCtx->FinishFrame();
@@ -765,6 +718,13 @@ void Tutorial23_CommandQueues::UpdateUI()
                 ImGui::Checkbox("Glow", &m_Glow);
         }
 
+        // Synchronization placed by the frame graph in the last frame
+        {
+            const auto& Stats = m_FrameGraph.GetStatistics();
+            ImGui::Separator();
+            ImGui::TextDisabled("Fence waits: %u, signals: %u, barriers: %u", Stats.NumWaits, Stats.NumSignals, Stats.NumBarriers);
+        }
+
         // Idle GPU to avoid validation errors.
         if (PrevUseAsyncCompute != m_UseAsyncCompute || PrevUseAsyncTransfer != m_UseAsyncTransfer)
             m_pDevice->IdleGPU();
@@ -33,6 +33,8 @@
 #include "Terrain.hpp"
 #include "Buildings.hpp"
 #include "Profiler.hpp"
+#include "FrameGraph.hpp"
+#include "FramePasses.hpp"
 
 namespace Diligent
 {
@@ -42,6 +44,8 @@ class Tutorial23_CommandQueues final : public SampleBase
 public:
     ~Tutorial23_CommandQueues() override;
 
+    virtual CommandLineStatus ProcessCommandLine(int argc, const char* const* argv) override final;
+
     virtual void ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
     virtual void Initialize(const SampleInitInfo& InitInfo) override final;
 
@@ -58,8 +62,8 @@ private:
     void DownSample();
     void PostProcess();
 
-    void ComputePass();
-    void UploadPass();
+    void ComputePass(IDeviceContext* pContext);
+    void UploadPass(IDeviceContext* pContext);
     void GraphicsPass1();
     void GraphicsPass2();
 
@@ -90,13 +94,10 @@ private:
     RefCntAutoPtr<IDeviceContext> m_ComputeCtx; // or second graphics on mobile GPUs
     RefCntAutoPtr<IDeviceContext> m_TransferCtx;
 
-    RefCntAutoPtr<IFence> m_GraphicsCtxFence;
-    RefCntAutoPtr<IFence> m_ComputeCtxFence;
-    RefCntAutoPtr<IFence> m_TransferCtxFence;
-
-    Uint64 m_GraphicsCtxFenceValue = 0;
-    Uint64 m_ComputeCtxFenceValue  = 0;
-    Uint64 m_TransferCtxFenceValue = 0;
+    // Places fences and barriers between the passes on the graphics, compute and transfer queues
+    FrameGraph          m_FrameGraph;
+    FramePassResources  m_FrameGraphRes;
+    FramePassFuncs      m_FramePassFuncs;
 
     struct GBuffer
     {